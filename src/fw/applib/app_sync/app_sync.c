@@ -18,8 +18,54 @@
 #include "syscall/syscall.h"
 #include "system/passert.h"
 
+#include <stdalign.h>
 #include <string.h>
 
+//! The index of the current dictionary for app_sync_get() lives in the unused space at the end of
+//! the buffer, after the dictionary. AppSync is part of the app ABI so it can't hold a pointer to
+//! it, and allocating it on the app heap would take memory away from the app.
+//! If the index doesn't fit, app_sync_get() walks the dictionary instead.
+static DictionaryIndex *prv_index_location(const AppSync *s, size_t *size_out) {
+  const uintptr_t buffer_end = (uintptr_t)s->buffer + s->buffer_size;
+  const uintptr_t dict_end = (uintptr_t)s->current_iter.end;
+  const uintptr_t index_start = (dict_end + alignof(DictionaryIndex) - 1) &
+                                ~(alignof(DictionaryIndex) - 1);
+  if (dict_end < (uintptr_t)s->buffer || index_start + sizeof(DictionaryIndex) > buffer_end) {
+    return NULL;
+  }
+  *size_out = buffer_end - index_start;
+  return (DictionaryIndex *)index_start;
+}
+
+//! Call before the dictionary changes, app_sync_get() walks the dictionary until the index is
+//! rebuilt
+static void prv_invalidate_index(AppSync *s) {
+  size_t size;
+  DictionaryIndex *index = prv_index_location(s, &size);
+  if (index) {
+    index->dictionary = NULL;
+  }
+}
+
+//! Call once the dictionary changed successfully
+static void prv_rebuild_index(AppSync *s) {
+  size_t size;
+  DictionaryIndex *index = prv_index_location(s, &size);
+  if (index && !dict_index_build(&s->current_iter, index, size)) {
+    // Leave an empty index that can't be mistaken for a valid one
+    index->dictionary = NULL;
+  }
+}
+
+static const DictionaryIndex *prv_get_index(const AppSync *s) {
+  size_t size;
+  const DictionaryIndex *index = prv_index_location(s, &size);
+  if (!index || index->dictionary != s->current_iter.dictionary) {
+    return NULL;
+  }
+  return index;
+}
+
 static void delegate_errors(AppSync *s, DictionaryResult dict_result,
                             AppMessageResult app_message_result) {
   if (dict_result == DICT_OK && app_message_result == APP_MSG_OK) {
@@ -51,10 +97,16 @@ static void update_callback(DictionaryIterator *updated_iter, void *context) {
   AppSync *s = context;
   uint32_t size = s->buffer_size;
   const bool update_existing_keys_only = true;
+  // The merge moves the tuples, including while the value_changed callbacks run. It also moves
+  // the end of the dictionary, and with it the index, to the end of the buffer until it's done.
+  prv_invalidate_index(s);
   DictionaryResult result = dict_merge(&s->current_iter, &size,
                                        updated_iter,
                                        update_existing_keys_only,
                                        update_key_callback, s);
+  if (result == DICT_OK) {
+    prv_rebuild_index(s);
+  }
   delegate_errors(s, result, APP_MSG_OK);
 }
 
@@ -86,6 +138,9 @@ void app_sync_init(AppSync *s,
   uint32_t in_out_size = buffer_size;
   const DictionaryResult dict_result = dict_serialize_tuplets_to_buffer_with_iter(
     &s->current_iter, keys_and_initial_values, count, s->buffer, &in_out_size);
+  if (dict_result == DICT_OK) {
+    prv_rebuild_index(s);
+  }
   app_message_set_context(s);
   app_message_register_outbox_sent(update_callback);
   app_message_register_outbox_failed(out_failed_callback);
@@ -119,5 +174,9 @@ AppMessageResult app_sync_set(AppSync *s, const Tuplet * const updated_keys_and_
 }
 
 const Tuple * app_sync_get(const AppSync *s, const uint32_t key) {
+  const DictionaryIndex *index = prv_get_index(s);
+  if (index) {
+    return dict_index_find(index, key);
+  }
   return dict_find(&s->current_iter, key);
 }
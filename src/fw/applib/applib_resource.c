@@ -46,30 +46,43 @@ size_t applib_resource_load_byte_range(
                                  (uint32_t)h, start_offset, buffer, num_bytes);
 }
 
+void *applib_resource_mmap(ResAppNum app_num, uint32_t resource_id,
+                           size_t offset, size_t num_bytes) {
+  if (num_bytes == 0 || app_num != SYSTEM_APP) {
+    // we don't support memory-mapping for resources that don't belong to the system
+    return NULL;
+  }
+
+  size_t resource_size = 0;
+  const uint8_t *mapped_data = sys_resource_read_only_bytes(SYSTEM_APP, resource_id,
+                                                            &resource_size);
+  if (!mapped_data || (offset + num_bytes) > resource_size) {
+    return NULL;
+  }
+
+  applib_resource_track_mmapped(mapped_data);
+  return (uint8_t *)(mapped_data + offset);
+}
+
 void *applib_resource_mmap_or_load(ResAppNum app_num, uint32_t resource_id,
                                    size_t offset, size_t num_bytes, bool used_aligned) {
   if (num_bytes == 0) {
     return NULL;
   }
 
-  const uint8_t *mapped_data = (app_num == SYSTEM_APP) ?
-                               sys_resource_read_only_bytes(SYSTEM_APP, resource_id, NULL) : NULL;
-
-  uint8_t *result = NULL;
-
-  if (mapped_data) {
-    applib_resource_track_mmapped(mapped_data);
-    result = (uint8_t *)(mapped_data + offset);
-  } else {
-    // TODO: PBL-40010 clean this up
-    // we are wasting 7 bytes here so that clients of this API have the chance to
-    // align the data
-    result = applib_malloc(num_bytes + (used_aligned ? 7 : 0));
-    if (!result || sys_resource_load_range(app_num, resource_id, offset,
-                                           result, num_bytes) != num_bytes) {
-      applib_free(result);
-      return NULL;
-    }
+  uint8_t *result = applib_resource_mmap(app_num, resource_id, offset, num_bytes);
+  if (result) {
+    return result;
+  }
+
+  // TODO: PBL-40010 clean this up
+  // we are wasting 7 bytes here so that clients of this API have the chance to
+  // align the data
+  result = applib_malloc(num_bytes + (used_aligned ? 7 : 0));
+  if (!result || sys_resource_load_range(app_num, resource_id, offset,
+                                         result, num_bytes) != num_bytes) {
+    applib_free(result);
+    return NULL;
   }
 
   return result;
@@ -38,6 +38,14 @@ bool applib_resource_munmap(const void *bytes);
 //! @return true, if any remaining resources were untracked
 bool applib_resource_munmap_all();
 
+//! Tries to memory-map a range of a resource without falling back to loading it into RAM.
+//! Only system resources living in builtin or memory-mappable flash storage can be mapped and
+//! only if the whole range [offset, offset + num_bytes) lies within the resource.
+//! The returned pointer is tracked and must be released with \ref applib_resource_munmap().
+//! @return NULL, if the resource range couldn't be memory-mapped
+void *applib_resource_mmap(ResAppNum app_num, uint32_t resource_id,
+                           size_t offset, size_t num_bytes);
+
 //! Tries to load a resource as memory-mapped data. If this isn't supported on the system
 //! or for a given resource if will try to allocate data and load it into RAM instead.
 //! Have a look at \ref resource_load_byte_range_system for the discussion of arguments
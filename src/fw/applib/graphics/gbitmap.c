@@ -465,7 +465,8 @@ static bool prv_init_with_pbi_data(GBitmap *bitmap, uint8_t *data, size_t data_s
   return true;
 }
 
-bool gbitmap_init_with_resource_system(GBitmap* bitmap, ResAppNum app_num, uint32_t resource_id) {
+static bool prv_init_with_resource_system(GBitmap *bitmap, ResAppNum app_num,
+                                          uint32_t resource_id, bool *is_png_out) {
   if (!bitmap) {
     return false;
   }
@@ -480,6 +481,9 @@ bool gbitmap_init_with_resource_system(GBitmap* bitmap, ResAppNum app_num, uint3
 
   // Scan the resource data to see if it contains PNG data
   if (gbitmap_png_data_is_png(data, data_size)) {
+    if (is_png_out) {
+      *is_png_out = true;
+    }
     const bool result = gbitmap_init_with_png_data(bitmap, data, data_size);
     // the actual pixels live uncompressed on the heap now, we can free the PNG data
     applib_resource_munmap_or_free(data);
@@ -501,6 +505,73 @@ bool gbitmap_init_with_resource_system(GBitmap* bitmap, ResAppNum app_num, uint3
   }
 }
 
+bool gbitmap_init_with_resource_system(GBitmap* bitmap, ResAppNum app_num, uint32_t resource_id) {
+  return prv_init_with_resource_system(bitmap, app_num, resource_id, NULL);
+}
+
+//! Serializes a bitmap that was decoded from a PNG back into the PBI format and hands it to the
+//! bitmap cache.
+static void prv_store_in_bitmap_cache(const GBitmap *bitmap, ResAppNum app_num,
+                                      uint32_t resource_id) {
+  const GBitmapFormat format = bitmap->info.format;
+  const size_t pixel_data_bytes = bitmap->row_size_bytes * bitmap->bounds.size.h;
+  const size_t palette_bytes = gbitmap_get_palette_size(format) * sizeof(GColor);
+  const size_t data_size = offsetof(BitmapData, data) + pixel_data_bytes + palette_bytes;
+
+  BitmapData *pbi = applib_malloc(data_size);
+  if (!pbi) {
+    return;
+  }
+
+  *pbi = (BitmapData) {
+    .row_size_bytes = bitmap->row_size_bytes,
+    .width = bitmap->bounds.size.w,
+    .height = bitmap->bounds.size.h,
+  };
+  // Only the format and version are meaningful once the bitmap has been serialized, the heap
+  // allocation flags get recomputed when the data is loaded again
+  const BitmapInfo info = {
+    .format = format,
+    .version = bitmap->info.version,
+  };
+  memcpy(&pbi->info_flags, &info, sizeof(pbi->info_flags));
+  memcpy(pbi->data, bitmap->addr, pixel_data_bytes);
+  if (palette_bytes) {
+    memcpy(pbi->data + pixel_data_bytes, bitmap->palette, palette_bytes);
+  }
+
+  sys_bitmap_cache_store(app_num, resource_id, (const uint8_t *)pbi, data_size);
+  applib_free(pbi);
+}
+
+GBitmap *gbitmap_create_with_resource_system_cached(ResAppNum app_num, uint32_t resource_id) {
+  GBitmap *bitmap = prv_allocate_gbitmap();
+  if (!bitmap) {
+    return NULL;
+  }
+
+  size_t cached_size;
+  uint8_t *data = sys_bitmap_cache_load(app_num, resource_id, &cached_size);
+  if (data) {
+    if (prv_init_with_pbi_data(bitmap, data, cached_size, false /* is_builtin */)) {
+      return bitmap;
+    }
+    applib_free(data);
+  }
+
+  // Cache miss, decode the resource and remember the result if that was expensive
+  bool is_png = false;
+  if (!prv_init_with_resource_system(bitmap, app_num, resource_id, &is_png)) {
+    applib_free(bitmap);
+    return NULL;
+  }
+  if (is_png) {
+    prv_store_in_bitmap_cache(bitmap, app_num, resource_id);
+  }
+
+  return bitmap;
+}
+
 uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
   if (!bitmap) {
     return 0;
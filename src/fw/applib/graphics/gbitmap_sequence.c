@@ -22,6 +22,7 @@
 #include "util/time/time.h"
 #include "applib/app_logging.h"
 #include "applib/applib_malloc.auto.h"
+#include "applib/applib_resource_private.h"
 #include "syscall/syscall.h"
 #include "system/passert.h"
 #include "util/bitset.h"
@@ -102,17 +103,12 @@ GBitmapSequence *gbitmap_sequence_create_with_resource_system(ResAppNum app_num,
   }
   int32_t frame_bytes = bitmap_sequence->png_decoder_data.read_cursor;
 
-  frame_data_buffer = applib_zalloc(frame_bytes);
+  // System APNGs on memory-mappable flash are decoded straight from flash
+  frame_data_buffer = applib_resource_mmap_or_load(app_num, resource_id, 0, frame_bytes, false);
   if (frame_data_buffer == NULL) {
     goto cleanup;
   }
 
-  const size_t bytes_read = sys_resource_load_range(app_num, resource_id,
-                                                    0, frame_data_buffer, frame_bytes);
-  if (bytes_read != (size_t)frame_bytes) {
-    goto cleanup;
-  }
-
   upng_t *upng = upng_create();
   if (upng == NULL) {
     goto cleanup;
@@ -158,7 +154,9 @@ GBitmapSequence *gbitmap_sequence_create_with_resource_system(ResAppNum app_num,
   bitmap_sequence->header_loaded = true;
 
 cleanup:
-  applib_free(frame_data_buffer);  // Free compressed image buffer
+  if (frame_data_buffer) {
+    applib_resource_munmap_or_free(frame_data_buffer);  // Free compressed image buffer
+  }
 
   if (!bitmap_sequence || !bitmap_sequence->header_loaded) {
     APP_LOG(APP_LOG_LEVEL_ERROR, APNG_LOAD_ERROR);
@@ -255,17 +253,10 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
     goto cleanup;
   }
 
-  buffer = applib_zalloc(metadata_bytes);
-  if (buffer == NULL) {
-    goto cleanup;
-  }
-
   ResAppNum app_num = sys_get_current_resource_num();
-  const size_t bytes_read = sys_resource_load_range(
-      app_num, bitmap_sequence->resource_id,
-      png_decoder_data->read_cursor, buffer, metadata_bytes);
-
-  if (bytes_read != (size_t)metadata_bytes) {
+  buffer = applib_resource_mmap_or_load(app_num, bitmap_sequence->resource_id,
+                                        png_decoder_data->read_cursor, metadata_bytes, false);
+  if (buffer == NULL) {
     goto cleanup;
   }
 
@@ -278,7 +269,8 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
             (upng_state == UPNG_ENOMEM) ? APNG_MEMORY_ERROR : APNG_DECODE_ERROR);
     goto cleanup;
   }
-  applib_free(buffer);
+  applib_resource_munmap_or_free(buffer);
+  buffer = NULL;
 
   bitmap_sequence->current_frame++;
 
@@ -402,7 +394,9 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
 cleanup:
   if (!retval) {
     APP_LOG(APP_LOG_LEVEL_ERROR, APNG_UPDATE_ERROR);
-    applib_free(buffer);
+    if (buffer) {
+      applib_resource_munmap_or_free(buffer);
+    }
   }
 
   return retval;
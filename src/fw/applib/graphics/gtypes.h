@@ -1062,6 +1062,12 @@ GBitmap* gbitmap_create_with_resource(uint32_t resource_id);
 //! @internal
 GBitmap *gbitmap_create_with_resource_system(ResAppNum app_num, uint32_t resource_id);
 
+//! @internal
+//! Same as \ref gbitmap_create_with_resource_system but PNG resources are only decoded once, the
+//! decoded bitmap is stored in the bitmap cache and loaded from there afterwards.
+//! Meant for static images that get loaded over and over again, such as app icons.
+GBitmap *gbitmap_create_with_resource_system_cached(ResAppNum app_num, uint32_t resource_id);
+
 //! @internal
 //! @see gbitmap_init_with_resource
 //! @param app_num The app's resource bank number
@@ -717,9 +717,188 @@ static void prv_apply_orphan_state(const OrphanLineState *state, Line *line) {
   line->width_px = state->width_px;
 }
 
+////////////////////////////////////////////////////////////
+// Line start checkpoints
+
+//! Used to record and resume from the checkpoints while walking the lines of the text being drawn
+typedef struct {
+  TextDrawState *text_draw_state;
+  //! Whether the context's checkpoints belong to the text being drawn
+  bool is_matching;
+  uint16_t line_index;
+  int16_t max_line_width_px;
+} CheckpointWalkState;
+
+void text_draw_state_free_checkpoints(TextDrawState *text_draw_state) {
+  applib_free(text_draw_state->checkpoints);
+  text_draw_state->checkpoints = NULL;
+}
+
+static bool prv_checkpoints_can_be_used(GContext *ctx, TextLayout *layout) {
+  const TextBoxParams *text_box = &ctx->text_draw_state.text_box;
+  const TextLayoutFlowData *flow_data = graphics_text_layout_get_flow_data(layout);
+  // Paging and perimeters depend on where the text box is on screen, not only on the text
+  const bool uses_paging = flow_data->paging.page_on_screen.size_h != 0;
+  const bool uses_perimeter = flow_data->perimeter.impl != NULL;
+  const size_t text_length = text_box->utf8_bounds->end - text_box->utf8_bounds->start;
+  return (!uses_paging && !uses_perimeter && (prv_get_line_height(text_box) > 0) &&
+          (text_length <= UINT16_MAX));
+}
+
+static uint32_t prv_text_hash(const TextBoxParams *text_box) {
+  const Utf8Bounds *utf8_bounds = text_box->utf8_bounds;
+  return hash(utf8_bounds->start, utf8_bounds->end - utf8_bounds->start);
+}
+
+static bool prv_checkpoints_match(TextDrawState *text_draw_state) {
+  TextLayoutCheckpoints *checkpoints = text_draw_state->checkpoints;
+  const TextBoxParams *text_box = &text_draw_state->text_box;
+  const Utf8Bounds *utf8_bounds = text_box->utf8_bounds;
+  // Only hash the text once everything else matches, most draws are of a different text
+  if (!checkpoints ||
+      checkpoints->stride == 0 ||
+      checkpoints->text != utf8_bounds->start ||
+      checkpoints->text_length != (utf8_bounds->end - utf8_bounds->start) ||
+      !gsize_equal(&checkpoints->box_size, &text_box->box.size) ||
+      checkpoints->font != text_box->font ||
+      checkpoints->overflow_mode != text_box->overflow_mode ||
+      checkpoints->line_spacing_delta != text_box->line_spacing_delta) {
+    return false;
+  }
+  // The text was already hashed when it was drawn earlier in this frame
+  if (text_draw_state->frame_id != 0 &&
+      checkpoints->text_verified_frame_id == text_draw_state->frame_id) {
+    return true;
+  }
+  if (checkpoints->text_hash != prv_text_hash(text_box)) {
+    return false;
+  }
+  checkpoints->text_verified_frame_id = text_draw_state->frame_id;
+  return true;
+}
+
+static void prv_checkpoint_walk_init(GContext *ctx, CheckpointWalkState *walk) {
+  TextDrawState *text_draw_state = &ctx->text_draw_state;
+  *walk = (CheckpointWalkState) {
+    .text_draw_state = text_draw_state,
+    .is_matching = prv_checkpoints_match(text_draw_state),
+  };
+}
+
+//! Moves the line and word iterators to the last checkpoint above the clip box. Lines above
+//! that checkpoint would not have been rendered, so there is no need to walk them.
+static void prv_resume_from_checkpoint(GContext *ctx, TextLayout *layout,
+                                       CheckpointWalkState *walk) {
+  if (!walk->is_matching) {
+    return;
+  }
+
+  const TextBoxParams *text_box = &ctx->text_draw_state.text_box;
+  const TextLayoutCheckpoints *checkpoints = ctx->text_draw_state.checkpoints;
+  Line *line = &ctx->text_draw_state.line;
+  const int16_t line_height = prv_get_line_height(text_box);
+  const int32_t clip_box_min_y = ctx->draw_state.clip_box.origin.y;
+
+  const TextLayoutCheckpoint *resume_at = NULL;
+  for (int i = 0; i < checkpoints->num_checkpoints; i++) {
+    const TextLayoutCheckpoint *checkpoint = &checkpoints->checkpoints[i];
+    // The descender of the line above the checkpoint reaches into the checkpoint's line
+    const int32_t line_min_y = line->origin.y + (checkpoint->line_index * line_height);
+    if (line_min_y + TEXT_LINE_DESCENDER_LINE(line) > clip_box_min_y) {
+      break;
+    }
+    resume_at = checkpoint;
+  }
+  if (!resume_at) {
+    return;
+  }
+
+  utf8_t *text = text_box->utf8_bounds->start;
+  WordIterState *word_iter_state = &ctx->text_draw_state.line_iter_state.word_iter_state;
+  word_iter_state->current = (Word) {
+    .start = text + resume_at->word_start_offset,
+    .end = text + resume_at->word_end_offset,
+    .width_px = resume_at->word_width_px,
+  };
+  line->origin.y += resume_at->line_index * line_height;
+
+  walk->line_index = resume_at->line_index;
+  walk->max_line_width_px = resume_at->max_line_width_px;
+  if (layout) {
+    layout->max_used_size.w = MAX(layout->max_used_size.w, resume_at->max_line_width_px);
+  }
+}
+
+//! Called at the start of every line after the first one
+static void prv_record_checkpoint(CheckpointWalkState *walk, const TextBoxParams *text_box,
+                                  const Word *word) {
+  TextLayoutCheckpoints *checkpoints = walk->text_draw_state->checkpoints;
+  if (!walk->is_matching) {
+    // Short texts that never get this far don't evict the checkpoints of another long text
+    if (walk->line_index != TEXT_LAYOUT_CHECKPOINT_MIN_STRIDE) {
+      return;
+    }
+    if (!checkpoints) {
+      // Only contexts that draw long texts pay for the checkpoints, drawing works without them
+      checkpoints = applib_malloc(sizeof(TextLayoutCheckpoints));
+      if (!checkpoints) {
+        return;
+      }
+      walk->text_draw_state->checkpoints = checkpoints;
+    }
+    const Utf8Bounds *utf8_bounds = text_box->utf8_bounds;
+    *checkpoints = (TextLayoutCheckpoints) {
+      .text = utf8_bounds->start,
+      .text_hash = prv_text_hash(text_box),
+      .text_verified_frame_id = walk->text_draw_state->frame_id,
+      .text_length = utf8_bounds->end - utf8_bounds->start,
+      .box_size = text_box->box.size,
+      .font = text_box->font,
+      .overflow_mode = text_box->overflow_mode,
+      .line_spacing_delta = text_box->line_spacing_delta,
+      .stride = TEXT_LAYOUT_CHECKPOINT_MIN_STRIDE,
+    };
+    walk->is_matching = true;
+  }
+
+  if ((walk->line_index % checkpoints->stride) != 0 || !word->start || !word->end) {
+    return;
+  }
+  const int num_checkpoints = checkpoints->num_checkpoints;
+  if (num_checkpoints > 0 &&
+      checkpoints->checkpoints[num_checkpoints - 1].line_index >= walk->line_index) {
+    return;
+  }
+
+  if (num_checkpoints == TEXT_LAYOUT_NUM_CHECKPOINTS) {
+    if (checkpoints->stride >= TEXT_LAYOUT_CHECKPOINT_MAX_STRIDE) {
+      return;
+    }
+    // Keep every other checkpoint, spreading them over twice as many lines
+    for (int i = 0; i < TEXT_LAYOUT_NUM_CHECKPOINTS / 2; i++) {
+      checkpoints->checkpoints[i] = checkpoints->checkpoints[(2 * i) + 1];
+    }
+    checkpoints->num_checkpoints = TEXT_LAYOUT_NUM_CHECKPOINTS / 2;
+    checkpoints->stride *= 2;
+    if ((walk->line_index % checkpoints->stride) != 0) {
+      return;
+    }
+  }
+
+  const utf8_t *text = text_box->utf8_bounds->start;
+  checkpoints->checkpoints[checkpoints->num_checkpoints++] = (TextLayoutCheckpoint) {
+    .line_index = walk->line_index,
+    .word_start_offset = word->start - text,
+    .word_end_offset = word->end - text,
+    .word_width_px = word->width_px,
+    .max_line_width_px = walk->max_line_width_px,
+  };
+}
+
 //! Iterate over lines in the text box
 static inline void prv_walk_lines_down(Iterator* const line_iter, TextLayout* const layout,
-                                       WalkLinesCallbacks* const callbacks) {
+                                       WalkLinesCallbacks* const callbacks,
+                                       CheckpointWalkState* const checkpoint_walk) {
   LineIterState* line_iter_state = (LineIterState*) line_iter->state;
   GContext* ctx = line_iter_state->ctx;
   const GSize ctx_size = graphics_context_get_framebuffer_size(ctx);
@@ -834,6 +1013,10 @@ render_line: {} // this {} is just an empty statement that both C and our linter
     if (callbacks->layout_update_cb) {
       callbacks->layout_update_cb(layout, line, text_box_params);
     }
+    if (checkpoint_walk) {
+      checkpoint_walk->max_line_width_px = MAX(checkpoint_walk->max_line_width_px,
+                                               line->width_px);
+    }
 
     if (callbacks->stop_condition_cb) {
       if (callbacks->stop_condition_cb(ctx, line, text_box_params)) {
@@ -847,6 +1030,11 @@ render_line: {} // this {} is just an empty statement that both C and our linter
 
     // Shouldn't have rendered the line if there was insufficient space
     PBL_ASSERTN(iter_next(line_iter));
+
+    if (checkpoint_walk) {
+      checkpoint_walk->line_index++;
+      prv_record_checkpoint(checkpoint_walk, text_box_params, current_word_ref);
+    }
   }
 }
 
@@ -1013,7 +1201,8 @@ static bool prv_text_layout_is_fresh(TextLayout* layout, GFont const font, const
 }
 
 static inline void prv_text_walk_lines(GContext* ctx, TextLayout* const layout,
-                                       WalkLinesCallbacks* callbacks) {
+                                       WalkLinesCallbacks* callbacks,
+                                       CheckpointWalkState* checkpoint_walk) {
 
   TextBoxParams *text_box = &ctx->text_draw_state.text_box;
 
@@ -1048,7 +1237,11 @@ static inline void prv_text_walk_lines(GContext* ctx, TextLayout* const layout,
   Iterator line_iter;
   line_iter_init(&line_iter, &ctx->text_draw_state.line_iter_state, ctx);
 
-  prv_walk_lines_down(&line_iter, layout, callbacks);
+  if (checkpoint_walk) {
+    prv_resume_from_checkpoint(ctx, layout, checkpoint_walk);
+  }
+
+  prv_walk_lines_down(&line_iter, layout, callbacks, checkpoint_walk);
 }
 
 static void prv_graphics_text_layout_update(GContext* ctx, const char* text, GFont const font,
@@ -1093,7 +1286,7 @@ static void prv_graphics_text_layout_update(GContext* ctx, const char* text, GFo
     .line_spacing_delta = line_spacing_delta,
   };
 
-  prv_text_walk_lines(ctx, layout, &callbacks);
+  prv_text_walk_lines(ctx, layout, &callbacks, NULL);
 }
 
 // helper macro to avoid source code duplication
@@ -1187,7 +1380,13 @@ void graphics_draw_text(GContext* ctx, const char* text, GFont const font,
     .line_spacing_delta = line_spacing_delta,
   };
 
-  prv_text_walk_lines(ctx, layout, &callbacks);
+  CheckpointWalkState checkpoint_walk;
+  const bool use_checkpoints = prv_checkpoints_can_be_used(ctx, layout);
+  if (use_checkpoints) {
+    prv_checkpoint_walk_init(ctx, &checkpoint_walk);
+  }
+
+  prv_text_walk_lines(ctx, layout, &callbacks, use_checkpoints ? &checkpoint_walk : NULL);
 }
 
 void graphics_text_layout_cache_init(GTextLayoutCacheRef* layout) {
@@ -92,12 +92,77 @@ typedef struct {
   WordIterState word_iter_state;
 } LineIterState;
 
+//! Number of line start checkpoints kept for the last long text drawn into a GContext
+#define TEXT_LAYOUT_NUM_CHECKPOINTS 8
+//! Number of lines between checkpoints, doubles whenever all checkpoints are taken
+#define TEXT_LAYOUT_CHECKPOINT_MIN_STRIDE 4
+#define TEXT_LAYOUT_CHECKPOINT_MAX_STRIDE 1024
+
+//! State of the line iterator at the start of a line, walking the lines can resume from here
+//! instead of starting over at the top of the text
+typedef struct {
+  uint16_t line_index;
+  //! Current word of the word iterator, offsets are in bytes from the start of the text
+  uint16_t word_start_offset;
+  uint16_t word_end_offset;
+  int16_t word_width_px;
+  //! Width of the widest line above the checkpoint
+  int16_t max_line_width_px;
+} TextLayoutCheckpoint;
+
+//! Periodic line start checkpoints of a long text, so that drawing the bottom of a scrolled text
+//! doesn't have to break all the lines above the clip box again
+typedef struct {
+  //! The checkpoints are only valid as long as these parameters haven't changed
+  const utf8_t *text;
+  uint32_t text_hash;
+  //! The frame in which text_hash was last found to match, drawing the same text again in that
+  //! frame doesn't hash it again. See text_draw_state_begin_frame()
+  uint32_t text_verified_frame_id;
+  uint16_t text_length;
+  GSize box_size;
+  GFont font;
+  GTextOverflowMode overflow_mode;
+  int16_t line_spacing_delta;
+
+  uint16_t stride;
+  uint8_t num_checkpoints;
+  TextLayoutCheckpoint checkpoints[TEXT_LAYOUT_NUM_CHECKPOINTS];
+} TextLayoutCheckpoints;
+
 typedef struct {
   TextBoxParams text_box;
   Line line;
   LineIterState line_iter_state;
+  //! Allocated with applib_malloc the first time a text longer than
+  //! TEXT_LAYOUT_CHECKPOINT_MIN_STRIDE lines is drawn into the context, NULL until then. This
+  //! costs sizeof(TextLayoutCheckpoints), 112 bytes on the watch, of the app heap for app contexts.
+  //! Apps that only draw short texts never pay for it and if the allocation fails the text is
+  //! drawn without checkpoints.
+  TextLayoutCheckpoints *checkpoints;
+  //! Identifies the frame being rendered, 0 while no frame is being rendered
+  uint32_t frame_id;
+  uint32_t last_frame_id;
 } TextDrawState;
 
+//! Frees the line start checkpoints of a GContext that is about to be re-initialized
+void text_draw_state_free_checkpoints(TextDrawState *text_draw_state);
+
+//! Marks the start of rendering a frame into the context. Until text_draw_state_end_frame(), the
+//! text buffers drawn are expected not to change, so a text that is drawn more than once only
+//! gets hashed the first time.
+static inline void text_draw_state_begin_frame(TextDrawState *text_draw_state) {
+  text_draw_state->last_frame_id++;
+  if (text_draw_state->last_frame_id == 0) {
+    text_draw_state->last_frame_id++;
+  }
+  text_draw_state->frame_id = text_draw_state->last_frame_id;
+}
+
+static inline void text_draw_state_end_frame(TextDrawState *text_draw_state) {
+  text_draw_state->frame_id = 0;
+}
+
 void char_iter_init(Iterator* char_iter, CharIterState* char_iter_state, const TextBoxParams* const text_box_params, utf8_t* start);
 void word_iter_init(Iterator* word_iter, WordIterState* word_iter_state, GContext* ctx, const TextBoxParams* const text_box_params, utf8_t* start);
 void line_iter_init(Iterator* line_iter, LineIterState* line_iter_state, GContext* ctx);
@@ -32,6 +32,8 @@
 #include "util/math.h"
 #include "util/string.h"
 
+#include <math.h>
+
 #define DEBUG_ROCKY_APPMESSAGE 1
 #if DEBUG_ROCKY_APPMESSAGE
 #define DBG(fmt, ...) PBL_LOG(LOG_LEVEL_DEBUG, fmt, ## __VA_ARGS__)
@@ -70,13 +72,21 @@ typedef struct {
   uint8_t data[0];
 } MessageNode;
 
+//! An object, serialized either as a zero-terminated JSON string or in the binary encoding.
+typedef struct {
+  uint8_t *data;
+  //! Size of the data in bytes, including the zero terminator of a JSON string.
+  uint32_t size_bytes;
+  bool is_binary;
+} SerializedObject;
+
 typedef struct OutgoingObject {
   ListNode node;
 
-  //! Working buffer containing the JSON string respresentation of the object.
-  char *data_buffer;
+  //! Working buffer containing the serialized representation of the object.
+  SerializedObject serialized;
 
-  //! The next offset in bytes, into the JSON string (excluding the PostMessageChunkPayload
+  //! The next offset in bytes, into the serialized object (excluding the PostMessageChunkPayload
   //! header) that the next chunk's payload will start at.
   uint32_t offset_bytes;
 } OutgoingObject;
@@ -135,13 +145,16 @@ static void prv_awaiting_reset_complete_remote_initiated_enter(void);
 static void prv_awaiting_reset_complete_local_initiated__enter(bool should_send_reset_request);
 static void prv_send_reset_request(void);
 static void prv_session_open__after_exit(void);
-static void prv_object_queue_pop_head_and_emit_error_event_and_own_json_buffer(void);
+static void prv_object_queue_pop_head_and_emit_error_event(void);
 static void prv_start_session_closed_object_queue_timer(void);
 static void prv_stop_session_closed_object_queue_timer(void);
 
 static bool prv_is_outbox_busy(void);
 static void prv_outbox_try_send_next(void);
-T_STATIC jerry_value_t prv_json_parse(const char *object);
+static bool prv_is_binary_encoding_negotiated(void);
+static jerry_value_t prv_serialize(jerry_value_t value, bool is_binary,
+                                   SerializedObject *serialized_out);
+static jerry_value_t prv_deserialize(const SerializedObject *serialized);
 
 ////////////////////////////////////////////////////////////////////////////////
 // Comm Session Handling
@@ -187,20 +200,24 @@ static void prv_handle_comm_session_event(PebbleEvent *e, void *unused) {
 
 static void prv_object_queue_send_current_chunk(void);
 
-static void prv_object_queue_pop_head(bool should_free_data_buffer) {
+static void prv_free_outgoing_object(OutgoingObject *obj) {
+  task_free(obj->serialized.data);
+  task_free(obj);
+}
+
+static void prv_object_queue_pop_head(bool should_free_object) {
   OutgoingObject *obj = s_state.out.object_queue;
   list_remove((ListNode *)obj, (ListNode **)&s_state.out.object_queue, NULL);
 
-  if (should_free_data_buffer) {
-    task_free(obj->data_buffer);
+  if (should_free_object) {
+    prv_free_outgoing_object(obj);
   }
-  task_free(obj);
 }
 
 static void prv_calc_current_chunk_size(size_t *out_bytes_remaining,
                                          size_t *out_chunk_payload_size) {
   OutgoingObject *obj = s_state.out.object_queue;
-  const size_t bytes_remaining = strlen(obj->data_buffer + obj->offset_bytes) + 1;
+  const size_t bytes_remaining = obj->serialized.size_bytes - obj->offset_bytes;
   *out_bytes_remaining = bytes_remaining;
   *out_chunk_payload_size = MIN(bytes_remaining, s_state.tx_chunk_size_bytes);
 }
@@ -215,16 +232,48 @@ static void prv_object_queue_handle_chunk_sent(void) {
   const bool is_object_complete = (sent_chunk_payload_size == bytes_remaining_before_sent_chunk);
   if (is_object_complete) {
     DBG("Object Send Complete.");
-    prv_object_queue_pop_head(true /* should_free_data_buffer */);
+    prv_object_queue_pop_head(true /* should_free_object */);
   } else {
     OutgoingObject * const obj = s_state.out.object_queue;
     obj->offset_bytes += sent_chunk_payload_size;
   }
 }
 
+//! Objects are serialized for the protocol version of the session that was open when they got
+//! posted. Re-serializes the object if the session that is open now uses another encoding.
+static bool prv_object_convert_for_session(OutgoingObject *obj) {
+  const bool is_binary = prv_is_binary_encoding_negotiated();
+  if (obj->offset_bytes != 0 || obj->serialized.is_binary == is_binary) {
+    return true;
+  }
+
+  JS_VAR value = prv_deserialize(&obj->serialized);
+  if (jerry_value_has_error_flag(value)) {
+    rocky_error_print(value);
+    return false;
+  }
+  SerializedObject converted;
+  JS_VAR result = prv_serialize(value, is_binary, &converted);
+  if (jerry_value_has_error_flag(result)) {
+    rocky_error_print(result);
+    return false;
+  }
+  task_free(obj->serialized.data);
+  obj->serialized = converted;
+  return true;
+}
+
 static void prv_object_queue_send_current_chunk(void) {
   PBL_ASSERTN(s_state.out.object_queue);
 
+  if (!prv_object_convert_for_session(s_state.out.object_queue)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Dropping Message.");
+    prv_object_queue_pop_head_and_emit_error_event();
+    // The error event handlers might have posted (and started sending) another object already:
+    prv_outbox_try_send_next();
+    return;
+  }
+
   DictionaryIterator *it = NULL;
   app_message_outbox_begin(&it);
   if (!it) {
@@ -248,8 +297,7 @@ static void prv_object_queue_send_current_chunk(void) {
     .length = tuple_data_length,
   };
 
-  // Write the PostMessageChunkPayload header into obj->data_buffer (overwriting part of the JSON
-  // string that has been sent out):
+  // Write the PostMessageChunkPayload header into the outbox:
   const bool is_first = (obj->offset_bytes == 0);
   PostMessageChunkPayload *next_chunk =
       (PostMessageChunkPayload *) it->dictionary->head->value[0].data;
@@ -264,8 +312,8 @@ static void prv_object_queue_send_current_chunk(void) {
       .continuation_is_first = false,
     };
   }
-  // Copy the JSON fragment:
-  memcpy(next_chunk->chunk_data, &obj->data_buffer[obj->offset_bytes], payload_size);
+  // Copy the fragment of the serialized object:
+  memcpy(next_chunk->chunk_data, &obj->serialized.data[obj->offset_bytes], payload_size);
 
   // Move the cursor just like a dict_write_data() call would.
   // app_message_outbox_send() is expecting this!
@@ -351,12 +399,17 @@ static bool prv_handle_chunk_received(Tuple *tuple) {
   const bool is_last_chunk = (s_state.in.received_size_bytes == s_state.in.total_size_bytes);
   if (is_last_chunk) {
     if (rocky_global_has_event_handlers(ROCKY_EVENT_MESSAGE)) {
-      // Last chunk MUST be zero terminated:
-      if (s_state.in.reassembly_buffer[s_state.in.total_size_bytes - 1] != '\0') {
+      const SerializedObject received = {
+        .data = s_state.in.reassembly_buffer,
+        .size_bytes = s_state.in.total_size_bytes,
+        .is_binary = prv_is_binary_encoding_negotiated(),
+      };
+      // Last chunk MUST be zero terminated when receiving a JSON string:
+      if (!received.is_binary && received.data[received.size_bytes - 1] != '\0') {
         PBL_LOG(LOG_LEVEL_ERROR, "Last Chunk MUST be zero-terminated! Dropping msg.");
       } else {
-        // Try to parse the received JSON string:
-        JS_VAR object = prv_json_parse((const char *)s_state.in.reassembly_buffer);
+        // Try to deserialize the received object:
+        JS_VAR object = prv_deserialize(&received);
         if (jerry_value_has_error_flag(object)) {
           rocky_error_print(object);
         } else {
@@ -477,7 +530,7 @@ static void prv_handle_outbox_result(AppMessageResult reason) {
       } else {
         if (s_state.out.failure_count >= CHUNK_MESSAGE_MAX_FAILURES) {
           APP_LOG(APP_LOG_LEVEL_WARNING, "Dropping Message.");
-          prv_object_queue_pop_head_and_emit_error_event_and_own_json_buffer();
+          prv_object_queue_pop_head_and_emit_error_event();
         } else {
           // Retry happens below by calling prv_object_queue_send_current_chunk()
         }
@@ -820,6 +873,494 @@ T_STATIC jerry_value_t prv_json_parse(const char *object) {
   return prv_call_json_function(GLOBAL_JSON_PARSE, &string_obj, 1);
 }
 
+static jerry_value_t prv_create_oom_error(void) {
+  return rocky_error_oom("can't postMessage() -- object too large");
+}
+
+static jerry_value_t prv_create_not_jsonable_error(void) {
+  return rocky_error_unexpected_type(0, "JSON.stringify()-able object");
+}
+
+static jerry_value_t prv_create_malformed_error(void) {
+  return rocky_error_argument_invalid("Malformed postMessage() object");
+}
+
+static jerry_value_t prv_json_serialize(jerry_value_t value, SerializedObject *serialized_out) {
+  JS_VAR json_string = prv_json_stringify(value);
+  if (jerry_value_has_error_flag(json_string)) {
+    return jerry_acquire_value(json_string);
+  }
+  if (jerry_value_is_undefined(json_string)) {
+    // ECMA v5.1, 15.12.3, Note 5: Values that do not have a JSON representation (such as undefined
+    // and functions) do not produce a String. Instead they produce the undefined value.
+    return prv_create_not_jsonable_error();
+  }
+
+  const uint32_t str_size = jerry_get_utf8_string_size(json_string) + 1 /* trailing zero */;
+  uint8_t *const data = task_zalloc(str_size);
+  if (!data) {
+    return prv_create_oom_error();
+  }
+  jerry_string_to_utf8_char_buffer(json_string, data, str_size);
+
+  *serialized_out = (SerializedObject) {
+    .data = data,
+    .size_bytes = str_size,
+    .is_binary = false,
+  };
+  return jerry_create_undefined();
+}
+
+//////////////////////////////////////////////////
+// Binary encoding, see PostMessageValueType
+
+//! Capacity of the encoder buffer after the first allocation, doubles every time it runs out
+#define BINARY_ENCODER_MIN_CAPACITY_BYTES (64)
+
+typedef struct {
+  uint8_t *buffer;
+  size_t size_bytes;
+  size_t capacity_bytes;
+  //! Objects with another prototype than this (or null) are encoded as JSON, because they might
+  //! serialize differently than plain objects do (think of Date or Number objects).
+  jerry_value_t object_prototype;
+  //! Name of the method with which objects can customize their JSON representation.
+  jerry_value_t to_json_name;
+  //! Set when a string couldn't be written, because it contains U+0000 which the engine won't
+  //! copy out as UTF-8. The value that contains the string gets encoded as JSON instead.
+  bool is_json_required;
+} BinaryEncoder;
+
+static bool prv_encoder_reserve(BinaryEncoder *encoder, size_t num_bytes) {
+  const size_t required_bytes = encoder->size_bytes + num_bytes;
+  if (required_bytes <= encoder->capacity_bytes) {
+    return true;
+  }
+  const size_t capacity_bytes = MAX(MAX(required_bytes, encoder->capacity_bytes * 2),
+                                    BINARY_ENCODER_MIN_CAPACITY_BYTES);
+  uint8_t *const buffer = task_realloc(encoder->buffer, capacity_bytes);
+  if (!buffer) {
+    return false;
+  }
+  encoder->buffer = buffer;
+  encoder->capacity_bytes = capacity_bytes;
+  return true;
+}
+
+static bool prv_encoder_write(BinaryEncoder *encoder, const void *data, size_t num_bytes) {
+  if (!prv_encoder_reserve(encoder, num_bytes)) {
+    return false;
+  }
+  memcpy(encoder->buffer + encoder->size_bytes, data, num_bytes);
+  encoder->size_bytes += num_bytes;
+  return true;
+}
+
+static bool prv_encoder_write_type(BinaryEncoder *encoder, PostMessageValueType type) {
+  const uint8_t type_byte = type;
+  return prv_encoder_write(encoder, &type_byte, sizeof(type_byte));
+}
+
+static bool prv_encoder_write_varint(BinaryEncoder *encoder, uint32_t value) {
+  uint8_t bytes[5];
+  size_t num_bytes = 0;
+  do {
+    bytes[num_bytes] = (value & 0x7f);
+    value >>= 7;
+    if (value) {
+      bytes[num_bytes] |= 0x80;
+    }
+    ++num_bytes;
+  } while (value);
+  return prv_encoder_write(encoder, bytes, num_bytes);
+}
+
+//! @return false if out of memory
+static bool prv_encoder_write_string(BinaryEncoder *encoder, jerry_value_t string) {
+  const jerry_size_t size = jerry_get_utf8_string_size(string);
+  if (!prv_encoder_write_varint(encoder, size) || !prv_encoder_reserve(encoder, size)) {
+    return false;
+  }
+  const jerry_size_t copied_size =
+      jerry_string_to_utf8_char_buffer(string, encoder->buffer + encoder->size_bytes, size);
+  encoder->size_bytes += copied_size;
+  if (copied_size != size) {
+    encoder->is_json_required = true;
+  }
+  return true;
+}
+
+static bool prv_encoder_write_number(BinaryEncoder *encoder, double number) {
+  if (!isfinite(number)) {
+    return prv_encoder_write_type(encoder, PostMessageValueTypeNull);
+  }
+  // Use the smallest integer type that can represent the number. Note that -0 becomes 0, which is
+  // what JSON.stringify() does as well.
+  if (number >= INT32_MIN && number <= INT32_MAX && number == (int32_t)number) {
+    const int32_t integer = (int32_t)number;
+    if (integer >= INT8_MIN && integer <= INT8_MAX) {
+      const int8_t value = integer;
+      return (prv_encoder_write_type(encoder, PostMessageValueTypeInt8) &&
+              prv_encoder_write(encoder, &value, sizeof(value)));
+    }
+    if (integer >= INT16_MIN && integer <= INT16_MAX) {
+      const int16_t value = integer;
+      return (prv_encoder_write_type(encoder, PostMessageValueTypeInt16) &&
+              prv_encoder_write(encoder, &value, sizeof(value)));
+    }
+    return (prv_encoder_write_type(encoder, PostMessageValueTypeInt32) &&
+            prv_encoder_write(encoder, &integer, sizeof(integer)));
+  }
+  return (prv_encoder_write_type(encoder, PostMessageValueTypeDouble) &&
+          prv_encoder_write(encoder, &number, sizeof(number)));
+}
+
+static bool prv_is_plain_object_or_array(BinaryEncoder *encoder, jerry_value_t value) {
+  if (!jerry_value_is_object(value)) {
+    return false;
+  }
+  // Same check as JSON.stringify() does. If the getter throws, JSON.stringify() will throw again.
+  JS_VAR to_json = jerry_get_property(value, encoder->to_json_name);
+  if (jerry_value_has_error_flag(to_json) || jerry_value_is_function(to_json)) {
+    return false;
+  }
+  if (jerry_value_is_array(value)) {
+    return true;
+  }
+  // Not a JS_VAR: jerry_get_prototype() doesn't acquire the value it returns.
+  const jerry_value_t prototype = jerry_get_prototype(value);
+  return (jerry_value_is_null(prototype) || prototype == encoder->object_prototype);
+}
+
+static jerry_value_t prv_encode_value(BinaryEncoder *encoder, jerry_value_t value,
+                                      unsigned int depth, PostMessageValueType undefined_type);
+
+static jerry_value_t prv_encode_array(BinaryEncoder *encoder, jerry_value_t array,
+                                      unsigned int depth) {
+  const uint32_t length = jerry_get_array_length(array);
+  if (!prv_encoder_write_type(encoder, PostMessageValueTypeArray) ||
+      !prv_encoder_write_varint(encoder, length)) {
+    return prv_create_oom_error();
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    JS_VAR element = jerry_get_property_by_index(array, i);
+    if (jerry_value_has_error_flag(element)) {
+      return jerry_acquire_value(element);
+    }
+    // Like JSON.stringify(), turn elements without a JSON representation into null:
+    JS_VAR result = prv_encode_value(encoder, element, depth, PostMessageValueTypeNull);
+    if (jerry_value_has_error_flag(result)) {
+      return jerry_acquire_value(result);
+    }
+  }
+  return jerry_create_undefined();
+}
+
+static jerry_value_t prv_encode_object(BinaryEncoder *encoder, jerry_value_t object,
+                                       unsigned int depth) {
+  // Same properties, in the same order, as JSON.stringify() would serialize:
+  JS_VAR keys = jerry_get_object_keys(object);
+  if (jerry_value_has_error_flag(keys)) {
+    return jerry_acquire_value(keys);
+  }
+  const uint32_t num_keys = jerry_get_array_length(keys);
+  if (!prv_encoder_write_type(encoder, PostMessageValueTypeObject) ||
+      !prv_encoder_write_varint(encoder, num_keys)) {
+    return prv_create_oom_error();
+  }
+  for (uint32_t i = 0; i < num_keys; ++i) {
+    JS_VAR key = jerry_get_property_by_index(keys, i);
+    JS_VAR property_value = jerry_get_property(object, key);
+    if (jerry_value_has_error_flag(property_value)) {
+      return jerry_acquire_value(property_value);
+    }
+    if (!prv_encoder_write_string(encoder, key)) {
+      return prv_create_oom_error();
+    }
+    if (encoder->is_json_required) {
+      return jerry_create_undefined();
+    }
+    // Properties without a JSON representation get left out by the receiving end:
+    JS_VAR result = prv_encode_value(encoder, property_value, depth,
+                                     PostMessageValueTypeUndefined);
+    if (jerry_value_has_error_flag(result)) {
+      return jerry_acquire_value(result);
+    }
+  }
+  return jerry_create_undefined();
+}
+
+static jerry_value_t prv_encode_json(BinaryEncoder *encoder, jerry_value_t value,
+                                     PostMessageValueType undefined_type) {
+  JS_VAR json_string = prv_json_stringify(value);
+  if (jerry_value_has_error_flag(json_string)) {
+    return jerry_acquire_value(json_string);
+  }
+  const bool is_written = jerry_value_is_undefined(json_string) ?
+      prv_encoder_write_type(encoder, undefined_type) :
+      (prv_encoder_write_type(encoder, PostMessageValueTypeJSON) &&
+       prv_encoder_write_string(encoder, json_string));
+  return is_written ? jerry_create_undefined() : prv_create_oom_error();
+}
+
+static jerry_value_t prv_encode_value_binary(BinaryEncoder *encoder, jerry_value_t value,
+                                             unsigned int depth,
+                                             PostMessageValueType undefined_type) {
+  bool is_written;
+  if (jerry_value_is_undefined(value) || jerry_value_is_function(value)) {
+    is_written = prv_encoder_write_type(encoder, undefined_type);
+  } else if (jerry_value_is_null(value)) {
+    is_written = prv_encoder_write_type(encoder, PostMessageValueTypeNull);
+  } else if (jerry_value_is_boolean(value)) {
+    is_written = prv_encoder_write_type(encoder, jerry_get_boolean_value(value) ?
+                                                 PostMessageValueTypeTrue :
+                                                 PostMessageValueTypeFalse);
+  } else if (jerry_value_is_number(value)) {
+    is_written = prv_encoder_write_number(encoder, jerry_get_number_value(value));
+  } else if (jerry_value_is_string(value)) {
+    is_written = (prv_encoder_write_type(encoder, PostMessageValueTypeString) &&
+                  prv_encoder_write_string(encoder, value));
+  } else if (depth < POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH &&
+             prv_is_plain_object_or_array(encoder, value)) {
+    return jerry_value_is_array(value) ? prv_encode_array(encoder, value, depth + 1) :
+                                         prv_encode_object(encoder, value, depth + 1);
+  } else {
+    return prv_encode_json(encoder, value, undefined_type);
+  }
+  return is_written ? jerry_create_undefined() : prv_create_oom_error();
+}
+
+//! @param depth Number of arrays and objects the value is nested in
+//! @param undefined_type Type to write if the value has no JSON representation
+//! @return undefined if successful or the error otherwise
+static jerry_value_t prv_encode_value(BinaryEncoder *encoder, jerry_value_t value,
+                                      unsigned int depth, PostMessageValueType undefined_type) {
+  const size_t start_size_bytes = encoder->size_bytes;
+  JS_VAR result = prv_encode_value_binary(encoder, value, depth, undefined_type);
+  if (!encoder->is_json_required || jerry_value_has_error_flag(result)) {
+    return jerry_acquire_value(result);
+  }
+  // JSON.stringify() escapes U+0000, so start over and write the value as a JSON string:
+  encoder->is_json_required = false;
+  encoder->size_bytes = start_size_bytes;
+  return prv_encode_json(encoder, value, undefined_type);
+}
+
+T_STATIC jerry_value_t prv_binary_encode(jerry_value_t value, SerializedObject *serialized_out) {
+  JS_VAR empty_object = jerry_create_object();
+  JS_VAR to_json_name = jerry_create_string((const jerry_char_t *)"toJSON");
+  BinaryEncoder encoder = {
+    // Looking up Object.prototype through the Object constructor leaks memory in this version of
+    // the engine, so take it from an object literal instead:
+    .object_prototype = jerry_get_prototype(empty_object),
+    .to_json_name = to_json_name,
+  };
+
+  JS_VAR result = prv_encode_value(&encoder, value, 0, PostMessageValueTypeUndefined);
+  if (jerry_value_has_error_flag(result)) {
+    task_free(encoder.buffer);
+    return jerry_acquire_value(result);
+  }
+  if (encoder.buffer[0] == PostMessageValueTypeUndefined) {
+    task_free(encoder.buffer);
+    return prv_create_not_jsonable_error();
+  }
+
+  // The object might sit in the queue for a while, give back the unused capacity:
+  uint8_t *const data = task_realloc(encoder.buffer, encoder.size_bytes);
+  *serialized_out = (SerializedObject) {
+    .data = data ?: encoder.buffer,
+    .size_bytes = encoder.size_bytes,
+    .is_binary = true,
+  };
+  return jerry_create_undefined();
+}
+
+typedef struct {
+  const uint8_t *cursor;
+  const uint8_t *end;
+} BinaryDecoder;
+
+static size_t prv_decoder_get_remaining_bytes(const BinaryDecoder *decoder) {
+  return (decoder->end - decoder->cursor);
+}
+
+static bool prv_decoder_read(BinaryDecoder *decoder, void *data_out, size_t num_bytes) {
+  if (prv_decoder_get_remaining_bytes(decoder) < num_bytes) {
+    return false;
+  }
+  memcpy(data_out, decoder->cursor, num_bytes);
+  decoder->cursor += num_bytes;
+  return true;
+}
+
+static bool prv_decoder_read_varint(BinaryDecoder *decoder, uint32_t *value_out) {
+  uint32_t value = 0;
+  for (unsigned int shift = 0; shift < 32; shift += 7) {
+    uint8_t byte;
+    if (!prv_decoder_read(decoder, &byte, sizeof(byte))) {
+      return false;
+    }
+    value |= ((uint32_t)(byte & 0x7f) << shift);
+    if (!(byte & 0x80)) {
+      *value_out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+static jerry_value_t prv_decode_string(BinaryDecoder *decoder) {
+  uint32_t size;
+  if (!prv_decoder_read_varint(decoder, &size) ||
+      prv_decoder_get_remaining_bytes(decoder) < size) {
+    return prv_create_malformed_error();
+  }
+  const jerry_char_t *const string = decoder->cursor;
+  decoder->cursor += size;
+  return jerry_create_string_utf8_sz(string, size);
+}
+
+//! Reads the number of elements or properties of an array or object.
+static bool prv_decoder_read_count(BinaryDecoder *decoder, uint32_t *count_out) {
+  // Each element takes at least one byte, so a corrupt count can't make us allocate a huge array:
+  return (prv_decoder_read_varint(decoder, count_out) &&
+          *count_out <= prv_decoder_get_remaining_bytes(decoder));
+}
+
+static jerry_value_t prv_decode_value(BinaryDecoder *decoder, unsigned int depth);
+
+static jerry_value_t prv_decode_array(BinaryDecoder *decoder, unsigned int depth) {
+  uint32_t length;
+  if (!prv_decoder_read_count(decoder, &length)) {
+    return prv_create_malformed_error();
+  }
+  JS_VAR array = jerry_create_array(length);
+  for (uint32_t i = 0; i < length; ++i) {
+    JS_VAR element = prv_decode_value(decoder, depth);
+    if (jerry_value_has_error_flag(element)) {
+      return jerry_acquire_value(element);
+    }
+    if (jerry_value_is_undefined(element)) {
+      return prv_create_malformed_error();
+    }
+    JS_UNUSED_VAL = jerry_set_property_by_index(array, i, element);
+  }
+  return jerry_acquire_value(array);
+}
+
+static jerry_value_t prv_decode_object(BinaryDecoder *decoder, unsigned int depth) {
+  uint32_t num_properties;
+  if (!prv_decoder_read_count(decoder, &num_properties)) {
+    return prv_create_malformed_error();
+  }
+  JS_VAR object = jerry_create_object();
+  for (uint32_t i = 0; i < num_properties; ++i) {
+    JS_VAR name = prv_decode_string(decoder);
+    if (jerry_value_has_error_flag(name)) {
+      return jerry_acquire_value(name);
+    }
+    JS_VAR property_value = prv_decode_value(decoder, depth);
+    if (jerry_value_has_error_flag(property_value)) {
+      return jerry_acquire_value(property_value);
+    }
+    if (!jerry_value_is_undefined(property_value)) {
+      JS_UNUSED_VAL = jerry_set_property(object, name, property_value);
+    }
+  }
+  return jerry_acquire_value(object);
+}
+
+//! @param depth Number of arrays and objects the value is nested in
+//! @return The decoded value, undefined for PostMessageValueTypeUndefined or the error otherwise
+static jerry_value_t prv_decode_value(BinaryDecoder *decoder, unsigned int depth) {
+  uint8_t type;
+  if (!prv_decoder_read(decoder, &type, sizeof(type))) {
+    return prv_create_malformed_error();
+  }
+  switch (type) {
+    case PostMessageValueTypeUndefined:
+      return jerry_create_undefined();
+    case PostMessageValueTypeNull:
+      return jerry_create_null();
+    case PostMessageValueTypeFalse:
+    case PostMessageValueTypeTrue:
+      return jerry_create_boolean(type == PostMessageValueTypeTrue);
+    case PostMessageValueTypeInt8: {
+      int8_t value;
+      return prv_decoder_read(decoder, &value, sizeof(value)) ?
+          jerry_create_number(value) : prv_create_malformed_error();
+    }
+    case PostMessageValueTypeInt16: {
+      int16_t value;
+      return prv_decoder_read(decoder, &value, sizeof(value)) ?
+          jerry_create_number(value) : prv_create_malformed_error();
+    }
+    case PostMessageValueTypeInt32: {
+      int32_t value;
+      return prv_decoder_read(decoder, &value, sizeof(value)) ?
+          jerry_create_number(value) : prv_create_malformed_error();
+    }
+    case PostMessageValueTypeDouble: {
+      double value;
+      return prv_decoder_read(decoder, &value, sizeof(value)) ?
+          jerry_create_number(value) : prv_create_malformed_error();
+    }
+    case PostMessageValueTypeString:
+      return prv_decode_string(decoder);
+    case PostMessageValueTypeJSON: {
+      JS_VAR json_string = prv_decode_string(decoder);
+      if (jerry_value_has_error_flag(json_string)) {
+        return jerry_acquire_value(json_string);
+      }
+      return prv_call_json_function(GLOBAL_JSON_PARSE, &json_string, 1);
+    }
+    case PostMessageValueTypeArray:
+    case PostMessageValueTypeObject:
+      if (depth >= POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH) {
+        return prv_create_malformed_error();
+      }
+      return (type == PostMessageValueTypeArray) ? prv_decode_array(decoder, depth + 1) :
+                                                   prv_decode_object(decoder, depth + 1);
+    default:
+      return prv_create_malformed_error();
+  }
+}
+
+T_STATIC jerry_value_t prv_binary_decode(const uint8_t *data, size_t size_bytes) {
+  BinaryDecoder decoder = {
+    .cursor = data,
+    .end = data + size_bytes,
+  };
+  JS_VAR value = prv_decode_value(&decoder, 0);
+  if (jerry_value_has_error_flag(value)) {
+    return jerry_acquire_value(value);
+  }
+  if (jerry_value_is_undefined(value) || decoder.cursor != decoder.end) {
+    return prv_create_malformed_error();
+  }
+  return jerry_acquire_value(value);
+}
+
+//////////////////////////////////////////////////
+
+static bool prv_is_binary_encoding_negotiated(void) {
+  // Before the first session is opened, this is 0 and objects get serialized as JSON:
+  return (s_state.protocol_version >= POSTMESSAGE_PROTOCOL_BINARY_ENCODING_VERSION);
+}
+
+//! @return undefined if successful or the error otherwise
+static jerry_value_t prv_serialize(jerry_value_t value, bool is_binary,
+                                   SerializedObject *serialized_out) {
+  return is_binary ? prv_binary_encode(value, serialized_out) :
+                     prv_json_serialize(value, serialized_out);
+}
+
+static jerry_value_t prv_deserialize(const SerializedObject *serialized) {
+  return serialized->is_binary ? prv_binary_decode(serialized->data, serialized->size_bytes) :
+                                 prv_json_parse((const char *)serialized->data);
+}
+
 #define BOX_SIZE (APP_MESSAGE_OUTBOX_SIZE_MINIMUM)
 #define postMessage_HEADER_SIZE_BYTES (2 * sizeof(Tuple))
 
@@ -827,28 +1368,27 @@ T_STATIC jerry_value_t prv_json_parse(const char *object) {
 // API: "postmessageerror" event
 ////////////////////////////////////////////////////////////////////////////////
 
-static void prv_free_json_buffer_associated_with_postmessageerror_event(const uintptr_t ptr) {
-  task_free((char *)ptr);
+static void prv_free_object_associated_with_postmessageerror_event(const uintptr_t ptr) {
+  prv_free_outgoing_object((OutgoingObject *)ptr);
 }
 
 JERRY_FUNCTION(prv_postmessageerror_data_getter) {
-  char *json_buffer = NULL;
-  PBL_ASSERTN(jerry_get_object_native_handle(this_val, (uintptr_t *)&json_buffer));
-  PBL_ASSERTN(json_buffer);
-  return prv_json_parse(json_buffer);
+  OutgoingObject *obj = NULL;
+  PBL_ASSERTN(jerry_get_object_native_handle(this_val, (uintptr_t *)&obj));
+  PBL_ASSERTN(obj);
+  return prv_deserialize(&obj->serialized);
 }
 
-static void prv_object_queue_pop_head_and_emit_error_event_and_own_json_buffer(void) {
+static void prv_object_queue_pop_head_and_emit_error_event(void) {
   DBG("postmessageerror event");
   OutgoingObject *old_head = s_state.out.object_queue;
-  char *const json_data_buffer = old_head->data_buffer;
 
-  // Don't free the JSON data buffer, ownership is about to be passed to the error event.
-  prv_object_queue_pop_head(false /* should_free_data_buffer */);
+  // Don't free the object, ownership is about to be passed to the error event.
+  prv_object_queue_pop_head(false /* should_free_object */);
 
   JS_VAR event = rocky_global_create_event(ROCKY_EVENT_ERROR);
-  jerry_set_object_native_handle(event, (uintptr_t)json_data_buffer,
-                                 prv_free_json_buffer_associated_with_postmessageerror_event);
+  jerry_set_object_native_handle(event, (uintptr_t)old_head,
+                                 prv_free_object_associated_with_postmessageerror_event);
   rocky_define_property(event, ROCKY_EVENT_MESSAGE_DATA, prv_postmessageerror_data_getter, NULL);
   rocky_global_call_event_handlers(event);
 }
@@ -880,7 +1420,7 @@ static void prv_session_closed_object_queue_timer_cb(void *unused) {
   DBG("Erroring out head object, 3s passed!");
 
   s_state.out.session_closed_object_queue_timer = EVENTED_TIMER_INVALID_ID;
-  prv_object_queue_pop_head_and_emit_error_event_and_own_json_buffer();
+  prv_object_queue_pop_head_and_emit_error_event();
 
   if (s_state.out.object_queue) {
     // Still not open and still things in the object queue, restart the timer:
@@ -897,10 +1437,6 @@ static void prv_start_session_closed_object_queue_timer(void) {
       app_timer_register(SESSION_CLOSED_TIMEOUT_MS, prv_session_closed_object_queue_timer_cb, NULL);
 }
 
-static jerry_value_t prv_create_oom_error(void) {
-  return rocky_error_oom("can't postMessage() -- object too large");
-}
-
 static bool prv_object_queue_add(OutgoingObject *msg) {
   if (s_state.out.object_queue) {
     list_append((ListNode *)s_state.out.object_queue, (ListNode *)msg);
@@ -918,30 +1454,21 @@ JERRY_FUNCTION(prv_post_message) {
 
   const jerry_value_t js_msg = argv[0];
 
-  JS_VAR json_string = prv_json_stringify(js_msg);
-  if (jerry_value_has_error_flag(json_string)) {
-    return jerry_acquire_value(json_string);
-  }
-  if (jerry_value_is_undefined(json_string)) {
-    // ECMA v5.1, 15.12.3, Note 5: Values that do not have a JSON representation (such as undefined
-    // and functions) do not produce a String. Instead they produce the undefined value.
-    return rocky_error_unexpected_type(0, "JSON.stringify()-able object");
-  }
-
-  const uint32_t str_size = jerry_get_utf8_string_size(json_string) + 1 /* trailing zero */;
-  char *const data_buffer = task_zalloc(str_size);
-  if (!data_buffer) {
-    return prv_create_oom_error();
+  // Serialize for the last negotiated protocol version, that's most likely what the next session
+  // will use as well. If not, the object gets converted before it's sent out.
+  SerializedObject serialized;
+  JS_VAR result = prv_serialize(js_msg, prv_is_binary_encoding_negotiated(), &serialized);
+  if (jerry_value_has_error_flag(result)) {
+    return jerry_acquire_value(result);
   }
-  jerry_string_to_utf8_char_buffer(json_string, (jerry_char_t *)data_buffer, str_size);
 
   OutgoingObject * const obj = task_zalloc(sizeof(*obj));
   if (!obj) {
-    task_free(data_buffer);
+    task_free(serialized.data);
     return prv_create_oom_error();
   }
   *obj = (OutgoingObject) {
-    .data_buffer = data_buffer,
+    .serialized = serialized,
   };
 
   const bool is_first = prv_object_queue_add(obj);
@@ -999,9 +1526,7 @@ static bool prv_free_control_msg_for_each_cb(ListNode *node, void *context) {
 }
 
 static bool prv_free_outbound_object_for_each_cb(ListNode *node, void *context) {
-  OutgoingObject *object = (OutgoingObject *)node;
-  task_free(object->data_buffer);
-  task_free(object);
+  prv_free_outgoing_object((OutgoingObject *)node);
   return true;
 }
 
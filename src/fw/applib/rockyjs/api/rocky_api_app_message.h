@@ -21,7 +21,11 @@
 #include <util/attributes.h>
 
 #define POSTMESSAGE_PROTOCOL_MIN_VERSION ((uint8_t)1)
-#define POSTMESSAGE_PROTOCOL_MAX_VERSION ((uint8_t)1)
+#define POSTMESSAGE_PROTOCOL_MAX_VERSION ((uint8_t)2)
+
+//! From this version on, Chunks carry objects in the binary encoding (see PostMessageValueType)
+//! instead of as zero-terminated JSON strings.
+#define POSTMESSAGE_PROTOCOL_BINARY_ENCODING_VERSION ((uint8_t)2)
 
 //! Max size in bytes of the largest Chunk payload that can be sent out.
 #define POSTMESSAGE_PROTOCOL_MAX_TX_CHUNK_SIZE ((uint16_t)1000)
@@ -70,7 +74,7 @@ typedef struct PACKED {
     //! Header for first Chunk in a sequence of chunks. Valid when is_first == true.
     struct PACKED {
       //! Total size of the object (sum of the lengths of all chunk_data in the Chunk sequence)
-      //! including a zero byte at the end of the JSON string.
+      //! including a zero byte at the end of the JSON string, if the object is sent as JSON.
       uint32_t total_size_bytes:31;
       //! Always set to true for the first Chunk.
       bool is_first:1;
@@ -85,11 +89,47 @@ typedef struct PACKED {
       bool continuation_is_first:1;
     };
   };
-  //! JSON string data (potentially a partial fragment).
-  //! The final Chunk's chunk_data MUST be zero-terminated!
+  //! JSON string data or binary encoded object (potentially a partial fragment).
+  //! When sending JSON, the final Chunk's chunk_data MUST be zero-terminated!
   char chunk_data[0];
 } PostMessageChunkPayload;
 
+//! Type byte at the start of each value in the binary encoding of an object. The payload that
+//! follows depends on the type. Multi-byte numbers are little-endian, lengths and counts are
+//! unsigned LEB128 varints and strings are UTF-8 without a zero terminator.
+typedef enum {
+  //! Only valid as the value of an object property, the property is left out.
+  //! This is what JSON.stringify() does with undefined values and functions.
+  PostMessageValueTypeUndefined = 0,
+  PostMessageValueTypeNull = 1,
+  PostMessageValueTypeFalse = 2,
+  PostMessageValueTypeTrue = 3,
+  //! Followed by an int8_t
+  PostMessageValueTypeInt8 = 4,
+  //! Followed by an int16_t
+  PostMessageValueTypeInt16 = 5,
+  //! Followed by an int32_t
+  PostMessageValueTypeInt32 = 6,
+  //! Followed by a double. Non-finite numbers are sent as null, like JSON.stringify() does.
+  PostMessageValueTypeDouble = 7,
+  //! Followed by the length of the string in bytes and the string itself
+  PostMessageValueTypeString = 8,
+  //! Followed by the number of elements and the encoded elements
+  PostMessageValueTypeArray = 9,
+  //! Followed by the number of properties and for each property, its name (length and string)
+  //! and encoded value
+  PostMessageValueTypeObject = 10,
+  //! Followed by the length of a JSON string and the string itself. Used for anything that isn't
+  //! a plain object or array, such as objects with a toJSON() method, and for values that are
+  //! nested deeper than POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH.
+  PostMessageValueTypeJSON = 11,
+
+  PostMessageValueType_Count
+} PostMessageValueType;
+
+//! Maximum number of nested arrays and objects in the binary encoding of an object
+#define POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH (8)
+
 typedef enum {
   PostMessageErrorUnsupportedVersion,
   PostMessageErrorMalformedResetComplete,
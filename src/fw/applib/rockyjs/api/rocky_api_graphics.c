@@ -16,6 +16,7 @@
 
 #include "jerry-api.h"
 #include "rocky_api_graphics.h"
+#include "rocky_api_graphics_color.h"
 #include "rocky_api_graphics_path2d.h"
 #include "rocky_api_graphics_text.h"
 #include "rocky_api_util.h"
@@ -334,6 +335,7 @@ static void prv_init_apis(void) {
   rocky_add_function(rocky, ROCKY_REQUESTDRAW, prv_request_draw);
   rocky_api_graphics_text_init();
   rocky_api_graphics_path2d_reset_state(); // does not have an init, so we call reset_state()
+  rocky_api_graphics_color_init();
 }
 
 static void prv_deinit_apis(void) {
@@ -345,6 +347,7 @@ static void prv_deinit_apis(void) {
   }
   rocky_api_graphics_text_deinit();
   rocky_api_graphics_path2d_reset_state();
+  rocky_api_graphics_color_deinit();
 }
 
 static bool prv_add_handler(const char *event_name, jerry_value_t handler) {
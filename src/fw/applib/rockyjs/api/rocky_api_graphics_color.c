@@ -19,6 +19,7 @@
 #include "rocky_api_util.h"
 
 #include "string.h"
+#include "util/attributes.h"
 #include "util/size.h"
 
 #define GColorARGB8FromRGBA(red, green, blue, alpha) \
@@ -351,15 +352,71 @@ bool rocky_api_graphics_color_parse(const char *color_value, GColor8 *parsed_col
     prv_parse_hex(color_value, parsed_color);
 }
 
+//! Draw handlers set the same few colors on every frame, usually from string literals which
+//! JerryScript hands to us as the very same string value every time. The most recently parsed
+//! strings are kept alive along with their colors so they don't get parsed again.
+typedef struct RockyAPIGraphicsInternedColor {
+  jerry_value_t string;
+  GColor color;
+} RockyAPIGraphicsInternedColor;
+
+#define NUM_INTERNED_COLORS (8)
+
+//! Oldest first
+SECTION(".rocky_bss") static RockyAPIGraphicsInternedColor s_interned_colors[NUM_INTERNED_COLORS];
+SECTION(".rocky_bss") static size_t s_num_interned_colors;
+
+static bool prv_find_interned_color(jerry_value_t string, GColor *result) {
+  for (size_t i = 0; i < s_num_interned_colors; i++) {
+    if (s_interned_colors[i].string == string) {
+      *result = s_interned_colors[i].color;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void prv_intern_color(jerry_value_t string, GColor color) {
+  if (s_num_interned_colors == NUM_INTERNED_COLORS) {
+    // drop the oldest one
+    jerry_release_value(s_interned_colors[0].string);
+    s_num_interned_colors--;
+    memmove(&s_interned_colors[0], &s_interned_colors[1],
+            s_num_interned_colors * sizeof(s_interned_colors[0]));
+  }
+  s_interned_colors[s_num_interned_colors++] = (RockyAPIGraphicsInternedColor) {
+    .string = jerry_acquire_value(string),
+    .color = color,
+  };
+}
+
 bool rocky_api_graphics_color_from_value(jerry_value_t value, GColor *result) {
   if (jerry_value_is_number(value)) {
     *result = (GColor) {.argb = jerry_get_int32_value(value)};
     return true;
   }
   if (jerry_value_is_string(value)) {
+    if (prv_find_interned_color(value, result)) {
+      return true;
+    }
     char color_str[50] = {0};
     jerry_string_to_utf8_char_buffer(value, (jerry_char_t *)color_str, sizeof(color_str));
-    return rocky_api_graphics_color_parse(color_str, result);
+    if (!rocky_api_graphics_color_parse(color_str, result)) {
+      return false;
+    }
+    prv_intern_color(value, *result);
+    return true;
   }
   return false;
 }
+
+void rocky_api_graphics_color_init(void) {
+  s_num_interned_colors = 0;
+}
+
+void rocky_api_graphics_color_deinit(void) {
+  for (size_t i = 0; i < s_num_interned_colors; i++) {
+    jerry_release_value(s_interned_colors[i].string);
+  }
+  s_num_interned_colors = 0;
+}
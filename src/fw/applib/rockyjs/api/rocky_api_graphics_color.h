@@ -29,3 +29,8 @@ typedef struct RockyAPIGraphicsColorDefinition {
 bool rocky_api_graphics_color_parse(const char *color_value, GColor8 *parsed_color);
 
 bool rocky_api_graphics_color_from_value(jerry_value_t value, GColor *parsed_color);
+
+void rocky_api_graphics_color_init(void);
+
+//! Releases the strings that rocky_api_graphics_color_from_value() keeps to skip parsing them again
+void rocky_api_graphics_color_deinit(void);
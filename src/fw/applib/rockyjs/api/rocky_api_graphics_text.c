@@ -182,14 +182,57 @@ T_STATIC const RockyAPISystemFontDefinition s_font_definitions[] = {
 //! The index to the default font in s_font_definitions
 #define DEFAULT_FONT_DEFINITION (s_font_definitions[2])
 
+//! Draw handlers usually switch between the same couple of font strings on every frame. The
+//! strings that were matched most recently are kept alive along with their definitions, so the
+//! very same string value doesn't need to be copied and compared to all names again.
+typedef struct RockyAPIInternedFont {
+  jerry_value_t string;
+  const RockyAPISystemFontDefinition *definition;
+} RockyAPIInternedFont;
+
+#define NUM_INTERNED_FONTS (2)
+
+//! Oldest first
+SECTION(".rocky_bss") static RockyAPIInternedFont s_interned_fonts[NUM_INTERNED_FONTS];
+SECTION(".rocky_bss") static size_t s_num_interned_fonts;
+
+static void prv_intern_font(jerry_value_t string, const RockyAPISystemFontDefinition *definition) {
+  if (s_num_interned_fonts == NUM_INTERNED_FONTS) {
+    // drop the oldest one
+    jerry_release_value(s_interned_fonts[0].string);
+    s_num_interned_fonts--;
+    memmove(&s_interned_fonts[0], &s_interned_fonts[1],
+            s_num_interned_fonts * sizeof(s_interned_fonts[0]));
+  }
+  s_interned_fonts[s_num_interned_fonts++] = (RockyAPIInternedFont) {
+    .string = jerry_acquire_value(string),
+    .definition = definition,
+  };
+}
+
+static void prv_release_interned_fonts(void) {
+  for (size_t i = 0; i < s_num_interned_fonts; i++) {
+    jerry_release_value(s_interned_fonts[i].string);
+  }
+  s_num_interned_fonts = 0;
+}
+
 T_STATIC bool prv_font_definition_from_value(
       jerry_value_t value, RockyAPISystemFontDefinition const **result) {
+  for (size_t i = 0; i < s_num_interned_fonts; i++) {
+    if (s_interned_fonts[i].string == value) {
+      *result = s_interned_fonts[i].definition;
+      return true;
+    }
+  }
+
   char str[50] = {0};
   jerry_string_to_utf8_char_buffer(value, (jerry_char_t *)str, sizeof(str));
 
   const RockyAPISystemFontDefinition *def = s_font_definitions;
   while (def->js_name) {
     if (strcmp(str, def->js_name) == 0) {
+      prv_intern_font(value, def);
       *result = def;
       return true;
     }
@@ -273,9 +316,11 @@ void rocky_api_graphics_text_reset_state(void) {
 
 void rocky_api_graphics_text_init(void) {
   s_default_font = fonts_get_system_font(DEFAULT_FONT_DEFINITION.res_key);
+  s_num_interned_fonts = 0;
   rocky_api_graphics_text_reset_state();
 }
 
 void rocky_api_graphics_text_deinit(void) {
   prv_text_state_deinit();
+  prv_release_interned_fonts();
 }
@@ -140,7 +140,9 @@ void window_render(Window *window, GContext *ctx) {
   DrawingStateOrigins saved_state;
   prv_adjust_drawing_state_for_legacy2_apps(&saved_state, ctx, window);
 
+  text_draw_state_begin_frame(&ctx->text_draw_state);
   layer_render_tree(&window->layer, ctx);
+  text_draw_state_end_frame(&ctx->text_draw_state);
 
   prv_restore_drawing_state(&saved_state, ctx);
 
@@ -99,35 +99,37 @@ static void prv_weather_event_handler(UNUSED PebbleEvent *event, void *context)
       launcher_app_glance_structured_get_data(structured_glance);
   PBL_ASSERTN(weather_glance);
 
-  WeatherLocationForecast *forecast = weather_service_create_default_forecast();
-
-  // Update the icon for the forecast's weather type
-  const WeatherType weather_type = NULL_SAFE_FIELD_ACCESS(forecast, current_weather_type,
-                                                          WeatherType_Unknown);
-  const uint32_t new_weather_icon_resource_id =
-      prv_get_weather_icon_resource_id_for_type(weather_type);
-  if (weather_glance->icon_resource_id != new_weather_icon_resource_id) {
-    kino_reel_destroy(weather_glance->icon);
-    weather_glance->icon = kino_reel_create_with_resource(new_weather_icon_resource_id);
-    weather_glance->icon_resource_id = new_weather_icon_resource_id;
-  }
-
   // Zero out the glance's title buffer
   const size_t weather_glance_title_size = sizeof(weather_glance->title);
   memset(weather_glance->title, 0, weather_glance_title_size);
+
+  // The forecast is a view into the weather service's cache, only valid until we unlock it.
+  // Copy what we need out of it so the cache isn't locked while we format the subtitle.
+  WeatherType weather_type = WeatherType_Unknown;
+  int current_temp = WEATHER_SERVICE_LOCATION_FORECAST_UNKNOWN_TEMP;
+  char weather_phrase[WEATHER_SERVICE_MAX_SHORT_PHRASE_BUFFER_SIZE] = {};
+  weather_service_lock();
+  const WeatherLocationForecast *forecast = weather_service_get_default_forecast();
+  const bool has_forecast = (forecast != NULL);
+  if (forecast) {
+    weather_type = forecast->current_weather_type;
+    current_temp = forecast->current_temp;
+    strncpy(weather_phrase, forecast->current_weather_phrase, sizeof(weather_phrase) - 1);
+  }
   // Choose the title we should display based on whether or not we have a forecast
   const char *title = NULL_SAFE_FIELD_ACCESS(forecast, location_name,
                                              weather_glance->fallback_title);
   // Subtract 1 from the size as a shortcut for null terminating the title since we zero it out
   // above
   strncpy(weather_glance->title, title, weather_glance_title_size - 1);
+  weather_service_unlock();
 
   // Zero out the glance's subtitle buffer
   const size_t weather_glance_subtitle_size = sizeof(weather_glance->subtitle);
   memset(weather_glance->subtitle, 0, weather_glance_subtitle_size);
   // We'll only set the subtitle if we have a default forecast
-  if (forecast) {
-    if (forecast->current_temp == WEATHER_SERVICE_LOCATION_FORECAST_UNKNOWN_TEMP) {
+  if (has_forecast) {
+    if (current_temp == WEATHER_SERVICE_LOCATION_FORECAST_UNKNOWN_TEMP) {
       /// Shown when the current temperature is unknown
       const char *no_temperature_string = i18n_get("--°", weather_glance);
       // Subtract 1 from the size as a shortcut for null terminating the subtitle since we zero it
@@ -138,18 +140,25 @@ static void prv_weather_event_handler(UNUSED PebbleEvent *event, void *context)
       const char *temp_and_phrase_formatter = i18n_get("%i° - %s", weather_glance);
       /// Today's current temperature (e.g. "68°")
       const char *temp_only_formatter = i18n_get("%i°", weather_glance);
-      const char *localized_phrase = i18n_get(forecast->current_weather_phrase, weather_glance);
+      const char *localized_phrase = i18n_get(weather_phrase, weather_glance);
       const char *formatter_string = strlen(localized_phrase) ? temp_and_phrase_formatter :
                                      temp_only_formatter;
       // It's safe to pass more arguments to snprintf() than might be used by formatter_string
       snprintf(weather_glance->subtitle, weather_glance_subtitle_size, formatter_string,
-               forecast->current_temp, localized_phrase);
+               current_temp, localized_phrase);
     }
   }
 
   i18n_free_all(weather_glance);
 
-  weather_service_destroy_default_forecast(forecast);
+  // Update the icon for the forecast's weather type
+  const uint32_t new_weather_icon_resource_id =
+      prv_get_weather_icon_resource_id_for_type(weather_type);
+  if (weather_glance->icon_resource_id != new_weather_icon_resource_id) {
+    kino_reel_destroy(weather_glance->icon);
+    weather_glance->icon = kino_reel_create_with_resource(new_weather_icon_resource_id);
+    weather_glance->icon_resource_id = new_weather_icon_resource_id;
+  }
 
   // Broadcast to the service that we changed the glance
   launcher_app_glance_structured_notify_service_glance_changed(structured_glance);
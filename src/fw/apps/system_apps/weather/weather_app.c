@@ -48,7 +48,7 @@ typedef struct WeatherAppData {
   WeatherAppWarningDialog *warning_dialog;
 } WeatherAppData;
 
-static bool prv_is_weather_forecast_recent(WeatherLocationForecast *forecast) {
+static bool prv_is_weather_forecast_recent(const WeatherLocationForecast *forecast) {
   if (!forecast) {
     return false;
   }
@@ -192,9 +192,10 @@ static NOINLINE void prv_init(void) {
 
   // Request the default forecast separately instead of using the forecast list in `data` to avoid
   // any potential race conditions
-  WeatherLocationForecast *default_forecast = weather_service_create_default_forecast();
-  const bool is_default_forecast_data_recent = prv_is_weather_forecast_recent(default_forecast);
-  weather_service_destroy_default_forecast(default_forecast);
+  weather_service_lock();
+  const bool is_default_forecast_data_recent =
+      prv_is_weather_forecast_recent(weather_service_get_default_forecast());
+  weather_service_unlock();
 
   // TODO PBL-38484: Consider using a different dialog for when data is stale but phone is connected
   if (is_default_forecast_data_recent || connection_service_peek_pebble_app_connection()) {
@@ -19,6 +19,7 @@
 #include "applib/graphics/8_bit/framebuffer.h"
 #include "applib/graphics/graphics.h"
 #include "applib/graphics/gtypes.h"
+#include "applib/graphics/text_layout_private.h"
 #include "comm/ble/gap_le_connection.h"
 #include "comm/bt_lock.h"
 #include "console_internal.h"
@@ -1169,6 +1170,8 @@ static GContext *prv_perftest_get_context(void) {
   GContext *ctx = &s_perftest_ctx;
   FrameBuffer *fb = compositor_get_framebuffer();
   memset(fb->buffer, 0xff, FRAMEBUFFER_SIZE_BYTES);
+  // Every perftest starts from a fresh context, don't leak the last one's text checkpoints
+  text_draw_state_free_checkpoints(&ctx->text_draw_state);
   graphics_context_init(ctx, fb, GContextInitializationMode_App);
   return ctx;
 }
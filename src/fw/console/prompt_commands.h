@@ -61,6 +61,7 @@ extern void command_dump_malloc_kernel(void);
 extern void command_dump_malloc_app(void);
 extern void command_dump_malloc_worker(void);
 extern void command_dump_malloc_bt(void);
+extern void command_dump_malloc_trace(void);
 
 extern void command_read_word(const char*);
 
@@ -221,6 +222,7 @@ extern void command_display_set(const char *color);
 extern void command_accessory_power_set(const char *on);
 extern void command_accessory_stress_test(void);
 extern void command_smartstrap_status(void);
+extern void command_smartstrap_stats(void);
 #endif
 extern void command_mic_start(char *timeout_str, char *sample_size_str, char *sample_rate_str,
                               char *volume_str);
@@ -472,6 +474,7 @@ static const Command s_prompt_commands[] = {
   { "accessory stress", command_accessory_stress_test, 0 },
 #if !RELEASE && !RECOVERY_FW
   { "smartstrap status", command_smartstrap_status, 0 },
+  { "smartstrap stats", command_smartstrap_stats, 0 },
 #endif // RELEASE
 #endif // CAPABILITY_HAS_ACCESSORY_CONNECTOR
 
@@ -544,6 +547,10 @@ static const Command s_prompt_commands[] = {
 #endif /* BT_CONTROLLER_CC2564X */
 #endif /* MALLOC_INSTRUMENTATION */
 
+#ifdef MALLOC_TRACE
+  { "dump malloc trace", command_dump_malloc_trace, 0 },
+#endif
+
   /*
   { "read word", command_read_word, 1 },
 
@@ -68,8 +68,18 @@
 //! Within accessory_send_stream(), how long we wait for a byte to be sent before timing-out.
 #define SEND_BYTE_TIMEOUT_MS (100)
 
+//! The fastest baud rate a smartstrap can negotiate (@see smartstrap_link_control.c)
+#define RX_MAX_BAUD (460800)
+//! How long the receiver may take to get to received data before the DMA laps it. With bulk
+//! receiving, the data is decoded from KernelBG, which can be held up by other callbacks. Anything
+//! slower than this is detected as an overrun and fails the read.
+#define RX_MAX_LATENCY_MS (20)
+
 //! We DMA into this buffer as a circular buffer
-#define RX_BUFFER_LENGTH (200)
+#define RX_BUFFER_LENGTH (1024)
+// Each byte takes 10 bits on the wire
+_Static_assert(RX_BUFFER_LENGTH >= (RX_MAX_BAUD / 10) * RX_MAX_LATENCY_MS / 1000,
+               "The RX buffer is too small to cover the receive latency at the fastest baud rate");
 static uint8_t DMA_BSS s_rx_buffer[RX_BUFFER_LENGTH];
 
 //! The current baud rate
@@ -103,6 +113,11 @@ static volatile bool s_did_send_byte;
 static bool s_use_dma;
 //! Whether or not DMA is enabled
 static bool s_dma_enabled;
+//! Whether or not received DMA data should be handed to the manager in bulk when the line goes idle
+static bool s_dma_bulk_rx;
+//! Set when the UART reports a receive error while bulk receiving, since there's no telling which
+//! of the received bytes it applies to
+static volatile bool s_dma_bulk_rx_error;
 //! Used by accessory_send_stream() to track whether or not we've sent a byte recently
 static volatile bool s_has_sent_byte;
 
@@ -128,6 +143,7 @@ static struct {
 } s_stop_mode_monitor;
 
 static bool prv_rx_irq_handler(UARTDevice *dev, uint8_t data, const UARTRXErrorFlags *err_flags);
+static bool prv_rx_idle_irq_handler(UARTDevice *dev, const UARTRXErrorFlags *err_flags);
 static bool prv_tx_irq_handler(UARTDevice *dev);
 
 
@@ -147,10 +163,20 @@ static void prv_unlock(void) {
   mutex_unlock_recursive(s_blocked_lock);
 }
 
+//! Bulk receiving is only used while we are actually receiving. While input is disabled, the bytes
+//! we read back are our own and need to be checked one at a time for bus contention.
+static void prv_update_rx_idle_handler(void) {
+  const bool use_idle_handler = s_dma_enabled && s_dma_bulk_rx && s_input_enabled;
+  uart_set_rx_idle_interrupt_handler(ACCESSORY_UART,
+                                     use_idle_handler ? prv_rx_idle_irq_handler : NULL);
+}
+
 static void prv_enable_dma(void) {
   PBL_ASSERTN(!s_dma_enabled);
   s_dma_enabled = true;
+  s_dma_bulk_rx_error = false;
   uart_start_rx_dma(ACCESSORY_UART, s_rx_buffer, sizeof(s_rx_buffer));
+  prv_update_rx_idle_handler();
 }
 
 static void prv_disable_dma(void) {
@@ -158,6 +184,7 @@ static void prv_disable_dma(void) {
     return;
   }
   s_dma_enabled = false;
+  prv_update_rx_idle_handler();
   uart_stop_rx_dma(ACCESSORY_UART);
 }
 
@@ -390,6 +417,9 @@ void accessory_disable_input(void) {
   s_input_enabled = false;
   s_send_history.has_data = false;
   s_bus_contention_detected = false;
+  if (s_dma_bulk_rx) {
+    prv_update_rx_idle_handler();
+  }
   prv_unlock();
 }
 
@@ -414,12 +444,33 @@ void accessory_enable_input(void) {
   uart_read_byte(ACCESSORY_UART);
 
   s_input_enabled = true;
+  if (s_dma_bulk_rx) {
+    if (s_dma_enabled) {
+      // skip anything we read back while input was disabled
+      uart_clear_rx_dma_buffer(ACCESSORY_UART);
+      s_dma_bulk_rx_error = false;
+    }
+    prv_update_rx_idle_handler();
+  }
   prv_unlock();
 }
 
 void accessory_use_dma(bool use_dma) {
   prv_lock();
   s_use_dma = use_dma;
+  s_dma_bulk_rx = false;
+  if (s_use_dma) {
+    prv_enable_dma();
+  } else {
+    prv_disable_dma();
+  }
+  prv_unlock();
+}
+
+void accessory_use_dma_bulk_rx(bool use_dma) {
+  prv_lock();
+  s_use_dma = use_dma;
+  s_dma_bulk_rx = use_dma;
   if (s_use_dma) {
     prv_enable_dma();
   } else {
@@ -428,6 +479,33 @@ void accessory_use_dma(bool use_dma) {
   prv_unlock();
 }
 
+size_t accessory_get_rx_data(const uint8_t **data, bool *has_error) {
+  prv_lock();
+  size_t length = 0;
+  *has_error = false;
+  if (s_dma_enabled && s_dma_bulk_rx) {
+    bool overrun;
+    length = uart_get_rx_dma_data(ACCESSORY_UART, data, &overrun);
+    if (overrun || s_dma_bulk_rx_error) {
+      // drop everything received so far and start over with the next byte
+      s_dma_bulk_rx_error = false;
+      uart_clear_rx_dma_buffer(ACCESSORY_UART);
+      *has_error = true;
+      length = 0;
+    }
+  }
+  prv_unlock();
+  return length;
+}
+
+void accessory_consume_rx_data(size_t length) {
+  prv_lock();
+  if (s_dma_enabled && s_dma_bulk_rx) {
+    uart_consume_rx_dma_data(ACCESSORY_UART, length);
+  }
+  prv_unlock();
+}
+
 bool accessory_bus_contention_detected(void) {
   return s_bus_contention_detected;
 }
@@ -504,6 +582,17 @@ static bool prv_rx_irq_handler(UARTDevice *dev, uint8_t data, const UARTRXErrorF
   return should_context_switch;
 }
 
+static bool prv_rx_idle_irq_handler(UARTDevice *dev, const UARTRXErrorFlags *err_flags) {
+  s_stop_mode_monitor.max_intervals_without_data = ACCESSORY_VALID_DATA_STOP_INTERVALS;
+  if (err_flags->framing_error || err_flags->noise_detected || err_flags->parity_error ||
+      err_flags->overrun_error) {
+    // some byte in the DMA buffer is bad, which the manager finds out about when it reads the data
+    s_dma_bulk_rx_error = true;
+  }
+  // The data is decoded from task context, so all we need to do here is let the manager know
+  return accessory_manager_handle_rx_data_from_isr();
+}
+
 static bool prv_tx_irq_handler(UARTDevice *dev) {
   bool should_context_switch = false;
   if (s_stream_cb && !s_send_history.has_data) {
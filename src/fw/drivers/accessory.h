@@ -97,6 +97,12 @@ bool accessory_manager_handle_character_from_isr(char c);
 //! @return whether we need to trigger a context switch based on handling this character
 bool accessory_manager_handle_break_from_isr(void);
 
+//! Called from the accessory UART interrupt when there is received data waiting to be read with
+//! accessory_get_rx_data() (@see accessory_use_dma_bulk_rx). The manager is responsible for
+//! implementing this function.
+//! @return whether we need to trigger a context switch
+bool accessory_manager_handle_rx_data_from_isr(void);
+
 //! Returns whether or not there has been bus contention detected since accessory_disable_input()
 //! was last called.
 bool accessory_bus_contention_detected(void);
@@ -106,3 +112,20 @@ bool accessory_is_present(void);
 
 //! Uses DMA for receiving from the peripheral
 void accessory_use_dma(bool use_dma);
+
+//! Uses DMA for receiving from the peripheral, but rather than calling
+//! accessory_manager_handle_character_from_isr() for every byte, the manager is notified via
+//! accessory_manager_handle_rx_data_from_isr() once the line goes idle and reads the data out of
+//! the DMA buffer from task context.
+void accessory_use_dma_bulk_rx(bool use_dma);
+
+//! Gets the next contiguous span of data received while using bulk DMA receiving
+//! @param[out] data Set to point at the received data, which is valid until it is consumed
+//! @param[out] has_error Set to true if received data was lost (the receiver fell too far behind)
+//! or corrupted (a framing, noise or parity error). Everything received up until then is dropped
+//! and no data is returned by this call.
+//! @return The length of the span, which is 0 if there is no pending data
+size_t accessory_get_rx_data(const uint8_t **data, bool *has_error);
+
+//! Releases data returned by accessory_get_rx_data() so the DMA can reuse its space
+void accessory_consume_rx_data(size_t length);
@@ -21,6 +21,7 @@
 #include "drivers/gpio.h"
 #include "drivers/periph_config.h"
 #include "system/passert.h"
+#include "util/math.h"
 
 #include "FreeRTOS.h"
 
@@ -257,7 +258,9 @@ void uart_set_rx_interrupt_enabled(UARTDevice *dev, bool enabled) {
   PBL_ASSERTN(dev->state->initialized);
   if (enabled) {
     dev->state->rx_int_enabled = true;
-    dev->periph->CR1 |= USART_CR1_RXNEIE;
+    if (!dev->state->rx_idle_irq_handler) {
+      dev->periph->CR1 |= USART_CR1_RXNEIE;
+    }
     prv_set_interrupt_enabled(dev, true);
   } else {
     // disable interrupt if TX is also disabled
@@ -284,7 +287,21 @@ void uart_set_tx_interrupt_enabled(UARTDevice *dev, bool enabled) {
 void uart_irq_handler(UARTDevice *dev) {
   PBL_ASSERTN(dev->state->initialized);
   bool should_context_switch = false;
-  if (dev->state->rx_irq_handler && dev->state->rx_int_enabled) {
+  if (dev->state->rx_idle_irq_handler && dev->state->rx_dma_buffer) {
+    const bool is_idle = (dev->periph->SR & USART_SR_IDLE);
+    if (is_idle) {
+      const UARTRXErrorFlags err_flags = uart_has_errored_out(dev);
+      // the IDLE and error flags are cleared by reading SR (done above) followed by DR
+      (void)dev->periph->DR;
+      if (err_flags.overrun_error) {
+        // the DMA didn't get to a byte before the next one arrived
+        dev->state->rx_dma_overrun = true;
+      }
+      if (dev->state->rx_idle_irq_handler(dev, &err_flags)) {
+        should_context_switch = true;
+      }
+    }
+  } else if (dev->state->rx_irq_handler && dev->state->rx_int_enabled) {
     const UARTRXErrorFlags err_flags = {
       .overrun_error = uart_has_rx_overrun(dev),
       .framing_error = uart_has_rx_framing_error(dev),
@@ -333,10 +350,43 @@ void uart_clear_all_interrupt_flags(UARTDevice *dev) {
 // DMA
 ////////////////////////////////////////////////////////////////////////////////
 
+//! @return The total number of bytes the RX DMA has written since it was started
+static uint32_t prv_rx_dma_get_num_written(UARTDevice *dev) {
+  const uint32_t length = dev->state->rx_dma_length;
+  // Read the count before the DMA's position, so that a transfer boundary which is counted in
+  // between can't make the position look like it's a whole lap ahead
+  const uint32_t num_written = dev->state->rx_dma_num_written;
+  const uint32_t next_idx = (length - dma_request_get_current_data_counter(dev->rx_dma)) % length;
+  // add how far the DMA has gotten since the last half / complete transfer was counted
+  return num_written + ((next_idx + length - (num_written % length)) % length);
+}
+
+static bool prv_rx_dma_circular_handler(DMARequest *request, void *context, bool is_complete) {
+  UARTDevice *dev = context;
+  // Count the data written up to this transfer boundary so that uart_get_rx_dma_data() can tell
+  // when the DMA laps the consumer. The DMA has moved on by at least one byte since the last one.
+  const uint32_t length = dev->state->rx_dma_length;
+  const uint32_t boundary_idx = is_complete ? 0 : (length / 2);
+  const uint32_t counted_idx = dev->state->rx_dma_num_written % length;
+  dev->state->rx_dma_num_written += ((boundary_idx + length - counted_idx - 1) % length) + 1;
+
+  if (!dev->state->rx_idle_irq_handler) {
+    return false;
+  }
+  // Let the consumer know about the data before the DMA wraps around, even if the line hasn't gone
+  // idle yet
+  const UARTRXErrorFlags err_flags = { };
+  return dev->state->rx_idle_irq_handler(dev, &err_flags);
+}
+
 void uart_start_rx_dma(UARTDevice *dev, void *buffer, uint32_t length) {
   dev->periph->CR3 |= USART_CR3_DMAR;
-  dma_request_start_circular(dev->rx_dma, buffer, (void *)&dev->periph->DR, length, NULL, NULL);
+  dma_request_start_circular(dev->rx_dma, buffer, (void *)&dev->periph->DR, length,
+                             prv_rx_dma_circular_handler, (void *)dev);
   dev->state->rx_dma_index = 0;
+  dev->state->rx_dma_num_written = 0;
+  dev->state->rx_dma_num_consumed = 0;
+  dev->state->rx_dma_overrun = false;
   dev->state->rx_dma_length = length;
   dev->state->rx_dma_buffer = buffer;
 }
@@ -351,4 +401,58 @@ void uart_stop_rx_dma(UARTDevice *dev) {
 void uart_clear_rx_dma_buffer(UARTDevice *dev) {
   dev->state->rx_dma_index = dev->state->rx_dma_length -
                              dma_request_get_current_data_counter(dev->rx_dma);
+  if (dev->state->rx_dma_buffer) {
+    dev->state->rx_dma_num_consumed = prv_rx_dma_get_num_written(dev);
+    dev->state->rx_dma_overrun = false;
+  }
+}
+
+void uart_set_rx_idle_interrupt_handler(UARTDevice *dev, UARTRXIdleInterruptHandler irq_handler) {
+  PBL_ASSERTN(dev->state->initialized);
+  dev->state->rx_idle_irq_handler = irq_handler;
+  if (irq_handler) {
+    // the DMA collects the data, so we only need to know when the line goes idle
+    dev->periph->CR1 &= ~USART_CR1_RXNEIE;
+    dev->periph->CR1 |= USART_CR1_IDLEIE;
+    prv_set_interrupt_enabled(dev, true);
+  } else {
+    dev->periph->CR1 &= ~USART_CR1_IDLEIE;
+    if (dev->state->rx_int_enabled) {
+      dev->periph->CR1 |= USART_CR1_RXNEIE;
+    }
+    prv_set_interrupt_enabled(dev, dev->state->rx_int_enabled || dev->state->tx_int_enabled);
+  }
+}
+
+uint32_t uart_get_rx_dma_data(UARTDevice *dev, const uint8_t **data, bool *overrun) {
+  *overrun = false;
+  if (!dev->state->rx_dma_buffer) {
+    return 0;
+  }
+  const uint32_t dma_length = dev->state->rx_dma_length;
+  const uint32_t pending = prv_rx_dma_get_num_written(dev) - dev->state->rx_dma_num_consumed;
+  if (dev->state->rx_dma_overrun || (pending > dma_length)) {
+    // the DMA has overwritten data which wasn't consumed yet
+    dev->state->rx_dma_overrun = true;
+    *overrun = true;
+    return 0;
+  }
+  const uint32_t index = dev->state->rx_dma_index;
+  *data = &dev->state->rx_dma_buffer[index];
+  // only return the part up until the end of the buffer, the rest is returned by the next call
+  return MIN(pending, dma_length - index);
+}
+
+void uart_consume_rx_dma_data(UARTDevice *dev, uint32_t length) {
+  if (!dev->state->rx_dma_buffer) {
+    return;
+  }
+  PBL_ASSERTN(length <= dev->state->rx_dma_length);
+  // the DMA could also have lapped the data while it was being read
+  if (prv_rx_dma_get_num_written(dev) - dev->state->rx_dma_num_consumed >
+      dev->state->rx_dma_length) {
+    dev->state->rx_dma_overrun = true;
+  }
+  dev->state->rx_dma_num_consumed += length;
+  dev->state->rx_dma_index = (dev->state->rx_dma_index + length) % dev->state->rx_dma_length;
 }
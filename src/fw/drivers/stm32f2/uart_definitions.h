@@ -28,11 +28,18 @@ typedef struct UARTState {
   bool initialized;
   UARTRXInterruptHandler rx_irq_handler;
   UARTTXInterruptHandler tx_irq_handler;
+  UARTRXIdleInterruptHandler rx_idle_irq_handler;
   bool rx_int_enabled;
   bool tx_int_enabled;
   uint8_t *rx_dma_buffer;
   uint32_t rx_dma_length;
   uint32_t rx_dma_index;
+  //! Number of bytes written by the RX DMA up to its last half / complete transfer
+  volatile uint32_t rx_dma_num_written;
+  //! Number of bytes released with uart_consume_rx_dma_data()
+  uint32_t rx_dma_num_consumed;
+  //! Set once received data was lost before it was consumed
+  volatile bool rx_dma_overrun;
 } UARTDeviceState;
 
 typedef const struct UARTDevice {
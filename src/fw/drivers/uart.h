@@ -43,6 +43,12 @@ typedef struct UARTRXErrorFlags {
 typedef bool (*UARTRXInterruptHandler)(UARTDevice *dev, uint8_t data,
                                        const UARTRXErrorFlags *err_flags);
 typedef bool (*UARTTXInterruptHandler)(UARTDevice *dev);
+//! The type of function which is called from within the UART ISR while receiving via DMA once the
+//! line goes idle or the DMA buffer is half / completely filled (@see \Ref
+//! uart_set_rx_idle_interrupt_handler)
+//! @return Whether or not the ISR should context switch at the end instead of resuming the previous
+//! task (@see \Ref portEND_SWITCHING_ISR)
+typedef bool (*UARTRXIdleInterruptHandler)(UARTDevice *dev, const UARTRXErrorFlags *err_flags);
 
 //! Initializes the device
 void uart_init(UARTDevice *dev);
@@ -97,6 +103,25 @@ void uart_stop_rx_dma(UARTDevice *dev);
 //! Discards any pending data in the RX DMA buffer
 void uart_clear_rx_dma_buffer(UARTDevice *dev);
 
+//! Sets a handler which is called (within an ISR) when the line goes idle while receiving via DMA,
+//! instead of calling the receive IRQ handler for every byte. The received data is left in the DMA
+//! buffer to be read with uart_get_rx_dma_data() and released with uart_consume_rx_dma_data().
+//! Passing NULL restores the per-byte receive IRQ handler.
+void uart_set_rx_idle_interrupt_handler(UARTDevice *dev, UARTRXIdleInterruptHandler irq_handler);
+
+//! Gets the next contiguous span of data in the RX DMA buffer which hasn't been consumed yet
+//! @param[in] dev The UART device
+//! @param[out] data Set to point at the start of the span within the DMA buffer
+//! @param[out] overrun Set to true if received data was lost because the DMA lapped data which
+//! hadn't been consumed yet or the UART overran, in which case no data is returned until
+//! uart_clear_rx_dma_buffer() is called
+//! @return The length of the span, which is 0 if there is no pending data
+uint32_t uart_get_rx_dma_data(UARTDevice *dev, const uint8_t **data, bool *overrun);
+
+//! Marks the given number of bytes of the RX DMA buffer as consumed. If the DMA overwrote them
+//! while they were being read, the next call to uart_get_rx_dma_data() reports an overrun.
+void uart_consume_rx_dma_data(UARTDevice *dev, uint32_t length);
+
 //! Returns whether or not the peripheral has a byte ready to be read
 bool uart_is_rx_ready(UARTDevice *dev);
 
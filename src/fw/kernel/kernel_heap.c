@@ -19,6 +19,20 @@
 #include "mcu/interrupts.h"
 #include "services/common/analytics/analytics.h"
 
+#ifdef MALLOC_TRACE
+#include "kernel_heap_trace.h"
+
+#include "console/prompt.h"
+#include "util/math.h"
+#include "util/size.h"
+#include "util/string.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+#endif
+
 #define CMSIS_COMPATIBLE
 #include <mcu.h>
 
@@ -47,6 +61,39 @@ static void prv_heap_unlock(void *ctx) {
   }
 }
 
+#ifdef MALLOC_TRACE
+#ifndef KERNEL_HEAP_TRACE_NUM_RECORDS
+#define KERNEL_HEAP_TRACE_NUM_RECORDS (512)
+#endif
+
+//! Kernel heap operations that haven't been dumped yet, see kernel_heap_trace.h
+static struct {
+  KernelHeapTraceRecord records[KERNEL_HEAP_TRACE_NUM_RECORDS];
+  uint16_t num_records;
+  uint32_t num_dropped_records;
+} s_trace;
+
+//! Called with the kernel heap locked, so it can't use the heap and must be quick.
+static void prv_heap_trace(Heap *heap, HeapTraceOp op, void *ptr, size_t nbytes,
+                           uintptr_t client_pc) {
+  if (s_trace.num_records >= ARRAY_LENGTH(s_trace.records)) {
+    s_trace.num_dropped_records++;
+    return;
+  }
+
+  const uint16_t offset = ptr ? (((uintptr_t)ptr - (uintptr_t)heap->begin) /
+                                 KERNEL_HEAP_TRACE_UNIT_SIZE)
+                              : KERNEL_HEAP_TRACE_OFFSET_NULL;
+  s_trace.records[s_trace.num_records++] = (KernelHeapTraceRecord) {
+    .pc = client_pc,
+    .ticks = xTaskGetTickCount(),
+    .offset = offset,
+    .size = MIN(DIVIDE_CEIL(nbytes, KERNEL_HEAP_TRACE_UNIT_SIZE), 0x7FFF),
+    .is_free = (op == HeapTraceOp_Free),
+  };
+}
+#endif
+
 void kernel_heap_init(void) {
   extern int _heap_start;
   extern int _heap_end;
@@ -56,6 +103,9 @@ void kernel_heap_init(void) {
     .lock_function = prv_heap_lock,
     .unlock_function = prv_heap_unlock
   });
+#ifdef MALLOC_TRACE
+  heap_set_trace_handler(&s_kernel_heap, prv_heap_trace);
+#endif
 }
 
 void analytics_external_collect_kernel_heap_stats(void) {
@@ -78,3 +128,44 @@ void command_dump_malloc_kernel(void) {
   heap_dump_malloc_instrumentation_to_dbgserial(&s_kernel_heap);
 }
 #endif
+
+#ifdef MALLOC_TRACE
+static void prv_send_trace_line(const void *data, size_t length) {
+  char buffer[sizeof(KERNEL_HEAP_TRACE_LINE_PREFIX) + 2 * sizeof(KernelHeapTraceHeader)];
+  strcpy(buffer, KERNEL_HEAP_TRACE_LINE_PREFIX);
+  const size_t prefix_length = strlen(KERNEL_HEAP_TRACE_LINE_PREFIX);
+  byte_stream_to_hex_string(buffer + prefix_length, sizeof(buffer) - prefix_length, data, length,
+                            false /* stream_backward */);
+  prompt_send_response(buffer);
+}
+
+//! Prints the records collected since the last dump and removes them from the buffer. Feed the
+//! output to tools/heap_trace.py.
+void command_dump_malloc_trace(void) {
+  prv_heap_lock(NULL);
+  const uint16_t num_records = s_trace.num_records;
+  const uint32_t num_dropped_records = s_trace.num_dropped_records;
+  prv_heap_unlock(NULL);
+
+  const KernelHeapTraceHeader header = {
+    .magic = KERNEL_HEAP_TRACE_MAGIC,
+    .version = KERNEL_HEAP_TRACE_VERSION,
+    .record_size = sizeof(KernelHeapTraceRecord),
+    .num_records = num_records,
+    .heap_size = heap_size(&s_kernel_heap),
+    .num_dropped_records = num_dropped_records,
+  };
+  prv_send_trace_line(&header, sizeof(header));
+  for (uint16_t i = 0; i < num_records; i++) {
+    prv_send_trace_line(&s_trace.records[i], sizeof(KernelHeapTraceRecord));
+  }
+
+  // Sending the response may have used the heap, only drop the records that were printed
+  prv_heap_lock(NULL);
+  memmove(&s_trace.records[0], &s_trace.records[num_records],
+          (s_trace.num_records - num_records) * sizeof(KernelHeapTraceRecord));
+  s_trace.num_records -= num_records;
+  s_trace.num_dropped_records -= num_dropped_records;
+  prv_heap_unlock(NULL);
+}
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//! Format of the kernel heap traces recorded by builds configured with --malloc_trace.
+//!
+//! The "dump malloc trace" prompt command prints a chunk of the trace as "HT:<hex>" lines: one
+//! KernelHeapTraceHeader followed by num_records KernelHeapTraceRecords, in the order the
+//! operations happened. The records are removed from the watch once they've been dumped, so a
+//! long trace is the concatenation of all the chunks dumped since boot.
+//! tools/heap_trace.py turns a serial log into a binary trace and replays it with the
+//! heap_trace_replay host tool (tools/heap_trace), which runs it against src/libutil/heap.c.
+//! This header is shared between the firmware and the host tool, so keep it free of firmware
+//! dependencies.
+
+#include "util/attributes.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KERNEL_HEAP_TRACE_MAGIC (0x54525448) // "HTRT"
+#define KERNEL_HEAP_TRACE_VERSION (1)
+
+//! Offsets and sizes in the trace are in units of this many bytes
+#define KERNEL_HEAP_TRACE_UNIT_SIZE (4)
+
+//! Offset of a malloc that failed
+#define KERNEL_HEAP_TRACE_OFFSET_NULL ((uint16_t)0xFFFF)
+
+//! Prefix of the lines printed by the "dump malloc trace" prompt command
+#define KERNEL_HEAP_TRACE_LINE_PREFIX "HT:"
+
+typedef struct PACKED {
+  uint32_t magic;
+  uint8_t version;
+  //! sizeof(KernelHeapTraceRecord), so that the record can grow
+  uint8_t record_size;
+  //! Number of records that follow this header
+  uint16_t num_records;
+  //! Size of the traced heap in bytes
+  uint32_t heap_size;
+  //! Number of records that were dropped before this chunk because the buffer on the watch was
+  //! full. A trace with dropped records can't be replayed faithfully.
+  uint32_t num_dropped_records;
+} KernelHeapTraceHeader;
+
+typedef struct PACKED {
+  //! Caller of the malloc or free
+  uint32_t pc;
+  //! RTC ticks since boot at the time of the operation
+  uint32_t ticks;
+  //! Offset of the buffer from the start of the heap, in units of KERNEL_HEAP_TRACE_UNIT_SIZE.
+  //! KERNEL_HEAP_TRACE_OFFSET_NULL if the malloc failed.
+  uint16_t offset;
+  //! Requested size of a malloc or usable size of a freed block, in units of
+  //! KERNEL_HEAP_TRACE_UNIT_SIZE, rounded up
+  uint16_t size:15;
+  bool is_free:1;
+} KernelHeapTraceRecord;
+
+_Static_assert(sizeof(KernelHeapTraceRecord) == 12, "KernelHeapTraceRecord changed size");
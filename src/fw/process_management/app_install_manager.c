@@ -67,6 +67,26 @@ typedef struct RecentAppCache {
 
 static RecentAppCache s_recent_apps;
 
+//! An AppInstallEntry of an app in the app db, along with the generation of the app db it was
+//! read from.
+typedef struct CachedAppEntry {
+  AppInstallId id;
+  uint32_t app_db_generation;
+  AppInstallEntry entry;
+} CachedAppEntry;
+
+// The number of app db entries to keep decoded. The launcher, glances and app message routing
+// tend to ask about the same few apps over and over again.
+#define NUM_CACHED_APP_ENTRIES 4
+
+typedef struct AppEntryCache {
+  PebbleRecursiveMutex *mutex;
+  CircularCache cache;
+  uint8_t cache_buffer[NUM_CACHED_APP_ENTRIES * sizeof(CachedAppEntry)];
+} AppEntryCache;
+
+static AppEntryCache s_app_entries;
+
 //! timeout for an app that has OnCommunication visibility (given in seconds)
 static int32_t VISIBILITY_ON_ACTIVITY_TIMEOUT_SECONDS = (5 * SECONDS_PER_MINUTE);
 
@@ -558,6 +578,13 @@ static int prv_cmp_recent_apps(void *a, void *b) {
   return !(app_a->id == app_b->id);
 }
 
+static int prv_cmp_cached_app_entries(void *a, void *b) {
+  CachedAppEntry *entry_a = (CachedAppEntry *)a;
+  CachedAppEntry *entry_b = (CachedAppEntry *)b;
+
+  return !(entry_a->id == entry_b->id);
+}
+
 // PBL-31769: This should be moved to send_text.c
 #if !PLATFORM_TINTIN && defined(APP_ID_SEND_TEXT)
 static void prv_capabilities_changed_event_handler(PebbleEvent *event, void *context) {
@@ -578,6 +605,11 @@ void app_install_manager_init(void) {
                       NUM_RECENT_APPS, prv_cmp_recent_apps);
   s_recent_apps.mutex = mutex_create_recursive();
 
+  memset(s_app_entries.cache_buffer, 0, sizeof(s_app_entries.cache_buffer));
+  circular_cache_init(&s_app_entries.cache, s_app_entries.cache_buffer, sizeof(CachedAppEntry),
+                      NUM_CACHED_APP_ENTRIES, prv_cmp_cached_app_entries);
+  s_app_entries.mutex = mutex_create_recursive();
+
   // PBL-31769: This should be moved to send_text.c
 #if !PLATFORM_TINTIN && defined(APP_ID_SEND_TEXT)
   s_capabilities_event_info = (EventServiceInfo) {
@@ -727,6 +759,42 @@ bool prv_app_install_entry_from_fw_registry_entry(const AppRegistryEntry *reg_en
   return true;
 }
 
+//! @return true if a current copy of the entry of the app db app was found in the cache
+static bool prv_get_cached_app_db_entry(AppInstallId install_id, AppInstallEntry *entry) {
+  bool rv = false;
+  mutex_lock_recursive(s_app_entries.mutex);
+  {
+    CachedAppEntry *cached = circular_cache_get(&s_app_entries.cache, &install_id);
+    if (cached && (cached->app_db_generation == app_db_get_generation())) {
+      *entry = cached->entry;
+      rv = true;
+    }
+  }
+  mutex_unlock_recursive(s_app_entries.mutex);
+  return rv;
+}
+
+static void prv_cache_app_db_entry(AppInstallId install_id, uint32_t app_db_generation,
+                                   const AppInstallEntry *entry) {
+  mutex_lock_recursive(s_app_entries.mutex);
+  {
+    CachedAppEntry *cached = circular_cache_get(&s_app_entries.cache, &install_id);
+    if (cached) {
+      // Replace the outdated copy
+      cached->app_db_generation = app_db_generation;
+      cached->entry = *entry;
+    } else {
+      CachedAppEntry new_entry = {
+        .id = install_id,
+        .app_db_generation = app_db_generation,
+        .entry = *entry,
+      };
+      circular_cache_push(&s_app_entries.cache, &new_entry);
+    }
+  }
+  mutex_unlock_recursive(s_app_entries.mutex);
+}
+
 bool app_install_get_entry_for_install_id(AppInstallId install_id, AppInstallEntry *entry) {
   if ((install_id == INSTALL_ID_INVALID) || (entry == NULL)) {
     return false;
@@ -753,18 +821,25 @@ bool app_install_get_entry_for_install_id(AppInstallId install_id, AppInstallEnt
       entry->record_order = record_order;
     }
     return rv;
-  } else if (app_db_exists_install_id(install_id)) {
-    AppDBEntry *db_entry = kernel_malloc_check(sizeof(AppDBEntry));
-    bool rv = (app_db_get_app_entry_for_install_id(install_id, db_entry) == S_SUCCESS);
-    if (rv) {
-      rv = prv_app_install_entry_from_app_db_entry(install_id, db_entry, entry);
-    }
-    kernel_free(db_entry);
-    return rv;
+  } else if (prv_get_cached_app_db_entry(install_id, entry)) {
+    return true;
   }
 
-  PBL_LOG(LOG_LEVEL_ERROR, "Failed to get entry for id %"PRId32, install_id);
-  return false;
+  // Sample the generation before reading, so that the entry isn't cached if it changes meanwhile
+  const uint32_t app_db_generation = app_db_get_generation();
+  AppDBEntry *db_entry = kernel_malloc_check(sizeof(AppDBEntry));
+  bool rv = (app_db_get_app_entry_for_install_id(install_id, db_entry) == S_SUCCESS);
+  if (rv) {
+    rv = prv_app_install_entry_from_app_db_entry(install_id, db_entry, entry);
+  }
+  kernel_free(db_entry);
+
+  if (!rv) {
+    PBL_LOG(LOG_LEVEL_ERROR, "Failed to get entry for id %"PRId32, install_id);
+    return false;
+  }
+  prv_cache_app_db_entry(install_id, app_db_generation, entry);
+  return true;
 }
 
 bool app_install_get_uuid_for_install_id(AppInstallId install_id, Uuid *uuid_out) {
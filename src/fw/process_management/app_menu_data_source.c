@@ -331,7 +331,8 @@ static void prv_load_list_item_icon(AppMenuDataSource *source, AppMenuNode *node
 
   if (node->icon_resource_id != RESOURCE_ID_INVALID) {
     // If we have some sort of valid resource_id, try loading it
-    node->icon = gbitmap_create_with_resource_system(node->app_num, node->icon_resource_id);
+    node->icon = gbitmap_create_with_resource_system_cached(node->app_num,
+                                                            node->icon_resource_id);
   }
 
   if (!node->icon) {
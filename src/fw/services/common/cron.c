@@ -31,29 +31,113 @@ static RegularTimerInfo s_regular = {
   .cb = prv_timer_callback,
 };
 
-// List of jobs sorted from soonest to farthest.
-static ListNode *s_scheduled_jobs;
+//! The scheduled jobs, kept as a binary min-heap ordered by execution time. Jobs with the same
+//! execution time are ordered by when they were scheduled. Each job keeps track of its own
+//! position in the heap, so finding and removing a job doesn't need to search the heap.
+//! The heap is statically sized so that scheduling a job never has to allocate.
+typedef struct {
+  CronJob *jobs[CRON_MAX_JOBS];
+  uint16_t count;
+} CronHeap;
+
+static CronHeap s_scheduled_jobs;
+static uint32_t s_next_schedule_seq;
 
 // -------------------------------------------------------------------------------------------
 static bool prv_is_scheduled(CronJob *job) {
   // Assumes mutex lock is already taken
-  return list_contains(s_scheduled_jobs, &job->list_node);
+  return (job->heap_index < s_scheduled_jobs.count &&
+          s_scheduled_jobs.jobs[job->heap_index] == job);
 }
 
-static int prv_sort(void *a, void *b) {
-  CronJob *job_a = (CronJob*)a;
-  CronJob *job_b = (CronJob*)b;
-  return job_b->cached_execute_time - job_a->cached_execute_time;
+static bool prv_runs_before(const CronJob *job_a, const CronJob *job_b) {
+  if (job_a->cached_execute_time != job_b->cached_execute_time) {
+    return job_a->cached_execute_time < job_b->cached_execute_time;
+  }
+  return (int32_t)(job_a->schedule_seq - job_b->schedule_seq) < 0;
+}
+
+static void prv_heap_set(uint16_t index, CronJob *job) {
+  s_scheduled_jobs.jobs[index] = job;
+  job->heap_index = index;
+}
+
+static void prv_heap_sift_up(uint16_t index) {
+  CronJob *job = s_scheduled_jobs.jobs[index];
+  while (index > 0) {
+    const uint16_t parent = (index - 1) / 2;
+    if (!prv_runs_before(job, s_scheduled_jobs.jobs[parent])) {
+      break;
+    }
+    prv_heap_set(index, s_scheduled_jobs.jobs[parent]);
+    index = parent;
+  }
+  prv_heap_set(index, job);
+}
+
+static void prv_heap_sift_down(uint16_t index) {
+  CronJob *job = s_scheduled_jobs.jobs[index];
+  while (true) {
+    const uint16_t left = (2 * index) + 1;
+    if (left >= s_scheduled_jobs.count) {
+      break;
+    }
+    const uint16_t right = left + 1;
+    uint16_t child = left;
+    if (right < s_scheduled_jobs.count &&
+        prv_runs_before(s_scheduled_jobs.jobs[right], s_scheduled_jobs.jobs[left])) {
+      child = right;
+    }
+    if (!prv_runs_before(s_scheduled_jobs.jobs[child], job)) {
+      break;
+    }
+    prv_heap_set(index, s_scheduled_jobs.jobs[child]);
+    index = child;
+  }
+  prv_heap_set(index, job);
+}
+
+//! Restores the heap order after the execution time of the job at the index has changed.
+static void prv_heap_update(uint16_t index) {
+  if (index > 0 &&
+      prv_runs_before(s_scheduled_jobs.jobs[index], s_scheduled_jobs.jobs[(index - 1) / 2])) {
+    prv_heap_sift_up(index);
+  } else {
+    prv_heap_sift_down(index);
+  }
+}
+
+static void prv_heap_add(CronJob *job) {
+  PBL_ASSERT(s_scheduled_jobs.count < CRON_MAX_JOBS, "Too many cron jobs scheduled");
+  job->schedule_seq = s_next_schedule_seq++;
+  prv_heap_set(s_scheduled_jobs.count++, job);
+  prv_heap_sift_up(job->heap_index);
+}
+
+static void prv_heap_remove(CronJob *job) {
+  const uint16_t index = job->heap_index;
+  CronJob *last_job = s_scheduled_jobs.jobs[--s_scheduled_jobs.count];
+  if (last_job != job) {
+    prv_heap_set(index, last_job);
+    prv_heap_update(index);
+  }
+}
+
+static void prv_heap_clear(void) {
+  s_scheduled_jobs.count = 0;
+}
+
+static CronJob *prv_heap_peek(void) {
+  return (s_scheduled_jobs.count > 0) ? s_scheduled_jobs.jobs[0] : NULL;
 }
 
 // -------------------------------------------------------------------------------------------
 static void prv_timer_callback(void* data) {
   mutex_lock(s_list_mutex);
-  while (s_scheduled_jobs != NULL &&
-         ((CronJob*)s_scheduled_jobs)->cached_execute_time <= rtc_get_time()) {
-    CronJob *job = (CronJob*)s_scheduled_jobs;
-    // Remove the job from the list, it's done.
-    s_scheduled_jobs = list_pop_head(s_scheduled_jobs);
+  CronJob *job;
+  while ((job = prv_heap_peek()) != NULL && job->cached_execute_time <= rtc_get_time()) {
+    // Remove the job from the schedule, it's done.
+    prv_heap_remove(job);
 
     // Release the mutex while we execute the callback
     mutex_unlock(s_list_mutex);
@@ -70,22 +154,18 @@ void cron_service_handle_clock_change(PebbleSetTimeEvent *set_time_info) {
   const bool must_recalc = set_time_info->gmt_offset_delta != 0 || set_time_info->dst_changed;
   // Because it's ABS, it'll be unsigned. This makes the compiler behave.
   const uint32_t change_diff = ABS(set_time_info->utc_time_delta);
-  // Need to re-build the list somewhere else
-  ListNode *newlist = NULL;
-  while (s_scheduled_jobs != NULL) {
-    CronJob* job = (CronJob*)s_scheduled_jobs;
-    s_scheduled_jobs = list_pop_head(s_scheduled_jobs);
-    // Re-calculate the execute time.
+  // Re-calculate all the execute times first, then restore the heap order in one go.
+  for (uint16_t i = 0; i < s_scheduled_jobs.count; i++) {
+    CronJob *job = s_scheduled_jobs.jobs[i];
     // See the notes in the API header on how this works.
     if (must_recalc || change_diff >= job->clock_change_tolerance) {
       job->cached_execute_time = cron_job_get_execute_time(job);
     }
     PBL_LOG(LOG_LEVEL_INFO, "Cron job rescheduled for %ld", job->cached_execute_time);
-
-    newlist = list_sorted_add(newlist, &job->list_node, prv_sort, true);
   }
-  // Then move it back to the static
-  s_scheduled_jobs = newlist;
+  for (int i = (s_scheduled_jobs.count / 2) - 1; i >= 0; i--) {
+    prv_heap_sift_down(i);
+  }
 
   mutex_unlock(s_list_mutex);
 
@@ -98,7 +178,7 @@ void cron_service_init(void) {
   PBL_ASSERTN(s_list_mutex == NULL);
 
   s_list_mutex = mutex_create();
-  s_scheduled_jobs = NULL;
+  s_scheduled_jobs = (CronHeap) {};
 
   regular_timer_add_seconds_callback(&s_regular);
 }
@@ -112,9 +192,11 @@ time_t cron_job_schedule(CronJob *job) {
   const time_t now = rtc_get_time();
   // Always update the execution time.
   job->cached_execute_time = cron_job_get_execute_time_from_epoch(job, now);
-  // If not scheduled yet, schedule it.
+  // If not scheduled yet, schedule it. Otherwise move it to its new place in the schedule.
   if (!prv_is_scheduled(job)) {
-    s_scheduled_jobs = list_sorted_add(s_scheduled_jobs, &job->list_node, prv_sort, true);
+    prv_heap_add(job);
+  } else {
+    prv_heap_update(job->heap_index);
   }
   PBL_LOG(LOG_LEVEL_DEBUG, "Cron job scheduled for %ld (%+ld)", job->cached_execute_time,
           (job->cached_execute_time - now));
@@ -137,13 +219,12 @@ time_t cron_job_schedule_after(CronJob *job, CronJob *new_job) {
 
   // copy schedule info from existing job
   CronJob temp_job = *job;
-  list_init(&temp_job.list_node);
   temp_job.cb = new_job->cb;
   temp_job.cb_data = new_job->cb_data;
   *new_job = temp_job;
 
-  // insert after in the list, which guarantees it gets executed after
-  list_insert_after(&job->list_node, &new_job->list_node);
+  // new_job gets a later schedule_seq than job, which guarantees it gets executed after
+  prv_heap_add(new_job);
   PBL_LOG(LOG_LEVEL_DEBUG, "Cron job scheduled for %ld", job->cached_execute_time);
 
   mutex_unlock(s_list_mutex);
@@ -169,7 +250,7 @@ bool cron_job_unschedule(CronJob *job) {
   mutex_lock(s_list_mutex);
 
   if (prv_is_scheduled(job)) {
-    list_remove(&job->list_node, &s_scheduled_jobs, NULL);
+    prv_heap_remove(job);
     removed = true;
   }
 
@@ -183,16 +264,7 @@ bool cron_job_unschedule(CronJob *job) {
 
 void cron_clear_all_jobs(void) {
   mutex_lock(s_list_mutex);
-
-  // Iterate over all the jobs to remove them all.
-  for (ListNode* iter = s_scheduled_jobs; iter != NULL; ) {
-    CronJob* job = (CronJob*)iter;
-    iter = list_get_next(iter);
-    // Remove the job from the list.
-    list_remove(&job->list_node, NULL, NULL);
-  }
-  s_scheduled_jobs = NULL;
-
+  prv_heap_clear();
   mutex_unlock(s_list_mutex);
 }
 
@@ -208,7 +280,7 @@ void cron_service_deinit(void) {
 uint32_t cron_service_get_job_count(void) {
   uint32_t count = 0;
   mutex_lock(s_list_mutex);
-  count = list_count(s_scheduled_jobs);
+  count = s_scheduled_jobs.count;
   mutex_unlock(s_list_mutex);
   return count;
 }
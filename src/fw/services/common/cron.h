@@ -23,6 +23,11 @@
 //! Properly handles DST, etc.
 //! This file is for controlling the service itself. The actual job API is in <pebbleos/cron.h>
 
+//! The maximum number of jobs which may be scheduled at once. Cron jobs are owned by services
+//! which only ever schedule a handful of them, so this is a fixed limit rather than a heap
+//! allocation which could fail when a job is scheduled.
+#define CRON_MAX_JOBS 16
+
 //! Initialize the cron service.
 void cron_service_init(void);
 
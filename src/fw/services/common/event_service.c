@@ -30,6 +30,7 @@
 #include "FreeRTOS.h"
 #include "queue.h"
 
+#include <stddef.h>
 #include <string.h>
 
 typedef struct {
@@ -40,7 +41,6 @@ typedef struct {
 } EventServiceEntry;
 
 typedef struct {
-  ListNode list_node;
   void *ptr;
   // There is an intent bit for each task + a special "claimed" bit
   uint16_t intents_pending;
@@ -48,19 +48,39 @@ typedef struct {
 
 static const uint16_t CLAIMED_BIT = (1 << NumPebbleTask);
 
-static EventServiceBuffer *s_event_service_buffers = NULL;
+//! The number of stolen event buffers that can be tracked without allocating. A buffer is held
+//! until every subscribed task has handled its event, so this only needs to cover the events
+//! that are in flight at the same time.
+#define EVENT_SERVICE_NUM_BUFFER_SLOTS 16
+
+//! Stolen event buffers, placed at the slot their pointer hashes to (or the next free one).
+//! A slot is free when its ptr is NULL. Slots are only taken on KernelMain, but can be released
+//! from any task once the last intent has been cleared.
+static EventServiceBuffer s_event_service_buffer_slots[EVENT_SERVICE_NUM_BUFFER_SLOTS];
+
+//! Buffers that didn't fit into the slot table
+typedef struct {
+  ListNode list_node;
+  EventServiceBuffer esb;
+} EventServiceOverflowBuffer;
+
+static EventServiceOverflowBuffer *s_event_service_overflow_buffers = NULL;
 
 // We dynamically allocate one of these for every service UUID that either a client subscribes to or a service
 // publishes an event to.
-typedef struct {
-  ListNode  list_node;
+typedef struct EventPluginUUIDEntry {
+  struct EventPluginUUIDEntry *next;          // next entry in the same bucket
   uint16_t  service_index;                    // index of the service
   Uuid      uuid;                             // UUID
 } EventPluginUUIDEntry;
 
+#define EVENT_PLUGIN_NUM_BUCKETS 8
+
 static uint16_t s_next_service_index = 0;
-static ListNode s_plugin_list;
-// This mutex guards the s_plugin_list linked list
+//! Registered plugin services, hashed by UUID. Entries are never removed and are only published
+//! once fully initialized, so lookups don't need to take the mutex.
+static EventPluginUUIDEntry *s_plugin_buckets[EVENT_PLUGIN_NUM_BUCKETS];
+// This mutex guards adding entries to s_plugin_buckets
 static PebbleMutex *s_plugin_list_mutex = NULL;
 
 // There's an event service for each event so that
@@ -189,6 +209,74 @@ static bool prv_task_is_masked_out(PebbleEvent *e, PebbleTask task) {
   return (e->task_mask & task_bit);
 }
 
+// -------------------------------------------------------------------------------------------------
+static unsigned int prv_get_buffer_slot_index(const void *buf) {
+  // Heap allocations are at least 8 byte aligned
+  return (((uintptr_t)buf) >> 3) % EVENT_SERVICE_NUM_BUFFER_SLOTS;
+}
+
+static bool prv_is_buffer_slot(const EventServiceBuffer *esb) {
+  return (esb >= &s_event_service_buffer_slots[0] &&
+          esb < &s_event_service_buffer_slots[EVENT_SERVICE_NUM_BUFFER_SLOTS]);
+}
+
+static void prv_add_esb(void *buf, uint16_t intents_pending) {
+  const unsigned int start_index = prv_get_buffer_slot_index(buf);
+  for (unsigned int i = 0; i < EVENT_SERVICE_NUM_BUFFER_SLOTS; i++) {
+    EventServiceBuffer *esb =
+        &s_event_service_buffer_slots[(start_index + i) % EVENT_SERVICE_NUM_BUFFER_SLOTS];
+    if (__atomic_load_n(&esb->ptr, __ATOMIC_ACQUIRE) == NULL) {
+      esb->intents_pending = intents_pending;
+      // Setting the pointer last makes the slot visible to the other tasks, and the release
+      // ensures they see the intents before they see the pointer
+      __atomic_store_n(&esb->ptr, buf, __ATOMIC_RELEASE);
+      return;
+    }
+  }
+
+  EventServiceOverflowBuffer *entry = kernel_zalloc_check(sizeof(EventServiceOverflowBuffer));
+  entry->esb = (EventServiceBuffer) {
+    .ptr = buf,
+    .intents_pending = intents_pending,
+  };
+  list_init(&entry->list_node);
+  s_event_service_overflow_buffers = (EventServiceOverflowBuffer *)list_prepend(
+      (ListNode *)s_event_service_overflow_buffers, &entry->list_node);
+}
+
+static bool prv_overflow_buffer_find(ListNode *found_node, void *data) {
+  EventServiceOverflowBuffer *entry = (EventServiceOverflowBuffer *)found_node;
+  return (entry->esb.ptr == data);
+}
+
+static EventServiceBuffer *prv_find_esb(void *buf) {
+  const unsigned int start_index = prv_get_buffer_slot_index(buf);
+  for (unsigned int i = 0; i < EVENT_SERVICE_NUM_BUFFER_SLOTS; i++) {
+    EventServiceBuffer *esb =
+        &s_event_service_buffer_slots[(start_index + i) % EVENT_SERVICE_NUM_BUFFER_SLOTS];
+    if (__atomic_load_n(&esb->ptr, __ATOMIC_ACQUIRE) == buf) {
+      return esb;
+    }
+  }
+
+  EventServiceOverflowBuffer *entry = (EventServiceOverflowBuffer *)list_find(
+      (ListNode *)s_event_service_overflow_buffers, prv_overflow_buffer_find, buf);
+  return entry ? &entry->esb : NULL;
+}
+
+//! Stops tracking the buffer. Doesn't free the buffer itself.
+static void prv_remove_esb(EventServiceBuffer *esb) {
+  if (prv_is_buffer_slot(esb)) {
+    // Hand the slot back to KernelMain only once we're done with it
+    __atomic_store_n(&esb->ptr, NULL, __ATOMIC_RELEASE);
+    return;
+  }
+  EventServiceOverflowBuffer *entry =
+      (EventServiceOverflowBuffer *)((uint8_t *)esb - offsetof(EventServiceOverflowBuffer, esb));
+  list_remove(&entry->list_node, (ListNode **)&s_event_service_overflow_buffers, NULL);
+  kernel_free(entry);
+}
+
 static bool prv_steal_buffer(void *buf, EventServiceEntry *service, PebbleEvent *e) {
   uint16_t intents_pending =  0;
 
@@ -200,12 +288,7 @@ static bool prv_steal_buffer(void *buf, EventServiceEntry *service, PebbleEvent
   }
 
   if (intents_pending) {
-    EventServiceBuffer *esb = kernel_zalloc_check(sizeof(EventServiceBuffer));
-    esb->ptr = buf;
-    esb->intents_pending = intents_pending;
-    list_init(&esb->list_node);
-    s_event_service_buffers = (EventServiceBuffer *)list_prepend(
-        (ListNode *)s_event_service_buffers, (ListNode *)esb);
+    prv_add_esb(buf, intents_pending);
     return true; // we stole the buffer
   } else {
     return false;
@@ -264,18 +347,11 @@ void event_service_handle_event(PebbleEvent *e) {
 }
 
 // -------------------------------------------------------------------------------------------------
-static bool prv_buffer_find(ListNode *found_node, void *data) {
-  EventServiceBuffer *esb = (EventServiceBuffer *)found_node;
-  return (esb->ptr == data);
-}
-
 static EventServiceBuffer* prv_get_esb_for_event(PebbleEvent *e) {
   void **buf_ptr = event_get_buffer(e);
   EventServiceBuffer *esb = NULL;
   if (buf_ptr && *buf_ptr) {
-    esb = (EventServiceBuffer *)list_find((ListNode *)s_event_service_buffers,
-                                          prv_buffer_find,
-                                          *buf_ptr);
+    esb = prv_find_esb(*buf_ptr);
   }
   return esb;
 }
@@ -308,44 +384,64 @@ void event_service_free_claimed_buffer(void *ref) {
     uint16_t intents_pending =  __sync_and_and_fetch(&esb->intents_pending, ~CLAIMED_BIT);
 
     if (!intents_pending) {
-      list_remove((ListNode *)esb, (ListNode **)&s_event_service_buffers, NULL);
-      if (esb->ptr) {
-        kernel_free(esb->ptr);
-        esb->ptr = NULL;
-      }
-      kernel_free(esb);
+      void *buf = esb->ptr;
+      prv_remove_esb(esb);
+      kernel_free(buf);
     }
   }
 }
 
 // ---------------------------------------------------------------------------------------------------------------
-static bool prv_service_filter(ListNode *node, void *tp) {
-  EventPluginUUIDEntry *info = (EventPluginUUIDEntry *)node;
-  return uuid_equal(&info->uuid, (Uuid *)tp);
+static EventPluginUUIDEntry **prv_get_plugin_bucket(const Uuid *uuid) {
+  const uint8_t *bytes = (const uint8_t *)uuid;
+  uint8_t hash = 0;
+  for (unsigned int i = 0; i < sizeof(Uuid); i++) {
+    hash ^= bytes[i];
+  }
+  return &s_plugin_buckets[hash % EVENT_PLUGIN_NUM_BUCKETS];
+}
+
+static EventPluginUUIDEntry *prv_find_plugin_entry(EventPluginUUIDEntry *bucket,
+                                                   const Uuid *uuid) {
+  for (EventPluginUUIDEntry *entry = bucket; entry; entry = entry->next) {
+    if (uuid_equal(&entry->uuid, uuid)) {
+      return entry;
+    }
+  }
+  return NULL;
 }
 
 // ---------------------------------------------------------------------------------------------------------------
-// TODO: We need to prune out entries from this list when they are no longer needed
+// TODO: We need to prune out entries from this registry when they are no longer needed
 // TODO: The applib should force a restriction on the number of plugin service UUIDs that an app can subscribe
 //          to at once.
 static int16_t prv_get_plugin_index(const Uuid *uuid) {
   int16_t result = -1;
+  EventPluginUUIDEntry **bucket = prv_get_plugin_bucket(uuid);
+
+  // Look for this service UUID
+  EventPluginUUIDEntry *found =
+      prv_find_plugin_entry(__atomic_load_n(bucket, __ATOMIC_ACQUIRE), uuid);
+  if (found) {
+    return found->service_index;
+  }
 
   mutex_lock(s_plugin_list_mutex);
 
-  // Look for this service UUID
-  ListNode *found;
-  ListNode *list = &s_plugin_list;
-  found = list_find(list, prv_service_filter, (void*)uuid);
+  // Check again, another task might have registered it in the mean time
+  found = prv_find_plugin_entry(*bucket, uuid);
   if (found) {
-    result = ((EventPluginUUIDEntry *)found)->service_index;
+    result = found->service_index;
     goto unlock;
   }
 
   EventPluginUUIDEntry *entry = kernel_zalloc_check(sizeof(EventPluginUUIDEntry));
   entry->service_index = ++s_next_service_index;
   entry->uuid = *uuid;
-  list_append(list, &entry->list_node);
+  entry->next = *bucket;
+  // Publishing the entry last makes it visible to lookups that don't hold the mutex, and the
+  // release ensures they never see it before it has been filled in
+  __atomic_store_n(bucket, entry, __ATOMIC_RELEASE);
   result = entry->service_index;
 
   char uuid_buffer[UUID_STRING_BUFFER_LENGTH];
@@ -386,8 +482,7 @@ DEFINE_SYSCALL(void, sys_event_service_cleanup, PebbleEvent *e) {
       *buf_ptr = NULL;
     } else {
       // free the EventServiceBuffer and free the data
-      list_remove((ListNode *)esb, (ListNode **)&s_event_service_buffers, NULL);
-      kernel_free(esb);
+      prv_remove_esb(esb);
 
       event_deinit(e);
     }
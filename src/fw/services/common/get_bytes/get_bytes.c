@@ -22,7 +22,9 @@
 #include "flash_region/flash_region.h"
 #include "kernel/events.h"
 #include "kernel/pbl_malloc.h"
+#include "services/common/comm_session/protocol.h"
 #include "services/common/comm_session/session_send_buffer.h"
+#include "services/common/comm_session/session_send_queue.h"
 #include "services/common/get_bytes/get_bytes_storage.h"
 #include "services/common/system_task.h"
 #include "services/normal/filesystem/pfs.h"
@@ -41,16 +43,42 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-// Internal state used by the protocol handler.
+//! The number of data messages which can be queued up at once. While one message is being sent
+//! out, the next chunk is read from storage into the other.
+#define GET_BYTES_NUM_SEND_JOBS 2
+
+typedef struct GetBytesState GetBytesState;
+
+//! A data message which the send queue reads directly out of, so the chunks are read from storage
+//! straight into the message and never copied into a separate send buffer.
 typedef struct {
+  //! @note This is the first field, so that we can cast between the two types
+  SessionSendQueueJob queue_job;
+  GetBytesState *state;
+  //! Length of the message (including the Pebble Protocol header)
+  size_t length;
+  //! Number of bytes of the message which have been consumed by the transport
+  size_t consumed_length;
+  //! The Pebble Protocol header, followed by a GetBytesRspObjectData and the data
+  uint8_t message[];
+} GetBytesSendJob;
+
+// Internal state used by the protocol handler.
+typedef struct GetBytesState {
   CommSession *session;
   GetBytesObjectType object_type;
   uint8_t transaction_id;
   uint32_t num_bytes;
-  bool sent_header;
   GetBytesStorage storage;
   TickType_t start_ticks;
   SlaveConnEventStats conn_event_stats;
+  //! The maximum number of bytes of the object which fit in a single data message
+  uint32_t max_chunk_len;
+  GetBytesSendJob *send_jobs[GET_BYTES_NUM_SEND_JOBS];
+  //! The number of send jobs which have been queued up and not yet freed by the send queue
+  uint8_t num_jobs_in_flight;
+  //! Set if a data message couldn't be sent out completely (i.e. the session disconnected)
+  bool failed;
 } GetBytesState;
 
 
@@ -110,103 +138,191 @@ static void prv_gather_and_record_stats(GetBytesState *state) {
 }
 
 // -----------------------------------------------------------------------------------------------
-static void prv_protocol_send_next_chunk(void* raw_state) {
-  GetBytesState* state = (GetBytesState*)raw_state;
-
-  // -------------------------------------------------------------------------------------------
-  // Did we fetch the total size yet? If not, walk through all the chunks getting the total size
-  if (state->num_bytes == 0) {
-    uint32_t size;
-    // read the size of object from storage
-    GetBytesInfoErrorCode rv = gb_storage_get_size(&state->storage, &size);
-    if (rv != GET_BYTES_OK) {
-      prv_protocol_send_err_response(state->session, state->transaction_id, rv);
-      goto cleanup;
-    }
-    state->num_bytes = size;
-    PBL_LOG(LOG_LEVEL_DEBUG, "GET_BYTES: total bytes: %ld", state->num_bytes);
-  }
+// Interfaces towards Send Queue:
+// NOTE: These are called with bt_lock() held
 
-  // -------------------------------------------------------------------------------------------
-  // Send next chunk out
-  uint32_t remaining_bytes = state->num_bytes - state->storage.current_offset;
-  uint32_t packet_len;
+static size_t prv_send_job_impl_get_length(const SessionSendQueueJob *send_job) {
+  const GetBytesSendJob *job = (const GetBytesSendJob *)send_job;
+  return (job->length - job->consumed_length);
+}
 
-  uint32_t data_len = 0;
-  if (state->sent_header) {
-    uint32_t max_buf_len = comm_session_send_buffer_get_max_payload_length(state->session);
-    if (max_buf_len == 0) {
-      // Session disconnected in the mean time
-      packet_len = 0;
-    } else {
-      data_len = MIN(remaining_bytes, max_buf_len - sizeof(GetBytesRspObjectData));
-      packet_len = data_len + sizeof(GetBytesRspObjectData);
-    }
+static size_t prv_send_job_impl_copy(const SessionSendQueueJob *send_job, int start_offset,
+                                     size_t length, uint8_t *data_out) {
+  const GetBytesSendJob *job = (const GetBytesSendJob *)send_job;
+  const size_t length_after_offset = (job->length - job->consumed_length - start_offset);
+  const size_t length_to_copy = MIN(length_after_offset, length);
+  memcpy(data_out, job->message + job->consumed_length + start_offset, length_to_copy);
+  return length_to_copy;
+}
+
+static size_t prv_send_job_impl_get_read_pointer(const SessionSendQueueJob *send_job,
+                                                 const uint8_t **data_out) {
+  const GetBytesSendJob *job = (const GetBytesSendJob *)send_job;
+  *data_out = job->message + job->consumed_length;
+  return (job->length - job->consumed_length);
+}
+
+static void prv_send_job_impl_consume(const SessionSendQueueJob *send_job, size_t length) {
+  GetBytesSendJob *job = (GetBytesSendJob *)send_job;
+  job->consumed_length += length;
+}
+
+static void prv_handle_send_job_done(void *data);
+
+static void prv_send_job_impl_free(SessionSendQueueJob *send_job) {
+  // This is the signal that there's space to send the next chunk. Reading it from storage can't be
+  // done while bt_lock() is held, so defer that to KernelBG.
+  system_task_add_callback(prv_handle_send_job_done, send_job);
+}
+
+static const SessionSendJobImpl s_get_bytes_send_job_impl = {
+  .get_length = prv_send_job_impl_get_length,
+  .copy = prv_send_job_impl_copy,
+  .get_read_pointer = prv_send_job_impl_get_read_pointer,
+  .consume = prv_send_job_impl_consume,
+  .free = prv_send_job_impl_free,
+};
+
+// -----------------------------------------------------------------------------------------------
+static void prv_finish(GetBytesState *state) {
+  const bool successful = !state->failed;
+  if (successful) {
+    prv_gather_and_record_stats(state);
   } else {
-    packet_len = sizeof(GetBytesRspObjectInfo);
+    PBL_LOG(LOG_LEVEL_ERROR, "GET_BYTES: aborted");
   }
 
-  SendBuffer *sb;
-  if (packet_len == 0 ||
-      !(sb = comm_session_send_buffer_begin_write(state->session, GET_BYTES_ENDPOINT_ID, packet_len,
-                                                  COMM_SESSION_DEFAULT_TIMEOUT))) {
-    // If timeout, try again
-    // MT: What if the session got disconnected?
-    system_task_add_callback(prv_protocol_send_next_chunk, state);
-    return;
+  // If all done, mark the image as "read" and free up our state structure
+  gb_storage_cleanup(&state->storage, successful);
+  comm_session_set_responsiveness(state->session, BtConsumerPpGetBytes, ResponseTimeMax, 0);
+  for (int i = 0; i < GET_BYTES_NUM_SEND_JOBS; i++) {
+    kernel_free(state->send_jobs[i]);
   }
+  kernel_free(state);
 
-  if (state->sent_header) {
-    // Send next chunk of data
-    GetBytesRspObjectData* rsp = (GetBytesRspObjectData *) kernel_zalloc_check(packet_len);
-    *rsp = (GetBytesRspObjectData) {
-      .hdr.cmd_id = GET_BYTES_CMD_OBJECT_DATA,
-      .hdr.transaction_id = state->transaction_id,
-      .byte_offset = htonl(state->storage.current_offset),
-    };
-
-    // read the next chunk from storage
-    gb_storage_read_next_chunk(&state->storage, rsp->data, data_len);
-
-    comm_session_send_buffer_write(sb, (const uint8_t *) rsp, packet_len);
-    kernel_free(rsp);
-    PBL_LOG(LOG_LEVEL_DEBUG, "GET_BYTES: sending next %d bytes. %d remaining", (int)data_len,
-            (int)(remaining_bytes-data_len));
-  } else {
-    // Send image info response
-    const GetBytesRspObjectInfo rsp = (const GetBytesRspObjectInfo) {
-      .hdr.cmd_id = GET_BYTES_CMD_OBJECT_INFO,
-      .hdr.transaction_id = state->transaction_id,
-      .error_code = htonl(GET_BYTES_OK),
-      .num_bytes  = htonl(state->num_bytes),
-    };
-    comm_session_send_buffer_write(sb, (const uint8_t *) &rsp, sizeof(rsp));
-    state->sent_header = true;
+  s_get_bytes_in_progress = false;
+  prv_put_status_event(DebugInfoStateFinished);
+}
+
+//! Reads the next chunk from storage into the job's message and queues it up to be sent.
+static void prv_send_next_chunk(GetBytesState *state, GetBytesSendJob *job) {
+  const uint32_t remaining_bytes = state->num_bytes - state->storage.current_offset;
+  const uint32_t data_len = MIN(remaining_bytes, state->max_chunk_len);
+  const uint32_t payload_len = sizeof(GetBytesRspObjectData) + data_len;
+
+  PebbleProtocolHeader *pp_header = (PebbleProtocolHeader *)job->message;
+  *pp_header = (PebbleProtocolHeader) {
+    .endpoint_id = htons(GET_BYTES_ENDPOINT_ID),
+    .length = htons(payload_len),
+  };
+  GetBytesRspObjectData *rsp = (GetBytesRspObjectData *)(job->message + sizeof(*pp_header));
+  *rsp = (GetBytesRspObjectData) {
+    .hdr.cmd_id = GET_BYTES_CMD_OBJECT_DATA,
+    .hdr.transaction_id = state->transaction_id,
+    .byte_offset = htonl(state->storage.current_offset),
+  };
+
+  // read the next chunk from storage
+  gb_storage_read_next_chunk(&state->storage, rsp->data, data_len);
+  PBL_LOG(LOG_LEVEL_DEBUG, "GET_BYTES: sending next %d bytes. %d remaining", (int)data_len,
+          (int)(remaining_bytes - data_len));
+
+  job->queue_job = (SessionSendQueueJob) {
+    .impl = &s_get_bytes_send_job_impl,
+  };
+  job->length = sizeof(*pp_header) + payload_len;
+  job->consumed_length = 0;
+  state->num_jobs_in_flight++;
+  comm_session_set_responsiveness(state->session, BtConsumerPpGetBytes, ResponseTimeMin,
+                                  MIN_LATENCY_MODE_TIMEOUT_CD_SECS);
+  // If the session has been closed in the mean time, the job is freed right away
+  SessionSendQueueJob *queue_job = &job->queue_job;
+  comm_session_send_queue_add_job(state->session, &queue_job);
+}
+
+static void prv_handle_send_job_done(void *data) {
+  GetBytesSendJob *job = data;
+  GetBytesState *state = job->state;
+  state->num_jobs_in_flight--;
+  if (job->consumed_length < job->length) {
+    state->failed = true;
   }
-  comm_session_send_buffer_end_write(sb);
 
-  if (state->storage.current_offset >= state->num_bytes) {
-    prv_gather_and_record_stats(state);
+  if (!state->failed && (state->storage.current_offset < state->num_bytes)) {
+    prv_send_next_chunk(state, job);
+  } else if (state->num_jobs_in_flight == 0) {
+    prv_finish(state);
+  }
+}
 
-    // If all done, mark the image as "read" and free up our state structure
-    gb_storage_cleanup(&state->storage, true /* successful  */);
-    kernel_free(state);
+//! Allocates the send jobs and queues up the first chunks. The second job is only used to read
+//! ahead, so the transfer will still work (just slower) if it can't be allocated.
+static void prv_start_data_transfer(GetBytesState *state) {
+  const uint32_t max_payload_len = comm_session_send_buffer_get_max_payload_length(state->session);
+  if (max_payload_len <= sizeof(GetBytesRspObjectData)) {
+    // Session disconnected in the mean time
+    state->failed = true;
+    prv_finish(state);
+    return;
+  }
+  state->max_chunk_len = max_payload_len - sizeof(GetBytesRspObjectData);
+  const size_t job_size = sizeof(GetBytesSendJob) + sizeof(PebbleProtocolHeader) +
+                          max_payload_len;
+  for (int i = 0; i < GET_BYTES_NUM_SEND_JOBS; i++) {
+    if (state->storage.current_offset >= state->num_bytes) {
+      break;
+    }
+    GetBytesSendJob *job = (i == 0) ? kernel_malloc_check(job_size) : kernel_malloc(job_size);
+    if (!job) {
+      break;
+    }
+    job->state = state;
+    state->send_jobs[i] = job;
+    prv_send_next_chunk(state, job);
+  }
 
-    s_get_bytes_in_progress = false;
-    prv_put_status_event(DebugInfoStateFinished);
-    comm_session_set_responsiveness(state->session, BtConsumerPpGetBytes, ResponseTimeMax, 0);
+  if (state->num_jobs_in_flight == 0) {
+    // there was no data to send
+    prv_finish(state);
+  }
+}
+
+static void prv_send_info_response(void *raw_state) {
+  GetBytesState *state = raw_state;
+  const GetBytesRspObjectInfo rsp = (const GetBytesRspObjectInfo) {
+    .hdr.cmd_id = GET_BYTES_CMD_OBJECT_INFO,
+    .hdr.transaction_id = state->transaction_id,
+    .error_code = htonl(GET_BYTES_OK),
+    .num_bytes  = htonl(state->num_bytes),
+  };
+  if (!comm_session_send_data(state->session, GET_BYTES_ENDPOINT_ID, (const uint8_t *)&rsp,
+                              sizeof(rsp), COMM_SESSION_DEFAULT_TIMEOUT)) {
+    if (comm_session_send_buffer_get_max_payload_length(state->session) == 0) {
+      // Session disconnected in the mean time
+      state->failed = true;
+      prv_finish(state);
+    } else {
+      // If timeout, try again
+      system_task_add_callback(prv_send_info_response, state);
+    }
     return;
-  } else {
-    comm_session_set_responsiveness(state->session, BtConsumerPpGetBytes, ResponseTimeMin,
-                                    MIN_LATENCY_MODE_TIMEOUT_CD_SECS);
   }
 
-  system_task_add_callback(prv_protocol_send_next_chunk, state);
-  return;
+  prv_start_data_transfer(state);
+}
 
-cleanup:
-  gb_storage_cleanup(&state->storage, false /* unsuccessful  */);
-  kernel_free(state);
+static void prv_protocol_start_transfer(GetBytesState *state) {
+  // read the size of object from storage
+  GetBytesInfoErrorCode rv = gb_storage_get_size(&state->storage, &state->num_bytes);
+  if (rv != GET_BYTES_OK) {
+    prv_protocol_send_err_response(state->session, state->transaction_id, rv);
+    gb_storage_cleanup(&state->storage, false /* unsuccessful  */);
+    kernel_free(state);
+    return;
+  }
+  PBL_LOG(LOG_LEVEL_DEBUG, "GET_BYTES: total bytes: %ld", state->num_bytes);
+
+  prv_send_info_response(state);
 }
 
 // -----------------------------------------------------------------------------------------------
@@ -310,5 +426,5 @@ void get_bytes_protocol_msg_callback(CommSession *session, const uint8_t* msg_da
   state->start_ticks = rtc_get_ticks();
   bt_driver_analytics_get_conn_event_stats(&state->conn_event_stats);
 
-  prv_protocol_send_next_chunk(state);
+  prv_protocol_start_transfer(state);
 }
@@ -21,7 +21,6 @@
 #include <inttypes.h>
 #include <stdint.h>
 
-#include "kernel/core_dump_private.h"
 #include "services/common/comm_session/session.h"
 #include "util/attributes.h"
 
@@ -20,6 +20,7 @@
 #include "drivers/flash.h"
 #include "flash_region/flash_region.h"
 #include "kernel/core_dump.h"
+#include "kernel/core_dump_private.h"
 #include "kernel/pbl_malloc.h"
 #include "system/logging.h"
 #include "system/status_codes.h"
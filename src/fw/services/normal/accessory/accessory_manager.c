@@ -66,6 +66,20 @@ bool accessory_manager_handle_break_from_isr(void) {
   return false;
 }
 
+bool accessory_manager_handle_rx_data_from_isr(void) {
+  // NOTE: THIS IS RUN WITHIN AN ISR
+  switch (s_input_state) {
+  case AccessoryInputStateSmartstrap:
+    return smartstrap_handle_rx_data_from_isr();
+  case AccessoryInputStateIdle:
+  case AccessoryInputStateMic:
+    // fallthrough
+  default:
+    break;
+  }
+  return false;
+}
+
 // The accessory state is used to differentiate between different consumers of the accessory port.
 // Before a consumer uses the accessory port, it must set its state and return the state to idle
 // once it has finished. No other consumer will be permitted to use the accessory port until the
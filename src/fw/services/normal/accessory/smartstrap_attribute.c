@@ -15,6 +15,7 @@
  */
 
 #include "applib/applib_malloc.auto.h"
+#include "drivers/rtc.h"
 #include "kernel/events.h"
 #include "kernel/pbl_malloc.h"
 #include "process_management/process_manager.h"
@@ -31,6 +32,7 @@
 #include "system/logging.h"
 #include "system/passert.h"
 #include "util/list.h"
+#include "util/math.h"
 #include "util/mbuf.h"
 
 //! Currently, we only support attributes being created by the App task
@@ -67,8 +69,14 @@ typedef struct {
   SmartstrapRequestType request_type:8;
   //! The current state of this attribute
   SmartstrapAttributeState state:8;
+  //! The priority with which requests for this attribute are scheduled
+  SmartstrapAttributePriority priority:8;
   //! The timeout to use for the next request
   uint16_t timeout_ms;
+  //! The sequence number of the pending request, used to send requests of equal priority in order
+  uint32_t request_seq;
+  //! The time at which the pending request was made
+  RtcTicks request_ticks;
   //! Whether or not writes are being blocked
   bool write_blocked;
   //! Whether or not this attribute has a deferred delete pending
@@ -89,6 +97,8 @@ typedef enum {
 static SmartstrapAttributeInternal *s_attr_head;
 static bool s_deferred_delete_queued;
 static PebbleMutex *s_attr_list_lock;
+static uint32_t s_next_request_seq;
+static SmartstrapAttributeStats s_stats;
 
 
 // Init
@@ -208,6 +218,38 @@ static SmartstrapAttributeInternal *prv_find_by_state(SmartstrapAttributeState s
 // NOTE: These all run on KernelBG which moves attributes from the RequestPending to the Idle state
 ////////////////////////////////////////////////////////////////////////////////
 
+static void prv_record_request_completed(SmartstrapAttributeInternal *attr) {
+  const uint32_t latency_ms = ((rtc_get_ticks() - attr->request_ticks) * 1000) / RTC_TICKS_HZ;
+  mutex_lock(s_attr_list_lock);
+  s_stats.num_completed++;
+  s_stats.total_latency_ms += latency_ms;
+  s_stats.max_latency_ms = MAX(s_stats.max_latency_ms, latency_ms);
+  mutex_unlock(s_attr_list_lock);
+}
+
+//! Returns whether or not attr_a's pending request should be sent before attr_b's
+static bool prv_should_send_before(const SmartstrapAttributeInternal *attr_a,
+                                   const SmartstrapAttributeInternal *attr_b) {
+  if (attr_a->priority != attr_b->priority) {
+    return attr_a->priority > attr_b->priority;
+  }
+  return (int32_t)(attr_a->request_seq - attr_b->request_seq) < 0;
+}
+
+//! NOTE: the caller must hold s_attr_list_lock
+static SmartstrapAttributeInternal *prv_get_next_pending(void) {
+  mutex_assert_held_by_curr_task(s_attr_list_lock, true);
+  SmartstrapAttributeInternal *next = NULL;
+  SmartstrapAttributeInternal *attr;
+  FOREACH_VALID_ATTR(attr) {
+    if ((attr->state == SmartstrapAttributeStateRequestPending) &&
+        (!next || prv_should_send_before(attr, next))) {
+      next = attr;
+    }
+  }
+  return next;
+}
+
 bool smartstrap_attribute_send_pending(void) {
   PBL_ASSERT_TASK(PebbleTask_KernelBackground);
   mutex_lock(s_attr_list_lock);
@@ -217,8 +259,8 @@ bool smartstrap_attribute_send_pending(void) {
     return false;
   }
 
-  // get the next attribute which has a pending request
-  SmartstrapAttributeInternal *attr = prv_find_by_state(SmartstrapAttributeStateRequestPending);
+  // get the attribute with the highest priority pending request
+  SmartstrapAttributeInternal *attr = prv_get_next_pending();
   mutex_unlock(s_attr_list_lock);
   if (!attr) {
     return false;
@@ -241,7 +283,12 @@ bool smartstrap_attribute_send_pending(void) {
   if (result == SmartstrapResultBusy) {
     // there was another request in progress so we'll try again later
     return false;
-  } else if ((result == SmartstrapResultOk) &&
+  } else if (result == SmartstrapResultOk) {
+    mutex_lock(s_attr_list_lock);
+    s_stats.num_frames++;
+    mutex_unlock(s_attr_list_lock);
+  }
+  if ((result == SmartstrapResultOk) &&
              (smartstrap_fsm_state_get() != SmartstrapStateReadReady)) {
     prv_set_attribute_state(attr, SmartstrapAttributeStateRequestInProgress);
     if (attr->request_type == SmartstrapRequestTypeWrite) {
@@ -252,6 +299,7 @@ bool smartstrap_attribute_send_pending(void) {
   } else {
     // Either the request was not written successfully, or we are not waiting for a response for it.
     prv_set_attribute_state(attr, SmartstrapAttributeStateIdle);
+    prv_record_request_completed(attr);
   }
 
   // send an event now that we've completed the write
@@ -291,6 +339,7 @@ void smartstrap_attribute_send_event(SmartstrapEventType type, SmartstrapProfile
   if (type == SmartstrapDataReceivedEvent) {
     PBL_ASSERTN(attr->state == SmartstrapAttributeStateRequestInProgress);
     prv_set_attribute_state(attr, SmartstrapAttributeStateIdle);
+    prv_record_request_completed(attr);
     if (attr->request_type == SmartstrapRequestTypeWrite) {
       // the data we got was the ACK of the write, so change the event type and don't block writes
       event.smartstrap.type = SmartstrapDataSentEvent;
@@ -305,6 +354,29 @@ void smartstrap_attribute_send_event(SmartstrapEventType type, SmartstrapProfile
   }
 }
 
+void smartstrap_attribute_get_stats(SmartstrapAttributeStats *stats) {
+  mutex_lock(s_attr_list_lock);
+  *stats = s_stats;
+  mutex_unlock(s_attr_list_lock);
+}
+
+#if !RELEASE
+#include "console/prompt.h"
+
+void command_smartstrap_stats(void) {
+  SmartstrapAttributeStats stats;
+  smartstrap_attribute_get_stats(&stats);
+  char buf[80];
+  prompt_send_response_fmt(buf, sizeof(buf), "requests=%"PRIu32", frames=%"PRIu32,
+                           stats.num_requests, stats.num_frames);
+  const uint32_t avg_latency_ms =
+      stats.num_completed ? (stats.total_latency_ms / stats.num_completed) : 0;
+  prompt_send_response_fmt(buf, sizeof(buf), "completed=%"PRIu32", avg_ms=%"PRIu32
+                           ", max_ms=%"PRIu32, stats.num_completed, avg_latency_ms,
+                           stats.max_latency_ms);
+}
+#endif
+
 static void prv_do_deferred_delete_cb(void *context) {
   s_deferred_delete_queued = false;
   mutex_lock(s_attr_list_lock);
@@ -352,7 +424,8 @@ DEFINE_SYSCALL(bool, sys_smartstrap_attribute_register, uint16_t service_id,
   *new_attr = (SmartstrapAttributeInternal) {
     .service_id = service_id,
     .attribute_id = attribute_id,
-    .mbuf = MBUF_EMPTY
+    .mbuf = MBUF_EMPTY,
+    .priority = SmartstrapAttributePriorityNormal
   };
   list_init(&new_attr->list_node);
   mbuf_set_data(&new_attr->mbuf, buffer, buffer_length);
@@ -480,10 +553,30 @@ DEFINE_SYSCALL(SmartstrapResult, sys_smartstrap_attribute_do_request, Smartstrap
   attr->write_length = write_length;
   attr->request_type = type;
   attr->timeout_ms = timeout_ms;
+  attr->request_ticks = rtc_get_ticks();
+  mutex_lock(s_attr_list_lock);
+  attr->request_seq = s_next_request_seq++;
+  s_stats.num_requests++;
+  mutex_unlock(s_attr_list_lock);
   smartstrap_connection_kick_monitor();
   return SmartstrapResultOk;
 }
 
+DEFINE_SYSCALL(bool, sys_smartstrap_attribute_set_priority, SmartstrapAttribute *app_attr,
+               SmartstrapAttributePriority priority) {
+  if ((unsigned)priority >= NumSmartstrapAttributePriorities) {
+    PBL_LOG(LOG_LEVEL_ERROR, "Invalid attribute priority: %d", priority);
+    syscall_failed();
+  }
+  mutex_lock(s_attr_list_lock);
+  SmartstrapAttributeInternal *attr = prv_find_by_buffer((uint8_t *)app_attr);
+  if (attr) {
+    attr->priority = priority;
+  }
+  mutex_unlock(s_attr_list_lock);
+  return (attr != NULL);
+}
+
 DEFINE_SYSCALL(void, sys_smartstrap_attribute_event_processed, SmartstrapAttribute *app_attr) {
   mutex_lock(s_attr_list_lock);
   SmartstrapAttributeInternal *attr = prv_find_by_buffer((uint8_t *)app_attr);
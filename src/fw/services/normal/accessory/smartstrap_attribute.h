@@ -64,6 +64,26 @@ typedef enum {
   SmartstrapRequestTypeWriteRead
 } SmartstrapRequestType;
 
+//! The priorities with which the pending requests of attributes are sent. Requests of equal
+//! priority are sent in the order in which they were made.
+typedef enum {
+  SmartstrapAttributePriorityLow = 0,
+  SmartstrapAttributePriorityNormal,
+  SmartstrapAttributePriorityHigh,
+  NumSmartstrapAttributePriorities
+} SmartstrapAttributePriority;
+
+typedef struct {
+  //! The number of requests which were queued by the app
+  uint32_t num_requests;
+  //! The number of request frames which were sent to the smartstrap
+  uint32_t num_frames;
+  //! The number of requests which have completed
+  uint32_t num_completed;
+  //! The total and maximum time between a request being queued and it completing
+  uint32_t total_latency_ms;
+  uint32_t max_latency_ms;
+} SmartstrapAttributeStats;
 
 //! Initializes the smartstrap attribute code
 void smartstrap_attribute_init(void);
@@ -76,6 +96,9 @@ void smartstrap_attribute_send_event(SmartstrapEventType type, SmartstrapProfile
                                      SmartstrapResult result, uint16_t service_id,
                                      uint16_t attribute_id, uint16_t read_length);
 
+//! Gets the request scheduling statistics
+void smartstrap_attribute_get_stats(SmartstrapAttributeStats *stats);
+
 //! Unregisters all attributes which the app has registered
 void smartstrap_attribute_unregister_all(void);
 
@@ -97,5 +120,10 @@ SmartstrapResult sys_smartstrap_attribute_do_request(SmartstrapAttribute *app_at
                                                      SmartstrapRequestType type,
                                                      uint16_t timeout_ms, uint32_t write_length);
 
+//! Sets the priority which is used when scheduling requests for the specified attribute
+//! @return false if the attribute doesn't exist
+bool sys_smartstrap_attribute_set_priority(SmartstrapAttribute *app_attr,
+                                           SmartstrapAttributePriority priority);
+
 //! Called by app_smartstrap.c after the app's event callback is called for an attribute
 void sys_smartstrap_attribute_event_processed(SmartstrapAttribute *app_attr);
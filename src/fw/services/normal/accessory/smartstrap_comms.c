@@ -108,6 +108,8 @@ static SendInfo s_send_info;
 
 //! Timer used to enforce read timeouts
 static TimerID s_read_timer = TIMER_INVALID_ID;
+//! Set while a KernelBG callback to decode data from the accessory DMA buffer is queued
+static volatile bool s_rx_data_pending;
 
 
 // Init
@@ -175,7 +177,7 @@ static void prv_read_complete_system_task_cb(void *context_ptr) {
     new_timer_stop(s_read_timer);
   }
 
-  accessory_use_dma(false);
+  accessory_use_dma_bulk_rx(false);
   mbuf_clear_next(&s_header_mbuf);
   prv_reset_read_info();
   prv_reset_read_consumer();
@@ -201,8 +203,8 @@ static void prv_read_timeout(void *context) {
   }
 }
 
-static void prv_store_byte(const uint8_t data) {
-  // NOTE: THIS IS RUN WITHIN AN ISR
+static void prv_store_bytes(const uint8_t *data, uint32_t length) {
+  // NOTE: THIS MAY BE RUN WITHIN AN ISR
   // The checksum byte is the last byte in the frame. This byte could be the last byte we receive
   // (making it the checksum byte), so we always keep a 1 byte temporary buffer before storing the
   // byte in the MBuf. This avoids us potentially overrunning a conservatively sized payload buffer;
@@ -214,21 +216,27 @@ static void prv_store_byte(const uint8_t data) {
       s_read_info.should_drop = true;
     }
   }
-  // Store this byte in the footer_byte. Note that we will still calculate the checksum on this byte
-  // and verify that the checksum is 0 at the end, so if this byte is the actual footer byte (aka.
-  // the checksum), we will still include it in the checksum.
-  s_read_info.footer_byte = data;
+  for (uint32_t i = 0; (i + 1 < length) && !s_read_info.should_drop; i++) {
+    if (!mbuf_iterator_write_byte(&s_read_consumer.mbuf_iter, data[i])) {
+      s_read_info.should_drop = true;
+    }
+  }
+  // Store the last byte in the footer_byte. Note that we will still calculate the checksum on this
+  // byte and verify that the checksum is 0 at the end, so if this byte is the actual footer byte
+  // (aka. the checksum), we will still include it in the checksum.
+  s_read_info.footer_byte = data[length - 1];
 
   // increment the length and run the CRC calculation
-  s_read_info.length++;
-  crc8_calculate_bytes_streaming((uint8_t *)&data, sizeof(data), (uint8_t *)&s_read_info.checksum,
+  s_read_info.length += length;
+  crc8_calculate_bytes_streaming(data, length, (uint8_t *)&s_read_info.checksum,
                                  false /* !big_endian */);
 }
 
-static void prv_handle_complete_frame(bool *should_context_switch) {
+//! @param should_context_switch NULL if this is being called from KernelBG rather than an ISR
+static void prv_handle_complete_frame(SmartstrapState state, bool *should_context_switch) {
   FrameHeader *header = mbuf_get_data(&s_header_mbuf);
   bool is_notify = header->flags.is_notify;
-  if ((is_notify && (smartstrap_fsm_state_get() != SmartstrapStateNotifyInProgress)) ||
+  if ((is_notify && (state != SmartstrapStateNotifyInProgress)) ||
       (!is_notify && (s_read_consumer.profile != header->profile))) {
     // We weither got a notify frame in response to a normal read, or we got a response for a
     // different frame than we requested.
@@ -247,13 +255,20 @@ static void prv_handle_complete_frame(bool *should_context_switch) {
     // If this is a notification, we shouldn't have a read consumer set.
     PBL_ASSERTN(!is_notify || (s_read_consumer.profile == SmartstrapProfileInvalid));
     // this frame is valid - transition the FSM and queue up processing of it
-    smartstrap_fsm_state_set(SmartstrapStateReadComplete);
+    if (!smartstrap_fsm_state_test_and_set(state, SmartstrapStateReadComplete)) {
+      // the timeout beat us to it
+      return;
+    }
     ReadCompleteContext context = {
       .success = true,
       .is_notify = is_notify
     };
-    system_task_add_callback_from_isr(prv_read_complete_system_task_cb, context.context_ptr,
-                                      should_context_switch);
+    if (should_context_switch) {
+      system_task_add_callback_from_isr(prv_read_complete_system_task_cb, context.context_ptr,
+                                        should_context_switch);
+    } else {
+      system_task_add_callback(prv_read_complete_system_task_cb, context.context_ptr);
+    }
   } else {
     // Reset our context so we can try again to receive a frame in case we do happen to get a valid
     // one before the timeout occurs.
@@ -262,26 +277,96 @@ static void prv_handle_complete_frame(bool *should_context_switch) {
   }
 }
 
+static bool prv_is_hdlc_special(uint8_t data) {
+  return (data == HDLC_FLAG) || (data == HDLC_ESCAPE);
+}
+
+//! @param should_context_switch NULL if this is being called from KernelBG rather than an ISR
+static void prv_decode_data(const uint8_t *data, uint32_t length, bool *should_context_switch) {
+  uint32_t i = 0;
+  while (i < length) {
+    const SmartstrapState state = smartstrap_fsm_state_get();
+    if ((state != SmartstrapStateReadInProgress) && (state != SmartstrapStateNotifyInProgress)) {
+      // we're no longer reading, so drop the rest
+      return;
+    }
+
+    if (!s_read_info.hdlc_ctx.escape && !prv_is_hdlc_special(data[i])) {
+      // store everything up until the next flag / escape byte at once
+      uint32_t run_end = i + 1;
+      while ((run_end < length) && !prv_is_hdlc_special(data[run_end])) {
+        run_end++;
+      }
+      if (!s_read_info.should_drop) {
+        prv_store_bytes(&data[i], run_end - i);
+      }
+      i = run_end;
+      continue;
+    }
+
+    uint8_t byte = data[i++];
+    bool hdlc_err;
+    bool should_store;
+    bool is_complete = hdlc_streaming_decode(&s_read_info.hdlc_ctx, &byte, &should_store,
+                                             &hdlc_err);
+    if (hdlc_err) {
+      // the rest of the frame is invalid
+      s_read_info.should_drop = true;
+    } else if (is_complete) {
+      prv_handle_complete_frame(state, should_context_switch);
+    } else if (should_store && !s_read_info.should_drop) {
+      prv_store_bytes(&byte, sizeof(byte));
+    }
+  }
+}
+
 bool smartstrap_handle_data_from_isr(uint8_t data) {
   // NOTE: THIS IS RUN WITHIN AN ISR
-  if ((smartstrap_fsm_state_get() != SmartstrapStateReadInProgress) &&
-      (smartstrap_fsm_state_get() != SmartstrapStateNotifyInProgress)) {
-    return false;
+  bool should_context_switch = false;
+  prv_decode_data(&data, sizeof(data), &should_context_switch);
+  return should_context_switch;
+}
+
+//! Fails the read in progress right away, rather than leaving it to the timeout
+static void prv_fail_read(void) {
+  const SmartstrapState state = smartstrap_fsm_state_get();
+  if (((state == SmartstrapStateReadInProgress) || (state == SmartstrapStateNotifyInProgress)) &&
+      smartstrap_fsm_state_test_and_set(state, SmartstrapStateReadComplete)) {
+    ReadCompleteContext context = {
+      .success = false,
+      .is_notify = (state == SmartstrapStateNotifyInProgress)
+    };
+    system_task_add_callback(prv_read_complete_system_task_cb, context.context_ptr);
   }
+}
 
-  bool should_context_switch = false;
-  bool hdlc_err;
-  bool should_store;
-  bool is_complete = hdlc_streaming_decode(&s_read_info.hdlc_ctx, &data, &should_store, &hdlc_err);
-  if (hdlc_err) {
-    // the rest of the frame is invalid
-    s_read_info.should_drop = true;
-  } else if (is_complete) {
-    prv_handle_complete_frame(&should_context_switch);
-  } else if (should_store && !s_read_info.should_drop) {
-    prv_store_byte(data);
+static void prv_decode_rx_data_system_task_cb(void *context) {
+  PBL_ASSERT_TASK(PebbleTask_KernelBackground);
+  // clear the flag first so that data which arrives while we're decoding queues up another pass
+  s_rx_data_pending = false;
+  const uint8_t *data;
+  size_t length;
+  bool has_error;
+  while ((length = accessory_get_rx_data(&data, &has_error)) > 0) {
+    prv_decode_data(data, length, NULL);
+    accessory_consume_rx_data(length);
   }
+  if (has_error) {
+    // part of the response was lost or corrupted
+    PBL_LOG(LOG_LEVEL_WARNING, "Smartstrap receive error");
+    prv_fail_read();
+  }
+}
 
+bool smartstrap_handle_rx_data_from_isr(void) {
+  // NOTE: THIS IS RUN WITHIN AN ISR
+  if (s_rx_data_pending) {
+    // the queued callback will pick up this data as well
+    return false;
+  }
+  bool should_context_switch = false;
+  s_rx_data_pending = system_task_add_callback_from_isr(prv_decode_rx_data_system_task_cb, NULL,
+                                                        &should_context_switch);
   return should_context_switch;
 }
 
@@ -464,7 +549,7 @@ SmartstrapResult smartstrap_send(SmartstrapProfile profile, MBuf *write_mbuf, MB
 
   // send off the frame
   mbuf_iterator_init(&s_send_info.mbuf_iter, &start_flag_mbuf);
-  accessory_use_dma(true);
+  accessory_use_dma_bulk_rx(true);
   if (!accessory_send_stream(prv_send_stream_callback, (void *)read_mbuf)) {
     accessory_enable_input();
   }
@@ -478,13 +563,13 @@ SmartstrapResult smartstrap_send(SmartstrapProfile profile, MBuf *write_mbuf, MB
       PBL_ASSERTN(new_timer_start(s_read_timer, timeout_ms, prv_read_timeout, NULL, 0));
     } else {
       // clean up and return an error
-      accessory_use_dma(false);
+      accessory_use_dma_bulk_rx(false);
       prv_reset_read_consumer();
       smartstrap_fsm_state_set(SmartstrapStateReadReady);
       return SmartstrapResultBusy;
     }
   } else {
-    accessory_use_dma(false);
+    accessory_use_dma_bulk_rx(false);
     smartstrap_fsm_state_set(SmartstrapStateReadReady);
     if (!mbuf_iterator_is_finished(&s_send_info.mbuf_iter)) {
       // The write was not successful, so return an error
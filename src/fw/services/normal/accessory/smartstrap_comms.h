@@ -34,6 +34,10 @@ bool smartstrap_handle_data_from_isr(uint8_t c);
 //! Called by accessory_manager when we receive a break character
 bool smartstrap_handle_break_from_isr(void);
 
+//! Called by accessory_manager when received data is waiting in the accessory DMA buffer. The data
+//! is decoded from KernelBG.
+bool smartstrap_handle_rx_data_from_isr(void);
+
 //! Sends a message over the accessory port using the smartstrap protocol. The message will be sent
 //! synchronously and the response will be read asynchronously with an event being put on the
 //! calling task's queue when the response is read or a timeout occurs. A response will only be
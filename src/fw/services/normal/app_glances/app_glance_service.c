@@ -23,6 +23,7 @@
 #include "kernel/pbl_malloc.h"
 #include "os/mutex.h"
 #include "process_management/app_install_manager.h"
+#include "services/common/new_timer/new_timer.h"
 #include "services/normal/app_cache.h"
 #include "services/normal/blob_db/app_glance_db.h"
 #include "syscall/syscall_internal.h"
@@ -30,6 +31,41 @@
 #include "system/status_codes.h"
 #include "util/math.h"
 
+#include <string.h>
+
+//! valid_until of cache entries which stay valid until their glance changes
+#define CACHE_ENTRY_NEVER_EXPIRES ((time_t)INT32_MAX)
+
+//! The decoded current slice of an app's glance (or the fact that it has none), which stays the
+//! current slice for any time in [valid_from, valid_until)
+typedef struct AppGlanceCacheEntry {
+  Uuid app_uuid;
+  time_t valid_from;
+  time_t valid_until;
+  uint32_t last_used; //!< Value of the cache's use counter when this entry was last used
+  unsigned int heap_index; //!< Position of this entry in the cache's expiration heap
+  bool has_slice;
+  AppGlanceSliceType slice_type;
+  time_t slice_expiration_time;
+  uint32_t slice_icon_resource_id;
+  char slice_template_string[]; //!< Only as long as the slice's template string
+} AppGlanceCacheEntry;
+
+//! Cache of the current slices of recently requested glances, so reloading the launcher doesn't
+//! need to read and deserialize glances that haven't changed. Entries are dropped when their glance
+//! changes; the entries are also kept in a min-heap ordered by valid_until so a single timer can
+//! drop each entry once its slice expires.
+static struct {
+  PebbleMutex *mutex;
+  AppGlanceCacheEntry *heap[APP_GLANCE_SERVICE_CACHE_NUM_ENTRIES];
+  unsigned int count;
+  uint32_t use_counter;
+  //! Incremented whenever entries are invalidated, so a slice read from the database while the
+  //! glance was being changed doesn't get cached
+  uint32_t generation;
+  TimerID expiration_timer;
+} s_cache;
+
 //! Return true to continue iteration and false to stop it.
 typedef bool (*SliceForEachCb)(AppGlanceSliceInternal *slice, void *context);
 
@@ -98,6 +134,194 @@ static bool prv_find_current_glance(AppGlanceSliceInternal *slice, void *context
   return true;
 }
 
+//////////////////////
+// Slice cache
+// NOTE: All of these must be called with s_cache.mutex held
+//////////////////////
+
+static void prv_cache_heap_swap(unsigned int a, unsigned int b) {
+  AppGlanceCacheEntry *tmp = s_cache.heap[a];
+  s_cache.heap[a] = s_cache.heap[b];
+  s_cache.heap[b] = tmp;
+  s_cache.heap[a]->heap_index = a;
+  s_cache.heap[b]->heap_index = b;
+}
+
+static void prv_cache_heap_sift_up(unsigned int i) {
+  while (i > 0) {
+    const unsigned int parent = (i - 1) / 2;
+    if (s_cache.heap[parent]->valid_until <= s_cache.heap[i]->valid_until) {
+      break;
+    }
+    prv_cache_heap_swap(i, parent);
+    i = parent;
+  }
+}
+
+static void prv_cache_heap_sift_down(unsigned int i) {
+  while (true) {
+    const unsigned int left = (2 * i) + 1;
+    const unsigned int right = left + 1;
+    unsigned int earliest = i;
+    if ((left < s_cache.count) &&
+        (s_cache.heap[left]->valid_until < s_cache.heap[earliest]->valid_until)) {
+      earliest = left;
+    }
+    if ((right < s_cache.count) &&
+        (s_cache.heap[right]->valid_until < s_cache.heap[earliest]->valid_until)) {
+      earliest = right;
+    }
+    if (earliest == i) {
+      break;
+    }
+    prv_cache_heap_swap(i, earliest);
+    i = earliest;
+  }
+}
+
+static void prv_cache_remove(AppGlanceCacheEntry *entry) {
+  const unsigned int i = entry->heap_index;
+  s_cache.count--;
+  if (i != s_cache.count) {
+    s_cache.heap[i] = s_cache.heap[s_cache.count];
+    s_cache.heap[i]->heap_index = i;
+    prv_cache_heap_sift_up(i);
+    prv_cache_heap_sift_down(i);
+  }
+  kernel_free(entry);
+}
+
+static AppGlanceCacheEntry *prv_cache_find(const Uuid *app_uuid) {
+  for (unsigned int i = 0; i < s_cache.count; i++) {
+    if (uuid_equal(&s_cache.heap[i]->app_uuid, app_uuid)) {
+      return s_cache.heap[i];
+    }
+  }
+  return NULL;
+}
+
+static void prv_cache_remove_expired(time_t now) {
+  while (s_cache.count && (s_cache.heap[0]->valid_until <= now)) {
+    prv_cache_remove(s_cache.heap[0]);
+  }
+}
+
+static void prv_cache_remove_least_recently_used(void) {
+  AppGlanceCacheEntry *lru_entry = NULL;
+  for (unsigned int i = 0; i < s_cache.count; i++) {
+    if (!lru_entry || (s_cache.heap[i]->last_used < lru_entry->last_used)) {
+      lru_entry = s_cache.heap[i];
+    }
+  }
+  if (lru_entry) {
+    prv_cache_remove(lru_entry);
+  }
+}
+
+static void prv_cache_expiration_timer_cb(void *data);
+
+//! Schedules the expiration timer for the entry which expires first, if any
+static void prv_cache_update_expiration_timer(void) {
+  new_timer_stop(s_cache.expiration_timer);
+  if (!s_cache.count || (s_cache.heap[0]->valid_until == CACHE_ENTRY_NEVER_EXPIRES)) {
+    return;
+  }
+  // Cap the timeout so it fits in a uint32_t; if it fires early it just gets rescheduled
+  const time_t time_until_expiration = s_cache.heap[0]->valid_until - rtc_get_time();
+  const uint32_t timeout_ms =
+      CLIP(time_until_expiration, 1, SECONDS_PER_DAY) * MS_PER_SECOND;
+  new_timer_start(s_cache.expiration_timer, timeout_ms, prv_cache_expiration_timer_cb, NULL,
+                  0 /* flags */);
+}
+
+static void prv_cache_expiration_timer_cb(void *data) {
+  mutex_lock(s_cache.mutex);
+  prv_cache_remove_expired(rtc_get_time());
+  prv_cache_update_expiration_timer();
+  mutex_unlock(s_cache.mutex);
+}
+
+static void prv_cache_put(const Uuid *app_uuid, const AppGlanceSliceInternal *slice,
+                          time_t valid_from, time_t valid_until) {
+  const char *template_string = slice ? slice->icon_and_subtitle.template_string : "";
+  const size_t template_string_size = strlen(template_string) + 1;
+  AppGlanceCacheEntry *entry = kernel_malloc(sizeof(*entry) + template_string_size);
+  if (!entry) {
+    // Caching is only an optimization
+    return;
+  }
+
+  *entry = (AppGlanceCacheEntry) {
+    .app_uuid = *app_uuid,
+    .valid_from = valid_from,
+    .valid_until = valid_until,
+    .last_used = ++s_cache.use_counter,
+    .has_slice = (slice != NULL),
+  };
+  if (slice) {
+    entry->slice_type = slice->type;
+    entry->slice_expiration_time = slice->expiration_time;
+    entry->slice_icon_resource_id = slice->icon_and_subtitle.icon_resource_id;
+  }
+  memcpy(entry->slice_template_string, template_string, template_string_size);
+
+  prv_cache_remove_expired(valid_from);
+  if (s_cache.count == APP_GLANCE_SERVICE_CACHE_NUM_ENTRIES) {
+    prv_cache_remove_least_recently_used();
+  }
+  entry->heap_index = s_cache.count;
+  s_cache.heap[s_cache.count++] = entry;
+  prv_cache_heap_sift_up(entry->heap_index);
+  prv_cache_update_expiration_timer();
+}
+
+//! @return true if the cache had a valid entry for the app, in which case found_out is set to
+//! whether the app has a current slice and slice_out is filled in if it does
+static bool prv_cache_get(const Uuid *app_uuid, time_t now, bool *found_out,
+                          AppGlanceSliceInternal *slice_out) {
+  AppGlanceCacheEntry *entry = prv_cache_find(app_uuid);
+  if (!entry) {
+    return false;
+  }
+  if ((now < entry->valid_from) || (now >= entry->valid_until)) {
+    // The current slice has changed (or the clock moved backwards)
+    prv_cache_remove(entry);
+    prv_cache_update_expiration_timer();
+    return false;
+  }
+
+  entry->last_used = ++s_cache.use_counter;
+  *found_out = entry->has_slice;
+  if (entry->has_slice) {
+    *slice_out = (AppGlanceSliceInternal) {
+      .type = entry->slice_type,
+      .expiration_time = entry->slice_expiration_time,
+      .icon_and_subtitle.icon_resource_id = entry->slice_icon_resource_id,
+    };
+    strncpy(slice_out->icon_and_subtitle.template_string, entry->slice_template_string,
+            sizeof(slice_out->icon_and_subtitle.template_string) - 1);
+  }
+  return true;
+}
+
+//! Drops the cached slice of the app with the provided UUID, or of every app if it is NULL
+static void prv_cache_invalidate(const Uuid *app_uuid) {
+  mutex_lock(s_cache.mutex);
+  s_cache.generation++;
+  if (app_uuid) {
+    AppGlanceCacheEntry *entry = prv_cache_find(app_uuid);
+    if (entry) {
+      prv_cache_remove(entry);
+    }
+  } else {
+    while (s_cache.count) {
+      prv_cache_remove(s_cache.heap[s_cache.count - 1]);
+    }
+  }
+  prv_cache_update_expiration_timer();
+  mutex_unlock(s_cache.mutex);
+}
+
 static void prv_glance_event_put(const Uuid *app_uuid) {
   Uuid *app_uuid_copy = kernel_zalloc_check(sizeof(Uuid));
   *app_uuid_copy = *app_uuid;
@@ -127,7 +351,15 @@ static void prv_blob_db_event_handler(PebbleEvent *event, void *context) {
     return;
   }
 
-  prv_glance_event_put((Uuid *)blob_db_event->key);
+  if (blob_db_event->type == BlobDBEventTypeFlush) {
+    // Every glance was removed and there's no single app to notify about
+    prv_cache_invalidate(NULL);
+    return;
+  }
+
+  const Uuid *app_uuid = (Uuid *)blob_db_event->key;
+  prv_cache_invalidate(app_uuid);
+  prv_glance_event_put(app_uuid);
 }
 
 static void prv_handle_app_cache_event(PebbleEvent *e, void *context) {
@@ -135,6 +367,7 @@ static void prv_handle_app_cache_event(PebbleEvent *e, void *context) {
     Uuid app_uuid;
     app_install_get_uuid_for_install_id(e->app_cache_event.install_id, &app_uuid);
     app_glance_db_delete_glance(&app_uuid);
+    prv_cache_invalidate(&app_uuid);
   }
 }
 
@@ -150,6 +383,11 @@ void app_glance_service_init_glance(AppGlance *glance) {
 }
 
 void app_glance_service_init(void) {
+  if (!s_cache.mutex) {
+    s_cache.mutex = mutex_create();
+    s_cache.expiration_timer = new_timer_create();
+  }
+  prv_cache_invalidate(NULL);
 
   static EventServiceInfo s_blob_db_event_info = {
     .type = PEBBLE_BLOBDB_EVENT,
@@ -165,15 +403,26 @@ void app_glance_service_init(void) {
 }
 
 bool app_glance_service_get_current_slice(const Uuid *app_uuid, AppGlanceSliceInternal *slice_out) {
-  if (!slice_out) {
+  if (!app_uuid || !slice_out) {
     return false;
   }
 
+  const time_t current_time = rtc_get_time();
+
+  // First check the cache
+  mutex_lock(s_cache.mutex);
   bool success;
-  // Try to read the app's glance, first checking the cache
+  const bool cache_hit = prv_cache_get(app_uuid, current_time, &success, slice_out);
+  const uint32_t cache_generation = s_cache.generation;
+  mutex_unlock(s_cache.mutex);
+  if (cache_hit) {
+    return success;
+  }
+
+  // Try to read the app's glance
   AppGlance *app_glance = kernel_zalloc_check(sizeof(*app_glance));
   const status_t rv = app_glance_db_read_glance(app_uuid, app_glance);
-  if (rv != S_SUCCESS) {
+  if ((rv != S_SUCCESS) && (rv != E_DOES_NOT_EXIST)) {
     success = false;
     goto cleanup;
   }
@@ -181,16 +430,29 @@ bool app_glance_service_get_current_slice(const Uuid *app_uuid, AppGlanceSliceIn
   // Iterate over the slices to find the current slice (which might be NULL if there aren't any
   // slices or if all of the slices have expired)
   FindCurrentSliceData find_current_slice_data = (FindCurrentSliceData) {
-    .current_time = rtc_get_time(),
+    .current_time = current_time,
   };
   prv_slice_for_each(app_glance, prv_find_current_glance, &find_current_slice_data);
-  if (!find_current_slice_data.current_slice) {
+  const AppGlanceSliceInternal *current_slice = find_current_slice_data.current_slice;
+
+  // The current slice stays current until it expires; if there is no current slice, there won't
+  // be one until the glance changes
+  const time_t valid_until =
+      (current_slice && (current_slice->expiration_time != APP_GLANCE_SLICE_NO_EXPIRATION)) ?
+          current_slice->expiration_time : CACHE_ENTRY_NEVER_EXPIRES;
+  mutex_lock(s_cache.mutex);
+  if (cache_generation == s_cache.generation) {
+    prv_cache_put(app_uuid, current_slice, current_time, valid_until);
+  }
+  mutex_unlock(s_cache.mutex);
+
+  if (!current_slice) {
     success = false;
     goto cleanup;
   }
 
   // Copy the current slice data to slice_out
-  *slice_out = *find_current_slice_data.current_slice;
+  *slice_out = *current_slice;
   success = true;
 
 cleanup:
@@ -206,6 +468,7 @@ DEFINE_SYSCALL(bool, sys_app_glance_update, const Uuid *uuid, const AppGlance *g
   }
   const bool success = (app_glance_db_insert_glance(uuid, glance) == S_SUCCESS);
   if (success) {
+    prv_cache_invalidate(uuid);
     prv_glance_event_put(uuid);
   }
   return success;
@@ -22,6 +22,11 @@
 #include "util/time/time.h"
 #include "util/uuid.h"
 
+//! Maximum number of apps whose current slice is kept in the service's cache. The least recently
+//! used entry is evicted to make room, so a launcher with more apps than this rereads each glance
+//! when it's scrolled straight through, but not when it's scrolled back.
+#define APP_GLANCE_SERVICE_CACHE_NUM_ENTRIES (32)
+
 typedef enum AppGlanceSliceType {
   AppGlanceSliceType_IconAndSubtitle = 0,
 
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bitmap_cache.h"
+
+#include <string.h>
+
+#include "kernel/pbl_malloc.h"
+#include "os/mutex.h"
+#include "process_management/app_manager.h"
+#include "services/normal/filesystem/app_file.h"
+#include "services/normal/filesystem/pfs.h"
+#include "services/normal/process_management/app_storage.h"
+#include "services/normal/settings/settings_file.h"
+#include "syscall/syscall_internal.h"
+#include "system/logging.h"
+#include "system/passert.h"
+#include "util/units.h"
+
+#define BITMAP_CACHE_FILE_SUFFIX "bmpcache"
+#define BITMAP_CACHE_MAX_SPACE KiBYTES(8)
+
+//! Prepended to the PBI data of every record
+typedef struct PACKED BitmapCacheRecordHeader {
+  //! Version of the resource bank the bitmap was decoded from
+  ResourceVersion version;
+} BitmapCacheRecordHeader;
+
+#define BITMAP_CACHE_MAX_PBI_SIZE (SETTINGS_VAL_MAX_LEN - sizeof(BitmapCacheRecordHeader))
+
+static PebbleMutex *s_mutex;
+
+static void prv_get_file_name(char *name, size_t buf_len, AppInstallId id) {
+  app_file_name_make(name, buf_len, id, BITMAP_CACHE_FILE_SUFFIX,
+                     strlen(BITMAP_CACHE_FILE_SUFFIX));
+}
+
+static bool prv_is_cacheable(ResAppNum app_num) {
+  // System resources are either memory-mappable or part of the firmware update, only cache
+  // resources that belong to installed apps
+  return (app_num != SYSTEM_APP);
+}
+
+//! Opening a settings file creates it, which only \ref bitmap_cache_store() should do. Most apps
+//! never get anything cached because their icons aren't PNGs.
+static status_t prv_open(SettingsFile *file, ResAppNum app_num, bool create) {
+  char name[APP_FILENAME_MAX_LENGTH];
+  prv_get_file_name(name, sizeof(name), (AppInstallId)app_num);
+  if (!create) {
+    const int fd = pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0);
+    if (fd < 0) {
+      return fd;
+    }
+    pfs_close(fd);
+  }
+  return settings_file_open(file, name, BITMAP_CACHE_MAX_SPACE);
+}
+
+//! Returns whether the record was decoded from the current version of the resource. Stale records
+//! get deleted on the way.
+static bool prv_check_version(SettingsFile *file, ResAppNum app_num, uint32_t resource_id,
+                              const BitmapCacheRecordHeader *header) {
+  const ResourceVersion version = resource_get_version(app_num, resource_id);
+  if (!resource_version_matches(&header->version, &version)) {
+    settings_file_delete(file, &resource_id, sizeof(resource_id));
+    return false;
+  }
+  return true;
+}
+
+void bitmap_cache_init(void) {
+  s_mutex = mutex_create();
+}
+
+uint8_t *bitmap_cache_load(ResAppNum app_num, uint32_t resource_id, size_t *size_out) {
+  if (!prv_is_cacheable(app_num) || !size_out) {
+    return NULL;
+  }
+
+  uint8_t *data = NULL;
+  mutex_lock(s_mutex);
+  {
+    SettingsFile file;
+    if (prv_open(&file, app_num, false /* create */) != S_SUCCESS) {
+      goto unlock;
+    }
+
+    const int record_len = settings_file_get_len(&file, &resource_id, sizeof(resource_id));
+    if (record_len <= (int)sizeof(BitmapCacheRecordHeader)) {
+      goto close;
+    }
+
+    // settings_file_get() reads records from their start, so read the header along with the
+    // PBI data and move the latter to the start of the buffer
+    data = task_malloc(record_len);
+    if (!data) {
+      goto close;
+    }
+    if ((settings_file_get(&file, &resource_id, sizeof(resource_id), data,
+                           record_len) != S_SUCCESS) ||
+        !prv_check_version(&file, app_num, resource_id, (BitmapCacheRecordHeader *)data)) {
+      task_free(data);
+      data = NULL;
+      goto close;
+    }
+    *size_out = record_len - sizeof(BitmapCacheRecordHeader);
+    memmove(data, data + sizeof(BitmapCacheRecordHeader), *size_out);
+
+close:
+    settings_file_close(&file);
+  }
+unlock:
+  mutex_unlock(s_mutex);
+  return data;
+}
+
+void bitmap_cache_store(ResAppNum app_num, uint32_t resource_id, const uint8_t *pbi_data,
+                        size_t pbi_data_size) {
+  if (!prv_is_cacheable(app_num) || !pbi_data || pbi_data_size == 0 ||
+      pbi_data_size > BITMAP_CACHE_MAX_PBI_SIZE) {
+    return;
+  }
+
+  const size_t record_len = sizeof(BitmapCacheRecordHeader) + pbi_data_size;
+  uint8_t *record = kernel_malloc(record_len);
+  if (!record) {
+    return;
+  }
+  *(BitmapCacheRecordHeader *)record = (BitmapCacheRecordHeader) {
+    .version = resource_get_version(app_num, resource_id),
+  };
+  memcpy(record + sizeof(BitmapCacheRecordHeader), pbi_data, pbi_data_size);
+
+  mutex_lock(s_mutex);
+  {
+    SettingsFile file;
+    if (prv_open(&file, app_num, true /* create */) == S_SUCCESS) {
+      // A full cache simply stops growing, the bitmap will be decoded from its PNG next time
+      const status_t rv = settings_file_set(&file, &resource_id, sizeof(resource_id), record,
+                                            record_len);
+      if (rv != S_SUCCESS) {
+        PBL_LOG(LOG_LEVEL_DEBUG, "Not caching bitmap %"PRIu32" of app %"PRIu32": %"PRId32,
+                resource_id, app_num, rv);
+      }
+      settings_file_close(&file);
+    }
+  }
+  mutex_unlock(s_mutex);
+
+  kernel_free(record);
+}
+
+void bitmap_cache_delete_app(AppInstallId id) {
+  char name[APP_FILENAME_MAX_LENGTH];
+  prv_get_file_name(name, sizeof(name), id);
+  mutex_lock(s_mutex);
+  pfs_remove(name);
+  mutex_unlock(s_mutex);
+}
+
+//! Only system apps (e.g. the launcher) may use the cache on behalf of other apps
+static void prv_syscall_assert_app_num(ResAppNum app_num) {
+  const AppInstallId current_id = app_manager_get_current_app_id();
+  if (!app_install_id_from_system(current_id) && ((ResAppNum)current_id != app_num)) {
+    syscall_failed();
+  }
+}
+
+DEFINE_SYSCALL(uint8_t *, sys_bitmap_cache_load, ResAppNum app_num, uint32_t resource_id,
+               size_t *size_out) {
+  if (PRIVILEGE_WAS_ELEVATED) {
+    syscall_assert_userspace_buffer(size_out, sizeof(*size_out));
+    prv_syscall_assert_app_num(app_num);
+  }
+  // The data is allocated on the heap of the calling task, which owns it from here on
+  return bitmap_cache_load(app_num, resource_id, size_out);
+}
+
+DEFINE_SYSCALL(void, sys_bitmap_cache_store, ResAppNum app_num, uint32_t resource_id,
+               const uint8_t *pbi_data, size_t pbi_data_size) {
+  if (PRIVILEGE_WAS_ELEVATED) {
+    syscall_assert_userspace_buffer(pbi_data, pbi_data_size);
+    prv_syscall_assert_app_num(app_num);
+  }
+  bitmap_cache_store(app_num, resource_id, pbi_data, pbi_data_size);
+}
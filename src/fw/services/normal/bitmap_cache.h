@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//! Bitmap cache
+//!
+//! Persistent cache of PNG resources that have already been decoded into the PBI format. Decoding
+//! a PNG means inflating it and converting its palette on every load, which is wasted work for
+//! static images such as app icons that are loaded over and over again. Clients opt in to the
+//! cache, see \ref gbitmap_create_with_resource_system_cached().
+//!
+//! Records are stored in a SettingsFile per app, named after the app's AppInstallId, keyed by
+//! resource id and tagged with the version of the resource bank they were decoded from. Stale
+//! records are ignored and the whole file is removed alongside the app's other files when the app
+//! cache evicts the app.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "process_management/app_install_types.h"
+#include "resource/resource.h"
+
+//! Initialize the bitmap cache.
+void bitmap_cache_init(void);
+
+//! Loads the cached PBI data for the given resource.
+//! @param[out] size_out The size of the PBI data
+//! @return The PBI data allocated on the current task's heap, NULL if there is none or if the
+//!     cached data is stale. Free it with task_free().
+uint8_t *bitmap_cache_load(ResAppNum app_num, uint32_t resource_id, size_t *size_out);
+
+//! Stores the decoded PBI data for the given resource. Data that doesn't fit into a single
+//! record is silently not cached.
+void bitmap_cache_store(ResAppNum app_num, uint32_t resource_id, const uint8_t *pbi_data,
+                        size_t pbi_data_size);
+
+//! Removes all cached bitmaps of the given app.
+void bitmap_cache_delete_app(AppInstallId id);
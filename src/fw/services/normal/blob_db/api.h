@@ -113,7 +113,9 @@ typedef status_t (*BlobDBIsDirtyImpl)(bool *is_dirty_out);
 
 //! Implements the GetDirtyList API.
 //! \return a linked list of \ref BlobDBDirtyItem with a node per out-of-sync item.
-//! \note There is no limit how large this list can get. Handle OOM scenarios gracefully!
+//! The list may only hold a batch of the out-of-sync items. Sync asks for the list again once it
+//! has worked through it, until an empty list is returned.
+//! \note Handle OOM scenarios gracefully!
 typedef BlobDBDirtyItem *(*BlobDBGetDirtyListImpl)(void);
 
 //! Implements the MarkSynced API.
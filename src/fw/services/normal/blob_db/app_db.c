@@ -29,6 +29,8 @@
 #include "util/math.h"
 #include "util/units.h"
 
+#include <stddef.h>
+
 #define SETTINGS_FILE_NAME   "appdb"
 // Holds about ~150 app metadata blobs
 #define SETTINGS_FILE_SIZE KiBYTES(20)
@@ -37,11 +39,79 @@
 
 static AppInstallId s_next_unique_flash_app_id;
 
+//! Entry of the index from the UUID of an app to its install id. Only a hash of the UUID is kept
+//! to save RAM, a match is confirmed by reading the UUID from the app's record.
+typedef struct {
+  uint32_t uuid_hash;
+  AppInstallId id;
+} AppDBIndexEntry;
+
+// The UUID is read from the start of a record without reading the rest of the entry
+_Static_assert(offsetof(AppDBEntry, uuid) == 0, "AppDBEntry must start with the UUID");
+
 static struct {
   SettingsFile settings_file;
   PebbleMutex *mutex;
+  //! Index of all the apps in the database, built when the database is initialized and kept
+  //! current by every insert and delete. If it can't be grown, it's dropped and lookups fall
+  //! back to scanning the file.
+  AppDBIndexEntry *index;
+  uint16_t index_count;
+  uint16_t index_capacity;
+  bool index_valid;
+  //! Changes every time an app is added, changed or removed
+  uint32_t generation;
 } s_app_db;
 
+//////////////////////
+// UUID index
+//////////////////////
+
+static uint32_t prv_uuid_hash(const Uuid *uuid) {
+  uint32_t words[UUID_SIZE / sizeof(uint32_t)];
+  memcpy(words, uuid, sizeof(words));
+  return words[0] ^ words[1] ^ words[2] ^ words[3];
+}
+
+static void prv_index_drop(void) {
+  kernel_free(s_app_db.index);
+  s_app_db.index = NULL;
+  s_app_db.index_count = 0;
+  s_app_db.index_capacity = 0;
+}
+
+static void prv_index_add(const Uuid *uuid, AppInstallId app_id) {
+  if (!s_app_db.index_valid) {
+    return;
+  }
+  if (s_app_db.index_count == s_app_db.index_capacity) {
+    const uint16_t new_capacity = MAX(s_app_db.index_capacity * 2, 16);
+    AppDBIndexEntry *new_index = kernel_realloc(s_app_db.index,
+                                                new_capacity * sizeof(AppDBIndexEntry));
+    if (!new_index) {
+      PBL_LOG(LOG_LEVEL_WARNING, "Couldn't grow the app db index, falling back to scanning");
+      prv_index_drop();
+      s_app_db.index_valid = false;
+      return;
+    }
+    s_app_db.index = new_index;
+    s_app_db.index_capacity = new_capacity;
+  }
+  s_app_db.index[s_app_db.index_count++] = (AppDBIndexEntry) {
+    .uuid_hash = prv_uuid_hash(uuid),
+    .id = app_id,
+  };
+}
+
+static void prv_index_remove(AppInstallId app_id) {
+  for (int i = 0; i < s_app_db.index_count; i++) {
+    if (s_app_db.index[i].id == app_id) {
+      s_app_db.index[i] = s_app_db.index[--s_app_db.index_count];
+      return;
+    }
+  }
+}
+
 //////////////////////
 // Settings helpers
 //////////////////////
@@ -90,6 +160,9 @@ static bool prv_each_inspect_ids(SettingsFile *file, SettingsRecordInfo *info, v
 
   AppInstallId app_id;
   info->get_key(file, (uint8_t *)&app_id, sizeof(AppInstallId));
+  Uuid uuid;
+  info->get_val(file, (uint8_t *)&uuid, sizeof(Uuid));
+  prv_index_add(&uuid, app_id);
 
   data->max_id = MAX(data->max_id, app_id);
   data->num_apps++;
@@ -114,11 +187,11 @@ static bool prv_db_filter_app_id(SettingsFile *file, SettingsRecordInfo *info, v
   struct UuidFilterData *uuid_data = (struct UuidFilterData *)context;
 
   AppInstallId app_id;
-  AppDBEntry entry;
+  Uuid uuid;
   info->get_key(file, (uint8_t *)&app_id, info->key_len);
-  info->get_val(file, (uint8_t *)&entry, info->val_len);
+  info->get_val(file, (uint8_t *)&uuid, sizeof(Uuid));
 
-  if (uuid_equal(&uuid_data->uuid, &entry.uuid)) {
+  if (uuid_equal(&uuid_data->uuid, &uuid)) {
     uuid_data->found_id = app_id;
     return false; // stop iterating
   }
@@ -128,6 +201,23 @@ static bool prv_db_filter_app_id(SettingsFile *file, SettingsRecordInfo *info, v
 //! Retrieves the AppInstallId for a given UUID using the SettingsFile that is already open.
 //! @note Requires holding the lock already
 static AppInstallId prv_find_install_id_for_uuid(SettingsFile *file, const Uuid *uuid) {
+  if (s_app_db.index_valid) {
+    const uint32_t uuid_hash = prv_uuid_hash(uuid);
+    for (int i = 0; i < s_app_db.index_count; i++) {
+      if (s_app_db.index[i].uuid_hash != uuid_hash) {
+        continue;
+      }
+      // Different UUIDs can have the same hash, check the one of the candidate
+      Uuid candidate_uuid;
+      if ((settings_file_get(file, (uint8_t *)&s_app_db.index[i].id, sizeof(AppInstallId),
+                             (uint8_t *)&candidate_uuid, sizeof(Uuid)) == S_SUCCESS) &&
+          uuid_equal(uuid, &candidate_uuid)) {
+        return s_app_db.index[i].id;
+      }
+    }
+    return INSTALL_ID_INVALID;
+  }
+
   // used when iterating through all entries in our database.
   struct UuidFilterData filter_data = {
     .found_id = INSTALL_ID_INVALID,
@@ -142,6 +232,10 @@ static AppInstallId prv_find_install_id_for_uuid(SettingsFile *file, const Uuid
 // App DB Specific API
 /////////////////////////
 
+uint32_t app_db_get_generation(void) {
+  return s_app_db.generation;
+}
+
 AppInstallId app_db_get_install_id_for_uuid(const Uuid *uuid) {
   status_t rv = prv_lock_mutex_and_open_file();
   if (rv != S_SUCCESS) {
@@ -240,8 +334,10 @@ void app_db_enumerate_entries(AppDBEnumerateCb cb, void *data) {
 /////////////////////////
 
 void app_db_init(void) {
+  kernel_free(s_app_db.index);
   memset(&s_app_db, 0, sizeof(s_app_db));
   s_app_db.mutex = mutex_create();
+  s_app_db.index_valid = true;
 
   // set to zero to reset unit test static variable.
   s_next_unique_flash_app_id = INSTALL_ID_INVALID;
@@ -299,6 +395,13 @@ status_t app_db_insert(const uint8_t *key, int key_len, const uint8_t *val, int
                            sizeof(AppInstallId), val, val_len);
   }
 
+  if (rv == S_SUCCESS) {
+    if (new_install) {
+      prv_index_add((const Uuid *)key, app_id);
+    }
+    s_app_db.generation++;
+  }
+
   prv_close_file_and_unlock_mutex();
 
   if (rv == S_SUCCESS) {
@@ -376,6 +479,10 @@ status_t app_db_delete(const uint8_t *key, int key_len) {
     rv = settings_file_delete(&s_app_db.settings_file, (uint8_t *)&app_id, sizeof(AppInstallId));
   }
 
+  if (rv == S_SUCCESS) {
+    prv_index_remove(app_id);
+    s_app_db.generation++;
+  }
 
   prv_close_file_and_unlock_mutex();
 
@@ -408,6 +515,9 @@ status_t app_db_flush(void) {
   // remove the settings file
   mutex_lock(s_app_db.mutex);
   pfs_remove(SETTINGS_FILE_NAME);
+  prv_index_drop();
+  s_app_db.index_valid = true;
+  s_app_db.generation++;
 
   mutex_unlock(s_app_db.mutex);
   PBL_LOG(LOG_LEVEL_WARNING, "AppDB Flush finished");
@@ -54,6 +54,10 @@ status_t app_db_get_app_entry_for_install_id(AppInstallId app_id, AppDBEntry *en
 
 void app_db_enumerate_entries(AppDBEnumerateCb cb, void *data);
 
+//! @return A number which changes whenever an app is added to, changed in or removed from the
+//! database. Sample it before reading an entry to know whether a copy of it is still current.
+uint32_t app_db_get_generation(void);
+
 /* AppDB AppInstallId Implementation */
 
 bool app_db_exists_install_id(AppInstallId app_id);
@@ -57,15 +57,21 @@ static struct {
 // Slice Type Implementation Definition
 //////////////////////////////////////////
 
-//! Return true if the type-specific serialized slice's attribute list is valid. You don't have to
-//! check the attribute list pointer (we check it before calling this callback).
-typedef bool (*AttributeListValidationFunc)(const AttributeList *attr_list);
-
-//! Callback for copying the type-specific attributes from a serialized slice's attribute list
-//! to the provided slice. You can assume that the attribute list and the slice_out pointers are
-//! valid because we check them before calling this callback.
-typedef void (*InitSliceFromAttributeListFunc)(const AttributeList *attr_list,
-                                               AppGlanceSliceInternal *slice_out);
+//! Callback for setting the type-specific fields of the provided slice to their defaults, before
+//! any attributes are decoded into it. You can assume that the slice pointer is valid because we
+//! check it before calling this callback.
+typedef void (*InitSliceFunc)(AppGlanceSliceInternal *slice_out);
+
+//! Callback for copying a type-specific attribute straight from a serialized slice to the provided
+//! slice. The attribute has already been checked to fit in the serialized slice and to have a
+//! valid length for its type. Skip attributes this slice type doesn't use, and return false if the
+//! attribute makes the slice invalid.
+typedef bool (*DecodeSliceAttributeFunc)(const SerializedAttributeHeader *attribute,
+                                         const uint8_t *attribute_data,
+                                         AppGlanceSliceInternal *slice_out);
+
+//! Return true if the decoded slice has the attributes required for its type.
+typedef bool (*SliceValidationFunc)(const AppGlanceSliceInternal *slice);
 
 //! Callback for adding the type-specific fields from a slice to the provided attribute list.
 //! You can assume that the slice and attribute list pointers are valid because we check them
@@ -74,8 +80,9 @@ typedef void (*InitAttributeListFromSliceFunc)(const AppGlanceSliceInternal *sli
                                                AttributeList *attr_list_to_init);
 
 typedef struct SliceTypeImplementation {
-  AttributeListValidationFunc is_attr_list_valid;
-  InitSliceFromAttributeListFunc init_slice_from_attr_list;
+  InitSliceFunc init_slice;
+  DecodeSliceAttributeFunc decode_attribute;
+  SliceValidationFunc is_slice_valid;
   InitAttributeListFromSliceFunc init_attr_list_from_slice;
 } SliceTypeImplementation;
 
@@ -83,19 +90,31 @@ typedef struct SliceTypeImplementation {
 // AppGlanceSliceType_IconAndSubtitle Implementation
 ////////////////////////////////////////////////////////
 
-static bool prv_is_icon_and_subtitle_slice_attribute_list_valid(const AttributeList *attr_list) {
-  // The icon and subtitle are optional.
+static void prv_init_icon_and_subtitle_slice(AppGlanceSliceInternal *slice_out) {
+  slice_out->icon_and_subtitle.icon_resource_id = INVALID_RESOURCE;
+}
+
+static bool prv_decode_icon_and_subtitle_slice_attribute(
+    const SerializedAttributeHeader *attribute, const uint8_t *attribute_data,
+    AppGlanceSliceInternal *slice_out) {
+  switch (attribute->id) {
+    case AttributeIdIcon:
+      memcpy(&slice_out->icon_and_subtitle.icon_resource_id, attribute_data, sizeof(uint32_t));
+      break;
+    case AttributeIdSubtitleTemplateString:
+      // Too long subtitles are truncated, like attribute_deserialize_list() does
+      strncpy(slice_out->icon_and_subtitle.template_string, (const char *)attribute_data,
+              MIN(attribute->length, (uint16_t)ATTRIBUTE_APP_GLANCE_SUBTITLE_MAX_LEN));
+      break;
+    default:
+      break;
+  }
   return true;
 }
 
-static void prv_init_icon_and_subtitle_slice_from_attr_list(const AttributeList *attr_list,
-                                                            AppGlanceSliceInternal *slice_out) {
-  slice_out->icon_and_subtitle.icon_resource_id = attribute_get_uint32(attr_list,
-                                                                       AttributeIdIcon,
-                                                                       INVALID_RESOURCE);
-  strncpy(slice_out->icon_and_subtitle.template_string,
-          attribute_get_string(attr_list, AttributeIdSubtitleTemplateString, NULL),
-          ATTRIBUTE_APP_GLANCE_SUBTITLE_MAX_LEN + 1);
+static bool prv_is_icon_and_subtitle_slice_valid(const AppGlanceSliceInternal *slice) {
+  // The icon and subtitle are optional.
+  return true;
 }
 
 static void prv_init_attribute_list_from_icon_and_subtitle_slice(
@@ -113,60 +132,13 @@ static void prv_init_attribute_list_from_icon_and_subtitle_slice(
 //! Add new entries to this array as we introduce new slice types
 static const SliceTypeImplementation s_slice_type_impls[AppGlanceSliceTypeCount] = {
   [AppGlanceSliceType_IconAndSubtitle] = {
-    .is_attr_list_valid = prv_is_icon_and_subtitle_slice_attribute_list_valid,
-    .init_slice_from_attr_list = prv_init_icon_and_subtitle_slice_from_attr_list,
+    .init_slice = prv_init_icon_and_subtitle_slice,
+    .decode_attribute = prv_decode_icon_and_subtitle_slice_attribute,
+    .is_slice_valid = prv_is_icon_and_subtitle_slice_valid,
     .init_attr_list_from_slice = prv_init_attribute_list_from_icon_and_subtitle_slice,
   },
 };
 
-//////////////////////////////////
-// Serialized Slice Iteration
-//////////////////////////////////
-
-//! Return true to continue iteration and false to stop it.
-typedef bool (*SliceForEachCb)(SerializedAppGlanceSliceHeader *serialized_slice, void *context);
-
-//! Returns true if iteration completed successfully, either due to reaching the end of the slices
-//! or if the client's callback returns false to stop iteration early.
-//! Returns false if an error occurred during iteration due to the slices' `.total_size` values
-//! not being consistent with the provided `serialized_glance_size` argument.
-static bool prv_slice_for_each(SerializedAppGlanceHeader *serialized_glance,
-                               size_t serialized_glance_size, SliceForEachCb cb, void *context) {
-  if (!serialized_glance || !cb) {
-    return false;
-  }
-
-  SerializedAppGlanceSliceHeader *current_slice =
-      (SerializedAppGlanceSliceHeader *)serialized_glance->data;
-
-  size_t glance_size_processed = sizeof(SerializedAppGlanceHeader);
-
-  // Note that we'll stop iterating after reading the max supported number of slices per glance
-  for (unsigned int i = 0; i < APP_GLANCE_DB_MAX_SLICES_PER_GLANCE; i++) {
-    // Stop iterating if we've read all of the slices by hitting the end of the glance data
-    if (glance_size_processed == serialized_glance_size) {
-      break;
-    }
-
-    // Stop iterating and report an error if we've somehow gone beyond the end of the glance data
-    if (glance_size_processed > serialized_glance_size) {
-      return false;
-    }
-
-    // Stop iterating if the client's callback function returns false
-    if (!cb(current_slice, context)) {
-      break;
-    }
-
-    // Advance to the next slice
-    glance_size_processed += current_slice->total_size;
-    current_slice =
-        (SerializedAppGlanceSliceHeader *)(((uint8_t *)current_slice) + current_slice->total_size);
-  }
-
-  return true;
-}
-
 /////////////////////////////////////////
 // Serialized Slice Validation Helpers
 /////////////////////////////////////////
@@ -175,177 +147,112 @@ static bool prv_is_slice_type_valid(uint8_t type) {
   return (type < AppGlanceSliceTypeCount);
 }
 
-//! Returns true if the provided AttributeList is valid for the specified AppGlanceSliceType,
-//! false otherwise.
-static bool prv_is_slice_attribute_list_valid(uint8_t type, const AttributeList *attr_list) {
-  // Check if the slice type is valid before we plug it into the validation func array below
-  if (!prv_is_slice_type_valid(type)) {
-    return false;
-  }
-
-  // Check if the AttributeList has the attributes required for this specific slice type
-  return s_slice_type_impls[type].is_attr_list_valid(attr_list);
-}
-
 //////////////////////////////////
-// Slice Deserialization
+// Slice Decoding
 //////////////////////////////////
 
-//! Returns true if a non-empty AttributeList was successfully deserialized from `serialized_slice`,
-//! `attr_list` was filled with the result, and `attr_list_data_buffer_out` was filled with the data
-//! buffer for `attr_list_out`. Returns false otherwise.
-//! @note If function returns true, client must call `attribute_list_destroy_list()`
-//!       on `attr_list_out` and `kernel_free()` on `attr_list_data_buffer_out`.
-static bool prv_deserialize_attribute_list(const SerializedAppGlanceSliceHeader *serialized_slice,
-                                           AttributeList *attr_list_out,
-                                           char **attr_list_data_buffer_out) {
-  if (!serialized_slice || !attr_list_out || !attr_list_data_buffer_out) {
-    return false;
-  }
-
-  const uint8_t num_attributes = serialized_slice->num_attributes;
-  // If there aren't any attributes, set `attr_list_out` to be an empty AttributeList and return
-  // true because technically we did successfully deserialize the AttributeList
-  if (!num_attributes) {
-    *attr_list_out = (AttributeList) {};
-    *attr_list_data_buffer_out = NULL;
-    return true;
-  }
+_Static_assert(NumAttributeIds <= 64, "Decoded attribute IDs don't fit in a uint64_t anymore");
 
-  const uint8_t * const serialized_attr_list_start = serialized_slice->data;
-  const uint8_t * const serialized_attr_list_end =
-      serialized_attr_list_start + serialized_slice->total_size;
-
-  // Get the buffer size needed for the attributes we're going to deserialize
-  const uint8_t *buffer_size_cursor = serialized_attr_list_start;
-  const int32_t buffer_size =
-      attribute_get_buffer_size_for_serialized_attributes(num_attributes, &buffer_size_cursor,
-                                                          serialized_attr_list_end);
-  if (buffer_size < 0) {
-    PBL_LOG(LOG_LEVEL_WARNING,
-            "Failed to measure the buffer size required for deserializing an AttributeList from a "
-            "serialized slice");
+//! Decodes a serialized slice straight from the serialized data, without deserializing its
+//! attributes into an AttributeList first. Every attribute has to fit in the slice, and like
+//! attribute_deserialize_list(), decoding stops at the first attribute with an unknown type or
+//! with the wrong length for its type.
+//! @return true if the serialized slice is valid, in which case `slice_out` holds the decoded slice
+static bool prv_decode_slice(const SerializedAppGlanceSliceHeader *serialized_slice,
+                             AppGlanceSliceInternal *slice_out) {
+  if (!prv_is_slice_type_valid(serialized_slice->type) ||
+      !WITHIN(serialized_slice->total_size, APP_GLANCE_DB_SLICE_MIN_SIZE,
+              APP_GLANCE_DB_SLICE_MAX_SIZE)) {
     return false;
   }
 
-  if (buffer_size) {
-    // Allocate buffer for the data attached to the attributes
-    *attr_list_data_buffer_out = kernel_zalloc(buffer_size);
-    if (!*attr_list_data_buffer_out) {
-      PBL_LOG(LOG_LEVEL_ERROR,
-              "Failed to alloc memory for the Attributes' data buffer while deserializing an "
-              "AttributeList from a serialized slice");
+  const SliceTypeImplementation *impl = &s_slice_type_impls[serialized_slice->type];
+  // Note that we default the expiration time to "never expire" if one was not provided
+  *slice_out = (AppGlanceSliceInternal) {
+    .expiration_time = APP_GLANCE_SLICE_NO_EXPIRATION,
+    .type = (AppGlanceSliceType)serialized_slice->type,
+  };
+  impl->init_slice(slice_out);
+
+  const uint8_t *cursor = serialized_slice->data;
+  const uint8_t * const slice_end =
+      (const uint8_t *)serialized_slice + serialized_slice->total_size;
+  // Like attribute_find(), the first attribute with a given ID is the one that counts
+  uint64_t decoded_attribute_ids = 0;
+  bool is_decoding = true;
+  for (unsigned int i = 0; i < serialized_slice->num_attributes; i++) {
+    if ((cursor + sizeof(SerializedAttributeHeader)) > slice_end) {
+      return false;
+    }
+    const SerializedAttributeHeader *attribute = (const SerializedAttributeHeader *)cursor;
+    cursor += sizeof(SerializedAttributeHeader);
+    if ((cursor + attribute->length) > slice_end) {
       return false;
     }
-  } else {
-    // No buffer needed, but set the output pointer to NULL because we might blindly free it below
-    // if we fail to alloc memory for the attribute_buffer
-    *attr_list_data_buffer_out = NULL;
-  }
-
-  // Allocate buffer for the Attribute's
-  // Note that this doesn't need to be passed back as an output because it gets freed as part of the
-  // client calling `attribute_list_destroy_list()` on `attr_list_out`
-  Attribute *attribute_buffer = kernel_zalloc(num_attributes * sizeof(*attribute_buffer));
-  if (!attribute_buffer) {
-    PBL_LOG(LOG_LEVEL_ERROR,
-            "Failed to alloc memory for the buffer of Attribute's while deserializing an "
-            "AttributeList from a serialized slice");
-    // Free the `*attr_list_data_buffer_out` we might have allocated above
-    kernel_free(*attr_list_data_buffer_out);
-    return false;
-  }
 
-  // Setup the arguments for `attribute_deserialize_list()`
-  char *attribute_data_buffer_pointer = *attr_list_data_buffer_out;
-  char * const attribute_data_buffer_end = attribute_data_buffer_pointer + buffer_size;
-  *attr_list_out = (AttributeList) {
-    .num_attributes = num_attributes,
-    .attributes = attribute_buffer,
-  };
-  const uint8_t *deserialization_cursor = serialized_attr_list_start;
+    is_decoding = is_decoding &&
+                  attribute_is_serialized_attribute_valid(attribute->id, attribute->length);
+    if (is_decoding && !(decoded_attribute_ids & ((uint64_t)1 << attribute->id))) {
+      decoded_attribute_ids |= ((uint64_t)1 << attribute->id);
+      if (attribute->id == AttributeIdTimestamp) {
+        uint32_t expiration_time;
+        memcpy(&expiration_time, cursor, sizeof(expiration_time));
+        slice_out->expiration_time = expiration_time;
+      } else if (!impl->decode_attribute(attribute, cursor, slice_out)) {
+        return false;
+      }
+    }
 
-  // Try to deserialize the AttributeList
-  const bool was_attr_list_deserialized = attribute_deserialize_list(&attribute_data_buffer_pointer,
-                                                                     attribute_data_buffer_end,
-                                                                     &deserialization_cursor,
-                                                                     serialized_attr_list_end,
-                                                                     *attr_list_out);
-  if (!was_attr_list_deserialized) {
-    kernel_free(attribute_buffer);
-    kernel_free(*attr_list_data_buffer_out);
+    cursor += attribute->length;
   }
 
-  return was_attr_list_deserialized;
+  return impl->is_slice_valid(slice_out);
 }
 
-typedef struct SliceDeserializationIteratorContext {
-  AppGlance *glance_out;
-  bool deserialization_failed;
-} SliceDeserializationIteratorContext;
-
-static bool prv_deserialize_slice(SerializedAppGlanceSliceHeader *serialized_slice, void *context) {
-  SliceDeserializationIteratorContext *deserialization_context = context;
+//! Walks the slices of a serialized glance once, checking and decoding each of them in place. This
+//! is used both to validate glances before they are inserted and to read them back.
+//! @param glance_out The glance to decode the slices into, or NULL to only check them
+//! @param decoded_size_out Set to the size of the serialized glance up to the last slice that was
+//!        decoded, which is smaller than `serialized_glance_size` if the glance has more than
+//!        APP_GLANCE_DB_MAX_SLICES_PER_GLANCE slices
+//! @return true if the slices' `.total_size` values are consistent with `serialized_glance_size`
+//!         and all of the decoded slices are valid, false otherwise
+static bool prv_decode_glance(const SerializedAppGlanceHeader *serialized_glance,
+                              size_t serialized_glance_size, AppGlance *glance_out,
+                              size_t *decoded_size_out) {
+  AppGlanceSliceInternal scratch_slice;
+  size_t decoded_size = sizeof(SerializedAppGlanceHeader);
+  unsigned int num_slices = 0;
+
+  // Note that we'll stop decoding after the max supported number of slices per glance
+  while ((num_slices < APP_GLANCE_DB_MAX_SLICES_PER_GLANCE) &&
+         (decoded_size < serialized_glance_size)) {
+    const SerializedAppGlanceSliceHeader *serialized_slice =
+        (const SerializedAppGlanceSliceHeader *)((const uint8_t *)serialized_glance +
+                                                 decoded_size);
+    const size_t remaining_size = serialized_glance_size - decoded_size;
+    if ((remaining_size < sizeof(SerializedAppGlanceSliceHeader)) ||
+        (serialized_slice->total_size > remaining_size)) {
+      return false;
+    }
 
-  // Deserialize the serialized slice's attribute list
-  AttributeList attr_list = {};
-  char *attr_list_data_buffer = NULL;
-  if (!prv_deserialize_attribute_list(serialized_slice, &attr_list, &attr_list_data_buffer)) {
-    deserialization_context->deserialization_failed = true;
-    return false;
-  }
+    AppGlanceSliceInternal *slice_out = glance_out ? &glance_out->slices[num_slices] :
+                                                     &scratch_slice;
+    if (!prv_decode_slice(serialized_slice, slice_out)) {
+      return false;
+    }
 
-  // Check that the deserialized attribute list is valid
-  const bool success = prv_is_slice_attribute_list_valid(serialized_slice->type, &attr_list);
-  if (!success) {
-    goto cleanup;
+    decoded_size += serialized_slice->total_size;
+    num_slices++;
   }
 
-  AppGlance *glance_out = deserialization_context->glance_out;
-
-  // Copy the common serialized slice fields to the output glance's slice
-  const unsigned int current_slice_index = glance_out->num_slices;
-  AppGlanceSliceInternal *current_slice_out = &glance_out->slices[current_slice_index];
-  // Note that we default the expiration time to "never expire" if one was not provided
-  *current_slice_out = (AppGlanceSliceInternal) {
-    .expiration_time = attribute_get_uint32(&attr_list, AttributeIdTimestamp,
-                                            APP_GLANCE_SLICE_NO_EXPIRATION),
-    .type = (AppGlanceSliceType)serialized_slice->type,
-  };
-  // Copy type-specific fields from the serialized slice to the output glance's slice
-  s_slice_type_impls[serialized_slice->type].init_slice_from_attr_list(&attr_list,
-                                                                       current_slice_out);
-
-  // Increment the number of slices in the glance
-  glance_out->num_slices++;
-
-cleanup:
-  attribute_list_destroy_list(&attr_list);
-  kernel_free(attr_list_data_buffer);
-
-  return success;
-}
-
-static status_t prv_deserialize_glance(SerializedAppGlanceHeader *serialized_glance,
-                                       size_t serialized_glance_size, AppGlance *glance_out) {
-  if (!serialized_glance || !glance_out) {
-    return E_INVALID_ARGUMENT;
+  if (glance_out) {
+    glance_out->num_slices = num_slices;
   }
-
-  // Zero out the output glance
-  *glance_out = (AppGlance) {};
-
-  // Iterate over the slices to deserialize them
-  SliceDeserializationIteratorContext context = (SliceDeserializationIteratorContext) {
-    .glance_out = glance_out,
-  };
-  if (!prv_slice_for_each(serialized_glance, serialized_glance_size,
-                          prv_deserialize_slice, &context) ||
-      context.deserialization_failed) {
-    return E_ERROR;
+  if (decoded_size_out) {
+    *decoded_size_out = decoded_size;
   }
-
-  return S_SUCCESS;
+  return true;
 }
 
 //////////////////////////////////
@@ -477,65 +384,44 @@ cleanup:
   return rv;
 }
 
-//////////////////////////////////
-// Serialized Slice Validation
-//////////////////////////////////
-
-static bool prv_is_serialized_slice_valid(const SerializedAppGlanceSliceHeader *serialized_slice) {
-  if (!serialized_slice ||
-      !prv_is_slice_type_valid(serialized_slice->type) ||
-      !WITHIN(serialized_slice->total_size, APP_GLANCE_DB_SLICE_MIN_SIZE,
-              APP_GLANCE_DB_SLICE_MAX_SIZE)) {
-    return false;
-  }
+//////////////////////
+// Settings helpers
+//////////////////////
 
-  // Deserialize the AttributeList from `serialized_slice`
-  AttributeList attr_list = {};
-  char *attr_list_data_buffer = NULL;
-  if (!prv_deserialize_attribute_list(serialized_slice, &attr_list, &attr_list_data_buffer)) {
-    PBL_LOG(LOG_LEVEL_WARNING,
-            "Failed to deserialize an AttributeList from a serialized slice");
-    return false;
-  }
+// TODO PBL-38080: Extract out settings file opening/closing and mutex locking/unlocking for BlobDB
 
-  // Check if the AttributeList has the attributes required for the slice
-  const bool is_attr_list_valid = prv_is_slice_attribute_list_valid(serialized_slice->type,
-                                                                    &attr_list);
-  if (!is_attr_list_valid) {
-    PBL_LOG(LOG_LEVEL_WARNING, "Serialized slice AttributeList is invalid");
+static status_t prv_lock_mutex_and_open_file(void) {
+  mutex_lock(s_app_glance_db.mutex);
+  const status_t rv = settings_file_open(&s_app_glance_db.settings_file, SETTINGS_FILE_NAME,
+                                         SETTINGS_FILE_SIZE);
+  if (rv != S_SUCCESS) {
+    mutex_unlock(s_app_glance_db.mutex);
   }
-
-  attribute_list_destroy_list(&attr_list);
-  kernel_free(attr_list_data_buffer);
-
-  return is_attr_list_valid;
+  return rv;
 }
 
-typedef struct SliceValidationIteratorContext {
-  bool is_at_least_one_slice_invalid;
-  size_t validated_size;
-} SliceValidationIteratorContext;
-
-//! If any slices are invalid, context.is_at_least_one_slice_invalid will be set to true.
-//! If all the slices are valid, context.validated_size will hold the size of the entire serialized
-//! glance after trimming any slices that go beyond the APP_GLANCE_DB_MAX_SLICES_PER_GLANCE limit.
-//! @note This assumes that context.validated_size has been initialized to take into account
-//!       the serialized app glance's header.
-static bool prv_validate_slice(SerializedAppGlanceSliceHeader *serialized_slice, void *context) {
-  SliceValidationIteratorContext *validation_context = context;
-  PBL_ASSERTN(validation_context);
-
-  if (!prv_is_serialized_slice_valid(serialized_slice)) {
-    *validation_context = (SliceValidationIteratorContext) {
-      .is_at_least_one_slice_invalid = true,
-      .validated_size = 0,
-    };
-    return false;
-  }
+static void prv_close_file_and_unlock_mutex(void) {
+  settings_file_close(&s_app_glance_db.settings_file);
+  mutex_unlock(s_app_glance_db.mutex);
+}
 
-  validation_context->validated_size += serialized_slice->total_size;
+//! Reads an entry from the open settings file, deleting it if it's stale.
+static status_t prv_get_entry(const uint8_t *key, int key_len, uint8_t *val_out,
+                              int val_out_len) {
+  status_t rv = settings_file_get(&s_app_glance_db.settings_file, key, (size_t)key_len, val_out,
+                                  (size_t)val_out_len);
+  if (rv == S_SUCCESS) {
+    SerializedAppGlanceHeader *serialized_app_glance = (SerializedAppGlanceHeader *)val_out;
 
-  return true;
+    // Change this block if we support multiple app glance versions in the future
+    if (serialized_app_glance->version != APP_GLANCE_DB_CURRENT_VERSION) {
+      // Clear out the stale entry
+      PBL_LOG(LOG_LEVEL_WARNING, "Read a AppGlanceDB entry with an outdated version; deleting it");
+      settings_file_delete(&s_app_glance_db.settings_file, key, (size_t)key_len);
+      rv = E_DOES_NOT_EXIST;
+    }
+  }
+  return rv;
 }
 
 /////////////////////////
@@ -568,27 +454,35 @@ status_t app_glance_db_read_glance(const Uuid *uuid, AppGlance *glance_out) {
   const uint8_t *key = (uint8_t *)uuid;
   const int key_size = UUID_SIZE;
 
-  const int serialized_glance_size = app_glance_db_get_len(key, key_size);
-  if (!serialized_glance_size) {
+  status_t rv = prv_lock_mutex_and_open_file();
+  if (rv != S_SUCCESS) {
     return E_DOES_NOT_EXIST;
+  }
+
+  // Look up the length and read the entry while the file is open rather than opening it twice
+  uint8_t *serialized_glance = NULL;
+  const int serialized_glance_size =
+      settings_file_get_len(&s_app_glance_db.settings_file, key, (size_t)key_size);
+  if (!serialized_glance_size) {
+    rv = E_DOES_NOT_EXIST;
   } else if (serialized_glance_size < 0) {
     WTF;
+  } else {
+    serialized_glance = kernel_malloc((size_t)serialized_glance_size);
+    rv = serialized_glance ? prv_get_entry(key, key_size, serialized_glance,
+                                           serialized_glance_size) : E_OUT_OF_MEMORY;
   }
 
-  uint8_t *serialized_glance = kernel_zalloc((size_t)serialized_glance_size);
-  if (!serialized_glance) {
-    return E_OUT_OF_MEMORY;
-  }
+  prv_close_file_and_unlock_mutex();
 
-  status_t rv = app_glance_db_read(key, key_size, serialized_glance, serialized_glance_size);
-  if (rv != S_SUCCESS) {
-    goto cleanup;
+  if (rv == S_SUCCESS) {
+    // Decode the slices straight from the entry we just read
+    *glance_out = (AppGlance) {};
+    rv = prv_decode_glance((SerializedAppGlanceHeader *)serialized_glance,
+                           (size_t)serialized_glance_size, glance_out, NULL) ? S_SUCCESS :
+                                                                              E_ERROR;
   }
 
-  rv = prv_deserialize_glance((SerializedAppGlanceHeader *)serialized_glance,
-                              (size_t)serialized_glance_size, glance_out);
-
-cleanup:
   kernel_free(serialized_glance);
   return rv;
 }
@@ -612,27 +506,6 @@ status_t app_glance_db_delete_glance(const Uuid *uuid) {
   return app_glance_db_delete((uint8_t *)uuid, UUID_SIZE);
 }
 
-//////////////////////
-// Settings helpers
-//////////////////////
-
-// TODO PBL-38080: Extract out settings file opening/closing and mutex locking/unlocking for BlobDB
-
-static status_t prv_lock_mutex_and_open_file(void) {
-  mutex_lock(s_app_glance_db.mutex);
-  const status_t rv = settings_file_open(&s_app_glance_db.settings_file, SETTINGS_FILE_NAME,
-                                         SETTINGS_FILE_SIZE);
-  if (rv != S_SUCCESS) {
-    mutex_unlock(s_app_glance_db.mutex);
-  }
-  return rv;
-}
-
-static void prv_close_file_and_unlock_mutex(void) {
-  settings_file_close(&s_app_glance_db.settings_file);
-  mutex_unlock(s_app_glance_db.mutex);
-}
-
 /////////////////////////
 // Blob DB API
 /////////////////////////
@@ -673,22 +546,11 @@ static status_t prv_validate_glance(const Uuid *app_uuid,
     return E_INVALID_ARGUMENT;
   }
 
-  // Validate the slices (which also records a `validated_size` we'll use to trim excess slices)
-  SliceValidationIteratorContext validation_context = {
-    // Start by taking into account the header of the serialized glance
-    .validated_size = sizeof(SerializedAppGlanceHeader),
-  };
-  // Iteration will fail if the slices report `total_size` values that
-  const bool iteration_succeeded =
-      prv_slice_for_each((SerializedAppGlanceHeader *)serialized_glance, *len,
-                         prv_validate_slice, &validation_context);
-  if (!iteration_succeeded) {
-    PBL_LOG(LOG_LEVEL_WARNING,
-            "Tried to insert AppGlanceDB entry but failed to iterate over the serialized slices");
-    return E_INVALID_ARGUMENT;
-  } else if (validation_context.is_at_least_one_slice_invalid) {
+  // Check the slices, which also gives us a `validated_size` we'll use to trim excess slices
+  size_t validated_size;
+  if (!prv_decode_glance(serialized_glance, *len, NULL, &validated_size)) {
     PBL_LOG(LOG_LEVEL_WARNING,
-            "Tried to insert AppGlanceDB entry with at least one invalid slice");
+            "Tried to insert AppGlanceDB entry with malformed or invalid slices");
     return E_INVALID_ARGUMENT;
   }
 
@@ -698,10 +560,10 @@ static status_t prv_validate_glance(const Uuid *app_uuid,
   // of knowing the max number of slices supported by the firmware, and so they send us as many
   // slices as they can fit in a BlobDB packet. We just take as many slices as we support and trim
   // the excess.
-  if (validation_context.validated_size < *len) {
+  if (validated_size < *len) {
     PBL_LOG(LOG_LEVEL_WARNING,
             "Trimming AppGlanceDB entry of excess slices before insertion");
-    *len = validation_context.validated_size;
+    *len = validated_size;
   }
   return S_SUCCESS;
 }
@@ -792,19 +654,7 @@ status_t app_glance_db_read(const uint8_t *key, int key_len, uint8_t *val_out, i
     return rv;
   }
 
-  rv = settings_file_get(&s_app_glance_db.settings_file, key, (size_t)key_len, val_out,
-                         (size_t)val_out_len);
-  if (rv == S_SUCCESS) {
-    SerializedAppGlanceHeader *serialized_app_glance = (SerializedAppGlanceHeader *)val_out;
-
-    // Change this block if we support multiple app glance versions in the future
-    if (serialized_app_glance->version != APP_GLANCE_DB_CURRENT_VERSION) {
-      // Clear out the stale entry
-      PBL_LOG(LOG_LEVEL_WARNING, "Read a AppGlanceDB entry with an outdated version; deleting it");
-      settings_file_delete(&s_app_glance_db.settings_file, key, (size_t)key_len);
-      rv = E_DOES_NOT_EXIST;
-    }
-  }
+  rv = prv_get_entry(key, key_len, val_out, val_out_len);
 
   prv_close_file_and_unlock_mutex();
 
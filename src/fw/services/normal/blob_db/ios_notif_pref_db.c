@@ -316,8 +316,7 @@ status_t ios_notif_pref_db_is_dirty(bool *is_dirty_out) {
     return rv;
   }
 
-  *is_dirty_out = false;
-  rv = settings_file_each(&file, sync_util_is_dirty_cb, is_dirty_out);
+  *is_dirty_out = sync_util_is_dirty(&file);
 
   prv_file_close_and_unlock(&file);
 
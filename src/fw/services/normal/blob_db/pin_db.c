@@ -203,7 +203,8 @@ status_t pin_db_read_item_header(TimelineItem *item_out, TimelineItemId *id) {
 status_t pin_db_next_item_header(TimelineItem *next_item_out,
                                  TimelineItemStorageFilterCallback filter) {
   TimelineItemId id;
-  status_t rv = timeline_item_storage_next_item(&s_pin_db_storage, &id, filter);
+  // The timeline event filter looks at every pin, so the time ordered index can't short circuit it
+  status_t rv = timeline_item_storage_next_item_scan_all(&s_pin_db_storage, &id, filter);
   if (rv) {
     return rv;
   }
@@ -260,8 +261,8 @@ status_t pin_db_flush(void) {
 }
 
 status_t pin_db_is_dirty(bool *is_dirty_out) {
-  *is_dirty_out = false;
-  return timeline_item_storage_each(&s_pin_db_storage, sync_util_is_dirty_cb, is_dirty_out);
+  *is_dirty_out = timeline_item_storage_is_dirty(&s_pin_db_storage);
+  return S_SUCCESS;
 }
 
 BlobDBDirtyItem* pin_db_get_dirty_list(void) {
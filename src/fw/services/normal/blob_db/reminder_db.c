@@ -267,8 +267,8 @@ status_t reminder_db_flush(void) {
 }
 
 status_t reminder_db_is_dirty(bool *is_dirty_out) {
-  *is_dirty_out = false;
-  return timeline_item_storage_each(&s_storage, sync_util_is_dirty_cb, is_dirty_out);
+  *is_dirty_out = timeline_item_storage_is_dirty(&s_storage);
+  return S_SUCCESS;
 }
 
 BlobDBDirtyItem* reminder_db_get_dirty_list(void) {
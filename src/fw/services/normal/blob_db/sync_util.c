@@ -18,26 +18,22 @@
 
 #include "kernel/pbl_malloc.h"
 #include "system/logging.h"
+#include "util/math.h"
 
 // Caution: CommonTimelineItemHeader .flags & .status are stored inverted and not auto-restored
 // by the underlying db API. If .flags or .status is used from a CommonTimelineItemHeader below,
 // be very careful
 
 
-bool sync_util_is_dirty_cb(SettingsFile *file, SettingsRecordInfo *info, void *context) {
-  // If there is a single dirty record, update the out bool to dirty and stop iterating
-  if (info->dirty) {
-    *((bool *)context) = true;
-    return false;
-  }
-
-  return true;
+bool sync_util_is_dirty(SettingsFile *file) {
+  return (settings_file_get_num_dirty(file) > 0);
 }
 
 bool sync_util_build_dirty_list_cb(SettingsFile *file, SettingsRecordInfo *info, void *context) {
-  if (info->dirty) {
-    BlobDBDirtyItem *dirty_list = *(BlobDBDirtyItem **)context;
-
+  BlobDBDirtyItem *dirty_list = *(BlobDBDirtyItem **)context;
+  // Deleted records are skipped by the sync session and don't count towards the dirty records
+  // of the file, so leave them out of the list as well
+  if (info->dirty && info->val_len > 0) {
     BlobDBDirtyItem *new_node = kernel_zalloc(sizeof(BlobDBDirtyItem) + info->key_len);
     if (!new_node) {
       PBL_LOG(LOG_LEVEL_WARNING, "Ran out of memory while building a dirty list");
@@ -48,9 +44,11 @@ bool sync_util_build_dirty_list_cb(SettingsFile *file, SettingsRecordInfo *info,
     new_node->key_len = info->key_len;
     info->get_key(file, new_node->key, new_node->key_len);
 
-    *(BlobDBDirtyItem **)context =
-        (BlobDBDirtyItem *)list_prepend((ListNode *) dirty_list, (ListNode *)new_node);
+    dirty_list = (BlobDBDirtyItem *)list_prepend((ListNode *) dirty_list, (ListNode *)new_node);
+    *(BlobDBDirtyItem **)context = dirty_list;
   }
 
-  return true;
+  // Stop once the batch is full or there are no dirty records left to find
+  const int num_items = list_count((ListNode *)dirty_list);
+  return (num_items < MIN(SYNC_UTIL_DIRTY_LIST_BATCH_SIZE, settings_file_get_num_dirty(file)));
 }
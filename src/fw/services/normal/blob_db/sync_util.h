@@ -23,10 +23,15 @@
 // by the underlying db API. If .flags or .status is used from a CommonTimelineItemHeader below,
 // be very careful.
 
-//! A settings file each callback which checks if the there are dirty records in the file
-//! @param context The address of a bool which will get set
-bool sync_util_is_dirty_cb(SettingsFile *file, SettingsRecordInfo *info, void *context);
+//! Maximum number of items put in a dirty list at once. The sync session asks for the next batch
+//! once it has worked through the current one, so a large backlog is never materialized at once.
+#define SYNC_UTIL_DIRTY_LIST_BATCH_SIZE 16
 
-//! A settings file each callback which builds a BlobDBDirtyItem list
+//! @return true if the file has any records which have not been marked as synced
+bool sync_util_is_dirty(SettingsFile *file);
+
+//! A settings file each callback which builds a BlobDBDirtyItem list of up to
+//! SYNC_UTIL_DIRTY_LIST_BATCH_SIZE items. Iteration stops as soon as the batch is full or every
+//! dirty record in the file has been found.
 //! @param context The address of an empty dirty list which will get built
 bool sync_util_build_dirty_list_cb(SettingsFile *file, SettingsRecordInfo *info, void *context);
@@ -20,9 +20,19 @@
 #include "services/normal/filesystem/pfs.h"
 #include "services/normal/settings/settings_raw_iter.h"
 #include "system/logging.h"
+#include "util/math.h"
+#include "util/time/time.h"
+
+#include <string.h>
 
 #define MAX_CHILDREN_PER_PIN 3
 
+// The index grows with the number of items, 24 bytes each. pin_db and reminder_db each have one,
+// so together they take at most 6 KiB of kernel heap, and only while holding 128 items each,
+// which is more than a few days of a busy timeline. Storages holding more items are scanned.
+#define INDEX_MIN_CAPACITY 16
+#define INDEX_MAX_CAPACITY 128
+
 typedef struct {
   Uuid parent_id;
   Uuid children_ids[MAX_CHILDREN_PER_PIN];
@@ -122,6 +132,244 @@ static bool prv_each_find_children(SettingsFile *file, SettingsRecordInfo *info,
   return ((find_info->num_children < MAX_CHILDREN_PER_PIN) && find_info->find_all);
 }
 
+///////////////////////////////////
+// Index
+///////////////////////////////////
+
+static bool prv_is_valid_record(SettingsRecordInfo *info) {
+  return (info->key_len == UUID_SIZE &&
+          info->val_len >= (int)sizeof(SerializedTimelineItemHeader));
+}
+
+static uint32_t prv_parent_id_hash(const Uuid *parent_id) {
+  uint32_t words[UUID_SIZE / sizeof(uint32_t)];
+  memcpy(words, parent_id, sizeof(words));
+  // Truncated to the width of TimelineItemStorageIndexEntry.parent_id_hash
+  return (words[0] ^ words[1] ^ words[2] ^ words[3]) & 0x7fffffff;
+}
+
+static time_t prv_index_entry_get_timestamp(const TimelineItemStorageIndexEntry *entry) {
+  return entry->is_local_time ? time_local_to_utc(entry->timestamp) : entry->timestamp;
+}
+
+static void prv_index_reset(TimelineItemStorage *storage) {
+  kernel_free(storage->index);
+  storage->index = NULL;
+  storage->index_count = 0;
+  storage->index_capacity = 0;
+  storage->index_valid = false;
+}
+
+static int prv_index_find(TimelineItemStorage *storage, const TimelineItemId *id) {
+  for (int i = 0; i < storage->index_count; i++) {
+    if (uuid_equal(&storage->index[i].id, id)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void prv_index_remove_at(TimelineItemStorage *storage, int i) {
+  storage->index_count--;
+  memmove(&storage->index[i], &storage->index[i + 1],
+          (storage->index_count - i) * sizeof(TimelineItemStorageIndexEntry));
+}
+
+static void prv_index_remove(TimelineItemStorage *storage, const TimelineItemId *id) {
+  if (!storage->index_valid) {
+    return;
+  }
+  const int i = prv_index_find(storage, id);
+  if (i >= 0) {
+    prv_index_remove_at(storage, i);
+  }
+}
+
+// Inserts the item after all entries with the same or an earlier timestamp, so that ties keep the
+// order in which the items were written. Returns false if the index couldn't grow.
+static bool prv_index_insert(TimelineItemStorage *storage, const TimelineItemId *id,
+                             const CommonTimelineItemHeader *hdr) {
+  if (storage->index_count == storage->index_capacity) {
+    if (storage->index_capacity == INDEX_MAX_CAPACITY) {
+      storage->index_too_large = true;
+      storage->num_items = storage->index_count + 1;
+      return false;
+    }
+    const uint16_t capacity =
+        MIN(INDEX_MAX_CAPACITY, MAX(INDEX_MIN_CAPACITY, storage->index_capacity * 2));
+    TimelineItemStorageIndexEntry *index =
+        kernel_realloc(storage->index, capacity * sizeof(TimelineItemStorageIndexEntry));
+    if (!index) {
+      return false;
+    }
+    storage->index = index;
+    storage->index_capacity = capacity;
+  }
+
+  int low = 0;
+  int high = storage->index_count;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (storage->index[mid].timestamp <= hdr->timestamp) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  memmove(&storage->index[low + 1], &storage->index[low],
+          (storage->index_count - low) * sizeof(TimelineItemStorageIndexEntry));
+  storage->index[low] = (TimelineItemStorageIndexEntry) {
+    .id = *id,
+    .timestamp = hdr->timestamp,
+    .parent_id_hash = prv_parent_id_hash(&hdr->parent_id),
+    .is_local_time = (hdr->all_day || hdr->is_floating),
+  };
+  storage->index_count++;
+  return true;
+}
+
+static void prv_index_update(TimelineItemStorage *storage, const TimelineItemId *id,
+                             const CommonTimelineItemHeader *hdr) {
+  if (!storage->index_valid) {
+    return;
+  }
+  // An overwritten record moves to the end of the settings file, so move it after its ties too
+  prv_index_remove(storage, id);
+  if (!prv_index_insert(storage, id, hdr)) {
+    if (!storage->index_too_large) {
+      PBL_LOG(LOG_LEVEL_WARNING, "Out of memory for timeline index of %s", storage->name);
+    }
+    prv_index_reset(storage);
+  }
+}
+
+static bool prv_each_build_index(SettingsFile *file, SettingsRecordInfo *info, void *context) {
+  if (!prv_is_valid_record(info)) {
+    return true;
+  }
+
+  SerializedTimelineItemHeader hdr;
+  info->get_val(file, &hdr, sizeof(SerializedTimelineItemHeader));
+  // Restore flags & status
+  hdr.common.flags = ~hdr.common.flags;
+  hdr.common.status = ~hdr.common.status;
+  TimelineItemId id;
+  info->get_key(file, (uint8_t *)&id, sizeof(TimelineItemId));
+
+  TimelineItemStorage *storage = context;
+  if (storage->index_too_large) {
+    // Only count the rest of the items, so that it's known when they fit again
+    storage->num_items++;
+    return true;
+  }
+  storage->index_valid = prv_index_insert(storage, &id, &hdr.common);
+  return (storage->index_valid || storage->index_too_large);
+}
+
+// Called for every item deleted from the file. Once the items fit in the index again, it's
+// rebuilt on the next query.
+static void prv_index_item_deleted(TimelineItemStorage *storage, const TimelineItemId *id) {
+  prv_index_remove(storage, id);
+  if (storage->index_too_large && (storage->num_items > 0)) {
+    storage->num_items--;
+    storage->index_too_large = (storage->num_items >= INDEX_MAX_CAPACITY);
+  }
+}
+
+//! Builds the index if needed. Returns false if it's not available and the settings file has to
+//! be scanned instead.
+static bool prv_index_ensure(TimelineItemStorage *storage) {
+  if (storage->index_valid) {
+    return true;
+  }
+  if (storage->index_too_large) {
+    return false;
+  }
+  prv_index_reset(storage);
+  storage->index_valid = true;
+  const status_t rv = settings_file_each(&storage->file, prv_each_build_index, storage);
+  if (FAILED(rv) || !storage->index_valid) {
+    if (!storage->index_too_large) {
+      PBL_LOG(LOG_LEVEL_WARNING, "Unable to build timeline index of %s", storage->name);
+    }
+    prv_index_reset(storage);
+    return false;
+  }
+  return true;
+}
+
+static bool prv_read_header(TimelineItemStorage *storage, const TimelineItemId *id,
+                            SerializedTimelineItemHeader *hdr) {
+  if (settings_file_get(&storage->file, id, sizeof(TimelineItemId), hdr,
+                        sizeof(SerializedTimelineItemHeader)) != S_SUCCESS) {
+    return false;
+  }
+  // Restore flags & status
+  hdr->common.flags = ~hdr->common.flags;
+  hdr->common.status = ~hdr->common.status;
+  return true;
+}
+
+// Confirms that the item of an entry whose parent hash matches really has the given parent
+static bool prv_index_entry_has_parent(TimelineItemStorage *storage,
+                                       const TimelineItemStorageIndexEntry *entry,
+                                       const Uuid *parent_id, uint32_t parent_id_hash) {
+  if (entry->parent_id_hash != parent_id_hash) {
+    return false;
+  }
+  SerializedTimelineItemHeader hdr;
+  return (prv_read_header(storage, &entry->id, &hdr) &&
+          uuid_equal(&hdr.common.parent_id, parent_id));
+}
+
+// Returns the position of the first entry at or after pos with the given kind of timestamp
+static int prv_index_next_of_kind(TimelineItemStorage *storage, int pos, bool is_local_time) {
+  while (pos < storage->index_count && storage->index[pos].is_local_time != is_local_time) {
+    pos++;
+  }
+  return pos;
+}
+
+// Walks the index in timestamp order. The entries are sorted by the stored timestamp, so local time
+// entries and UTC entries are each in order and only need to be merged once the timezone
+// adjustment is applied.
+static status_t prv_index_next_item(TimelineItemStorage *storage, Uuid *id_out,
+                                    TimelineItemStorageFilterCallback filter_cb) {
+  const time_t oldest = rtc_get_time() - storage->max_item_age;
+  int pos[2] = {
+    prv_index_next_of_kind(storage, 0, false),
+    prv_index_next_of_kind(storage, 0, true),
+  };
+  while (pos[false] < storage->index_count || pos[true] < storage->index_count) {
+    bool kind;
+    if (pos[true] >= storage->index_count) {
+      kind = false;
+    } else if (pos[false] >= storage->index_count) {
+      kind = true;
+    } else {
+      const time_t utc_timestamp = prv_index_entry_get_timestamp(&storage->index[pos[false]]);
+      const time_t local_timestamp = prv_index_entry_get_timestamp(&storage->index[pos[true]]);
+      kind = (local_timestamp < utc_timestamp ||
+              (local_timestamp == utc_timestamp && pos[true] < pos[false]));
+    }
+    const TimelineItemStorageIndexEntry *entry = &storage->index[pos[kind]];
+    pos[kind] = prv_index_next_of_kind(storage, pos[kind] + 1, kind);
+
+    if (prv_index_entry_get_timestamp(entry) < oldest) {
+      continue;
+    }
+    if (filter_cb) {
+      SerializedTimelineItemHeader hdr;
+      if (!prv_read_header(storage, &entry->id, &hdr) || !filter_cb(&hdr, NULL)) {
+        continue;
+      }
+    }
+    *id_out = entry->id;
+    return S_SUCCESS;
+  }
+  return S_NO_MORE_ITEMS;
+}
+
 ///////////////////////////////////
 // Public API
 ///////////////////////////////////
@@ -131,6 +379,11 @@ bool timeline_item_storage_is_empty(TimelineItemStorage *storage) {
 
   mutex_lock(storage->mutex);
 
+  if (storage->index_valid) {
+    rv = (storage->index_count == 0);
+    goto cleanup;
+  }
+
   AnyInfo any_info = { .empty = true };
   status_t status = settings_file_each(&storage->file, prv_each_any_item, &any_info);
   if (status) {
@@ -144,9 +397,29 @@ cleanup:
   return rv;
 }
 
+bool timeline_item_storage_is_dirty(TimelineItemStorage *storage) {
+  mutex_lock(storage->mutex);
+  const bool rv = (settings_file_get_num_dirty(&storage->file) > 0);
+  mutex_unlock(storage->mutex);
+  return rv;
+}
+
 status_t timeline_item_storage_next_item(TimelineItemStorage *storage, Uuid *id_out,
     TimelineItemStorageFilterCallback filter_cb) {
   mutex_lock(storage->mutex);
+  status_t rv;
+  if (prv_index_ensure(storage)) {
+    rv = prv_index_next_item(storage, id_out, filter_cb);
+    mutex_unlock(storage->mutex);
+    return rv;
+  }
+  mutex_unlock(storage->mutex);
+  return timeline_item_storage_next_item_scan_all(storage, id_out, filter_cb);
+}
+
+status_t timeline_item_storage_next_item_scan_all(TimelineItemStorage *storage, Uuid *id_out,
+    TimelineItemStorageFilterCallback filter_cb) {
+  mutex_lock(storage->mutex);
 
   NextInfo next_info = {0};
   next_info.current = rtc_get_time();
@@ -175,12 +448,25 @@ cleanup:
 bool timeline_item_storage_exists_with_parent(TimelineItemStorage *storage, const Uuid *parent_id) {
   mutex_lock(storage->mutex);
 
+  status_t rv;
+  if (prv_index_ensure(storage)) {
+    rv = S_NO_MORE_ITEMS;
+    const uint32_t parent_id_hash = prv_parent_id_hash(parent_id);
+    for (int i = 0; i < storage->index_count; i++) {
+      if (prv_index_entry_has_parent(storage, &storage->index[i], parent_id, parent_id_hash)) {
+        rv = S_SUCCESS;
+        break;
+      }
+    }
+    goto cleanup;
+  }
+
   FindChildrenInfo info = {
     .parent_id = *parent_id,
     .num_children = 0,
     .find_all = false,
   };
-  status_t rv = settings_file_each(&storage->file, prv_each_find_children, &info);
+  rv = settings_file_each(&storage->file, prv_each_find_children, &info);
   if (rv) {
     goto cleanup;
   }
@@ -202,28 +488,55 @@ status_t timeline_item_storage_delete_with_parent(
     TimelineItemStorageChildDeleteCallback child_delete_cb) {
   mutex_lock(storage->mutex);
 
-  FindChildrenInfo info = {
-    .parent_id = *parent_id,
-    .num_children = 0,
-    .find_all = true,
-  };
-  status_t rv = settings_file_each(&storage->file, prv_each_find_children, &info);
-  if (rv) {
+  status_t rv = S_SUCCESS;
+  if (prv_index_ensure(storage)) {
+    const uint32_t parent_id_hash = prv_parent_id_hash(parent_id);
+    // Walk backwards so that removing an entry doesn't move the ones still to be visited
+    for (int i = storage->index_count - 1; i >= 0; i--) {
+      if (!prv_index_entry_has_parent(storage, &storage->index[i], parent_id, parent_id_hash)) {
+        continue;
+      }
+      const TimelineItemId id = storage->index[i].id;
+      rv = settings_file_delete(&storage->file, &id, sizeof(Uuid));
+      if (rv != S_SUCCESS) {
+        goto cleanup;
+      }
+      prv_index_remove_at(storage, i);
+      if (child_delete_cb) {
+        child_delete_cb(&id);
+      }
+    }
     goto cleanup;
   }
 
-  for (int i = 0; i < info.num_children; ++i) {
-    const void *key = &info.children_ids[i];
-    rv = settings_file_delete(&storage->file, key, sizeof(Uuid));
-
-    if (rv != S_SUCCESS) {
+  // Without the index, find the children a batch at a time until a scan comes up short, so that
+  // every child is deleted like on the indexed path
+  FindChildrenInfo info;
+  do {
+    info = (FindChildrenInfo) {
+      .parent_id = *parent_id,
+      .num_children = 0,
+      .find_all = true,
+    };
+    rv = settings_file_each(&storage->file, prv_each_find_children, &info);
+    if (rv) {
       goto cleanup;
     }
 
-    if (child_delete_cb) {
-      child_delete_cb((Uuid *)key);
+    for (int i = 0; i < info.num_children; ++i) {
+      const void *key = &info.children_ids[i];
+      rv = settings_file_delete(&storage->file, key, sizeof(Uuid));
+
+      if (rv != S_SUCCESS) {
+        goto cleanup;
+      }
+      prv_index_item_deleted(storage, key);
+
+      if (child_delete_cb) {
+        child_delete_cb((Uuid *)key);
+      }
     }
-  }
+  } while (info.num_children == MAX_CHILDREN_PER_PIN);
 
 cleanup:
   mutex_unlock(storage->mutex);
@@ -255,6 +568,7 @@ void timeline_item_storage_init(TimelineItemStorage *storage,
 }
 
 void timeline_item_storage_deinit(TimelineItemStorage *storage) {
+  prv_index_reset(storage);
   settings_file_close(&storage->file);
 }
 
@@ -289,12 +603,22 @@ status_t timeline_item_storage_insert(TimelineItemStorage *storage,
   hdr->common.status = ~hdr->common.status;
 
   mutex_lock(storage->mutex);
+  // Without the index the items are only counted, which needs to know whether this one is new
+  const bool is_new_unindexed_item =
+      (storage->index_too_large && !settings_file_exists(&storage->file, key, key_len));
   status_t rv = settings_file_set(&storage->file, key, key_len, val, val_len);
 
   // Restore flags & status
   hdr->common.flags = ~hdr->common.flags;
   hdr->common.status = ~hdr->common.status;
 
+  if (rv == S_SUCCESS) {
+    if (is_new_unindexed_item) {
+      storage->num_items++;
+    }
+    prv_index_update(storage, (const TimelineItemId *)key, &hdr->common);
+  }
+
   if (mark_as_synced) {
     settings_file_mark_synced(&storage->file, key, key_len);
   }
@@ -375,6 +699,9 @@ status_t timeline_item_storage_delete(TimelineItemStorage *storage,
   mutex_lock(storage->mutex);
 
   status_t rv = settings_file_delete(&storage->file, key, key_len);
+  if (rv == S_SUCCESS) {
+    prv_index_item_deleted(storage, (const TimelineItemId *)key);
+  }
 
   mutex_unlock(storage->mutex);
   return rv;
@@ -430,6 +757,9 @@ static void prv_flush_rewrite_cb(SettingsFile *old,
 status_t timeline_item_storage_flush(TimelineItemStorage *storage) {
   mutex_lock(storage->mutex);
   status_t rv = settings_file_rewrite(&storage->file, prv_flush_rewrite_cb, NULL);
+  // Rebuilt from the rewritten file on next use
+  prv_index_reset(storage);
+  storage->index_too_large = false;
   mutex_unlock(storage->mutex);
   return rv;
 }
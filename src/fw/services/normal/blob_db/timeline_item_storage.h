@@ -22,12 +22,36 @@
 #include "os/mutex.h"
 #include "services/normal/timeline/item.h"
 
+//! An entry of the in-RAM index of a TimelineItemStorage. Only what is needed to order the items
+//! is kept. The parent is only a hash of its UUID, so a match is confirmed by reading the header
+//! from flash.
+typedef struct {
+  TimelineItemId id;
+  //! Timestamp as stored, before any timezone adjustment
+  time_t timestamp;
+  uint32_t parent_id_hash:31;
+  //! Whether the timestamp is in local time (all day or floating items)
+  bool is_local_time:1;
+} TimelineItemStorageIndexEntry;
+
 typedef struct {
   SettingsFile file;
   PebbleMutex *mutex;
   char *name;
   size_t max_size;
   uint32_t max_item_age; // seconds
+  //! Valid items ordered by timestamp, built on first use and kept current on every change.
+  //! If it can't be allocated or the storage holds more items than it may index, the queries
+  //! fall back to scanning the settings file.
+  TimelineItemStorageIndexEntry *index;
+  uint16_t index_count;
+  uint16_t index_capacity;
+  bool index_valid;
+  //! Set when the items didn't fit in the index, so that it isn't rebuilt on every query. Cleared
+  //! once enough items have been removed for them to fit again.
+  bool index_too_large;
+  //! The number of items in the file, only kept while index_too_large is set
+  uint16_t num_items;
 } TimelineItemStorage;
 
 typedef bool (*TimelineItemStorageFilterCallback)(SerializedTimelineItemHeader *hdr,
@@ -83,7 +107,17 @@ status_t timeline_item_storage_delete_with_parent(
 
 //! filter_cb is a type that returns TRUE if the item should be used, or FALSE if the item should
 //! be ignored.
+//! Items are offered to filter_cb earliest first, skipping items older than the max age, and the
+//! first item accepted is returned. filter_cb must not rely on seeing every item.
 status_t timeline_item_storage_next_item(TimelineItemStorage *storage, Uuid *id_out,
     TimelineItemStorageFilterCallback filter_cb);
 
+//! Same as timeline_item_storage_next_item, but every item in the storage is offered to filter_cb,
+//! for filters that accumulate state across all items. This has to scan the whole settings file.
+status_t timeline_item_storage_next_item_scan_all(TimelineItemStorage *storage, Uuid *id_out,
+    TimelineItemStorageFilterCallback filter_cb);
+
 bool timeline_item_storage_is_empty(TimelineItemStorage *storage);
+
+//! @return true if any item has not been marked as synced
+bool timeline_item_storage_is_dirty(TimelineItemStorage *storage);
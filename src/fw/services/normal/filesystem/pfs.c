@@ -1055,6 +1055,18 @@ size_t pfs_get_file_size(int fd) {
   return (res);
 }
 
+int pfs_get_file_start_page(int fd) {
+  mutex_lock_recursive(s_pfs_mutex);
+
+  int res = E_INVALID_ARGUMENT;
+  if (FD_VALID(fd)) {
+    res = PFS_FD(fd).file.start_page;
+  }
+
+  mutex_unlock_recursive(s_pfs_mutex);
+  return (res);
+}
+
 int pfs_read(int fd, void *buf_ptr, size_t size) {
   uint8_t *buf = buf_ptr;
   mutex_lock_recursive(s_pfs_mutex);
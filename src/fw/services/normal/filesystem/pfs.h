@@ -154,6 +154,12 @@ extern status_t pfs_remove(const char *name);
 //! Returns the size of the file. (The amount of bytes that can be read out)
 extern size_t pfs_get_file_size(int fd);
 
+//! Returns the physical page at which the file begins. No two files which exist at the same time
+//! begin at the same page, so this tells apart a file from one which replaced it under the same
+//! name.
+//! @return the page, or E_INVALID_ARGUMENT if the fd is not valid
+extern int pfs_get_file_start_page(int fd);
+
 //! Should only be called before using FS
 extern status_t pfs_init(bool run_filesystem_check);
 
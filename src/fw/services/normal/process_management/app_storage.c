@@ -25,6 +25,7 @@
 #include "flash_region/flash_region.h"
 #include "process_management/pebble_process_info.h"
 #include "resource/resource_storage.h"
+#include "services/normal/bitmap_cache.h"
 #include "services/normal/filesystem/pfs.h"
 #include "services/normal/filesystem/app_file.h"
 #include "system/logging.h"
@@ -107,6 +108,8 @@ void app_storage_delete_app(AppInstallId id) {
   pfs_remove(process_name);
   // remove resources
   resource_storage_clear(id);
+  // remove bitmaps decoded from those resources
+  bitmap_cache_delete_app(id);
 }
 
 bool app_storage_app_exists(AppInstallId id) {
@@ -25,6 +25,7 @@
 #include "services/normal/app_cache.h"
 #include "services/normal/app_fetch_endpoint.h"
 #include "services/normal/app_glances/app_glance_service.h"
+#include "services/normal/bitmap_cache.h"
 #include "services/normal/blob_db/api.h"
 #include "services/normal/blob_db/endpoint_private.h"
 #include "services/normal/data_logging/data_logging_service.h"
@@ -38,6 +39,7 @@
 #include "services/normal/phone_call.h"
 #include "services/normal/process_management/app_order_storage.h"
 #include "services/normal/send_text_service.h"
+#include "services/normal/settings/settings_file.h"
 #include "services/normal/stationary.h"
 #include "services/normal/timeline/event.h"
 #include "services/normal/wakeup.h"
@@ -53,6 +55,7 @@
 
 void services_normal_early_init(void) {
   pfs_init(true);
+  settings_file_init();
 }
 
 void services_normal_init(void) {
@@ -62,6 +65,7 @@ void services_normal_init(void) {
 
   blob_db_init_dbs();
   app_cache_init();
+  bitmap_cache_init();
   phone_call_service_init();
   music_init();
   alarm_init();
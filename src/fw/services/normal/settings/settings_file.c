@@ -19,16 +19,149 @@
 
 #include "drivers/rtc.h"
 #include "kernel/pbl_malloc.h"
+#include "os/mutex.h"
 #include "services/normal/filesystem/pfs.h"
 #include "system/logging.h"
 #include "system/passert.h"
 #include "util/crc8.h"
+#include "util/math.h"
 
 #include <string.h>
 #include <time.h>
 
 static status_t bootup_check(SettingsFile *file);
 static void compute_stats(SettingsFile *file);
+static bool prv_stats_valid_now(uint32_t valid_from, uint32_t valid_until);
+
+// Open state cache
+////////////////////////////////////////////////////////////////////////////////
+// Most users open and close their settings file around every single operation. Partial
+// transactions can only be left behind by a reboot, so a file only needs the bootup check the
+// first time it is opened after boot. Its stats are kept up to date by every write, so they are
+// remembered when the file is closed instead of being recomputed from all of its records on the
+// next open. They are only reused while the time is within the range in which the deleted records
+// would be counted the same way again, see SettingsFile.stats_valid_from.
+//
+// An entry is only valid for the exact file it was saved for, so it is keyed on the file's name
+// and the page at which pfs placed it. A file which replaced it under the same name (e.g. by
+// being overwritten) starts at a different page, and one which was newly created never uses it.
+// Entries are taken out of the cache while their file is open, and are dropped when a file is
+// rewritten.
+
+//! Number of recently closed files whose open state is remembered
+#define OPEN_STATE_CACHE_SIZE 8
+
+typedef struct {
+  //! Name of the file, owned by the cache. NULL if the entry is unused.
+  char *name;
+  //! The pfs page at which the file begins
+  int start_page;
+  int dead_space;
+  int used_space;
+  uint32_t last_modified;
+  int dirty_count;
+  uint32_t stats_valid_from;
+  uint32_t stats_valid_until;
+} SettingsFileOpenState;
+
+//! Sorted by most recently closed first
+static SettingsFileOpenState s_open_state_cache[OPEN_STATE_CACHE_SIZE];
+static PebbleMutex *s_open_state_mutex;
+
+static int prv_open_state_find(const char *name) {
+  for (int i = 0; i < OPEN_STATE_CACHE_SIZE && s_open_state_cache[i].name; i++) {
+    if (strcmp(s_open_state_cache[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+//! Removes the entry at the given index, moving the entries after it up by one.
+//! @return The name of the removed entry, which the caller has to free
+static char *prv_open_state_remove(int index) {
+  char *name = s_open_state_cache[index].name;
+  memmove(&s_open_state_cache[index], &s_open_state_cache[index + 1],
+          (OPEN_STATE_CACHE_SIZE - index - 1) * sizeof(SettingsFileOpenState));
+  s_open_state_cache[OPEN_STATE_CACHE_SIZE - 1] = (SettingsFileOpenState) {};
+  return name;
+}
+
+//! Takes the remembered state of a file which is being opened out of the cache, and fills in its
+//! stats if the state was saved for this very file.
+//! @param is_new_file Whether the file was just created, in which case the state is from a file
+//! with the same name which has since been removed, possibly from the same page.
+//! @return true if the stats were restored, false if the file has to be checked and scanned
+static bool prv_open_state_take(SettingsFile *file, bool is_new_file) {
+  const int start_page = pfs_get_file_start_page(file->iter.fd);
+  char *cached_name = NULL;
+  bool restored = false;
+  mutex_lock(s_open_state_mutex);
+  const int index = prv_open_state_find(file->name);
+  if (index >= 0) {
+    const SettingsFileOpenState *state = &s_open_state_cache[index];
+    if (!is_new_file && (start_page >= 0) && (state->start_page == start_page) &&
+        prv_stats_valid_now(state->stats_valid_from, state->stats_valid_until)) {
+      file->dead_space = state->dead_space;
+      file->used_space = state->used_space;
+      file->last_modified = state->last_modified;
+      file->dirty_count = state->dirty_count;
+      file->stats_valid_from = state->stats_valid_from;
+      file->stats_valid_until = state->stats_valid_until;
+      restored = true;
+    }
+    cached_name = prv_open_state_remove(index);
+  }
+  mutex_unlock(s_open_state_mutex);
+  kernel_free(cached_name);
+  return restored;
+}
+
+//! Remembers the stats of a file which is being closed. Takes ownership of the file's name.
+static void prv_open_state_save(SettingsFile *file) {
+  const int start_page = pfs_get_file_start_page(file->iter.fd);
+  if ((start_page < 0) || !prv_stats_valid_now(file->stats_valid_from, file->stats_valid_until)) {
+    kernel_free(file->name);
+    return;
+  }
+  char *evicted_name = NULL;
+  mutex_lock(s_open_state_mutex);
+  int index = prv_open_state_find(file->name);
+  if (index < 0) {
+    index = OPEN_STATE_CACHE_SIZE - 1;
+  }
+  evicted_name = prv_open_state_remove(index);
+  memmove(&s_open_state_cache[1], &s_open_state_cache[0],
+          (OPEN_STATE_CACHE_SIZE - 1) * sizeof(SettingsFileOpenState));
+  s_open_state_cache[0] = (SettingsFileOpenState) {
+    .name = file->name,
+    .start_page = start_page,
+    .dead_space = file->dead_space,
+    .used_space = file->used_space,
+    .last_modified = file->last_modified,
+    .dirty_count = file->dirty_count,
+    .stats_valid_from = file->stats_valid_from,
+    .stats_valid_until = file->stats_valid_until,
+  };
+  mutex_unlock(s_open_state_mutex);
+  kernel_free(evicted_name);
+}
+
+void settings_file_init(void) {
+  if (s_open_state_mutex == NULL) {
+    s_open_state_mutex = mutex_create();
+  }
+}
+
+// This is used by unit tests to clear out static state and simulate a reboot.
+void settings_file_reset_all_state(void) {
+  for (int i = 0; i < OPEN_STATE_CACHE_SIZE; i++) {
+    kernel_free(s_open_state_cache[i].name);
+    s_open_state_cache[i] = (SettingsFileOpenState) {};
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
 static bool file_hdr_is_uninitialized(SettingsFileHeader *file_hdr) {
   return (file_hdr->magic == 0xffffffff) && (file_hdr->version == 0xffff)
@@ -66,7 +199,8 @@ static status_t prv_open(SettingsFile *file, const char *name, uint8_t flags, in
   settings_raw_iter_init(&file->iter, fd, file->name);
 
   SettingsFileHeader file_hdr = file->iter.file_hdr;
-  if (file_hdr_is_uninitialized(&file_hdr)) {
+  const bool is_new_file = file_hdr_is_uninitialized(&file_hdr);
+  if (is_new_file) {
     // Newly created file, create & write out header.
     memcpy(&file_hdr.magic, SETTINGS_FILE_MAGIC, sizeof(file_hdr.magic));
     file_hdr.version = SETTINGS_FILE_VERSION;
@@ -87,7 +221,9 @@ static status_t prv_open(SettingsFile *file, const char *name, uint8_t flags, in
     return prv_open(file, name, flags, max_used_space);
   }
 
-  status_t status = bootup_check(file);
+  const bool stats_restored = prv_open_state_take(file, is_new_file);
+
+  status_t status = stats_restored ? S_SUCCESS : bootup_check(file);
   if (status < 0) {
     PBL_LOG(LOG_LEVEL_ERROR,
             "Bootup check failed (%"PRId32"), not good. "
@@ -114,7 +250,12 @@ static status_t prv_open(SettingsFile *file, const char *name, uint8_t flags, in
     }
   }
 
-  compute_stats(file);
+  if (stats_restored) {
+    // Lookups resume from the current record, which compute_stats() would have left at the end
+    settings_raw_iter_begin(&file->iter);
+  } else {
+    compute_stats(file);
+  }
 
   return S_SUCCESS;
 }
@@ -124,10 +265,19 @@ status_t settings_file_open(SettingsFile *file, const char *name,
   return prv_open(file, name, OP_FLAG_READ | OP_FLAG_WRITE, max_used_space);
 }
 
-void settings_file_close(SettingsFile *file) {
-  settings_raw_iter_deinit(&file->iter);
-  kernel_free(file->name);
+static void prv_close(SettingsFile *file, bool save_state) {
+  // The state is saved while the file is still open, so that pfs can tell which file it is
+  if (save_state) {
+    prv_open_state_save(file);
+  } else {
+    kernel_free(file->name);
+  }
   file->name = NULL;
+  settings_raw_iter_deinit(&file->iter);
+}
+
+void settings_file_close(SettingsFile *file) {
+  prv_close(file, true /* save_state */);
 }
 
 static int record_size(SettingsRecordHeader *hdr) {
@@ -181,18 +331,51 @@ static bool deleted_and_expired(SettingsRecordHeader *hdr) {
       && (hdr->last_modified <= (utc_time() - DELETED_LIFETIME));
 }
 
+// Whether the record holds a value which hasn't been synced yet. Deleted records are left out
+// whether or not they have expired: there is nothing to sync for them, and leaving them out keeps
+// the count from depending on the time.
+static bool counts_as_dirty(SettingsRecordHeader *hdr) {
+  return !overwritten(hdr) && (hdr->val_len != 0) && !flag_is_set(hdr, SETTINGS_FLAG_SYNCED);
+}
+
+static bool prv_stats_valid_now(uint32_t valid_from, uint32_t valid_until) {
+  const uint32_t now = utc_time();
+  return (valid_from <= now) && (now < valid_until);
+}
+
+//! Adds a record to the used or dead space, and narrows down the times at which it would be
+//! counted the same way again
+static void prv_count_record_space(SettingsFile *file, SettingsRecordHeader *hdr) {
+  if (overwritten(hdr)) {
+    file->dead_space += record_size(hdr);
+    return;
+  }
+  if (hdr->val_len == 0) {
+    const uint32_t expires_at = hdr->last_modified + DELETED_LIFETIME;
+    if (deleted_and_expired(hdr)) {
+      file->stats_valid_from = MAX(file->stats_valid_from, expires_at);
+      file->dead_space += record_size(hdr);
+      return;
+    }
+    file->stats_valid_until = MIN(file->stats_valid_until, expires_at);
+  }
+  file->used_space += record_size(hdr);
+}
+
 static void compute_stats(SettingsFile *file) {
   file->dead_space = 0;
   file->used_space = 0;
   file->last_modified = 0;
+  file->dirty_count = 0;
+  file->stats_valid_from = 0;
+  file->stats_valid_until = UINT32_MAX;
   file->used_space += sizeof(SettingsFileHeader);
   file->used_space += sizeof(SettingsRecordHeader); // EOF Marker
   for (settings_raw_iter_begin(&file->iter); !settings_raw_iter_end(&file->iter);
        settings_raw_iter_next(&file->iter)) {
-    if (overwritten(&file->iter.hdr) || deleted_and_expired(&file->iter.hdr)) {
-      file->dead_space += record_size(&file->iter.hdr);
-    } else {
-      file->used_space += record_size(&file->iter.hdr);
+    prv_count_record_space(file, &file->iter.hdr);
+    if (counts_as_dirty(&file->iter.hdr)) {
+      file->dirty_count++;
     }
     if (file->iter.hdr.last_modified > file->last_modified) {
       file->last_modified = file->iter.hdr.last_modified;
@@ -253,7 +436,11 @@ status_t settings_file_rewrite_filtered(
     kernel_free(key);
     kernel_free(val);
   }
-  settings_file_close(file);
+  // The records were copied without going through settings_file_set(), count them before the
+  // stats get saved on close
+  compute_stats(&new_file);
+  // The old file is replaced by the new one, so there's nothing to remember about it
+  prv_close(file, false /* save_state */);
   // We have to close and reopen the new_file so that it's temp flag is cleared.
   // Before the close succeeds, if we reboot, we will just end up reading the
   // old file. After the close suceeds, we will end up reading the new
@@ -429,6 +616,12 @@ status_t settings_file_set(SettingsFile *file, const void *key, size_t key_len,
   if (val_len > SETTINGS_VAL_MAX_LEN) {
     return E_RANGE;
   }
+  if (!prv_stats_valid_now(file->stats_valid_from, file->stats_valid_until)) {
+    // A deleted record expired, or the clock was set back past the expiry of one, since the
+    // stats were counted
+    compute_stats(file);
+  }
+
   const bool is_delete = (val_len == 0);
   const int rec_size = sizeof(SettingsRecordHeader) + key_len + val_len;
   if (!is_delete && file->used_space + rec_size > file->max_used_space) {
@@ -442,9 +635,13 @@ status_t settings_file_set(SettingsFile *file, const void *key, size_t key_len,
   }
 
   int overwritten_record = -1;
+  bool overwritten_record_was_dirty = false;
+  bool overwritten_record_was_dead = false;
   // Find an existing record, if any, and mark it as overwrite-in-progress.
   settings_raw_iter_resume(&file->iter);
   if (search_forward(&file->iter, key, key_len)) {
+    overwritten_record_was_dirty = counts_as_dirty(&file->iter.hdr);
+    overwritten_record_was_dead = deleted_and_expired(&file->iter.hdr);
     set_flag(&file->iter.hdr, SETTINGS_FLAG_OVERWRITE_STARTED);
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
     overwritten_record = settings_raw_iter_get_current_record_pos(&file->iter);
@@ -472,15 +669,26 @@ status_t settings_file_set(SettingsFile *file, const void *key, size_t key_len,
   // out the header, key, and value.
   set_flag(&new_hdr, SETTINGS_FLAG_WRITE_COMPLETE);
   settings_raw_iter_write_header(&file->iter, &new_hdr);
-  file->used_space += rec_size;
+  // Account for the record the same way compute_stats() would, since the stats outlive the file
+  // being open
+  prv_count_record_space(file, &new_hdr);
+  if (counts_as_dirty(&new_hdr)) {
+    file->dirty_count++;
+  }
+  file->last_modified = MAX(file->last_modified, new_hdr.last_modified);
 
   // Finally, mark the existing record, if any, as overwritten.
   if (overwritten_record >= 0) {
     settings_raw_iter_set_current_record_pos(&file->iter, overwritten_record);
     set_flag(&file->iter.hdr, SETTINGS_FLAG_OVERWRITE_COMPLETE);
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
-    file->dead_space += record_size(&file->iter.hdr);
-    file->used_space -= record_size(&file->iter.hdr);
+    if (!overwritten_record_was_dead) {
+      file->dead_space += record_size(&file->iter.hdr);
+      file->used_space -= record_size(&file->iter.hdr);
+    }
+    if (overwritten_record_was_dirty) {
+      file->dirty_count--;
+    }
   }
 
   return S_SUCCESS;
@@ -496,6 +704,9 @@ status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t k
   // Find an existing record, if any, and mark it as synced
   settings_raw_iter_resume(&file->iter);
   if (search_forward(&file->iter, key, key_len)) {
+    if (counts_as_dirty(&file->iter.hdr)) {
+      file->dirty_count--;
+    }
     set_flag(&file->iter.hdr, SETTINGS_FLAG_SYNCED);
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
     return S_SUCCESS;
@@ -504,6 +715,10 @@ status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t k
   return E_DOES_NOT_EXIST;
 }
 
+int settings_file_get_num_dirty(SettingsFile *file) {
+  return file->dirty_count;
+}
+
 status_t settings_file_delete(SettingsFile *file,
                               const void *key, size_t key_len) {
   return settings_file_set(file, key, key_len, NULL, 0);
@@ -64,6 +64,16 @@ typedef struct SettingsFile {
   //! When this file as a whole was last_modified.
   //! Defined as records.max(&:last_modified)
   uint32_t last_modified;
+  //! Number of live (not deleted) records which have not been marked as synced. Counted when the
+  //! file is opened and kept current as records are written and synced, so
+  //! that sync doesn't have to scan the file to find out if it has work to do.
+  int dirty_count;
+
+  //! Whether a deleted record has expired, and so counts as dead rather than used
+  //! space, depends on the time. The stats agree with counting all records from flash as long as
+  //! stats_valid_from <= utc time < stats_valid_until, and are counted again otherwise.
+  uint32_t stats_valid_from;
+  uint32_t stats_valid_until;
 
   //! The position of the current record in the iteration (if any). Necessary
   //! so that clients can read other records in the middle of iteration (i.e.
@@ -73,6 +83,9 @@ typedef struct SettingsFile {
 } SettingsFile;
 
 
+//! Sets up the cache of the state of recently closed files. Call once pfs has been initialized.
+void settings_file_init(void);
+
 //! max_used_space should be >= 5317 for persist files to make sure we can
 //! always fit all of the records in the worst case (if the programmer stored
 //! nothing but booleans).
@@ -99,6 +112,10 @@ status_t settings_file_set(SettingsFile *file, const void *key, size_t key_len,
 //! @param key_len the length of the key
 status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t key_len);
 
+//! @return the number of live records in the file which have not been marked
+//! as synced, without having to scan the file. Deleted records don't count.
+int settings_file_get_num_dirty(SettingsFile *file);
+
 //! set a byte in a setting. This can only be used a byte at a time to guarantee
 //! atomicity. Do not use to modify several bytes in a row!
 //! Note that only the reset bits will be applied (it writes flash directly)
@@ -181,6 +181,22 @@ static bool prv_deserialize_attribute(char **buffer, char *const buf_end, const
   return true;
 }
 
+bool attribute_is_serialized_attribute_valid(AttributeId id, uint16_t length) {
+  switch (prv_attribute_type(id)) {
+    case AttributeTypeString:
+    case AttributeTypeStringList:
+    case AttributeTypeUint32List:
+      return true;
+    case AttributeTypeUint8:
+      return (length == sizeof(uint8_t));
+    case AttributeTypeUint32:
+    case AttributeTypeResourceId:
+      return (length == sizeof(uint32_t));
+    default:
+      return false;
+  }
+}
+
 static int32_t prv_get_buffer_size_for_serialized_attribute(const uint8_t **cursor,
     const uint8_t *end) {
   SerializedAttributeHeader *attribute = (SerializedAttributeHeader *)*cursor;
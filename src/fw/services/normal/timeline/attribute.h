@@ -314,6 +314,11 @@ bool attribute_check_serialized_list(const uint8_t *cursor, const uint8_t *val_e
 int32_t attribute_get_buffer_size_for_serialized_attributes(uint8_t num_attributes,
     const uint8_t **cursor, const uint8_t *end);
 
+//! true, if a serialized attribute with this ID and length would be deserialized, that is if the
+//! attribute has a known type and fixed size types have the right length. For reading serialized
+//! attributes in place.
+bool attribute_is_serialized_attribute_valid(AttributeId id, uint16_t length);
+
 //! true, if successfully transforms a serialized attribute into in-memory representation
 bool attribute_deserialize_list(char **buffer, char *const buf_end,
     const uint8_t **cursor, const uint8_t *payload_end, AttributeList attr_list);
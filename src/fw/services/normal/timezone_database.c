@@ -22,6 +22,7 @@
 #include "system/passert.h"
 
 #include <util/attributes.h>
+#include <util/math.h>
 #include <util/size.h>
 
 #include <string.h>
@@ -31,7 +32,7 @@
 //   2 bytes  - Region count
 //   2 bytes  - DST Rule count
 //   2 bytes  - Link count
-// Regions
+// Regions, sorted by full region name ("Continent/City")
 //   For each region (24 bytes):
 //     1 byte   - Continent index, @see CONTINENT_NAMES
 //     15 bytes - City name
@@ -42,19 +43,20 @@
 //   For each DST ID (16 bytes)
 //     For each rule in the pair, first the start rule followed by the end rule (8 bytes)
 //       @see TimezoneDSTRule for the structure
-// Links
+// Links, sorted by link name
 //   For each link (35 bytes)
 //     2 bytes  - The region id this link maps to
 //     33 bytes - The name of the link that should be treated as an alias to the linked region
 
 typedef struct PACKED {
   uint16_t region_count;
-  uint16_t dst_rule_count;
+  uint16_t dst_rule_count; //!< Includes rule 0 which isn't actually stored in the database
   uint16_t link_count;
 } TimezoneDatabaseFlashHeader;
 #define TZDATA_HEADER_BYTES (sizeof(TimezoneDatabaseFlashHeader))
 
 #define TIMEZONE_CITY_LENGTH 15 // maximum length of the city name in timezone database
+#define REGION_NAME_BYTES (1 + TIMEZONE_CITY_LENGTH)
 #define REGION_BYTES (1 + TIMEZONE_CITY_LENGTH + 2 + 5 + 1)
 
 #define DST_RULE_BYTES (sizeof(TimezoneDSTRule))
@@ -85,21 +87,6 @@ static bool prv_database_read(uint32_t offset, void *data, size_t num_bytes) {
                                          offset, data, num_bytes) == num_bytes;
 }
 
-//! Note! This count includes rule 0 which isn't actually stored in the database.
-static int prv_get_dst_rule_count(void) {
-  uint16_t dst_rule_count;
-  prv_database_read(offsetof(TimezoneDatabaseFlashHeader, dst_rule_count),
-                    &dst_rule_count, sizeof(dst_rule_count));
-  return dst_rule_count;
-}
-
-static int prv_get_link_count(void) {
-  uint16_t link_count;
-  prv_database_read(offsetof(TimezoneDatabaseFlashHeader, link_count),
-                    &link_count, sizeof(link_count));
-  return link_count;
-}
-
 int timezone_database_get_region_count(void) {
   uint16_t region_count;
   prv_database_read(offsetof(TimezoneDatabaseFlashHeader, region_count),
@@ -140,41 +127,42 @@ bool timezone_database_load_region_info(uint16_t region_id, TimezoneInfo *tz_inf
   return true;
 }
 
-bool timezone_database_load_region_name(uint16_t region_id, char *region_name) {
-  if (region_id > timezone_database_get_region_count()) {
-    return false;
-  }
-
+//! Reads the continent index and city name of a region in a single read and formats them as
+//! "Continent/City" into region_name, which must be at least TIMEZONE_NAME_LENGTH long.
+static void prv_read_region_name(uint16_t region_id, char *region_name) {
   const int region_offset =
       // Skip over the region count
       TZDATA_HEADER_BYTES +
       // Skip over the regions list
       (region_id * REGION_BYTES);
 
-  // Read the continent index, which is the first byte
-  uint8_t continent_index = 0;
-  prv_database_read(region_offset, &continent_index, sizeof(continent_index));
-  PBL_ASSERTN(continent_index < ARRAY_LENGTH(CONTINENT_NAMES));
+  struct PACKED {
+    uint8_t continent_index;
+    char city_name[TIMEZONE_CITY_LENGTH];
+  } name_data;
+  _Static_assert(sizeof(name_data) == REGION_NAME_BYTES, "Unexpected region name size");
+  prv_database_read(region_offset, &name_data, sizeof(name_data));
+  PBL_ASSERTN(name_data.continent_index < ARRAY_LENGTH(CONTINENT_NAMES));
 
   // Copy the continent name into our buffer, followed by a slash.
-  const int continent_name_length = strlen(CONTINENT_NAMES[continent_index]);
-  memcpy(region_name, CONTINENT_NAMES[continent_index], continent_name_length);
+  const char *continent_name = CONTINENT_NAMES[name_data.continent_index];
+  const int continent_name_length = strlen(continent_name);
+  memcpy(region_name, continent_name, continent_name_length);
   region_name[continent_name_length] = '/';
 
+  // The city name is nul padded, but doesn't have a nul terminator if it uses all
+  // TIMEZONE_CITY_LENGTH bytes. The longest continent + slash + city name + nul always fits.
   char *city_name = region_name + continent_name_length + 1 /* slash */;
+  memcpy(city_name, name_data.city_name, TIMEZONE_CITY_LENGTH);
+  city_name[TIMEZONE_CITY_LENGTH] = '\0';
+}
 
-  // How many bytes left we have of our buffer to fill in the city information.
-  const int remaining_size = (region_name + TIMEZONE_NAME_LENGTH) - city_name;
-
-  // Fill the rest of our buffer with city name.
-  // Our generation script will ensure that continent + slash + city name + null will always
-  // fit in our buffer with a null terminator to spare.
-  prv_database_read(region_offset + 1 /* continent index */, city_name, remaining_size);
-
-  // FIXME: Perhaps we should refactor this to do one read instead of two? The information is
-  // right beside each other and it's pretty wasteful to do a 1 byte read followed by a 15 byte
-  // read as separate reads.
+bool timezone_database_load_region_name(uint16_t region_id, char *region_name) {
+  if (region_id > timezone_database_get_region_count()) {
+    return false;
+  }
 
+  prv_read_region_name(region_id, region_name);
   return true;
 }
 
@@ -204,61 +192,84 @@ bool timezone_database_load_dst_rule(uint8_t dst_id, TimezoneDSTRule *start, Tim
   return true;
 }
 
-static int prv_search_regions_by_name(const char *region_name, int region_name_length) {
-  const int region_count = timezone_database_get_region_count();
-
-  for (int i = 0; i < region_count; i++) {
+//! Finds the first region whose name starts with the given name. The regions are sorted by name,
+//! so this is a binary search for the first region which doesn't sort before the name.
+static int prv_search_regions_by_name(const TimezoneDatabaseFlashHeader *header,
+                                      const char *region_name, int region_name_length) {
+  int low = 0;
+  int high = header->region_count;
+  bool found = false;
+  while (low < high) {
+    const int mid = low + ((high - low) / 2);
     char lookup_region_name[TIMEZONE_NAME_LENGTH];
-    timezone_database_load_region_name(i, lookup_region_name);
-    if (strncmp(region_name, lookup_region_name, region_name_length) == 0) {
-      return i;
+    prv_read_region_name(mid, lookup_region_name);
+    const int cmp = strncmp(lookup_region_name, region_name, region_name_length);
+    if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      // The search ends on the last region we moved left from, so that's the match if any
+      found = (cmp == 0);
+      high = mid;
     }
   }
 
-  return -1;
+  return found ? low : -1;
 }
 
-static int prv_search_links_by_name(const char *region_name, int region_name_length) {
-  char name_asciz[256] = {0};
-  memcpy(name_asciz, region_name, region_name_length);
+//! Finds the link with the given name. The links are sorted by name, so this is a binary search
+//! for the first link which doesn't sort before the name.
+static int prv_search_links_by_name(const TimezoneDatabaseFlashHeader *header,
+                                    const char *region_name, int region_name_length) {
+  char name_asciz[LINK_NAME_LENGTH + 1] = {0};
+  memcpy(name_asciz, region_name, MIN(region_name_length, LINK_NAME_LENGTH));
 
   const int link_section_offset =
       // Skip over the region count
       TZDATA_HEADER_BYTES +
       // Skip over the regions list
-      (timezone_database_get_region_count() * REGION_BYTES) +
+      (header->region_count * REGION_BYTES) +
       // Skip over the DST list
-      ((prv_get_dst_rule_count() - 1) * DST_RULE_PAIR_BYTES);
+      ((header->dst_rule_count - 1) * DST_RULE_PAIR_BYTES);
 
-  const uint16_t link_count = prv_get_link_count();
-
-  for (int i = 0; i < link_count; i++) {
-    const int link_offset = link_section_offset + (i * LINK_BYTES);
-
-    char link_name[LINK_NAME_LENGTH + 1]; // + max length + null terminator
-    prv_database_read(link_offset + LINK_REGION_LENGTH, link_name, LINK_NAME_LENGTH);
-    link_name[sizeof(link_name) - 1] = '\0';
-
-    if (strncmp(name_asciz, link_name, LINK_NAME_LENGTH) == 0) {
-      // Found it!
-      uint16_t linked_region_id;
-      prv_database_read(link_offset, &linked_region_id, sizeof(linked_region_id));
-      return linked_region_id;
+  struct PACKED {
+    uint16_t region_id;
+    char name[LINK_NAME_LENGTH]; //!< nul padded, not nul terminated if it uses every byte
+  } link;
+  _Static_assert(sizeof(link) == LINK_BYTES, "Unexpected link size");
+
+  int low = 0;
+  int high = header->link_count;
+  int linked_region_id = -1;
+  while (low < high) {
+    const int mid = low + ((high - low) / 2);
+    prv_database_read(link_section_offset + (mid * LINK_BYTES), &link, sizeof(link));
+    const int cmp = strncmp(link.name, name_asciz, LINK_NAME_LENGTH);
+    if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      // The search ends on the last link we moved left from, so that's the match if any
+      linked_region_id = (cmp == 0) ? link.region_id : -1;
+      high = mid;
     }
   }
 
-  return -1;
+  return linked_region_id;
 }
 
 int timezone_database_find_region_by_name(const char *region_name, int region_name_length) {
-  int region_id = prv_search_regions_by_name(region_name, region_name_length);
+  TimezoneDatabaseFlashHeader header;
+  if (!prv_database_read(0, &header, sizeof(header))) {
+    return -1;
+  }
+
+  int region_id = prv_search_regions_by_name(&header, region_name, region_name_length);
 
   if (region_id == -1) {
     // Might be a Link, let's check.
     // To explain: iOS, when not synchronized from the internet, uses _ancient_ IANA region names.
     // For example, when in California, iOS will send "US/Pacific" which hasn't been the name of
     // that timezone since 1993. So we need to support linked timezones sent from the phone.
-    region_id = prv_search_links_by_name(region_name, region_name_length);
+    region_id = prv_search_links_by_name(&header, region_name, region_name_length);
   }
 
   return region_id;
@@ -78,6 +78,26 @@ struct prv_check_app_and_wakeup_event_s {
   int wakeup_count; //!< wakeup event count for app, negative for error (StatusCode)
 };
 
+//! RAM copy of the fields of a WakeupEntry needed to schedule, query and cancel it
+typedef struct {
+  time_t timestamp;
+  WakeupId wakeup_id;
+  Uuid uuid;
+} WakeupIndexEntry;
+
+//! Every scheduled wakeup event, kept as a binary min-heap ordered by timestamp. It is built from
+//! the settings file at init and after each rewrite of the file, and kept up to date by every
+//! add and delete, so the settings file is only needed for persistence. If the index can't be
+//! allocated it is left invalid and we fall back to scanning the settings file.
+typedef struct {
+  WakeupIndexEntry *entries;
+  uint16_t count;
+  uint16_t capacity;
+  bool valid;
+} WakeupIndex;
+
+#define WAKEUP_INDEX_MIN_CAPACITY 8
+
 // Local prototypes
 static WakeupEntry prv_wakeup_settings_get_entry(WakeupId wakeup_id);
 static void prv_wakeup_settings_delete_entry(WakeupId wakeup_id);
@@ -89,6 +109,170 @@ static TimerID s_current_timer_id = TIMER_INVALID_ID; // single timer reused for
 // single structure containing the global wakeup state
 static WakeupState s_wakeup_state = { -1, -1, 0 };
 static bool s_catchup_enabled = false; // enables catching up with missed events
+static WakeupIndex s_index; // protected by s_mutex
+
+////////////////////////////////////////////////////////////////////////////////
+// Wakeup index
+
+static bool prv_index_entry_is_before(const WakeupIndexEntry *a, const WakeupIndexEntry *b) {
+  if (a->timestamp != b->timestamp) {
+    return a->timestamp < b->timestamp;
+  }
+  return a->wakeup_id < b->wakeup_id;
+}
+
+static void prv_index_swap(uint16_t a, uint16_t b) {
+  const WakeupIndexEntry tmp = s_index.entries[a];
+  s_index.entries[a] = s_index.entries[b];
+  s_index.entries[b] = tmp;
+}
+
+static void prv_index_sift_up(uint16_t i) {
+  while (i > 0) {
+    const uint16_t parent = (i - 1) / 2;
+    if (!prv_index_entry_is_before(&s_index.entries[i], &s_index.entries[parent])) {
+      break;
+    }
+    prv_index_swap(i, parent);
+    i = parent;
+  }
+}
+
+static void prv_index_sift_down(uint16_t i) {
+  while (true) {
+    const uint16_t left = (2 * i) + 1;
+    const uint16_t right = left + 1;
+    uint16_t smallest = i;
+    if (left < s_index.count &&
+        prv_index_entry_is_before(&s_index.entries[left], &s_index.entries[smallest])) {
+      smallest = left;
+    }
+    if (right < s_index.count &&
+        prv_index_entry_is_before(&s_index.entries[right], &s_index.entries[smallest])) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      break;
+    }
+    prv_index_swap(i, smallest);
+    i = smallest;
+  }
+}
+
+static void prv_index_heapify(void) {
+  for (int i = (s_index.count / 2) - 1; i >= 0; i--) {
+    prv_index_sift_down(i);
+  }
+}
+
+static void prv_index_reset(void) {
+  kernel_free(s_index.entries);
+  s_index = (WakeupIndex) {};
+}
+
+//! Appends an entry without restoring the heap order.
+//! On allocation failure the index is reset and left invalid.
+static bool prv_index_append(WakeupId wakeup_id, const WakeupEntry *entry) {
+  if (s_index.count == s_index.capacity) {
+    const uint16_t new_capacity = MAX(WAKEUP_INDEX_MIN_CAPACITY, s_index.capacity * 2);
+    WakeupIndexEntry *new_entries =
+        kernel_realloc(s_index.entries, new_capacity * sizeof(WakeupIndexEntry));
+    if (!new_entries) {
+      PBL_LOG(LOG_LEVEL_WARNING, "Not enough memory for the wakeup index, falling back to scans");
+      prv_index_reset();
+      return false;
+    }
+    s_index.entries = new_entries;
+    s_index.capacity = new_capacity;
+  }
+  s_index.entries[s_index.count++] = (WakeupIndexEntry) {
+    .timestamp = entry->timestamp,
+    .wakeup_id = wakeup_id,
+    .uuid = entry->uuid,
+  };
+  return true;
+}
+
+static void prv_index_add(WakeupId wakeup_id, const WakeupEntry *entry) {
+  if (s_index.valid && prv_index_append(wakeup_id, entry)) {
+    prv_index_sift_up(s_index.count - 1);
+  }
+}
+
+static WakeupIndexEntry *prv_index_find(WakeupId wakeup_id) {
+  for (uint16_t i = 0; i < s_index.count; i++) {
+    if (s_index.entries[i].wakeup_id == wakeup_id) {
+      return &s_index.entries[i];
+    }
+  }
+  return NULL;
+}
+
+static void prv_index_remove(WakeupId wakeup_id) {
+  WakeupIndexEntry *index_entry = prv_index_find(wakeup_id);
+  if (!index_entry) {
+    return;
+  }
+  const uint16_t i = index_entry - s_index.entries;
+  s_index.count--;
+  if (i == s_index.count) {
+    return;
+  }
+  s_index.entries[i] = s_index.entries[s_index.count];
+  prv_index_sift_up(i);
+  prv_index_sift_down(i);
+}
+
+static void prv_index_remove_uuid(const Uuid *uuid) {
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < s_index.count; i++) {
+    if (!uuid_equal(&s_index.entries[i].uuid, uuid)) {
+      s_index.entries[kept++] = s_index.entries[i];
+    }
+  }
+  s_index.count = kept;
+  prv_index_heapify();
+}
+
+static bool prv_index_build_callback(SettingsFile *file, SettingsRecordInfo *info,
+                                     void *context) {
+  if (info->key_len != sizeof(WakeupId) || info->val_len != sizeof(WakeupEntry)) {
+    return true; // continue iterating
+  }
+
+  WakeupId wakeup_id;
+  info->get_key(file, (uint8_t*)&wakeup_id, sizeof(WakeupId));
+  if (wakeup_id <= 0) {
+    return true; // continue iterating
+  }
+
+  WakeupEntry entry;
+  info->get_val(file, (uint8_t*)&entry, sizeof(WakeupEntry));
+
+  // Stop iterating if we ran out of memory
+  return prv_index_append(wakeup_id, &entry);
+}
+
+//! Rebuilds the index from the settings file. Must be called with s_mutex held.
+static void prv_index_build(SettingsFile *file) {
+  prv_index_reset();
+  s_index.valid = true;
+  settings_file_each(file, prv_index_build_callback, NULL);
+  prv_index_heapify();
+}
+
+//! Rebuilds the index from the settings file on disk. Must be called with s_mutex held.
+static void prv_index_build_from_file(void) {
+  SettingsFile wakeup_settings;
+  if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME, SETTINGS_FILE_SIZE) == S_SUCCESS) {
+    prv_index_build(&wakeup_settings);
+    settings_file_close(&wakeup_settings);
+  } else {
+    prv_index_reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
 void wakeup_dispatcher_system_task(void *data){
   WakeupId wakeup_id = (WakeupId)data;
@@ -186,16 +370,30 @@ static void prv_wakeup_timer_next_pending(void) {
 
   mutex_lock(s_mutex);
   {
-    // Find the next event to occur
-    SettingsFile wakeup_settings;
-    if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME, SETTINGS_FILE_SIZE) == S_SUCCESS) {
-      // Reset wakeup state to use for the search
-      s_wakeup_state.current_wakeup_id = -1;
-      s_wakeup_state.timestamp = 0;
-      settings_file_each(&wakeup_settings, prv_find_next_wakeup_id_callback, NULL);
-      settings_file_close(&wakeup_settings);
+    if (!s_index.valid) {
+      prv_index_build_from_file();
+    }
+
+    // Reset wakeup state to use for the search
+    s_wakeup_state.current_wakeup_id = -1;
+    s_wakeup_state.timestamp = 0;
+
+    if (s_index.valid) {
+      // The soonest event is at the top of the heap
+      if (s_index.count) {
+        s_wakeup_state.current_wakeup_id = s_index.entries[0].wakeup_id;
+        s_wakeup_state.timestamp = s_index.entries[0].timestamp;
+      }
     } else {
-      PBL_LOG(LOG_LEVEL_ERROR, "Error: could not open APP_WAKEUP settings");
+      // Find the next event to occur
+      SettingsFile wakeup_settings;
+      if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME,
+                             SETTINGS_FILE_SIZE) == S_SUCCESS) {
+        settings_file_each(&wakeup_settings, prv_find_next_wakeup_id_callback, NULL);
+        settings_file_close(&wakeup_settings);
+      } else {
+        PBL_LOG(LOG_LEVEL_ERROR, "Error: could not open APP_WAKEUP settings");
+      }
     }
   }
   mutex_unlock(s_mutex);
@@ -233,7 +431,7 @@ static void prv_migrate_events_callback(SettingsFile *old_file, SettingsFile *ne
   }
 
   WakeupId wakeup_id;
-  info->get_val(old_file, (uint8_t*)&wakeup_id, sizeof(WakeupId));
+  info->get_key(old_file, (uint8_t*)&wakeup_id, sizeof(WakeupId));
 
   WakeupEntry entry;
   info->get_val(old_file, (uint8_t*)&entry, sizeof(WakeupEntry));
@@ -324,6 +522,7 @@ void wakeup_init(void) {
   struct prv_missed_events_s missed_events = { 0, NULL };
 
   s_mutex = mutex_create();
+  prv_index_reset();
 
   event_service_init(PEBBLE_WAKEUP_EVENT, NULL, NULL);
 
@@ -349,6 +548,7 @@ void wakeup_init(void) {
   } else {
     PBL_LOG(LOG_LEVEL_DEBUG, "Not rewriting wakeup file because no entries were found");
   }
+  prv_index_build(&wakeup_settings);
   settings_file_close(&wakeup_settings);
 
   // If wakeup events were missed by apps requesting notify_if_missed
@@ -426,10 +626,25 @@ static void prv_wakeup_settings_delete_entry(WakeupId wakeup_id) {
       settings_file_delete(&wakeup_settings, (uint8_t*)&wakeup_id, sizeof(WakeupId));
       settings_file_close(&wakeup_settings);
     }
+    prv_index_remove(wakeup_id);
   }
   mutex_unlock(s_mutex);
 }
 
+//! Looks up the owner of a wakeup event. Must be called with s_mutex held.
+//! @return true if the index is valid, in which case found_out is set
+static bool prv_index_lookup(WakeupId wakeup_id, bool *found_out, WakeupIndexEntry *entry_out) {
+  if (!s_index.valid) {
+    return false;
+  }
+  const WakeupIndexEntry *index_entry = prv_index_find(wakeup_id);
+  *found_out = (index_entry != NULL);
+  if (index_entry) {
+    *entry_out = *index_entry;
+  }
+  return true;
+}
+
 static WakeupEntry prv_wakeup_settings_get_entry(WakeupId wakeup_id) {
   WakeupEntry entry = {{0}};
 
@@ -447,11 +662,25 @@ static WakeupEntry prv_wakeup_settings_get_entry(WakeupId wakeup_id) {
 }
 
 DEFINE_SYSCALL(void, sys_wakeup_delete, WakeupId wakeup_id) {
+  Uuid owner = {};
 
-  WakeupEntry entry = prv_wakeup_settings_get_entry(wakeup_id);
+  mutex_lock(s_mutex);
+  bool found;
+  WakeupIndexEntry index_entry;
+  const bool index_valid = prv_index_lookup(wakeup_id, &found, &index_entry);
+  mutex_unlock(s_mutex);
+
+  if (index_valid) {
+    if (!found) {
+      return;
+    }
+    owner = index_entry.uuid;
+  } else {
+    owner = prv_wakeup_settings_get_entry(wakeup_id).uuid;
+  }
 
   // Only allow owner to delete its own wakeup events
-  if (uuid_equal(&app_manager_get_current_app_md()->uuid, &entry.uuid)) {
+  if (uuid_equal(&app_manager_get_current_app_md()->uuid, &owner)) {
     if (wakeup_id == s_wakeup_state.current_wakeup_id &&
         new_timer_scheduled(s_current_timer_id, NULL)) {
       new_timer_stop(s_current_timer_id);
@@ -494,6 +723,23 @@ static bool prv_check_count_and_availability_callback(SettingsFile *file,
 }
 
 
+static void prv_check_count_and_availability_in_index(
+    struct prv_check_app_and_wakeup_event_s *check) {
+  const Uuid *app_uuid = &app_manager_get_current_app_md()->uuid;
+  for (uint16_t i = 0; i < s_index.count; i++) {
+    const WakeupIndexEntry *index_entry = &s_index.entries[i];
+    // If the wakeup_id is with the same minute as another wakeup event
+    if ((index_entry->timestamp - WAKEUP_EVENT_WINDOW < check->wakeup_timestamp) &&
+        (check->wakeup_timestamp < (index_entry->timestamp + WAKEUP_EVENT_WINDOW))) {
+      check->wakeup_count = E_RANGE;
+      return;
+    }
+    if (uuid_equal(app_uuid, &index_entry->uuid)) {
+      check->wakeup_count++;
+    }
+  }
+}
+
 static StatusCode prv_wakeup_settings_add_entry(WakeupId wakeup_id, WakeupEntry entry) {
   status_t status = S_SUCCESS;
 
@@ -507,15 +753,22 @@ static StatusCode prv_wakeup_settings_add_entry(WakeupId wakeup_id, WakeupEntry
         .wakeup_count = 0,
         .wakeup_timestamp = entry.timestamp
       };
-      settings_file_each(&wakeup_settings, prv_check_count_and_availability_callback, &check);
+      if (s_index.valid) {
+        prv_check_count_and_availability_in_index(&check);
+      } else {
+        settings_file_each(&wakeup_settings, prv_check_count_and_availability_callback, &check);
+      }
 
       if (check.wakeup_count < S_SUCCESS) {
         status = check.wakeup_count;
       } else if (check.wakeup_count >= MAX_WAKEUP_EVENTS_PER_APP) {
         status = E_OUT_OF_RESOURCES;
       } else {
-        settings_file_set(&wakeup_settings, (uint8_t*)&wakeup_id, sizeof(WakeupId),
-                          (uint8_t*)&entry, sizeof(WakeupEntry));
+        status = settings_file_set(&wakeup_settings, (uint8_t*)&wakeup_id, sizeof(WakeupId),
+                                   (uint8_t*)&entry, sizeof(WakeupEntry));
+        if (status == S_SUCCESS) {
+          prv_index_add(wakeup_id, &entry);
+        }
       }
       settings_file_close(&wakeup_settings);
     } else {
@@ -565,6 +818,7 @@ DEFINE_SYSCALL(void, sys_wakeup_cancel_all_for_app, void) {
       settings_file_rewrite(&wakeup_settings, prv_delete_events_by_uuid_callback, NULL);
       settings_file_close(&wakeup_settings);
     }
+    prv_index_remove_uuid(&app_manager_get_current_app_md()->uuid);
   }
   mutex_unlock(s_mutex);
 
@@ -582,14 +836,25 @@ DEFINE_SYSCALL(time_t, sys_wakeup_query, WakeupId wakeup_id) {
 
   mutex_lock(s_mutex);
   {
-    SettingsFile wakeup_settings;
-    if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME, SETTINGS_FILE_SIZE) == S_SUCCESS) {
-      // Check if the wakeup id is valid by seeing if it is in the wakeup settings_file
-      status = settings_file_get(&wakeup_settings, (uint8_t*)&wakeup_id, sizeof(WakeupId),
-                                 (uint8_t*)&entry, sizeof(WakeupEntry));
-      settings_file_close(&wakeup_settings);
+    bool found;
+    WakeupIndexEntry index_entry;
+    if (prv_index_lookup(wakeup_id, &found, &index_entry)) {
+      if (found) {
+        entry.uuid = index_entry.uuid;
+        entry.timestamp = index_entry.timestamp;
+        status = S_SUCCESS;
+      }
     } else {
-      status = E_INTERNAL;
+      SettingsFile wakeup_settings;
+      if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME,
+                             SETTINGS_FILE_SIZE) == S_SUCCESS) {
+        // Check if the wakeup id is valid by seeing if it is in the wakeup settings_file
+        status = settings_file_get(&wakeup_settings, (uint8_t*)&wakeup_id, sizeof(WakeupId),
+                                   (uint8_t*)&entry, sizeof(WakeupEntry));
+        settings_file_close(&wakeup_settings);
+      } else {
+        status = E_INTERNAL;
+      }
     }
   }
   mutex_unlock(s_mutex);
@@ -636,8 +901,10 @@ void wakeup_migrate_timezone(int utc_diff) {
     SettingsFile wakeup_settings;
     if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME, SETTINGS_FILE_SIZE) == S_SUCCESS) {
       settings_file_rewrite(&wakeup_settings, prv_migrate_events_callback, (void*)&utc_diff);
+      prv_index_build(&wakeup_settings);
       settings_file_close(&wakeup_settings);
     } else {
+      prv_index_reset();
       PBL_LOG(LOG_LEVEL_ERROR, "Error: could not open wakeup settings");
     }
   }
@@ -654,9 +921,11 @@ static void prv_wakeup_rewrite_kernel_bg_cb(void *data) {
     if (settings_file_open(&wakeup_settings, SETTINGS_FILE_NAME, SETTINGS_FILE_SIZE) == S_SUCCESS) {
       // Update each wakeup entry via prv_update_events_callback and record any missed events
       settings_file_rewrite(&wakeup_settings, prv_update_events_callback, &missed_events);
+      prv_index_build(&wakeup_settings);
       settings_file_close(&wakeup_settings);
     } else {
       PBL_LOG(LOG_LEVEL_ERROR, "Error: could not open wakeup settings");
+      prv_index_reset();
     }
   }
   mutex_unlock(s_mutex);
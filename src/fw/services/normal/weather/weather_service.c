@@ -18,6 +18,7 @@
 #include "weather_service_private.h"
 
 #include "applib/event_service_client.h"
+#include "drivers/rtc.h"
 #include "kernel/events.h"
 #include "kernel/pbl_malloc.h"
 #include "os/mutex.h"
@@ -29,26 +30,31 @@
 #include "system/logging.h"
 #include "system/passert.h"
 
-static int prv_weather_data_list_node_comparator(void *a, void *b) {
-  return ((WeatherDataListNode *)b)->id - ((WeatherDataListNode *)a)->id;
-}
-
-typedef struct WeatherDBIteratorContext {
-  WeatherDataListNode *head;
-  size_t count;
-  SerializedWeatherAppPrefs *serialized_prefs;
-} WeatherDBIteratorContext;
+#include <string.h>
+
+//! Decoded forecasts of all the locations of the weather app, in the order of the weather app
+//! prefs. Kept up to date by the blob db event handler so that clients never have to touch the
+//! weather db, the prefs or sort anything.
+//! Each forecast is a single allocation, its strings are stored right after it.
+static struct {
+  //! The locations in the order of the weather app prefs, the first one is the default location
+  WeatherDBKey *locations;
+  //! The forecast of each location, NULL if the location has no valid weather db entry
+  WeatherLocationForecast **forecasts;
+  size_t num_locations;
+  //! Start of the day the forecasts were last checked for being too old, see
+  //! prv_cache_get_valid_forecast()
+  time_t today_start_utc;
+} s_cache;
 
 static PebbleMutex *s_mutex;
-static WeatherLocationForecast *s_default_forecast;
 
 static bool prv_entry_update_time_too_old_to_be_valid(const time_t update_time_utc) {
   const time_t oldest_valid_time_utc = time_start_of_today() - SECONDS_PER_DAY;
   return (update_time_utc < oldest_valid_time_utc);
 }
 
-static bool prv_fill_forecast_from_entry(WeatherDBEntry *entry,
-                                         WeatherLocationForecast *forecast_out) {
+static WeatherLocationForecast *prv_create_forecast_from_entry(WeatherDBEntry *entry) {
   PascalString16List pstring16_list;
   pstring_project_list_on_serialized_array(&pstring16_list, &entry->pstring16s);
   PascalString16 *location_pstring =
@@ -65,44 +71,75 @@ static bool prv_fill_forecast_from_entry(WeatherDBEntry *entry,
     PBL_LOG(LOG_LEVEL_ERROR,
             "Invalid entry. Valid UT: %u, location length: %"PRIu16,
             is_valid_entry_update_time, location_pstring_length);
-    return false;
+    return NULL;
   }
 
   if (prv_entry_update_time_too_old_to_be_valid(entry->last_update_time_utc)) {
     PBL_LOG(LOG_LEVEL_WARNING, "Weather entry too old to fill forecast");
-    return false;
+    return NULL;
   }
 
-  *forecast_out = (WeatherLocationForecast) {
+  // add 1 for each null terminator
+  const size_t location_name_size = location_pstring_length + 1;
+  const size_t phrase_size = phrase_pstring->str_length + 1;
+  WeatherLocationForecast *forecast =
+      task_zalloc_check(sizeof(WeatherLocationForecast) + location_name_size + phrase_size);
+  char *strings = (char *)(forecast + 1);
+
+  *forecast = (WeatherLocationForecast) {
+    .location_name = strings,
     .is_current_location = entry->is_current_location,
     .current_temp = entry->current_temp,
     .today_high = entry->today_high_temp,
     .today_low = entry->today_low_temp,
     .current_weather_type = entry->current_weather_type,
+    .current_weather_phrase = strings + location_name_size,
     .tomorrow_high = entry->tomorrow_high_temp,
     .tomorrow_low = entry->tomorrow_low_temp,
     .tomorrow_weather_type = entry->tomorrow_weather_type,
     .time_updated_utc = entry->last_update_time_utc,
   };
+  pstring_pstring16_to_string(location_pstring, forecast->location_name);
+  pstring_pstring16_to_string(phrase_pstring, forecast->current_weather_phrase);
 
-  // add 1 for null terminator
-  forecast_out->location_name = task_zalloc_check(location_pstring->str_length + 1);
-  pstring_pstring16_to_string(location_pstring, forecast_out->location_name);
+  return forecast;
+}
 
-  forecast_out->current_weather_phrase = task_zalloc_check(phrase_pstring->str_length + 1);
-  pstring_pstring16_to_string(phrase_pstring, forecast_out->current_weather_phrase);
+static size_t prv_forecast_strings_size(const WeatherLocationForecast *forecast) {
+  return strlen(forecast->location_name) + 1 + strlen(forecast->current_weather_phrase) + 1;
+}
 
-  return true;
+//! Copies the forecast to forecast_out and its strings to strings_out, which must be
+//! prv_forecast_strings_size() bytes long
+static void prv_copy_forecast(const WeatherLocationForecast *forecast,
+                              WeatherLocationForecast *forecast_out, char *strings_out) {
+  *forecast_out = *forecast;
+  const size_t location_name_size = strlen(forecast->location_name) + 1;
+  forecast_out->location_name = strings_out;
+  memcpy(forecast_out->location_name, forecast->location_name, location_name_size);
+  forecast_out->current_weather_phrase = strings_out + location_name_size;
+  strcpy(forecast_out->current_weather_phrase, forecast->current_weather_phrase);
 }
 
-static bool prv_get_location_index(Uuid *location, SerializedWeatherAppPrefs *prefs,
-                                   size_t *index_out) {
-  if (!index_out) {
-    return false;
+//! Forecasts don't get updated when the day changes, so check again whenever one is handed out.
+//! time_start_of_today() is too slow to call every time, only redo it once the day has changed.
+static const WeatherLocationForecast *prv_cache_get_valid_forecast(size_t index) {
+  const WeatherLocationForecast *forecast = s_cache.forecasts[index];
+  if (!forecast) {
+    return NULL;
+  }
+  const time_t now_utc = rtc_get_time();
+  if ((now_utc < s_cache.today_start_utc) ||
+      (now_utc >= s_cache.today_start_utc + SECONDS_PER_DAY)) {
+    s_cache.today_start_utc = time_util_get_midnight_of(now_utc);
   }
+  const time_t oldest_valid_time_utc = s_cache.today_start_utc - SECONDS_PER_DAY;
+  return (forecast->time_updated_utc < oldest_valid_time_utc) ? NULL : forecast;
+}
 
-  for (size_t idx = 0; idx < prefs->num_locations; idx++) {
-    if (uuid_equal(location, &prefs->locations[idx])) {
+static bool prv_cache_get_location_index(const WeatherDBKey *key, size_t *index_out) {
+  for (size_t idx = 0; idx < s_cache.num_locations; idx++) {
+    if (uuid_equal(key, &s_cache.locations[idx])) {
       *index_out = idx;
       return true;
     }
@@ -110,122 +147,109 @@ static bool prv_get_location_index(Uuid *location, SerializedWeatherAppPrefs *pr
   return false;
 }
 
-static void prv_add_to_list_if_valid(WeatherDBKey *key, WeatherDBEntry *entry,
-                                     void *context) {
-  WeatherDBIteratorContext *iterator_context = context;
-  SerializedWeatherAppPrefs *prefs = iterator_context->serialized_prefs;
+static void prv_cache_set_forecast(size_t index, WeatherLocationForecast *forecast) {
+  task_free(s_cache.forecasts[index]);
+  s_cache.forecasts[index] = forecast;
+}
+
+static void prv_cache_destroy(void) {
+  for (size_t idx = 0; idx < s_cache.num_locations; idx++) {
+    task_free(s_cache.forecasts[idx]);
+  }
+  // The locations are part of the same allocation as the forecasts
+  task_free(s_cache.forecasts);
+  s_cache = (typeof(s_cache)) {};
+}
+
+static void prv_cache_add_entry(WeatherDBKey *key, WeatherDBEntry *entry, void *context) {
   char key_string_buffer[UUID_STRING_BUFFER_LENGTH] = {0};
   size_t location_index;
 
-  if (!prv_get_location_index(key, prefs, &location_index)) {
+  if (!prv_cache_get_location_index(key, &location_index)) {
     uuid_to_string(key, key_string_buffer);
     PBL_LOG(LOG_LEVEL_WARNING, "Weather location %s has no known ordering! Skipping",
             key_string_buffer);
     return; // location not found in ordering list, skip over
   }
 
-  WeatherDataListNode *node = task_zalloc_check(sizeof(WeatherDataListNode));
-  node->id = location_index;
-  WeatherLocationForecast *forecast = &node->forecast;
-
-  if (!prv_fill_forecast_from_entry(entry, forecast)) {
+  WeatherLocationForecast *forecast = prv_create_forecast_from_entry(entry);
+  if (!forecast) {
     uuid_to_string(key, key_string_buffer);
     PBL_LOG(LOG_LEVEL_WARNING, "Could not create forecast from %s's entry", key_string_buffer);
-    task_free(node);
-    return;
   }
-
-  ListNode *to_add = (ListNode *)node;
-  list_init(to_add);
-
-  const bool ascending = true;
-  iterator_context->head =
-      (WeatherDataListNode *)list_sorted_add((ListNode *)iterator_context->head,
-                                              to_add,
-                                              prv_weather_data_list_node_comparator,
-                                              ascending);
-  iterator_context->count++;
+  prv_cache_set_forecast(location_index, forecast);
 }
 
-static bool prv_get_default_location_key(WeatherDBKey *key_out) {
+//! Rereads the ordering of the locations and all their forecasts
+static void prv_cache_rebuild(void) {
+  mutex_lock(s_mutex);
+  prv_cache_destroy();
+
   SerializedWeatherAppPrefs *prefs = watch_app_prefs_get_weather();
   if (!prefs) {
     PBL_LOG(LOG_LEVEL_ERROR, "No SerializedWeatherAppPrefs available!");
-    return false;
+    goto unlock;
   }
 
   // Can occur if the user removes all weather locations from their mobile app
   if (prefs->num_locations == 0) {
-    watch_app_prefs_destroy_weather(prefs);
-    return false;
+    goto destroy_prefs;
   }
 
-  const size_t default_location_index = 0;
-  *key_out = prefs->locations[default_location_index];
+  const size_t num_locations = prefs->num_locations;
+  s_cache.forecasts = task_zalloc_check(num_locations * (sizeof(WeatherLocationForecast *) +
+                                                         sizeof(WeatherDBKey)));
+  s_cache.locations = (WeatherDBKey *)(s_cache.forecasts + num_locations);
+  memcpy(s_cache.locations, prefs->locations, num_locations * sizeof(WeatherDBKey));
+  s_cache.num_locations = num_locations;
+
+  weather_db_for_each(prv_cache_add_entry, NULL);
 
+destroy_prefs:
   watch_app_prefs_destroy_weather(prefs);
-  return true;
+unlock:
+  mutex_unlock(s_mutex);
 }
 
-static void prv_update_default_location_cache(void) {
+//! Rereads the forecast of a single location after its weather db entry changed
+static void prv_cache_update_location(const WeatherDBKey *key) {
   mutex_lock(s_mutex);
-  weather_service_destroy_default_forecast(s_default_forecast);
-  s_default_forecast = NULL;
-
-  WeatherDBKey default_location_key;
-  if (!prv_get_default_location_key(&default_location_key)) {
-    goto cleanup;
+  size_t location_index;
+  if (!prv_cache_get_location_index(key, &location_index)) {
+    goto unlock;
   }
 
-  const int entry_len = weather_db_get_len((uint8_t *)&default_location_key,
-                                           sizeof(default_location_key));
-  if (entry_len == 0) {
-    goto cleanup;
-  }
-  WeatherDBEntry *entry = task_zalloc_check(entry_len);
-  status_t rv = weather_db_read((uint8_t *)&default_location_key, sizeof(default_location_key),
-                                (uint8_t *)entry, entry_len);
-  if (rv != S_SUCCESS) {
-    goto free_entry;
-  }
-  WeatherLocationForecast *forecast_out = task_zalloc_check(sizeof(WeatherLocationForecast));
-  if (prv_fill_forecast_from_entry(entry, forecast_out)) {
-    s_default_forecast = forecast_out;
-  } else {
-    task_free(forecast_out);
+  WeatherLocationForecast *forecast = NULL;
+  const int entry_len = weather_db_get_len((uint8_t *)key, sizeof(*key));
+  if (entry_len > 0) {
+    WeatherDBEntry *entry = task_zalloc_check(entry_len);
+    const status_t rv = weather_db_read((uint8_t *)key, sizeof(*key), (uint8_t *)entry,
+                                        entry_len);
+    if (rv == S_SUCCESS) {
+      forecast = prv_create_forecast_from_entry(entry);
+    }
+    task_free(entry);
   }
+  prv_cache_set_forecast(location_index, forecast);
 
-free_entry:
-  task_free(entry);
-cleanup:
+unlock:
   mutex_unlock(s_mutex);
 }
 
-WeatherLocationForecast *weather_service_create_default_forecast(void) {
+void weather_service_lock(void) {
   mutex_lock(s_mutex);
-  WeatherLocationForecast *forecast = NULL;
-  if (s_default_forecast) {
-    forecast = task_zalloc_check(sizeof(WeatherLocationForecast));
-    *forecast = *s_default_forecast;
-    const size_t location_name_length = strlen(s_default_forecast->location_name);
-    forecast->location_name = task_zalloc_check(location_name_length + 1);
-    strncpy(forecast->location_name, s_default_forecast->location_name, location_name_length);
-
-    const size_t phrase_length = strlen(s_default_forecast->current_weather_phrase);
-    forecast->current_weather_phrase = task_zalloc_check(phrase_length + 1);
-    strncpy(forecast->current_weather_phrase, s_default_forecast->current_weather_phrase,
-            phrase_length);
-  }
+}
+
+void weather_service_unlock(void) {
   mutex_unlock(s_mutex);
-  return forecast;
 }
 
-void weather_service_destroy_default_forecast(WeatherLocationForecast *forecast) {
-  if (forecast) {
-    task_free(forecast->location_name);
-    task_free(forecast->current_weather_phrase);
-    task_free(forecast);
+const WeatherLocationForecast *weather_service_get_default_forecast(void) {
+  const size_t default_location_index = 0;
+  if (s_cache.num_locations == 0) {
+    return NULL;
   }
+  return prv_cache_get_valid_forecast(default_location_index);
 }
 
 static void prv_blobdb_event_handler(PebbleEvent *event, void *context) {
@@ -244,15 +268,20 @@ static void prv_blobdb_event_handler(PebbleEvent *event, void *context) {
   if (blobdb_id == BlobDBIdWatchAppPrefs &&
       ((blobdb_event->type == BlobDBEventTypeFlush) || is_key_weather_app_pref)) {
     type = WeatherEventType_WeatherOrderChanged;
+    prv_cache_rebuild();
   } else if (blobdb_id == BlobDBIdWeather) {
     type = blobdb_event->type == BlobDBEventTypeInsert ? WeatherEventType_WeatherDataAdded :
                                                          WeatherEventType_WeatherDataRemoved;
+    if (blobdb_event->key && (blobdb_event->key_len == sizeof(WeatherDBKey))) {
+      prv_cache_update_location((const WeatherDBKey *)blobdb_event->key);
+    } else {
+      // Flushed
+      prv_cache_rebuild();
+    }
   } else {
     return;
   }
 
-  prv_update_default_location_cache();
-
   PebbleEvent e = (PebbleEvent) {
     .type = PEBBLE_WEATHER_EVENT,
     .weather = (PebbleWeatherEvent) {
@@ -271,22 +300,34 @@ void weather_service_init(void) {
     .handler = prv_blobdb_event_handler,
   };
 
-  prv_update_default_location_cache();
+  prv_cache_rebuild();
   event_service_client_subscribe(&s_blobdb_event_info);
 }
 
 WeatherDataListNode *weather_service_locations_list_create(size_t *count_out) {
-  WeatherDBIteratorContext context = (WeatherDBIteratorContext) {};
-  SerializedWeatherAppPrefs *prefs = watch_app_prefs_get_weather();
-  if (!prefs) {
-    return NULL;
+  WeatherDataListNode *head = NULL;
+  size_t count = 0;
+
+  mutex_lock(s_mutex);
+  // Walk backwards so that every node can be prepended, the list ends up in the cache's order
+  for (size_t idx = s_cache.num_locations; idx-- > 0;) {
+    const WeatherLocationForecast *forecast = prv_cache_get_valid_forecast(idx);
+    if (!forecast) {
+      continue;
+    }
+
+    WeatherDataListNode *node = task_zalloc_check(sizeof(WeatherDataListNode) +
+                                                  prv_forecast_strings_size(forecast));
+    node->id = idx;
+    prv_copy_forecast(forecast, &node->forecast, (char *)(node + 1));
+    list_init(&node->node);
+    head = (WeatherDataListNode *)list_prepend((ListNode *)head, &node->node);
+    count++;
   }
-  context.serialized_prefs = prefs;
-  weather_db_for_each(prv_add_to_list_if_valid, &context);
-  watch_app_prefs_destroy_weather(prefs);
-  *count_out = context.count;
+  mutex_unlock(s_mutex);
 
-  return context.head;
+  *count_out = count;
+  return head;
 }
 
 WeatherDataListNode *weather_service_locations_list_get_location_at_index(WeatherDataListNode *head,
@@ -296,8 +337,7 @@ WeatherDataListNode *weather_service_locations_list_get_location_at_index(Weathe
 
 void weather_service_locations_list_destroy(WeatherDataListNode *head) {
   while (head) {
-    task_free(head->forecast.location_name);
-    task_free(head->forecast.current_weather_phrase);
+    // The strings of the forecast are part of the same allocation as the node
     WeatherDataListNode *next = (WeatherDataListNode *)head->node.next;
     task_free(head);
     head = next;
@@ -61,16 +61,21 @@ typedef struct WeatherDataListNode {
 //! Initializes the weather service
 void weather_service_init(void);
 
-//! Retrieves the forecast for the default location in the database, if possible
-//! @return a copy of the default location's forecast, or NULL
-WeatherLocationForecast *weather_service_create_default_forecast(void);
+//! Locks the forecast cache of the service. The forecasts returned by
+//! weather_service_get_default_forecast() are only valid until weather_service_unlock() is called.
+//! Only hold the lock for as long as it takes to read the forecast, the cache can't be updated
+//! in the meantime.
+void weather_service_lock(void);
 
-//! Destroys the WeatherLocationForecast created with
-//! weather_service_create_forecast_for_default_location
-//! @param forecast The forecast to delete
-void weather_service_destroy_default_forecast(WeatherLocationForecast *forecast);
+//! Unlocks the forecast cache locked with weather_service_lock()
+void weather_service_unlock(void);
 
-//! Retrieves all valid weather records from weather_db and stores them in a list
+//! Retrieves the forecast for the default location without making a copy. Must be called with the
+//! forecast cache locked, see weather_service_lock().
+//! @return a read-only view of the default location's forecast, or NULL
+const WeatherLocationForecast *weather_service_get_default_forecast(void);
+
+//! Copies all valid forecasts from the forecast cache to a list
 //! List is guaranteed to be sorted by key
 //! List must be destroyed by weather_destroy_locations_list
 //! NOTE: ListNode and list.h are not exposed, so if this function becomes part of the public API,
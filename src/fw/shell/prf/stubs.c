@@ -144,6 +144,10 @@ bool app_db_exists_install_id(AppInstallId app_id) {
   return false;
 }
 
+uint32_t app_db_get_generation(void) {
+  return 0;
+}
+
 void timeline_item_destroy(TimelineItem* item) {
 }
 
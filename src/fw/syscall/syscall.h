@@ -90,6 +90,10 @@ void sys_resource_mapped_release_many(uint32_t num);
 
 uint32_t sys_resource_get_and_cache(ResAppNum app_num, uint32_t resource_id);
 
+uint8_t *sys_bitmap_cache_load(ResAppNum app_num, uint32_t resource_id, size_t *size_out);
+void sys_bitmap_cache_store(ResAppNum app_num, uint32_t resource_id, const uint8_t *pbi_data,
+                            size_t pbi_data_size);
+
 NORETURN sys_exit(void);
 
 GFont sys_font_get_system_font(const char *font_key);
@@ -318,71 +318,153 @@ static uint8_t* dict_copy(DictionaryIterator* iter) {
   return buf;
 }
 
-// Merge orig_iter and new_iter into dest_iter. Keys which exist in both
-// orig_iter and new_iter will get the value they have in new_iter.
+// Dictionary index
+////////////////////////////////////////////////////////////
+
+size_t dict_index_size(const DictionaryIterator *iter) {
+  DictionaryIterator iter_copy = *iter;
+  size_t num_tuples = 0;
+  for (Tuple *tuple = dict_read_first(&iter_copy); tuple; tuple = dict_read_next(&iter_copy)) {
+    num_tuples++;
+  }
+  return sizeof(DictionaryIndex) + (num_tuples * sizeof(DictionaryIndexEntry));
+}
+
+DictionaryIndex *dict_index_build(const DictionaryIterator *iter, void *buffer,
+                                  size_t buffer_size) {
+  if (buffer_size < sizeof(DictionaryIndex)) {
+    return NULL;
+  }
+  DictionaryIndex *index = buffer;
+  *index = (DictionaryIndex) {
+    .dictionary = iter->dictionary,
+  };
+  const size_t max_entries = (buffer_size - sizeof(DictionaryIndex)) /
+                             sizeof(DictionaryIndexEntry);
+
+  // Insertion sort, which keeps tuples with the same key in dictionary order so that lookups
+  // find the same tuple as dict_find(). Keys are mostly written in order, so it's usually linear.
+  DictionaryIterator iter_copy = *iter;
+  for (Tuple *tuple = dict_read_first(&iter_copy); tuple; tuple = dict_read_next(&iter_copy)) {
+    if (index->num_entries == max_entries) {
+      return NULL;
+    }
+    const DictionaryIndexEntry entry = {
+      .key = tuple->key,
+      .offset = (uint8_t *)tuple - (uint8_t *)iter->dictionary,
+    };
+    int i = index->num_entries++;
+    for (; i > 0 && index->entries[i - 1].key > entry.key; i--) {
+      index->entries[i] = index->entries[i - 1];
+    }
+    index->entries[i] = entry;
+  }
+  return index;
+}
+
+Tuple *dict_index_find(const DictionaryIndex *index, const uint32_t key) {
+  // Find the first entry with a key that isn't smaller than the one we're looking for
+  int low = 0;
+  int high = index->num_entries;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (index->entries[mid].key < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == index->num_entries || index->entries[low].key != key) {
+    return NULL;
+  }
+  return (Tuple *)((uint8_t *)index->dictionary + index->entries[low].offset);
+}
+
+// Merge
+////////////////////////////////////////////////////////////
+
+//! The dictionaries dict_merge() works on, with their indexes if there was enough memory for them
+typedef struct {
+  DictionaryIterator *iter;
+  DictionaryIndex *index;
+} MergeDictionary;
+
+static Tuple *prv_merge_find(const MergeDictionary *dict, const uint32_t key) {
+  return dict->index ? dict_index_find(dict->index, key) : dict_find(dict->iter, key);
+}
+
+// Merge orig and new into dest_iter. Keys which exist in both
+// orig and new will get the value they have in new.
 static DictionaryResult dict_merge_to(DictionaryIterator* dest_iter,
-                                      DictionaryIterator* orig_iter,
-                                      DictionaryIterator* new_iter,
+                                      const MergeDictionary *orig,
+                                      const MergeDictionary *new,
                                       const bool update_existing_keys_only,
                                       const DictionaryKeyUpdatedCallback update_key_callback,
                                       void* context) {
   DictionaryResult result = DICT_OK;
+  DictionaryIterator *orig_iter = orig->iter;
+  DictionaryIterator *new_iter = new->iter;
 
   // First, write the updated keys.
-  for (Tuple* new = dict_read_first(new_iter); new; new = dict_read_next(new_iter)) {
-    uint32_t key = new->key;
-    const Tuple* orig = dict_find(orig_iter, key);
-    if (orig == NULL && update_existing_keys_only) {
+  for (Tuple* new_tuple = dict_read_first(new_iter); new_tuple;
+       new_tuple = dict_read_next(new_iter)) {
+    uint32_t key = new_tuple->key;
+    const Tuple* orig_tuple = prv_merge_find(orig, key);
+    if (orig_tuple == NULL && update_existing_keys_only) {
       continue;
     }
-    if (orig == NULL) {
-      orig = NULL_TUPLE;
+    if (orig_tuple == NULL) {
+      orig_tuple = NULL_TUPLE;
     }
     Tuple* dest = dest_iter->cursor;
-    result = dict_write_tuple(dest_iter, new);
+    result = dict_write_tuple(dest_iter, new_tuple);
     if (result != DICT_OK) return result;
-    update_key_callback(key, dest, orig, context);
+    update_key_callback(key, dest, orig_tuple, context);
   }
 
   // Then, write any old keys which were not updated this round.
   // We still call update_key_callback here, even though the values
   // themselves have not changed, because we have shuffled them
   // around in memory, so their old buffers are no longer valid.
-  for (Tuple* orig = dict_read_first(orig_iter); orig; orig = dict_read_next(orig_iter)) {
-    uint32_t key = orig->key;
-    Tuple* new = dict_find(new_iter, key);
-    if (new != NULL) {
+  for (Tuple* orig_tuple = dict_read_first(orig_iter); orig_tuple;
+       orig_tuple = dict_read_next(orig_iter)) {
+    uint32_t key = orig_tuple->key;
+    if (prv_merge_find(new, key) != NULL) {
       // We already wrote this key, above.
       continue;
     }
     Tuple* dest = dest_iter->cursor;
-    result = dict_write_tuple(dest_iter, orig);
+    result = dict_write_tuple(dest_iter, orig_tuple);
     if (result != DICT_OK) return result;
-    update_key_callback(key, dest, orig, context);
+    update_key_callback(key, dest, orig_tuple, context);
   }
 
   return DICT_OK;
 }
 
 // Calculate the amount of space needed for a dest_iter which can fit the result
-// of merging orig_iter and new_iter. This logic should always mirror the logic
+// of merging orig and new. This logic should always mirror the logic
 // in dict_merge_to, except it should simply count the size, rather than
 // actually merging the results.
-static size_t dict_merge_to_size(DictionaryIterator* orig_iter,
-                                 DictionaryIterator* new_iter,
+static size_t dict_merge_to_size(const MergeDictionary *orig,
+                                 const MergeDictionary *new,
                                  const bool update_existing_keys_only) {
   size_t total_size_required = sizeof(Dictionary);
+  DictionaryIterator *orig_iter = orig->iter;
+  DictionaryIterator *new_iter = new->iter;
 
   // First, calculate the size of the new/updated keys.
-  for (Tuple* new = dict_read_first(new_iter); new; new = dict_read_next(new_iter)) {
-    if (dict_find(orig_iter, new->key) == NULL && update_existing_keys_only) continue;
-    total_size_required += sizeof(*new) + new->length;
+  for (Tuple* new_tuple = dict_read_first(new_iter); new_tuple;
+       new_tuple = dict_read_next(new_iter)) {
+    if (prv_merge_find(orig, new_tuple->key) == NULL && update_existing_keys_only) continue;
+    total_size_required += sizeof(*new_tuple) + new_tuple->length;
   }
 
   // Then, add in the size of the keys which have not changed.
-  for (Tuple* orig = dict_read_first(orig_iter); orig; orig = dict_read_next(orig_iter)) {
-    if (dict_find(new_iter, orig->key) != NULL) continue;
-    total_size_required += sizeof(*orig) + orig->length;
+  for (Tuple* orig_tuple = dict_read_first(orig_iter); orig_tuple;
+       orig_tuple = dict_read_next(orig_iter)) {
+    if (prv_merge_find(new, orig_tuple->key) != NULL) continue;
+    total_size_required += sizeof(*orig_tuple) + orig_tuple->length;
   }
 
   return total_size_required;
@@ -398,24 +480,57 @@ DictionaryResult dict_merge(DictionaryIterator* dest_iter,
     return DICT_INVALID_ARGS;
   }
 
-  size_t required_size = dict_merge_to_size(dest_iter, new_iter, update_existing_keys_only);
+  // Index both dictionaries so that finding the matching keys doesn't take a walk over the other
+  // dictionary for every tuple. The indexes are only an optimization, without them we fall back
+  // to dict_find().
+  const size_t orig_index_size = dict_index_size(dest_iter);
+  const size_t new_index_size = dict_index_size(new_iter);
+  uint8_t *index_buffer = task_malloc(orig_index_size + new_index_size);
+  MergeDictionary orig = { .iter = dest_iter };
+  MergeDictionary new = { .iter = new_iter };
+  if (index_buffer) {
+    orig.index = dict_index_build(dest_iter, index_buffer, orig_index_size);
+    new.index = dict_index_build(new_iter, index_buffer + orig_index_size, new_index_size);
+  }
+
+  uint8_t* orig_buffer = NULL;
+  DictionaryResult result;
+  size_t required_size = dict_merge_to_size(&orig, &new, update_existing_keys_only);
   if (*dest_buf_length_in_out < required_size) {
-    return DICT_NOT_ENOUGH_STORAGE;
+    result = DICT_NOT_ENOUGH_STORAGE;
+    goto cleanup;
   }
 
-  uint8_t* orig_buffer = dict_copy(dest_iter);
-  if (orig_buffer == NULL) return DICT_MALLOC_FAILED;
+  orig_buffer = dict_copy(dest_iter);
+  if (orig_buffer == NULL && index_buffer) {
+    // The merge can't do without the copy, so give it the memory of the indexes
+    task_free(index_buffer);
+    index_buffer = NULL;
+    orig.index = NULL;
+    new.index = NULL;
+    orig_buffer = dict_copy(dest_iter);
+  }
+  if (orig_buffer == NULL) {
+    result = DICT_MALLOC_FAILED;
+    goto cleanup;
+  }
 
   DictionaryIterator orig_iter;
-  DictionaryResult result = dict_init(&orig_iter, orig_buffer, dict_size(dest_iter));
+  result = dict_init(&orig_iter, orig_buffer, dict_size(dest_iter));
   if (result != DICT_OK) goto cleanup;
 
+  // The copy has the same layout, so the index of the original dictionary still applies to it
+  orig.iter = &orig_iter;
+  if (orig.index) {
+    orig.index->dictionary = orig_iter.dictionary;
+  }
+
   result = dict_write_begin(dest_iter,
                             (uint8_t*)dest_iter->dictionary,
                             (uint16_t)*dest_buf_length_in_out);
   if (result != DICT_OK) goto cleanup;
 
-  result = dict_merge_to(dest_iter, &orig_iter, new_iter,
+  result = dict_merge_to(dest_iter, &orig, &new,
                          update_existing_keys_only,
                          update_key_callback, context);
   if (result != DICT_OK) goto cleanup;
@@ -424,6 +539,7 @@ DictionaryResult dict_merge(DictionaryIterator* dest_iter,
 
 cleanup:
   task_free(orig_buffer);
+  task_free(index_buffer);
   return result;
 }
 
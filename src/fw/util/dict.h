@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 //! @file dict.h Generic key/value serializer and parser.
 
@@ -481,3 +482,36 @@ Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
 
 //!   @} // end addtogroup Dictionary
 //! @} // end addtogroup Foundation
+
+//! @internal
+//! Entry of a DictionaryIndex
+typedef struct {
+  uint32_t key;
+  //! Offset of the Tuple from the start of the Dictionary
+  uint16_t offset;
+} DictionaryIndexEntry;
+
+//! @internal
+//! The Tuples of a dictionary sorted by key, to find keys with a binary search instead of walking
+//! the whole dictionary. The index is only valid as long as the dictionary isn't modified.
+typedef struct {
+  const Dictionary *dictionary;
+  uint16_t num_entries;
+  DictionaryIndexEntry entries[];
+} DictionaryIndex;
+
+//! @internal
+//! @return The number of bytes needed for the index of the dictionary
+size_t dict_index_size(const DictionaryIterator *iter);
+
+//! @internal
+//! Builds the index of a dictionary in the given buffer.
+//! @param buffer Buffer for the index, must be aligned to 4 bytes
+//! @return The index, or NULL if it doesn't fit into buffer_size bytes
+DictionaryIndex *dict_index_build(const DictionaryIterator *iter, void *buffer,
+                                  size_t buffer_size);
+
+//! @internal
+//! Same as dict_find(), using an index of the dictionary.
+//! @return The first Tuple with the key, or NULL if there's none.
+Tuple *dict_index_find(const DictionaryIndex *index, const uint32_t key);
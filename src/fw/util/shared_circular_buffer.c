@@ -44,27 +44,46 @@ static uint32_t prv_get_data_length(const SharedCircularBuffer* buffer, SharedCi
 
 
 // -------------------------------------------------------------------------------------------------
-// Returns max amount of data available among all clients
-// On exit, *max_client will contain the client with the most amount of data available
-static uint32_t prv_get_max_data_length(const SharedCircularBuffer* buffer, SharedCircularBufferClient **max_client) {
-  ListNode *iter = buffer->clients;
-  if (!iter) {
-    *max_client = NULL;
-    return 0;
-  }
-
+// Rescans all clients for the one with the most amount of data available and caches it in
+// buffer->slowest_client. Only needed when the cached slowest client may have changed, which is when
+// it consumed data, was removed or was advanced.
+static void prv_update_slowest_client(SharedCircularBuffer* buffer) {
+  SharedCircularBufferClient *slowest = NULL;
   uint32_t max_data = 0;
-  uint32_t len;
+  ListNode *iter = buffer->clients;
   while (iter) {
-    len = prv_get_data_length(buffer, (SharedCircularBufferClient *)iter);
-    if (len >= max_data) {
-      *max_client = (SharedCircularBufferClient *)iter;
+    const uint32_t len = prv_get_data_length(buffer, (SharedCircularBufferClient *)iter);
+    if (!slowest || len > max_data) {
+      slowest = (SharedCircularBufferClient *)iter;
       max_data = len;
     }
-
     iter = iter->next;
   }
-  return max_data;
+  buffer->slowest_client = slowest;
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// Returns max amount of data available among all clients
+static uint32_t prv_get_max_data_length(const SharedCircularBuffer* buffer) {
+  if (!buffer->slowest_client) {
+    return 0;
+  }
+  return prv_get_data_length(buffer, buffer->slowest_client);
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// Advances the client's read index by length bytes, which must not exceed the data available
+static void prv_consume(SharedCircularBuffer* buffer, SharedCircularBufferClient *client,
+                        uint16_t length) {
+  if (!length) {
+    return;
+  }
+  client->read_index = (client->read_index + length) % buffer->buffer_size;
+  if (client == buffer->slowest_client) {
+    prv_update_slowest_client(buffer);
+  }
 }
 
 
@@ -74,6 +93,7 @@ void shared_circular_buffer_init(SharedCircularBuffer* buffer, uint8_t* storage,
   buffer->buffer_size = storage_size;
   buffer->clients = NULL;
   buffer->write_index = 0;
+  buffer->slowest_client = NULL;
 }
 
 
@@ -82,6 +102,10 @@ bool shared_circular_buffer_add_client(SharedCircularBuffer* buffer, SharedCircu
   PBL_ASSERTN(!list_contains(buffer->clients, &client->list_node));
   buffer->clients = list_prepend(buffer->clients, &client->list_node);
   client->read_index = buffer->write_index;
+  // A new client has no data available, so it can only be the slowest if it is the only one
+  if (!buffer->slowest_client) {
+    buffer->slowest_client = client;
+  }
   return true;
 }
 
@@ -90,6 +114,9 @@ bool shared_circular_buffer_add_client(SharedCircularBuffer* buffer, SharedCircu
 void shared_circular_buffer_remove_client(SharedCircularBuffer* buffer, SharedCircularBufferClient *client) {
   PBL_ASSERTN(list_contains(buffer->clients, &client->list_node));
   list_remove(&client->list_node, &buffer->clients, NULL);
+  if (client == buffer->slowest_client) {
+    prv_update_slowest_client(buffer);
+  }
 }
 
 
@@ -109,19 +136,17 @@ bool shared_circular_buffer_write(SharedCircularBuffer* buffer, const uint8_t* d
   }
 
   // Make sure there's room, deleting bytes from slackers if requested
-  SharedCircularBufferClient *slacker;
-  uint32_t max_data = prv_get_max_data_length(buffer, &slacker);
-  uint32_t avail_space = buffer->buffer_size - 1 - max_data;
+  uint32_t avail_space = buffer->buffer_size - 1 - prv_get_max_data_length(buffer);
   while (length > avail_space) {
     if (!advance_slackers) {
       return false;
     }
 
     // Delete data from the biggest slacker
-    slacker->read_index = buffer->write_index;
+    buffer->slowest_client->read_index = buffer->write_index;
+    prv_update_slowest_client(buffer);
 
-    max_data = prv_get_max_data_length(buffer, &slacker);
-    avail_space = buffer->buffer_size - max_data;
+    avail_space = buffer->buffer_size - 1 - prv_get_max_data_length(buffer);
   }
 
   const uint16_t remaining_length = buffer->buffer_size - buffer->write_index;
@@ -161,6 +186,26 @@ bool shared_circular_buffer_read(const SharedCircularBuffer* buffer,
 }
 
 
+// ---------------------------------------------------------------------------------------------
+uint16_t shared_circular_buffer_read_spans(const SharedCircularBuffer *buffer,
+                                           SharedCircularBufferClient *client, uint16_t length,
+                                           SharedCircularBufferSpan spans[2]) {
+  PBL_ASSERTN(list_contains(buffer->clients, &client->list_node));
+
+  length = MIN(length, prv_get_data_length(buffer, client));
+  const uint16_t first_length = MIN(length, buffer->buffer_size - client->read_index);
+  spans[0] = (SharedCircularBufferSpan) {
+    .data = &buffer->buffer[client->read_index],
+    .length = first_length,
+  };
+  spans[1] = (SharedCircularBufferSpan) {
+    .data = buffer->buffer,
+    .length = length - first_length,
+  };
+  return length;
+}
+
+
 // -------------------------------------------------------------------------------------------------
 bool shared_circular_buffer_consume(SharedCircularBuffer* buffer, SharedCircularBufferClient *client, uint16_t length) {
   PBL_ASSERTN(list_contains(buffer->clients, &client->list_node));
@@ -169,16 +214,14 @@ bool shared_circular_buffer_consume(SharedCircularBuffer* buffer, SharedCircular
     return false;
   }
 
-  client->read_index = (client->read_index + length) % buffer->buffer_size;
+  prv_consume(buffer, client, length);
   return true;
 }
 
 
 // -------------------------------------------------------------------------------------------------
 uint16_t shared_circular_buffer_get_write_space_remaining(const SharedCircularBuffer* buffer) {
-  SharedCircularBufferClient *slacker;
-  uint32_t max_data = prv_get_max_data_length(buffer, &slacker);
-  return  buffer->buffer_size - 1 - max_data;
+  return buffer->buffer_size - 1 - prv_get_max_data_length(buffer);
 }
 
 
@@ -194,21 +237,11 @@ uint16_t shared_circular_buffer_get_read_space_remaining(const SharedCircularBuf
 bool shared_circular_buffer_read_consume(SharedCircularBuffer *buffer, SharedCircularBufferClient *client,
                           uint16_t length, uint8_t *data, uint16_t *length_out) {
 
-  uint16_t data_length = prv_get_data_length(buffer, client);
-  uint16_t bytes_left = MIN(length, data_length);
-
-  *length_out = bytes_left;
-  while (bytes_left) {
-    uint16_t chunk;
-    const uint8_t *read_ptr;
-
-    shared_circular_buffer_read(buffer, client, bytes_left, &read_ptr, &chunk);
-    memcpy(data, read_ptr, chunk);
-    shared_circular_buffer_consume(buffer, client, chunk);
-
-    data += chunk;
-    bytes_left -= chunk;
-  }
+  SharedCircularBufferSpan spans[2];
+  *length_out = shared_circular_buffer_read_spans(buffer, client, length, spans);
+  memcpy(data, spans[0].data, spans[0].length);
+  memcpy(data + spans[0].length, spans[1].data, spans[1].length);
+  prv_consume(buffer, client, *length_out);
 
   return (*length_out == length);
 }
@@ -247,47 +280,62 @@ void subsampled_shared_circular_buffer_client_set_ratio(
   }
 }
 
+// -------------------------------------------------------------------------------------------------
+// Copies length bytes starting at offset within the concatenation of the two spans
+static void prv_copy_from_spans(const SharedCircularBufferSpan spans[2], uint16_t offset,
+                                uint16_t length, uint8_t *out) {
+  if (offset >= spans[0].length) {
+    memcpy(out, spans[1].data + (offset - spans[0].length), length);
+    return;
+  }
+  // The item may straddle the end of the buffer storage
+  const uint16_t first_length = MIN(length, spans[0].length - offset);
+  memcpy(out, spans[0].data + offset, first_length);
+  memcpy(out + first_length, spans[1].data, length - first_length);
+}
+
 // -------------------------------------------------------------------------------------------------
 size_t shared_circular_buffer_read_subsampled(
     SharedCircularBuffer* buffer,
     SubsampledSharedCircularBufferClient *client,
     size_t item_size, void *data, uint16_t num_items) {
-  uint16_t bytes_available = prv_get_data_length(
-      buffer, &client->buffer_client);
+  SharedCircularBufferClient *buffer_client = &client->buffer_client;
+  const uint16_t bytes_available = prv_get_data_length(buffer, buffer_client);
 
   // Optimized case when no subsampling
   if (client->numerator == client->denominator) {
     num_items = MIN(num_items, bytes_available / item_size);
     uint16_t bytes_out;
     shared_circular_buffer_read_consume(
-        buffer, &client->buffer_client, num_items * item_size,
+        buffer, buffer_client, num_items * item_size,
         (uint8_t *)data, &bytes_out);
     PBL_ASSERTN(bytes_out == num_items * item_size);
     return num_items;
   }
 
+  // Stride through the unread data in place, copying out only the items that are kept, and then
+  // consume everything that was walked over in one go.
+  SharedCircularBufferSpan spans[2];
+  const uint16_t bytes_walkable = shared_circular_buffer_read_spans(
+      buffer, buffer_client, bytes_available - (bytes_available % item_size), spans);
+
   // An interesting property of the subsampling algorithm used is that
   // the subsampling ratio does not need to be in reduced form. It will
   // give the exact same results if the numerator and denominator have a
   // common divisor.
-  char *out_buf = data;
+  uint8_t *out_buf = data;
   size_t items_read = 0;
-  while (items_read < num_items && bytes_available >= item_size) {
-    bytes_available -= item_size;
+  uint16_t offset = 0;
+  while (items_read < num_items && offset < bytes_walkable) {
     client->subsample_state += client->numerator;
     if (client->subsample_state >= client->denominator) {
       client->subsample_state %= client->denominator;
-      uint16_t bytes_out;
-      shared_circular_buffer_read_consume(buffer, &client->buffer_client,
-                                          item_size, (uint8_t *)out_buf,
-                                          &bytes_out);
-      PBL_ASSERTN(bytes_out == item_size);
+      prv_copy_from_spans(spans, offset, item_size, out_buf);
       out_buf += item_size;
       items_read++;
-    } else {
-      PBL_ASSERTN(shared_circular_buffer_consume(buffer, &client->buffer_client,
-                                                 item_size));
     }
+    offset += item_size;
   }
+  prv_consume(buffer, buffer_client, offset);
   return items_read;
 }
@@ -39,8 +39,17 @@ typedef struct SharedCircularBuffer {
   uint16_t buffer_size;
   uint16_t write_index;    //! where next byte will be written, (read_index == write_index) is an empty queue
   ListNode *clients;        //! linked list of clients
+  //! The client with the most unread data (the one that limits how much can be written), or NULL
+  //! if there are no clients. Kept up to date so that writes don't have to scan every client.
+  SharedCircularBufferClient *slowest_client;
 } SharedCircularBuffer;
 
+//! A contiguous run of unread bytes inside the buffer storage
+typedef struct SharedCircularBufferSpan {
+  const uint8_t *data;
+  uint16_t length;
+} SharedCircularBufferSpan;
+
 //! Init the buffer
 //! @param buffer The buffer to initialize
 //! @param storage storage for the data
@@ -88,6 +97,22 @@ void shared_circular_buffer_remove_client(SharedCircularBuffer* buffer, SharedCi
 bool shared_circular_buffer_read(const SharedCircularBuffer* buffer, SharedCircularBufferClient *client,
         uint16_t length, const uint8_t** data_out, uint16_t* length_out);
 
+//! Vectored version of shared_circular_buffer_read. Returns up to length bytes of unread data as
+//! at most two contiguous spans pointing directly into the buffer storage, so no copy is needed
+//! even when the data wraps around the end of the buffer. The second span has a length of 0 unless
+//! the data wraps. The data remains on the buffer until shared_circular_buffer_consume is called,
+//! which can be done once for the total length returned.
+//!
+//! @param buffer The buffer to read from
+//! @param client pointer to the client struct originally passed to circular_buffer_add_client
+//! @param length The maximum number of bytes to return
+//! @param[out] spans The spans holding the data
+//! @return The total number of bytes in both spans, which is less than length if less data is
+//!   available.
+uint16_t shared_circular_buffer_read_spans(const SharedCircularBuffer *buffer,
+                                           SharedCircularBufferClient *client, uint16_t length,
+                                           SharedCircularBufferSpan spans[2]);
+
 //! Removes length bytes of the oldest data from the buffer.
 //! @param buffer The buffer to operate on
 //! @param client Pointer to a client structure originally passed to circular_buffer_add_client
@@ -16,10 +16,10 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
-#include "util/list.h"
-
 //! @file cron.h
 //! Wall-clock based timer system. Designed for use in things such as alarms, calendar events, etc.
 //! Properly handles DST, etc.
@@ -48,7 +48,12 @@ typedef void (*CronJobCallback)(CronJob *job, void* data);
 
 struct CronJob {
   //! internal, no touchy
-  ListNode list_node;
+  //! Position of the job in the cron service's schedule heap.
+  uint16_t heap_index;
+  //! internal, no touchy
+  //! Order in which the job was scheduled, used to run jobs with the same execution time in the
+  //! order they were scheduled.
+  uint32_t schedule_seq;
 
   //! Cached execution timestamp in UTC.
   //! This is set by `cron_job_schedule`, and is required to never be changed once the job has been
@@ -233,6 +233,12 @@ void heap_set_corruption_handler(Heap *heap, CorruptionHandler corruption_handle
   heap->corruption_handler = corruption_handler;
 }
 
+#ifdef MALLOC_TRACE
+void heap_set_trace_handler(Heap *heap, HeapTraceHandler trace_handler) {
+  heap->trace_handler = trace_handler;
+}
+#endif
+
 void *heap_malloc(Heap* const heap, unsigned long nbytes, uintptr_t client_pc) {
   // Check to make sure the heap we have is initialized.
   UTIL_ASSERT(heap->begin);
@@ -268,6 +274,13 @@ void *heap_malloc(Heap* const heap, unsigned long nbytes, uintptr_t client_pc) {
         heap->high_water_mark = heap->current_size;
       }
     }
+
+#ifdef MALLOC_TRACE
+    if (heap->trace_handler) {
+      heap->trace_handler(heap, HeapTraceOp_Malloc,
+                          allocated_block ? &allocated_block->Data : NULL, nbytes, client_pc);
+    }
+#endif
   }
   heap_unlock(heap);
 
@@ -311,6 +324,14 @@ void heap_free(Heap* const heap, void *ptr, uintptr_t client_pc) {
     /* This will make calculations in this block easier.        */
     heap_info_ptr->is_allocated = false;
 
+#ifdef MALLOC_TRACE
+    if (heap->trace_handler) {
+      heap->trace_handler(heap, HeapTraceOp_Free, ptr,
+                          (heap_info_ptr->Size - HEAP_INFO_BLOCK_SIZE(0)) * ALIGNMENT_SIZE,
+                          client_pc);
+    }
+#endif
+
 #ifndef RELEASE
     if (heap->fuzz_on_free) {
       memset(ptr, 0xBD,
@@ -408,6 +429,19 @@ bool heap_is_allocated(Heap* const heap, void* ptr) {
   return rc;
 }
 
+void heap_for_each_block(Heap *heap, HeapBlockCallback cb, void *context) {
+  heap_lock(heap);
+  HeapInfo_t *heap_info_ptr = heap->begin;
+  while (heap_info_ptr < heap->end) {
+    if (!cb(&heap_info_ptr->Data, heap_info_ptr->Size * ALIGNMENT_SIZE,
+            heap_info_ptr->is_allocated, context)) {
+      break;
+    }
+    heap_info_ptr = get_next_block(heap, heap_info_ptr);
+  }
+  heap_unlock(heap);
+}
+
 bool heap_contains_address(Heap* const heap, void* ptr) {
   return (ptr >= (void*) heap->begin && ptr < (void*) heap->end);
 }
@@ -530,7 +564,7 @@ static HeapInfo_t *allocate_block(Heap* const heap, unsigned long n_units, HeapI
 
 // A very naive realloc implementation
 void* heap_realloc(Heap* const heap, void *ptr, unsigned long nbytes, uintptr_t client_pc) {
-#if !defined(MALLOC_INSTRUMENTATION)
+#if !defined(MALLOC_INSTRUMENTATION) && !defined(MALLOC_TRACE)
   client_pc = 0;
 #endif
   // Get a pointer to the Heap Info.
@@ -35,6 +35,22 @@ typedef struct HeapLockImpl {
 typedef void (*DoubleFreeHandler)(void*);
 typedef void (*CorruptionHandler)(void*);
 
+#ifdef MALLOC_TRACE
+struct Heap;
+
+typedef enum {
+  HeapTraceOp_Malloc,
+  HeapTraceOp_Free,
+} HeapTraceOp;
+
+//! Gets called for every malloc and free on the heap, with the heap locked. Must not use the heap.
+//! @param ptr The allocated or freed buffer, NULL if a malloc failed
+//! @param nbytes The requested size for a malloc, the usable size of the block for a free
+//! @param client_pc The PC register of the client who caused this malloc or free
+typedef void (*HeapTraceHandler)(struct Heap *heap, HeapTraceOp op, void *ptr, size_t nbytes,
+                                 uintptr_t client_pc);
+#endif
+
 typedef struct Heap {
   // These HeapInfo_t structure pointers are initialized to the start and the end of the heap area.
   // The begin will point to the first block that's in the heap area, where the end is actually a
@@ -55,6 +71,10 @@ typedef struct Heap {
 
   void *corrupt_block;
   CorruptionHandler corruption_handler;
+
+#ifdef MALLOC_TRACE
+  HeapTraceHandler trace_handler;
+#endif
 } Heap;
 
 //! Initialize the heap inside the specified boundaries, zero-ing out the free
@@ -78,6 +98,12 @@ void heap_set_double_free_handler(Heap *heap, DoubleFreeHandler double_free_hand
 //! If this isn't configured on a heap, the default behaviour is to trigger a PBL_CROAK.
 void heap_set_corruption_handler(Heap *heap, CorruptionHandler corruption_handler);
 
+#ifdef MALLOC_TRACE
+//! Configure the heap with a pointer that gets called for every malloc and free, used to record
+//! allocation traces that can be replayed on the host with tools/heap_trace.py.
+void heap_set_trace_handler(Heap *heap, HeapTraceHandler trace_handler);
+#endif
+
 //! Allocate a fragment of memory on the given heap. Tries to avoid
 //! fragmentation by obtaining memory requests larger than LARGE_SIZE from the
 //! endo of the buffer, while small fragments are taken from the start of the
@@ -136,4 +162,14 @@ uint32_t heap_get_minimum_headroom(Heap *heap);
 //!         fragment.
 void heap_calc_totals(Heap* const heap, unsigned int *used, unsigned int *free, unsigned int *max_free);
 
+//! Callback for heap_for_each_block()
+//! @param data The buffer of the block, as returned by heap_malloc() if the block is allocated
+//! @param block_size Size of the block in bytes, including its header
+//! @return false to stop iterating
+typedef bool (*HeapBlockCallback)(void *data, size_t block_size, bool is_allocated,
+                                  void *context);
+
+//! Walks all the blocks of the heap in address order, with the heap locked.
+void heap_for_each_block(Heap *heap, HeapBlockCallback cb, void *context);
+
 void heap_dump_malloc_instrumentation_to_dbgserial(Heap *heap);
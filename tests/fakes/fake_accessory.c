@@ -23,11 +23,24 @@
 #include <string.h>
 
 #define BUFFER_LENGTH 200
+#define RX_DMA_BUFFER_LENGTH 200
 
 static uint8_t s_buffer[BUFFER_LENGTH];
 static int s_buffer_index = 0;
 static bool s_did_send_byte = false;
 
+typedef struct {
+  uint8_t buffer[RX_DMA_BUFFER_LENGTH];
+  bool enabled;
+  //! Total number of bytes written by the "DMA" and consumed by the reader
+  uint32_t num_written;
+  uint32_t num_consumed;
+  uint32_t num_interrupts;
+  //! Set when a receive error was reported for the data in the buffer
+  bool has_error;
+} FakeRxDma;
+static FakeRxDma s_rx_dma;
+
 void accessory_disable_input(void) {
 }
 
@@ -37,6 +50,34 @@ void accessory_enable_input(void) {
 void accessory_use_dma(bool use_dma) {
 }
 
+void accessory_use_dma_bulk_rx(bool use_dma) {
+  s_rx_dma.enabled = use_dma;
+}
+
+size_t accessory_get_rx_data(const uint8_t **data, bool *has_error) {
+  *has_error = false;
+  if (!s_rx_dma.enabled) {
+    return 0;
+  }
+  if (s_rx_dma.has_error || (s_rx_dma.num_written - s_rx_dma.num_consumed > RX_DMA_BUFFER_LENGTH)) {
+    // the data was corrupted or the DMA lapped the reader, so drop everything
+    s_rx_dma.has_error = false;
+    s_rx_dma.num_consumed = s_rx_dma.num_written;
+    *has_error = true;
+    return 0;
+  }
+  const uint32_t index = s_rx_dma.num_consumed % RX_DMA_BUFFER_LENGTH;
+  const uint32_t pending = s_rx_dma.num_written - s_rx_dma.num_consumed;
+  const uint32_t until_wrap = RX_DMA_BUFFER_LENGTH - index;
+  *data = &s_rx_dma.buffer[index];
+  return (pending < until_wrap) ? pending : until_wrap;
+}
+
+void accessory_consume_rx_data(size_t length) {
+  cl_assert(length <= s_rx_dma.num_written - s_rx_dma.num_consumed);
+  s_rx_dma.num_consumed += length;
+}
+
 void accessory_send_byte(uint8_t data) {
   cl_assert(s_buffer_index < BUFFER_LENGTH);
   s_buffer[s_buffer_index++] = data;
@@ -55,3 +96,38 @@ void fake_accessory_get_buffer(uint8_t **buffer, int *length) {
   *buffer = s_buffer;
   *length = s_buffer_index;
 }
+
+void fake_accessory_rx_dma_reset(void) {
+  s_rx_dma = (FakeRxDma) {};
+}
+
+static void prv_rx_dma_interrupt(void) {
+  s_rx_dma.num_interrupts++;
+  smartstrap_handle_rx_data_from_isr();
+}
+
+static void prv_rx_dma_receive(const uint8_t *data, size_t length, bool has_error) {
+  for (size_t i = 0; i < length; i++) {
+    s_rx_dma.buffer[s_rx_dma.num_written % RX_DMA_BUFFER_LENGTH] = data[i];
+    s_rx_dma.num_written++;
+    if ((s_rx_dma.num_written % (RX_DMA_BUFFER_LENGTH / 2)) == 0) {
+      // half / complete transfer interrupt
+      prv_rx_dma_interrupt();
+    }
+  }
+  s_rx_dma.has_error |= has_error;
+  // idle line interrupt
+  prv_rx_dma_interrupt();
+}
+
+void fake_accessory_rx_dma_receive(const uint8_t *data, size_t length) {
+  prv_rx_dma_receive(data, length, false /* has_error */);
+}
+
+void fake_accessory_rx_dma_receive_with_error(const uint8_t *data, size_t length) {
+  prv_rx_dma_receive(data, length, true /* has_error */);
+}
+
+uint32_t fake_accessory_rx_dma_get_num_interrupts(void) {
+  return s_rx_dma.num_interrupts;
+}
@@ -17,12 +17,17 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 void accessory_enable_input(void);
 void accessory_disable_input(void);
 
 void accessory_use_dma(bool use_dma);
+void accessory_use_dma_bulk_rx(bool use_dma);
+
+size_t accessory_get_rx_data(const uint8_t **data, bool *has_error);
+void accessory_consume_rx_data(size_t length);
 
 void accessory_send_byte(uint8_t data);
 
@@ -30,3 +35,17 @@ typedef bool (*AccessoryDataStreamCallback)(void *context);
 void accessory_send_stream(AccessoryDataStreamCallback callback, void *context);
 
 void fake_accessory_get_buffer(uint8_t **buffer, int *length);
+
+//! Resets the fake RX DMA buffer
+void fake_accessory_rx_dma_reset(void);
+
+//! Writes data into the fake RX DMA buffer the way the UART's DMA would, notifying the smartstrap
+//! code every time half of the buffer is filled and once the line goes idle at the end. If the
+//! reader falls more than a buffer behind, it gets an overrun error.
+void fake_accessory_rx_dma_receive(const uint8_t *data, size_t length);
+
+//! Like fake_accessory_rx_dma_receive(), but the UART reports a framing error along with the data
+void fake_accessory_rx_dma_receive_with_error(const uint8_t *data, size_t length);
+
+//! Returns the number of times the smartstrap code was notified of received data
+uint32_t fake_accessory_rx_dma_get_num_interrupts(void);
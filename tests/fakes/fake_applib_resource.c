@@ -37,6 +37,11 @@ void applib_resource_munmap_or_free(void *bytes) {
   free(bytes);
 }
 
+void *applib_resource_mmap(ResAppNum app_num, uint32_t resource_id,
+                           size_t offset, size_t num_bytes) {
+  return NULL;
+}
+
 void *applib_resource_mmap_or_load(ResAppNum app_num, uint32_t resource_id,
                                    size_t offset, size_t num_bytes, bool used_aligned) {
   uint8_t *result = malloc(num_bytes + (used_aligned ? 7 : 0));
@@ -16,6 +16,8 @@
 
 #include "fake_resource_syscalls.h"
 
+#include <stdlib.h>
+
 #define PATH_STRING_LENGTH 512
 
 #define MAX_OPEN_FILES 512
@@ -24,6 +26,13 @@ static FILE* resource_files[MAX_OPEN_FILES] = {NULL};
 static const uint32_t resource_start_index = 1; // must start at 1 so font resources work
 static uint32_t resource_index = resource_start_index;
 
+// Whole files read into RAM to stand in for resources on memory-mappable flash
+static bool s_mappable;
+static uint8_t *s_mapped_data[MAX_OPEN_FILES];
+static size_t s_mapped_size[MAX_OPEN_FILES];
+
+static size_t s_num_bytes_loaded;
+
 ResAppNum sys_get_current_resource_num(void) {
   return 0;
 }
@@ -61,24 +70,60 @@ size_t sys_resource_load_range(ResAppNum app_num, uint32_t id, uint32_t start_by
   if (buffer && id < UINT32_MAX) {
     FILE* resource_file = resource_files[id];
     fseek(resource_file, start_bytes, SEEK_SET);
-    return fread(buffer, 1, num_bytes, resource_file); 
+    const size_t bytes_read = fread(buffer, 1, num_bytes, resource_file);
+    s_num_bytes_loaded += bytes_read;
+    return bytes_read;
   }
   return 0;
 }
 
 bool sys_resource_bytes_are_readonly(void *bytes) {
+  for (int i = resource_start_index; i < MAX_OPEN_FILES; i++) {
+    if (s_mapped_data[i] && ((uint8_t *)bytes >= s_mapped_data[i]) &&
+        ((uint8_t *)bytes < s_mapped_data[i] + s_mapped_size[i])) {
+      return true;
+    }
+  }
   return false;
 }
 
 const uint8_t *sys_resource_read_only_bytes(ResAppNum app_num, uint32_t resource_id,
                                             size_t *num_bytes_out) {
-  return NULL;
+  if (!s_mappable || resource_id >= MAX_OPEN_FILES || !resource_files[resource_id]) {
+    return NULL;
+  }
+  if (!s_mapped_data[resource_id]) {
+    FILE *resource_file = resource_files[resource_id];
+    fseek(resource_file, 0, SEEK_END);
+    const size_t resource_size = ftell(resource_file);
+    fseek(resource_file, 0, SEEK_SET);
+    uint8_t *data = malloc(resource_size);
+    if (fread(data, 1, resource_size, resource_file) != resource_size) {
+      free(data);
+      return NULL;
+    }
+    s_mapped_data[resource_id] = data;
+    s_mapped_size[resource_id] = resource_size;
+  }
+  if (num_bytes_out) {
+    *num_bytes_out = s_mapped_size[resource_id];
+  }
+  return s_mapped_data[resource_id];
 }
 
 uint32_t sys_resource_get_and_cache(ResAppNum app_num, uint32_t resource_id) {
   return resource_id;
 }
 
+uint8_t *sys_bitmap_cache_load(ResAppNum app_num, uint32_t resource_id, size_t *size_out) {
+  return NULL;
+}
+
+void sys_bitmap_cache_store(ResAppNum app_num, uint32_t resource_id, const uint8_t *pbi_data,
+                            size_t pbi_data_size) {
+  return;
+}
+
 bool sys_resource_is_valid(ResAppNum app_num, uint32_t resource_id) {
   return true;
 }
@@ -90,7 +135,20 @@ void fake_resource_syscalls_cleanup(void) {
       fclose(resource_file);
       resource_files[i] = NULL;
     }
+    free(s_mapped_data[i]);
+    s_mapped_data[i] = NULL;
+    s_mapped_size[i] = 0;
   }
 
   resource_index = resource_start_index;
+  s_mappable = false;
+  s_num_bytes_loaded = 0;
+}
+
+void fake_resource_syscalls_set_mappable(bool mappable) {
+  s_mappable = mappable;
+}
+
+size_t fake_resource_syscalls_get_num_bytes_loaded(void) {
+  return s_num_bytes_loaded;
 }
@@ -39,3 +39,10 @@ uint32_t sys_resource_get_and_cache(ResAppNum app_num, uint32_t resource_id);
 bool sys_resource_is_valid(ResAppNum app_num, uint32_t resource_id);
 
 void fake_resource_syscalls_cleanup(void);
+
+//! Makes sys_resource_read_only_bytes() return the contents of the loaded files, like for
+//! resources living on memory-mappable flash
+void fake_resource_syscalls_set_mappable(bool mappable);
+
+//! The number of bytes copied out of resources by sys_resource_load_range()
+size_t fake_resource_syscalls_get_num_bytes_loaded(void);
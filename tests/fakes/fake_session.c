@@ -22,6 +22,7 @@
 #include "system/logging.h"
 #include "services/common/comm_session/protocol.h"
 #include "services/common/comm_session/session_send_buffer.h"
+#include "services/common/comm_session/session_send_queue.h"
 #include "services/common/system_task.h"
 #include "util/circular_buffer.h"
 #include "system/hexdump.h"
@@ -29,6 +30,7 @@
 #include "clar_asserts.h"
 
 #include "util/list.h"
+#include "util/net.h"
 
 #include <string.h>
 
@@ -46,6 +48,8 @@ typedef struct CommSession {
   uint16_t max_out_payload_length;
   CircularBuffer send_buffer;
   uint8_t storage[1024];
+  //! Jobs added with comm_session_send_queue_add_job() that haven't been moved into send_buffer
+  SessionSendQueueJob *send_jobs;
 } CommSession;
 
 static CommSession *s_session_head;
@@ -103,6 +107,11 @@ void comm_session_close(CommSession *session, CommSessionCloseReason reason) {
     kernel_free(session->temp_write_buffer);
   }
   list_remove(&session->node, (ListNode **) &s_session_head, NULL);
+  while (session->send_jobs) {
+    SessionSendQueueJob *job = session->send_jobs;
+    list_remove(&job->node, (ListNode **) &session->send_jobs, NULL);
+    job->impl->free(job);
+  }
   kernel_free(session);
   ++s_session_close_call_count;
 }
@@ -163,6 +172,34 @@ void comm_session_send_queue_consume(CommSession *session, size_t length) {
   circular_buffer_consume(&session->send_buffer, length);
 }
 
+//! Moves the messages of the queued up jobs into the send buffer, for as long as they fit.
+//! @note The fake expects each job to contain exactly one Pebble Protocol message.
+static void prv_flush_send_jobs(CommSession *session) {
+  while (session->send_jobs) {
+    SessionSendQueueJob *job = session->send_jobs;
+    const size_t length = job->impl->get_length(job);
+    if (length > circular_buffer_get_write_space_remaining(&session->send_buffer)) {
+      return;
+    }
+    uint8_t *buffer = kernel_malloc(length);
+    cl_assert_equal_i(job->impl->copy(job, 0, length, buffer), length);
+    job->impl->consume(job, length);
+
+    // The fake transport expects the header in host byte order:
+    PebbleProtocolHeader *pp_header = (PebbleProtocolHeader *) buffer;
+    cl_assert_equal_i(ntohs(pp_header->length) + sizeof(*pp_header), length);
+    *pp_header = (PebbleProtocolHeader) {
+      .length = ntohs(pp_header->length),
+      .endpoint_id = ntohs(pp_header->endpoint_id),
+    };
+    circular_buffer_write(&session->send_buffer, buffer, length);
+    kernel_free(buffer);
+
+    list_remove(&job->node, (ListNode **) &session->send_jobs, NULL);
+    job->impl->free(job);
+  }
+}
+
 static void prv_send_next_kernel_bg_cb(void *data) {
   CommSession *session = (CommSession *) data;
   if (!list_contains((const ListNode *) s_session_head, (const ListNode *) session)) {
@@ -172,11 +209,29 @@ static void prv_send_next_kernel_bg_cb(void *data) {
   // Flip the flag before the send_next callback, so it can schedule again if needed.
   session->is_send_next_call_pending = false;
 
-  // Kick the transport to send out the next bytes from the send buffer
-  const size_t read_space = comm_session_send_queue_get_length(session);
-  if (read_space) {
+  // Kick the transport to send out the next bytes from the send buffer, until the queued up jobs
+  // have been sent out as well
+  do {
+    prv_flush_send_jobs(session);
+    const size_t read_space = comm_session_send_queue_get_length(session);
+    if (!read_space) {
+      break;
+    }
     session->transport_imp->send_next(session->transport);
+  } while (session->send_jobs);
+}
+
+void comm_session_send_queue_add_job(CommSession *session, SessionSendQueueJob **job_ptr) {
+  SessionSendQueueJob *job = *job_ptr;
+  if (!comm_session_is_valid(session)) {
+    job->impl->free(job);
+    *job_ptr = NULL;
+    return;
   }
+  list_init(&job->node);
+  session->send_jobs = (SessionSendQueueJob *)
+      list_get_head(list_append((ListNode *) session->send_jobs, &job->node));
+  comm_session_send_next(session);
 }
 
 void comm_session_send_next(CommSession *session) {
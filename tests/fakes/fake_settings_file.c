@@ -30,6 +30,7 @@ struct {
   uint32_t val_lens[UINT8_MAX];
   uint32_t key_lens[UINT8_MAX];
   bool dirty[UINT8_MAX];
+  uint32_t num_opens;
 } s_settings_file;
 
 void fake_settings_file_reset(void) {
@@ -112,10 +113,15 @@ status_t settings_file_open(SettingsFile *file, const char *name,
   } else {
     *file = (SettingsFile){};
     s_settings_file.open = true;
+    s_settings_file.num_opens++;
     return S_SUCCESS;
   }
 }
 
+uint32_t fake_settings_file_get_num_opens(void) {
+  return s_settings_file.num_opens;
+}
+
 void settings_file_close(SettingsFile *file) {
   cl_assert(s_settings_file.open);
   s_settings_file.open = false;
@@ -136,6 +142,16 @@ status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t k
   return E_DOES_NOT_EXIST;
 }
 
+int settings_file_get_num_dirty(SettingsFile *file) {
+  int num_dirty = 0;
+  for (unsigned i = 0; i < UINT8_MAX; ++i) {
+    if (s_settings_file.values[i] != NULL && s_settings_file.dirty[i]) {
+      num_dirty++;
+    }
+  }
+  return num_dirty;
+}
+
 status_t settings_file_set_byte(SettingsFile *file, const void *key, size_t key_len, size_t offset,
                                 uint8_t byte) {
   if (settings_file_exists(file, key, key_len)) {
@@ -16,4 +16,9 @@
 
 #pragma once
 
+#include <stdint.h>
+
 void fake_settings_file_reset(void);
+
+//! @return the number of times a settings file has been opened, which never gets reset
+uint32_t fake_settings_file_get_num_opens(void);
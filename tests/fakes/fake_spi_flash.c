@@ -36,8 +36,22 @@ typedef struct FakeFlashState {
   uint8_t* storage; //! Allocated buffer of length bytes.
   uint32_t write_count;
   uint32_t erase_count;
+  uint32_t read_count;
+  uint64_t bytes_written;
+  uint64_t bytes_read;
+  uint64_t busy_time_ns;
+  uint32_t *subsector_erase_counts; //! Allocated array, one count per subsector.
 } FakeFlashState;
 
+// Rough model of how long the flash part is busy, based on the typical timings in the datasheets
+// of the serial NOR parts on the watches. Only meant to compare workloads against each other.
+#define READ_COMMAND_NS (2000)
+#define TRANSFER_NS_PER_BYTE (125)
+#define PAGE_SIZE_BYTES (256)
+#define PAGE_PROGRAM_NS (500 * 1000)
+#define SUBSECTOR_ERASE_NS (40 * 1000 * 1000)
+#define SECTOR_ERASE_NS (400 * 1000 * 1000)
+
 static FakeFlashState s_state = { 0 };
 
 void fake_spi_flash_erase(void) {
@@ -47,6 +61,8 @@ void fake_spi_flash_erase(void) {
 void fake_spi_flash_cleanup(void) {
   free(s_state.storage);
   s_state.storage = NULL;
+  free(s_state.subsector_erase_counts);
+  s_state.subsector_erase_counts = NULL;
   s_state = (FakeFlashState) { 0 };
 }
 
@@ -60,8 +76,11 @@ void fake_spi_flash_init(uint32_t offset, uint32_t length) {
   s_state.length = length;
   s_state.storage = malloc(length);
   s_state.write_count = 0;
+  s_state.subsector_erase_counts =
+      calloc((length + SUBSECTOR_SIZE_BYTES - 1) / SUBSECTOR_SIZE_BYTES, sizeof(uint32_t));
   // Note: this is a harness failure, not a code failure.
   cl_assert(s_state.storage != NULL);
+  cl_assert(s_state.subsector_erase_counts != NULL);
   memset(s_state.storage, 0xff, length);
 }
 
@@ -117,6 +136,10 @@ void flash_read_bytes(uint8_t* buffer, uint32_t start_addr, uint32_t buffer_size
   cl_assert(start_addr >= s_state.offset);
   cl_assert(start_addr + buffer_size <= s_state.offset + s_state.length);
 
+  ++s_state.read_count;
+  s_state.bytes_read += buffer_size;
+  s_state.busy_time_ns += READ_COMMAND_NS + (uint64_t)buffer_size * TRANSFER_NS_PER_BYTE;
+
   memcpy(buffer, s_state.storage + (start_addr - s_state.offset), buffer_size);
 }
 
@@ -125,6 +148,14 @@ void flash_write_bytes(const uint8_t* buffer, uint32_t start_addr, uint32_t buff
   cl_assert(start_addr + buffer_size <= s_state.offset + s_state.length);
 
   ++s_state.write_count;
+  s_state.bytes_written += buffer_size;
+  if (buffer_size) {
+    // Every page that the write touches needs its own program cycle
+    const uint32_t num_pages = ((start_addr + buffer_size - 1) / PAGE_SIZE_BYTES) -
+                               (start_addr / PAGE_SIZE_BYTES) + 1;
+    s_state.busy_time_ns += (uint64_t)num_pages * PAGE_PROGRAM_NS +
+                            (uint64_t)buffer_size * TRANSFER_NS_PER_BYTE;
+  }
 
   for (int i = 0; i < buffer_size; ++i) {
     if (s_state.jmp_on_failure != NULL) {
@@ -156,6 +187,13 @@ static void erase_block(uint32_t block_addr, uint32_t block_size) {
   cl_assert(block_start + block_size <= s_state.offset + s_state.length);
 
   memset(&s_state.storage[block_start - s_state.offset], 0xff, block_size);
+
+  s_state.busy_time_ns += (block_size > SUBSECTOR_SIZE_BYTES) ? SECTOR_ERASE_NS :
+                                                                SUBSECTOR_ERASE_NS;
+  for (uint32_t addr = block_start; addr < block_start + block_size;
+       addr += SUBSECTOR_SIZE_BYTES) {
+    ++s_state.subsector_erase_counts[(addr - s_state.offset) / SUBSECTOR_SIZE_BYTES];
+  }
 }
 
 void flash_erase_sector_blocking(uint32_t sector_addr) {
@@ -193,3 +231,36 @@ uint32_t fake_flash_write_count(void) {
 uint32_t fake_flash_erase_count(void) {
   return s_state.erase_count;
 }
+
+uint32_t fake_flash_read_count(void) {
+  return s_state.read_count;
+}
+
+uint64_t fake_flash_bytes_written(void) {
+  return s_state.bytes_written;
+}
+
+uint64_t fake_flash_bytes_read(void) {
+  return s_state.bytes_read;
+}
+
+uint64_t fake_flash_busy_time_us(void) {
+  return s_state.busy_time_ns / 1000;
+}
+
+uint32_t fake_flash_subsector_erase_count(uint32_t addr) {
+  cl_assert(addr >= s_state.offset);
+  cl_assert(addr < s_state.offset + s_state.length);
+  return s_state.subsector_erase_counts[(addr - s_state.offset) / SUBSECTOR_SIZE_BYTES];
+}
+
+void fake_flash_reset_stats(void) {
+  s_state.write_count = 0;
+  s_state.erase_count = 0;
+  s_state.read_count = 0;
+  s_state.bytes_written = 0;
+  s_state.bytes_read = 0;
+  s_state.busy_time_ns = 0;
+  memset(s_state.subsector_erase_counts, 0,
+         ((s_state.length + SUBSECTOR_SIZE_BYTES - 1) / SUBSECTOR_SIZE_BYTES) * sizeof(uint32_t));
+}
@@ -45,3 +45,17 @@ void fake_flash_assert_region_untouched(uint32_t start_addr, uint32_t length);
 
 uint32_t fake_flash_write_count(void);
 uint32_t fake_flash_erase_count(void);
+uint32_t fake_flash_read_count(void);
+
+uint64_t fake_flash_bytes_written(void);
+uint64_t fake_flash_bytes_read(void);
+
+//! Modeled time the flash part would have been busy with all the reads, page programs and erases
+//! so far, using typical datasheet timings. Good for comparing workloads, not for absolute numbers.
+uint64_t fake_flash_busy_time_us(void);
+
+//! @return How many times the subsector containing addr has been erased, to look at wear leveling
+uint32_t fake_flash_subsector_erase_count(uint32_t addr);
+
+//! Zeroes all of the counters above, without touching the contents of the flash
+void fake_flash_reset_stats(void);
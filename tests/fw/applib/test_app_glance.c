@@ -78,6 +78,7 @@ void sys_timeline_resources_get_id(const TimelineResourceInfo *timeline_res,
 #include "stubs_i18n.h"
 #include "stubs_logging.h"
 #include "stubs_mutex.h"
+#include "stubs_new_timer.h"
 #include "stubs_passert.h"
 #include "stubs_pbl_malloc.h"
 
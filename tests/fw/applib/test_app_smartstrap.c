@@ -30,6 +30,7 @@
 #include "stubs_passert.h"
 #include "stubs_pbl_malloc.h"
 #include "stubs_serial.h"
+#include "stubs_syscall_internal.h"
 
 #define NON_NULL_MBUF ((MBuf *)1)
 #define assert_result_ok(result) cl_assert(result == SmartstrapResultOk)
@@ -255,6 +256,54 @@ void test_app_smartstrap__read(void) {
   app_smartstrap_attribute_destroy(attr);
 }
 
+void test_app_smartstrap__priority(void) {
+  // create the attributes, with the last one having the highest priority
+  SmartstrapAttribute *attr_low = app_smartstrap_attribute_create(0x1111, 0x2222, 100);
+  SmartstrapAttribute *attr_normal = app_smartstrap_attribute_create(0x1111, 0x3333, 100);
+  SmartstrapAttribute *attr_high = app_smartstrap_attribute_create(0x1111, 0x4444, 100);
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  cl_assert(sys_smartstrap_attribute_set_priority(attr_low, SmartstrapAttributePriorityLow));
+  cl_assert(sys_smartstrap_attribute_set_priority(attr_high, SmartstrapAttributePriorityHigh));
+
+  // start a read request on each of them, in order of increasing priority
+  assert_result_ok(app_smartstrap_attribute_read(attr_low));
+  assert_result_ok(app_smartstrap_attribute_read(attr_normal));
+  assert_result_ok(app_smartstrap_attribute_read(attr_high));
+
+  // the requests should be sent in order of decreasing priority
+  SmartstrapAttribute *attrs[] = { attr_high, attr_normal, attr_low };
+  const uint16_t attribute_ids[] = { 0x4444, 0x3333, 0x2222 };
+  for (int i = 0; i < 3; i++) {
+    stub_pebble_tasks_set_current(PebbleTask_KernelBackground);
+    prv_prepare_for_did_write(attrs[i]);
+    cl_assert(smartstrap_attribute_send_pending());
+    cl_assert(!s_pending_did_write.active);
+    SmartstrapRequest request = {
+      .service_id = 0x1111,
+      .attribute_id = attribute_ids[i],
+      .write_mbuf = NULL,
+      .read_mbuf = NON_NULL_MBUF,
+      .timeout_ms = SMARTSTRAP_TIMEOUT_DEFAULT
+    };
+    fake_smartstrap_profiles_check_request_params(&request);
+
+    // nothing else is sent until the response is received
+    cl_assert(!smartstrap_attribute_send_pending());
+    prv_prepare_for_did_read(attrs[i], 10);
+    smartstrap_attribute_send_event(SmartstrapDataReceivedEvent, SmartstrapProfileGenericService,
+                                    SmartstrapResultOk, 0x1111, attribute_ids[i], 10);
+    cl_assert(!s_pending_did_read.active);
+  }
+  cl_assert(!smartstrap_attribute_send_pending());
+
+  // destroy the attributes and check that the priority can't be set on them anymore
+  app_smartstrap_attribute_destroy(attr_low);
+  app_smartstrap_attribute_destroy(attr_normal);
+  app_smartstrap_attribute_destroy(attr_high);
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  cl_assert(!sys_smartstrap_attribute_set_priority(attr_high, SmartstrapAttributePriorityLow));
+}
+
 void test_app_smartstrap__write(void) {
   // create the attribute
   SmartstrapAttribute *attr = app_smartstrap_attribute_create(0x1111, 0x2222, 100);
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clar.h"
+
+#include "applib/app_sync/app_sync.h"
+#include "syscall/syscall.h"
+#include "util/size.h"
+
+#include <string.h>
+
+#include "stubs_logging.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+
+enum {
+  KEY_TEMPERATURE,
+  KEY_CITY,
+  KEY_ICON,
+};
+
+static AppSync s_sync;
+static void *s_app_message_context;
+static AppMessageInboxReceived s_inbox_received;
+static CallbackEventCallback s_scheduled_callback;
+static void *s_scheduled_callback_data;
+
+static int s_num_value_changed;
+static int s_num_errors;
+static DictionaryResult s_last_dict_error;
+
+
+// Stubs / fakes
+
+void *app_message_set_context(void *context) {
+  void *old_context = s_app_message_context;
+  s_app_message_context = context;
+  return old_context;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(
+    AppMessageInboxReceived received_callback) {
+  AppMessageInboxReceived old_callback = s_inbox_received;
+  s_inbox_received = received_callback;
+  return old_callback;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(
+    AppMessageInboxDropped dropped_callback) {
+  return NULL;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  return NULL;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(
+    AppMessageOutboxFailed failed_callback) {
+  return NULL;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  *iterator = NULL;
+  return APP_MSG_BUSY;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  return APP_MSG_BUSY;
+}
+
+void sys_current_process_schedule_callback(CallbackEventCallback async_cb, void *ctx) {
+  s_scheduled_callback = async_cb;
+  s_scheduled_callback_data = ctx;
+}
+
+
+// Helpers
+
+//! Looks up every key from the value_changed callback, like apps that update their whole UI
+//! whenever one of the values changes
+static void prv_value_changed(const uint32_t key, const Tuple *new_tuple, const Tuple *old_tuple,
+                              void *context) {
+  cl_assert_equal_p(context, &s_sync);
+  s_num_value_changed++;
+  cl_assert_equal_p(app_sync_get(&s_sync, key), new_tuple);
+  for (uint32_t other_key = KEY_TEMPERATURE; other_key <= KEY_ICON; other_key++) {
+    const Tuple *tuple = app_sync_get(&s_sync, other_key);
+    if (tuple) {
+      cl_assert_equal_i(tuple->key, other_key);
+    }
+  }
+}
+
+static void prv_error(DictionaryResult dict_error, AppMessageResult app_message_error,
+                      void *context) {
+  s_num_errors++;
+  s_last_dict_error = dict_error;
+}
+
+static void prv_init(uint8_t *buffer, uint16_t buffer_size) {
+  const Tuplet initial_values[] = {
+    TupletInteger(KEY_TEMPERATURE, (int32_t) 20),
+    TupletCString(KEY_CITY, "Berlin"),
+    TupletInteger(KEY_ICON, (uint8_t) 1),
+  };
+  app_sync_init(&s_sync, buffer, buffer_size, initial_values, ARRAY_LENGTH(initial_values),
+                prv_value_changed, prv_error, &s_sync);
+  cl_assert_equal_i(s_num_errors, 0);
+
+  cl_assert(s_scheduled_callback);
+  s_scheduled_callback(s_scheduled_callback_data);
+  cl_assert_equal_i(s_num_value_changed, ARRAY_LENGTH(initial_values));
+  s_num_value_changed = 0;
+}
+
+static void prv_receive(const Tuplet *tuplets, uint8_t num_tuplets) {
+  uint8_t buffer[512];
+  uint32_t size = sizeof(buffer);
+  cl_assert_equal_i(dict_serialize_tuplets_to_buffer(tuplets, num_tuplets, buffer, &size),
+                    DICT_OK);
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, buffer, size);
+  cl_assert(s_inbox_received);
+  s_inbox_received(&iter, s_app_message_context);
+}
+
+static void prv_assert_values(int32_t temperature, const char *city, uint8_t icon) {
+  cl_assert_equal_i(app_sync_get(&s_sync, KEY_TEMPERATURE)->value->int32, temperature);
+  cl_assert_equal_s(app_sync_get(&s_sync, KEY_CITY)->value->cstring, city);
+  cl_assert_equal_i(app_sync_get(&s_sync, KEY_ICON)->value->uint8, icon);
+  cl_assert_equal_p(app_sync_get(&s_sync, 42), NULL);
+}
+
+
+// Tests
+
+void test_app_sync__initialize(void) {
+  s_sync = (AppSync) {};
+  s_app_message_context = NULL;
+  s_inbox_received = NULL;
+  s_scheduled_callback = NULL;
+  s_scheduled_callback_data = NULL;
+  s_num_value_changed = 0;
+  s_num_errors = 0;
+  s_last_dict_error = DICT_OK;
+}
+
+void test_app_sync__cleanup(void) {
+  app_sync_deinit(&s_sync);
+}
+
+void test_app_sync__get(void) {
+  uint8_t buffer[256];
+  prv_init(buffer, sizeof(buffer));
+  prv_assert_values(20, "Berlin", 1);
+}
+
+void test_app_sync__get_without_room_for_index(void) {
+  // Exactly the size of the initial values
+  uint8_t buffer[sizeof(Dictionary) + (3 * sizeof(Tuple)) + sizeof(int32_t) + sizeof("Berlin") +
+                 sizeof(uint8_t)];
+  prv_init(buffer, sizeof(buffer));
+  prv_assert_values(20, "Berlin", 1);
+
+  const Tuplet update[] = {
+    TupletInteger(KEY_ICON, (uint8_t) 2),
+  };
+  prv_receive(update, ARRAY_LENGTH(update));
+  cl_assert_equal_i(s_num_errors, 0);
+  prv_assert_values(20, "Berlin", 2);
+}
+
+void test_app_sync__get_from_value_changed_during_merge(void) {
+  uint8_t buffer[256];
+  prv_init(buffer, sizeof(buffer));
+
+  // The updated values move to the front of the dictionary, the city gets longer
+  const Tuplet update[] = {
+    TupletCString(KEY_CITY, "San Francisco"),
+    TupletInteger(KEY_TEMPERATURE, (int32_t) 25),
+  };
+  prv_receive(update, ARRAY_LENGTH(update));
+  cl_assert_equal_i(s_num_errors, 0);
+  cl_assert_equal_i(s_num_value_changed, 3);
+  prv_assert_values(25, "San Francisco", 1);
+
+  const Tuplet second_update[] = {
+    TupletCString(KEY_CITY, "Rome"),
+  };
+  prv_receive(second_update, ARRAY_LENGTH(second_update));
+  cl_assert_equal_i(s_num_errors, 0);
+  prv_assert_values(25, "Rome", 1);
+}
+
+void test_app_sync__get_after_failed_merge(void) {
+  uint8_t buffer[96];
+  prv_init(buffer, sizeof(buffer));
+
+  char long_city[128];
+  memset(long_city, 'x', sizeof(long_city) - 1);
+  long_city[sizeof(long_city) - 1] = '\0';
+  const Tuplet too_big_update[] = {
+    TupletInteger(KEY_TEMPERATURE, (int32_t) 25),
+    TupletCString(KEY_CITY, long_city),
+  };
+  prv_receive(too_big_update, ARRAY_LENGTH(too_big_update));
+  cl_assert_equal_i(s_num_errors, 1);
+  cl_assert_equal_i(s_last_dict_error, DICT_NOT_ENOUGH_STORAGE);
+  cl_assert_equal_i(s_num_value_changed, 0);
+  prv_assert_values(20, "Berlin", 1);
+
+  const Tuplet update[] = {
+    TupletInteger(KEY_TEMPERATURE, (int32_t) 25),
+    TupletCString(KEY_CITY, "Paris"),
+  };
+  prv_receive(update, ARRAY_LENGTH(update));
+  cl_assert_equal_i(s_num_errors, 1);
+  cl_assert_equal_i(s_num_value_changed, 3);
+  prv_assert_values(25, "Paris", 1);
+}
@@ -206,6 +206,7 @@ bool timeline_resources_is_system(TimelineResourceId timeline_id) {
 #include "stubs_memory_layout.h"
 #include "stubs_music.h"
 #include "stubs_mutex.h"
+#include "stubs_new_timer.h"
 #include "stubs_notification_storage.h"
 #include "stubs_passert.h"
 #include "stubs_pebble_process_info.h"
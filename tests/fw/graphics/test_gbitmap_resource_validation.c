@@ -44,6 +44,13 @@ const uint8_t *sys_resource_read_only_bytes(ResAppNum app_num, uint32_t resource
   return NULL;
 }
 
+uint8_t *sys_bitmap_cache_load(ResAppNum app_num, uint32_t resource_id, size_t *size_out) {
+  return NULL;
+}
+
+void sys_bitmap_cache_store(ResAppNum app_num, uint32_t resource_id, const uint8_t *pbi_data,
+                            size_t pbi_data_size) {}
+
 // Fakes
 ///////////////////////
 size_t s_resource_size;
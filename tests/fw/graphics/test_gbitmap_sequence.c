@@ -47,9 +47,13 @@
 #include "fake_resource_syscalls.h"
 #include "fake_app_timer.h"
 
+// Memory-mapped test resources are treated like the ones in builtin flash
+bool resource_storage_builtin_bytes_are_readonly(const void *bytes) {
+  return sys_resource_bytes_are_readonly((void *)bytes);
+}
+
 // Stubs
 ////////////////////////////////////
-#include "stubs_applib_resource.h"
 #include "stubs_app_state.h"
 #include "stubs_logging.h"
 #include "stubs_heap.h"
@@ -343,3 +347,57 @@ void test_gbitmap_sequence__1bit_to_1bit_notification(void) {
     cl_check(gbitmap_pbi_eq(bitmap, filename_buffer));
   }
 }
+
+// Tests that an APNG on memory-mappable flash is decoded straight from the mapped resource
+// Result:
+//   - every frame matches the frame decoded from the data loaded into RAM
+
+// Tests that an APNG on memory-mappable flash is decoded straight from the mapped resource
+// Result:
+//   - every frame matches the frame decoded from the data loaded into RAM
+//   - only the chunk markers that are seeked over are copied out of the resource
+void test_gbitmap_sequence__mapped_frames_match_loaded_frames(void) {
+  uint32_t resource_id = sys_resource_load_file_as_resource(
+      TEST_IMAGES_PATH, "test_gbitmap_sequence__1bit_to_1bit_notification.apng");
+  cl_assert(resource_id != UINT32_MAX);
+  size_t loaded_bytes = fake_resource_syscalls_get_num_bytes_loaded();
+
+  GBitmapSequence *loaded_sequence = gbitmap_sequence_create_with_resource(resource_id);
+  cl_assert(loaded_sequence);
+  loaded_bytes = fake_resource_syscalls_get_num_bytes_loaded() - loaded_bytes;
+  const GSize size = gbitmap_sequence_get_bitmap_size(loaded_sequence);
+  GBitmap *loaded_bitmap = gbitmap_create_blank(size, GBitmapFormat1Bit);
+
+  fake_resource_syscalls_set_mappable(true);
+  size_t mapped_bytes = fake_resource_syscalls_get_num_bytes_loaded();
+  GBitmapSequence *mapped_sequence = gbitmap_sequence_create_with_resource(resource_id);
+  cl_assert(mapped_sequence);
+  mapped_bytes = fake_resource_syscalls_get_num_bytes_loaded() - mapped_bytes;
+  GBitmap *mapped_bitmap = gbitmap_create_blank(size, GBitmapFormat1Bit);
+
+  const uint32_t num_frames = gbitmap_sequence_get_total_num_frames(loaded_sequence);
+  cl_assert(num_frames > 1);
+  for (uint32_t i = 0; i < num_frames; i++) {
+    fake_resource_syscalls_set_mappable(false);
+    size_t num_bytes = fake_resource_syscalls_get_num_bytes_loaded();
+    cl_assert(gbitmap_sequence_update_bitmap_next_frame(loaded_sequence, loaded_bitmap, NULL));
+    loaded_bytes += fake_resource_syscalls_get_num_bytes_loaded() - num_bytes;
+
+    fake_resource_syscalls_set_mappable(true);
+    num_bytes = fake_resource_syscalls_get_num_bytes_loaded();
+    cl_assert(gbitmap_sequence_update_bitmap_next_frame(mapped_sequence, mapped_bitmap, NULL));
+    mapped_bytes += fake_resource_syscalls_get_num_bytes_loaded() - num_bytes;
+
+    cl_assert_equal_m(gbitmap_get_data(mapped_bitmap), gbitmap_get_data(loaded_bitmap),
+                      loaded_bitmap->row_size_bytes * size.h);
+  }
+  // Both read the same 8 byte chunk markers, only the sequence in RAM copies the frame data
+  cl_assert_equal_i(mapped_bytes % 8, 0);
+  cl_assert(mapped_bytes * 10 < loaded_bytes);
+
+  gbitmap_destroy(mapped_bitmap);
+  gbitmap_sequence_destroy(mapped_sequence);
+  gbitmap_destroy(loaded_bitmap);
+  gbitmap_sequence_destroy(loaded_sequence);
+  fake_resource_syscalls_cleanup();
+}
@@ -57,6 +57,8 @@ void sys_get_current_resource_num(){}
 void sys_resource_read_only_bytes(){}
 void sys_resource_load_range(){}
 void sys_resource_size(){}
+void sys_bitmap_cache_load(){}
+void sys_bitmap_cache_store(){}
 int32_t integer_sqrt(int64_t x){ return 0;}
 
 
@@ -49,6 +49,15 @@ extern AppTimer *rocky_api_app_message_get_session_closed_object_queue_timer(voi
 T_STATIC jerry_value_t prv_json_stringify(jerry_value_t object);
 T_STATIC jerry_value_t prv_json_parse(const char *);
 
+typedef struct {
+  uint8_t *data;
+  uint32_t size_bytes;
+  bool is_binary;
+} SerializedObject;
+
+T_STATIC jerry_value_t prv_binary_encode(jerry_value_t value, SerializedObject *serialized_out);
+T_STATIC jerry_value_t prv_binary_decode(const uint8_t *data, size_t size_bytes);
+
 T_STATIC void prv_handle_connection(void);
 T_STATIC void prv_handle_disconnection(void);
 
@@ -203,11 +212,26 @@ static const PostMessageResetCompletePayload VALID_RESET_COMPLETE = {
   .max_rx_chunk_size = POSTMESSAGE_PROTOCOL_MAX_RX_CHUNK_SIZE,
 };
 
+//! ResetComplete of a remote that only supports the JSON encoding of the first protocol version
+static const PostMessageResetCompletePayload V1_RESET_COMPLETE = {
+  .min_supported_version = POSTMESSAGE_PROTOCOL_MIN_VERSION,
+  .max_supported_version = POSTMESSAGE_PROTOCOL_MIN_VERSION,
+  .max_tx_chunk_size = POSTMESSAGE_PROTOCOL_MAX_TX_CHUNK_SIZE,
+  .max_rx_chunk_size = POSTMESSAGE_PROTOCOL_MAX_RX_CHUNK_SIZE,
+};
+
 static const size_t TINY_CHUNK_SIZE = 4;
 
 static const PostMessageResetCompletePayload TINY_RESET_COMPLETE = {
   .min_supported_version = POSTMESSAGE_PROTOCOL_MIN_VERSION,
-  .max_supported_version = POSTMESSAGE_PROTOCOL_MAX_VERSION,
+  .max_supported_version = POSTMESSAGE_PROTOCOL_MIN_VERSION,
+  .max_tx_chunk_size = TINY_CHUNK_SIZE,
+  .max_rx_chunk_size = TINY_CHUNK_SIZE,
+};
+
+static const PostMessageResetCompletePayload TINY_BINARY_RESET_COMPLETE = {
+  .min_supported_version = POSTMESSAGE_PROTOCOL_MIN_VERSION,
+  .max_supported_version = POSTMESSAGE_PROTOCOL_BINARY_ENCODING_VERSION,
   .max_tx_chunk_size = TINY_CHUNK_SIZE,
   .max_rx_chunk_size = TINY_CHUNK_SIZE,
 };
@@ -232,6 +256,10 @@ static const PostMessageResetCompletePayload TINY_RESET_COMPLETE = {
   RCV_APP_MESSAGE(TupletBytes(PostMessageKeyResetRequest, NULL, 0));
 
 #define RCV_RESET_COMPLETE() \
+  RCV_APP_MESSAGE(TupletBytes(PostMessageKeyResetComplete, \
+                  (const uint8_t *)&V1_RESET_COMPLETE, sizeof(V1_RESET_COMPLETE)));
+
+#define RCV_BINARY_RESET_COMPLETE() \
   RCV_APP_MESSAGE(TupletBytes(PostMessageKeyResetComplete, \
                   (const uint8_t *)&VALID_RESET_COMPLETE, sizeof(VALID_RESET_COMPLETE)));
 
@@ -887,6 +915,312 @@ void test_rocky_api_app_message__receive_message_multi_chunk(void) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Binary Encoding Tests
+////////////////////////////////////////////////////////////////////////////////
+
+static void prv_init_and_goto_binary_session_open(void) {
+  prv_init_and_goto_awaiting_reset_complete_remote_initiated();
+  RCV_BINARY_RESET_COMPLETE();
+  cl_assert_equal_i(rocky_api_app_message_get_state(), PostMessageStateSessionOpen);
+}
+
+static void prv_init_and_goto_binary_session_open_with_tiny_buffers(void) {
+  prv_init_and_goto_awaiting_reset_complete_remote_initiated();
+  RCV_APP_MESSAGE(TupletBytes(PostMessageKeyResetComplete,
+                              (const uint8_t *)&TINY_BINARY_RESET_COMPLETE,
+                              sizeof(TINY_BINARY_RESET_COMPLETE)));
+  cl_assert_equal_i(rocky_api_app_message_get_state(), PostMessageStateSessionOpen);
+}
+
+static void prv_assert_simple_test_object_pending_binary(void) {
+  // Compare with hard-coded byte array, to catch accidental changes to the ABI:
+  const uint8_t raw_bytes_v2[] = {
+    0x06, 0x00, 0x00, 0x80,
+    PostMessageValueTypeObject, 0x01, 0x01, 'x', PostMessageValueTypeInt8, 0x01,
+  };
+  EXPECT_OUTBOX_MESSAGE_PENDING(TupletBytes(PostMessageKeyChunk,
+                                            raw_bytes_v2, sizeof(raw_bytes_v2)));
+}
+
+//! Encodes and decodes the value of the global variable, and asserts that the result serializes
+//! to the same JSON string as the original value does.
+static void prv_assert_binary_round_trip(char *global_name, size_t expected_size) {
+  JS_VAR value = prv_js_global_get_value(global_name);
+  SerializedObject serialized;
+  JS_VAR result = prv_binary_encode(value, &serialized);
+  cl_assert_equal_b(jerry_value_has_error_flag(result), false);
+  cl_assert_equal_b(serialized.is_binary, true);
+  if (expected_size) {
+    cl_assert_equal_i(serialized.size_bytes, expected_size);
+  }
+
+  JS_VAR decoded = prv_binary_decode(serialized.data, serialized.size_bytes);
+  task_free(serialized.data);
+  cl_assert_equal_b(jerry_value_has_error_flag(decoded), false);
+
+  JS_VAR expected_json = prv_json_stringify(value);
+  JS_VAR decoded_json = prv_json_stringify(decoded);
+  char *expected_json_c_str = rocky_string_alloc_and_copy(expected_json);
+  char *decoded_json_c_str = rocky_string_alloc_and_copy(decoded_json);
+  cl_assert_equal_s(decoded_json_c_str, expected_json_c_str);
+  task_free(expected_json_c_str);
+  task_free(decoded_json_c_str);
+}
+
+void test_rocky_api_app_message__binary_round_trip(void) {
+  prv_init_api(false /* start_connected */);
+
+  EXECUTE_SCRIPT("var simple = { \"x\" : 1 };"
+                 "var numbers = [0, -1, 127, -128, 128, 32767, -32769, 2147483647, -2147483648,"
+                 "               2147483648, 1.5, -0, NaN, Infinity];"
+                 "var strings = ['', 'abc', 'caf\\u00e9 \\u263a', 'a\\u0000b'];"
+                 "var mixed = { a: true, b: false, c: null, d: undefined, e: function() {},"
+                 "              f: [undefined, function() {}], g: { h: { i: [] } },"
+                 "              j: new Date(0), k: { toJSON: function() { return 'k'; } },"
+                 "              l: { toJSON: function() { return undefined; } } };"
+                 "var deep = [[[[[[[[[[[[1, { x: [2] }]]]]]]]]]]]];");
+
+  prv_assert_binary_round_trip("simple", 6);
+  prv_assert_binary_round_trip("numbers", 0);
+  prv_assert_binary_round_trip("strings", 0);
+  prv_assert_binary_round_trip("mixed", 0);
+  prv_assert_binary_round_trip("deep", 0);
+}
+
+void test_rocky_api_app_message__binary_encode_not_jsonable(void) {
+  prv_init_api(false /* start_connected */);
+
+  EXECUTE_SCRIPT("var f = function() {};"
+                 "var undefinedJSON = { toJSON: function() { return undefined; } };"
+                 "var throwingJSON = { a: { toJSON: function() { throw 'toJSONError'; } } };"
+                 "var throwingGetter = { get a() { throw 'getterError'; } };");
+
+  char *names[] = { "f", "undefinedJSON", "throwingJSON", "throwingGetter" };
+  for (int i = 0; i < ARRAY_LENGTH(names); ++i) {
+    JS_VAR value = prv_js_global_get_value(names[i]);
+    SerializedObject serialized = {};
+    JS_VAR result = prv_binary_encode(value, &serialized);
+    cl_assert_equal_b(jerry_value_has_error_flag(result), true);
+    cl_assert_equal_p(serialized.data, NULL);
+  }
+}
+
+void test_rocky_api_app_message__binary_decode_malformed(void) {
+  prv_init_api(false /* start_connected */);
+
+  const struct {
+    uint8_t bytes[8];
+    size_t length;
+  } malformed[] = {
+    // Empty:
+    { .length = 0 },
+    // Undefined is only valid as the value of an object property:
+    { .bytes = { PostMessageValueTypeUndefined }, .length = 1 },
+    { .bytes = { PostMessageValueTypeArray, 0x01, PostMessageValueTypeUndefined }, .length = 3 },
+    // Unknown type:
+    { .bytes = { PostMessageValueType_Count }, .length = 1 },
+    // Truncated number and string:
+    { .bytes = { PostMessageValueTypeInt32, 0x01, 0x02 }, .length = 3 },
+    { .bytes = { PostMessageValueTypeString, 0x05, 'a', 'b' }, .length = 4 },
+    // Count that's larger than the remaining data:
+    { .bytes = { PostMessageValueTypeArray, 0xff, 0xff, 0xff, 0xff, 0x0f }, .length = 6 },
+    // Varint that doesn't end:
+    { .bytes = { PostMessageValueTypeString, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 }, .length = 7 },
+    // Trailing data:
+    { .bytes = { PostMessageValueTypeNull, PostMessageValueTypeNull }, .length = 2 },
+    // Invalid JSON:
+    { .bytes = { PostMessageValueTypeJSON, 0x01, '{' }, .length = 3 },
+  };
+  for (int i = 0; i < ARRAY_LENGTH(malformed); ++i) {
+    JS_VAR result = prv_binary_decode(malformed[i].bytes, malformed[i].length);
+    cl_assert_equal_b(jerry_value_has_error_flag(result), true);
+  }
+
+  // Nested deeper than the encoder would ever nest arrays:
+  uint8_t too_deep[2 * (POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH + 1) + 1];
+  for (int i = 0; i < POSTMESSAGE_BINARY_ENCODING_MAX_DEPTH + 1; ++i) {
+    too_deep[2 * i] = PostMessageValueTypeArray;
+    too_deep[2 * i + 1] = 0x01;
+  }
+  too_deep[sizeof(too_deep) - 1] = PostMessageValueTypeNull;
+  JS_VAR result = prv_binary_decode(too_deep, sizeof(too_deep));
+  cl_assert_equal_b(jerry_value_has_error_flag(result), true);
+
+  // One level less is fine:
+  JS_VAR deepest = prv_binary_decode(too_deep + 2, sizeof(too_deep) - 2);
+  cl_assert_equal_b(jerry_value_has_error_flag(deepest), false);
+}
+
+void test_rocky_api_app_message__post_message_binary(void) {
+  prv_init_and_goto_binary_session_open();
+
+  EXECUTE_SCRIPT("var x = " SIMPLE_TEST_OBJECT "; _rocky.postMessage(x);");
+  prv_assert_simple_test_object_pending_binary();
+
+  prv_rcv_app_message_ack(APP_MSG_OK);
+
+  EXPECT_OUTBOX_NO_MESSAGE_PENDING();
+}
+
+void test_rocky_api_app_message__post_message_binary_multi_chunk(void) {
+  prv_init_and_goto_binary_session_open_with_tiny_buffers();
+
+  EXECUTE_SCRIPT("var x = { \"x\" : 123 }; _rocky.postMessage(x);");
+
+  const uint8_t chunk_1[] = {
+    0x06, 0x00, 0x00, 0x80, PostMessageValueTypeObject, 0x01, 0x01, 'x',
+  };
+  EXPECT_OUTBOX_MESSAGE_PENDING(TupletBytes(PostMessageKeyChunk, chunk_1, sizeof(chunk_1)));
+  prv_rcv_app_message_ack(APP_MSG_OK);
+
+  const uint8_t chunk_2[] = {
+    0x04, 0x00, 0x00, 0x00, PostMessageValueTypeInt8, 123,
+  };
+  EXPECT_OUTBOX_MESSAGE_PENDING(TupletBytes(PostMessageKeyChunk, chunk_2, sizeof(chunk_2)));
+  prv_rcv_app_message_ack(APP_MSG_OK);
+
+  EXPECT_OUTBOX_NO_MESSAGE_PENDING();
+}
+
+void test_rocky_api_app_message__post_message_converted_for_session(void) {
+  // Posted before any session was opened, so serialized as JSON:
+  prv_init_api(false /* start_connected */);
+  EXECUTE_SCRIPT("var x = " SIMPLE_TEST_OBJECT ";"
+                 "var hasError = false;"
+                 "_rocky.on('postmessageerror', function() { hasError = true; });"
+                 "_rocky.postMessage(x);");
+
+  prv_simulate_transport_connection_event(true /* is_connected */);
+  RCV_RESET_REQUEST();
+  prv_rcv_app_message_ack(APP_MSG_OK);
+  RCV_BINARY_RESET_COMPLETE();
+  prv_assert_simple_test_object_pending_binary();
+  prv_rcv_app_message_ack(APP_MSG_OK);
+
+  // Posted while disconnected from a binary session and then sent to a JSON-only remote:
+  prv_simulate_transport_connection_event(false /* is_connected */);
+  EXECUTE_SCRIPT("_rocky.postMessage(x);");
+  prv_simulate_transport_connection_event(true /* is_connected */);
+  prv_postmessageconnected_postmessagedisconnected_negotiate_to_open_session();
+  prv_assert_simple_test_object_pending();
+  prv_rcv_app_message_ack(APP_MSG_OK);
+
+  EXPECT_OUTBOX_NO_MESSAGE_PENDING();
+  ASSERT_JS_GLOBAL_EQUALS_B("hasError", false);
+}
+
+void test_rocky_api_app_message__receive_binary_message_multi_chunk(void) {
+  prv_init_and_goto_binary_session_open_with_tiny_buffers();
+
+  EXECUTE_SCRIPT("var json_str = null;\n"
+                 "_rocky.on('message', function(e) {\n"
+                 "  json_str = JSON.stringify(e.data);\n"
+                 "});");
+
+  // Chunks for: {"x":123,"y":[null,"a"]}
+  const struct {
+    uint8_t byte_array[8];
+    size_t length;
+  } chunk_msg_defs[] = {
+    {
+      .byte_array = {0x0e, 0x00, 0x00, 0x80, PostMessageValueTypeObject, 0x02, 0x01, 'x'},
+      .length = 8,
+    },
+    {
+      .byte_array = {0x04, 0x00, 0x00, 0x00, PostMessageValueTypeInt8, 123, 0x01, 'y'},
+      .length = 8,
+    },
+    {
+      .byte_array = {0x08, 0x00, 0x00, 0x00,
+                     PostMessageValueTypeArray, 0x02, PostMessageValueTypeNull,
+                     PostMessageValueTypeString},
+      .length = 8,
+    },
+    {
+      .byte_array = {0x0c, 0x00, 0x00, 0x00, 0x01, 'a'},
+      .length = 6,
+    },
+  };
+
+  for (int i = 0; i < ARRAY_LENGTH(chunk_msg_defs); ++i) {
+    RCV_APP_MESSAGE(TupletBytes(PostMessageKeyChunk,
+                                (const uint8_t *) chunk_msg_defs[i].byte_array,
+                                chunk_msg_defs[i].length));
+  }
+
+  ASSERT_JS_GLOBAL_EQUALS_S("json_str", "{\"x\":123,\"y\":[null,\"a\"]}");
+}
+
+//! Sensor-style payload, like what a watchface would send to its companion every few seconds
+#define BENCHMARK_TEST_OBJECT \
+  "var samples = [];" \
+  "for (var i = 0; i < 25; i++) {" \
+  "  samples.push({ x: -12 + i, y: 1000 - 3 * i, z: -980 + 7 * i, vibe: i % 5 == 0 });" \
+  "}" \
+  "var x = { type: 'accel', time: 1482278400000, rate: 25, battery: 0.85, samples: samples };"
+
+#define BENCHMARK_NUM_ITERATIONS (2000)
+
+void test_rocky_api_app_message__encode_benchmark(void) {
+  prv_init_api(false /* start_connected */);
+  EXECUTE_SCRIPT(BENCHMARK_TEST_OBJECT);
+  JS_VAR value = prv_js_global_get_value("x");
+
+  size_t binary_size = 0;
+  for (int i = 0; i < BENCHMARK_NUM_ITERATIONS; ++i) {
+    SerializedObject serialized;
+    JS_VAR result = prv_binary_encode(value, &serialized);
+    cl_assert_equal_b(jerry_value_has_error_flag(result), false);
+    binary_size = serialized.size_bytes;
+    task_free(serialized.data);
+  }
+
+  size_t json_size = 0;
+  for (int i = 0; i < BENCHMARK_NUM_ITERATIONS; ++i) {
+    JS_VAR json_string = prv_json_stringify(value);
+    json_size = jerry_get_utf8_string_size(json_string) + 1 /* trailing zero */;
+  }
+
+  // The binary encoding is at least a third smaller than the JSON one
+  cl_assert(binary_size * 3 < json_size * 2);
+}
+
+void test_rocky_api_app_message__decode_benchmark(void) {
+  prv_init_api(false /* start_connected */);
+  EXECUTE_SCRIPT(BENCHMARK_TEST_OBJECT);
+
+  SerializedObject serialized;
+  char *json_c_str;
+  {
+    JS_VAR value = prv_js_global_get_value("x");
+    JS_VAR result = prv_binary_encode(value, &serialized);
+    cl_assert_equal_b(jerry_value_has_error_flag(result), false);
+    JS_VAR json_string = prv_json_stringify(value);
+    json_c_str = rocky_string_alloc_and_copy(json_string);
+  }
+
+  for (int i = 0; i < BENCHMARK_NUM_ITERATIONS; ++i) {
+    JS_VAR decoded = prv_binary_decode(serialized.data, serialized.size_bytes);
+    cl_assert_equal_b(jerry_value_is_object(decoded), true);
+    if (i == 0) {
+      JS_VAR decoded_json_string = prv_json_stringify(decoded);
+      char *decoded_json_c_str = rocky_string_alloc_and_copy(decoded_json_string);
+      cl_assert_equal_s(decoded_json_c_str, json_c_str);
+      task_free(decoded_json_c_str);
+    }
+  }
+
+  for (int i = 0; i < BENCHMARK_NUM_ITERATIONS; ++i) {
+    JS_VAR decoded = prv_json_parse(json_c_str);
+    cl_assert_equal_b(jerry_value_is_object(decoded), true);
+  }
+
+  cl_assert(serialized.size_bytes * 3 < (strlen(json_c_str) + 1) * 2);
+  task_free(serialized.data);
+  task_free(json_c_str);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // "postmessageerror" event
 ////////////////////////////////////////////////////////////////////////////////
@@ -969,3 +1303,23 @@ void test_rocky_api_app_message__postmessageerror_while_disconnected(void) {
 
   prv_assert_simple_test_object_pending();
 }
+
+void test_rocky_api_app_message__postmessageerror_binary(void) {
+  prv_init_and_goto_binary_session_open();
+
+  EXECUTE_SCRIPT("var didError = false;"
+                 "var dataJSON = undefined;"
+                 "_rocky.on('postmessageerror', "
+                 "          function(e) { didError = true; dataJSON = JSON.stringify(e.data); });"
+                 "_rocky.postMessage({ \"x\" : [1, 'y'] });");
+
+  // The object is dropped after the 3rd NACK:
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_JS_GLOBAL_EQUALS_B("didError", false);
+    prv_rcv_app_message_ack(APP_MSG_BUSY);
+    cl_assert_equal_b(app_timer_trigger(rocky_api_app_message_get_app_msg_retry_timer()), true);
+  }
+
+  ASSERT_JS_GLOBAL_EQUALS_B("didError", true);
+  ASSERT_JS_GLOBAL_EQUALS_S("dataJSON", "{\"x\":[1,\"y\"]}");
+}
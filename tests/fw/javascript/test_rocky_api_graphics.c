@@ -24,6 +24,7 @@
 #include "applib/rockyjs/api/rocky_api_graphics.h"
 #include "applib/rockyjs/api/rocky_api_graphics_text.h"
 #include "applib/rockyjs/pbl_jerry_port.h"
+#include "util/size.h"
 #include "util/trig.h"
 
 // Standard
@@ -701,6 +702,48 @@ void test_rocky_api_graphics__text_font_names_unique(void) {
   }
 }
 
+void test_rocky_api_graphics__text_font_interned(void) {
+  rocky_global_init(s_graphics_api);
+
+  // switch between more fonts than are interned
+  const char *names[] = {
+    "28px bold Gothic", "42px light Bitham", "18px Gothic", "21px Roboto",
+  };
+  jerry_value_t names_js[ARRAY_LENGTH(names)];
+  for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+    names_js[i] = jerry_create_string((jerry_char_t *)names[i]);
+  }
+  for (int round = 0; round < 3; round++) {
+    for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+      RockyAPISystemFontDefinition *def = NULL;
+      cl_assert_equal_b(true, prv_font_definition_from_value(names_js[i], &def));
+      cl_assert_equal_s(names[i], def->js_name);
+      def = NULL;
+      cl_assert_equal_b(true, prv_font_definition_from_value(names_js[i], &def));
+      cl_assert_equal_s(names[i], def->js_name);
+
+      // a different string with the same contents matches the same font
+      const jerry_value_t copy_js = jerry_create_string((jerry_char_t *)names[i]);
+      def = NULL;
+      cl_assert_equal_b(true, prv_font_definition_from_value(copy_js, &def));
+      cl_assert_equal_s(names[i], def->js_name);
+      jerry_release_value(copy_js);
+    }
+  }
+  for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+    jerry_release_value(names_js[i]);
+  }
+
+  // only exact matches count
+  const jerry_value_t prefix_js = jerry_create_string((jerry_char_t *)"28px bold");
+  RockyAPISystemFontDefinition *def = NULL;
+  cl_assert_equal_b(false, prv_font_definition_from_value(prefix_js, &def));
+  cl_assert_equal_b(false, prv_font_definition_from_value(prefix_js, &def));
+  jerry_release_value(prefix_js);
+
+  rocky_global_deinit();
+}
+
 void test_rocky_api_graphics__measure_text(void) {
   prv_global_init_and_set_ctx();
 
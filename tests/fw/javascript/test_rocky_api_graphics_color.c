@@ -23,6 +23,7 @@
 #include "applib/rockyjs/api/rocky_api_graphics.h"
 #include "applib/rockyjs/api/rocky_api_graphics_color.h"
 #include "applib/rockyjs/pbl_jerry_port.h"
+#include "util/size.h"
 
 // Standard
 #include "string.h"
@@ -169,6 +170,55 @@ void test_rocky_api_graphics_color__color_names_consistent(void) {
   }
 }
 
+void test_rocky_api_graphics_color__interned_strings(void) {
+  rocky_global_init(s_graphics_api);
+
+  // more strings than are interned
+  const char *names[] = {
+    "pastelyellow", "red", "melon", "purple", "darkgray", "white", "cadetblue", "yellow", "#0f0",
+  };
+  jerry_value_t strings[ARRAY_LENGTH(names)];
+  GColor8 expected[ARRAY_LENGTH(names)];
+  for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+    strings[i] = jerry_create_string((const jerry_char_t *)names[i]);
+    cl_assert(rocky_api_graphics_color_parse(names[i], &expected[i]));
+  }
+
+  for (int round = 0; round < 3; round++) {
+    for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+      GColor actual = {0};
+      cl_assert(rocky_api_graphics_color_from_value(strings[i], &actual));
+      cl_assert_equal_i(expected[i].argb, actual.argb);
+      cl_assert(rocky_api_graphics_color_from_value(strings[i], &actual));
+      cl_assert_equal_i(expected[i].argb, actual.argb);
+
+      // a different string with the same contents parses the same
+      const jerry_value_t copy = jerry_create_string((const jerry_char_t *)names[i]);
+      cl_assert(rocky_api_graphics_color_from_value(copy, &actual));
+      cl_assert_equal_i(expected[i].argb, actual.argb);
+      jerry_release_value(copy);
+    }
+  }
+
+  // invalid colors don't get interned
+  const jerry_value_t invalid = jerry_create_string((const jerry_char_t *)"pastel");
+  GColor actual = {0};
+  cl_assert(!rocky_api_graphics_color_from_value(invalid, &actual));
+  cl_assert(!rocky_api_graphics_color_from_value(invalid, &actual));
+  jerry_release_value(invalid);
+
+  // interned strings outlive the references the caller had
+  for (size_t i = 0; i < ARRAY_LENGTH(names); i++) {
+    jerry_release_value(strings[i]);
+  }
+  const jerry_value_t white = jerry_create_string((const jerry_char_t *)"white");
+  cl_assert(rocky_api_graphics_color_from_value(white, &actual));
+  cl_assert_equal_i(GColorWhiteARGB8, actual.argb);
+  jerry_release_value(white);
+
+  rocky_api_graphics_color_deinit();
+}
+
 void test_rocky_api_graphics_color__hex(void) {
   // invalid cases
   cl_assert_parsed_color("#", NULL);
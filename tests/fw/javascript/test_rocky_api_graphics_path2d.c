@@ -63,6 +63,9 @@ bool rocky_api_graphics_color_from_value(jerry_value_t value, GColor *result) {
   return false;
 }
 
+void rocky_api_graphics_color_init(void) {}
+void rocky_api_graphics_color_deinit(void) {}
+
 static Window s_app_window_stack_get_top_window;
 Window *app_window_stack_get_top_window() {
   return &s_app_window_stack_get_top_window;
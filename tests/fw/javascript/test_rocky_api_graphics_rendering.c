@@ -309,4 +309,42 @@ void test_rocky_api_graphics_rendering__arc(void) {
   const bool eq_result =
     gbitmap_pbi_eq(&s_context.dest_bitmap, TEST_NAMED_PBI_FILE("rocky_rendering_arc"));
   cl_check(eq_result);
-}
\ No newline at end of file
+}
+
+void test_rocky_api_graphics_rendering__redraw_named_colors(void) {
+  prv_global_init_and_set_ctx();
+
+  // a watchface that picks its colors by name, mostly ones at the end of the color table
+  EXECUTE_SCRIPT(
+    "var colors = ['pastelyellow', 'icterine', 'melon', 'rajah', 'white', 'folly'];\n"
+    "_rocky.on('draw', function(e) {\n"
+    "  var ctx = e.context;\n"
+    "  ctx.lineWidth = 2;\n"
+    "  for (var i = 0; i < colors.length; i++) {\n"
+    "    ctx.fillStyle = colors[i];\n"
+    "    ctx.fillRect(0, i * 20, 144, 20);\n"
+    "    ctx.strokeStyle = colors[colors.length - 1 - i];\n"
+    "    ctx.strokeRect(10, i * 20 + 5, 124, 10);\n"
+    "  }\n"
+    "});"
+  );
+
+  Layer *l = &app_window_stack_get_top_window()->layer;
+  const size_t num_bytes = s_pixels->row_size_bytes * DISP_ROWS;
+  l->update_proc(l, &s_context);
+  uint8_t *const first_frame = malloc(num_bytes);
+  memcpy(first_frame, s_context.dest_bitmap.addr, num_bytes);
+  cl_assert_equal_i(((uint8_t *)s_context.dest_bitmap.addr)[0], GColorPastelYellowARGB8);
+  cl_assert_equal_i(((uint8_t *)s_context.dest_bitmap.addr)[20 * s_pixels->row_size_bytes],
+                    GColorIcterineARGB8);
+
+  // every redraw looks up the same colors again
+  const int num_frames = 2000;
+  for (int i = 0; i < num_frames; i++) {
+    memset(s_context.dest_bitmap.addr, 0xff, num_bytes);
+    l->update_proc(l, &s_context);
+    cl_assert(memcmp(first_frame, s_context.dest_bitmap.addr, num_bytes) == 0);
+  }
+  free(first_frame);
+}
+
@@ -19,6 +19,7 @@
 #include "applib/rockyjs/api/rocky_api_util_args.h"
 
 #include "applib/rockyjs/api/rocky_api_errors.h"
+#include "applib/rockyjs/api/rocky_api_graphics_color.h"
 #include "applib/rockyjs/api/rocky_api_util.h"
 #include "applib/rockyjs/pbl_jerry_port.h"
 
@@ -67,6 +68,7 @@ void test_rocky_api_util_args__initialize(void) {
 }
 
 void test_rocky_api_util_args__cleanup(void) {
+  rocky_api_graphics_color_deinit();
   jerry_cleanup();
   rocky_runtime_context_deinit();
   fake_pbl_malloc_check_net_allocs();  // Make sure no memory was leaked
@@ -22,6 +22,8 @@
 #include "services/normal/filesystem/pfs.h"
 #include "services/normal/blob_db/app_db.h"
 
+#include <string.h>
+
 // Fixture
 ////////////////////////////////////////////////////////////////
 
@@ -273,3 +275,78 @@ void prv_enumerate_entries(AppInstallId install_id, AppDBEntry *entry, void *dat
 void test_app_db__enumerate(void) {
   app_db_enumerate_entries(prv_enumerate_entries, (void *)&some_data);
 }
+
+void test_app_db__lookup_after_delete_and_flush(void) {
+  const AppInstallId app_two_id = app_db_get_install_id_for_uuid(&app2.uuid);
+  cl_assert_equal_i(S_SUCCESS, app_db_delete((uint8_t*)&app2.uuid, sizeof(Uuid)));
+  cl_assert_equal_i(INSTALL_ID_INVALID, app_db_get_install_id_for_uuid(&app2.uuid));
+  cl_assert(app_db_get_install_id_for_uuid(&app3.uuid) > 0);
+
+  // Installing the app again gives it a new id
+  cl_assert_equal_i(S_SUCCESS, app_db_insert((uint8_t*)&app2.uuid,
+      sizeof(Uuid), (uint8_t*)&app2, sizeof(AppDBEntry)));
+  const AppInstallId new_app_two_id = app_db_get_install_id_for_uuid(&app2.uuid);
+  cl_assert(new_app_two_id > 0);
+  cl_assert(new_app_two_id != app_two_id);
+
+  // The index is rebuilt from flash on the next boot
+  app_db_init();
+  cl_assert_equal_i(new_app_two_id, app_db_get_install_id_for_uuid(&app2.uuid));
+  cl_assert_equal_i(1, app_db_get_install_id_for_uuid(&app1.uuid));
+
+  cl_assert_equal_i(S_SUCCESS, app_db_flush());
+  cl_assert_equal_i(INSTALL_ID_INVALID, app_db_get_install_id_for_uuid(&app1.uuid));
+  cl_assert_equal_i(INSTALL_ID_INVALID, app_db_get_install_id_for_uuid(&app3.uuid));
+}
+
+void test_app_db__lookup_uuids_with_same_hash(void) {
+  // Swapping the first two words of a UUID keeps the XOR of all of them
+  AppDBEntry swapped = app1;
+  memcpy(&swapped.uuid.byte0, &app1.uuid.byte4, 4);
+  memcpy(&swapped.uuid.byte4, &app1.uuid.byte0, 4);
+  cl_assert_equal_i(S_SUCCESS, app_db_insert((uint8_t*)&swapped.uuid,
+      sizeof(Uuid), (uint8_t*)&swapped, sizeof(AppDBEntry)));
+
+  const AppInstallId swapped_id = app_db_get_install_id_for_uuid(&swapped.uuid);
+  const AppInstallId app_one_id = app_db_get_install_id_for_uuid(&app1.uuid);
+  cl_assert_equal_i(4, swapped_id);
+  cl_assert_equal_i(1, app_one_id);
+
+  AppDBEntry temp;
+  cl_assert_equal_i(S_SUCCESS, app_db_read((uint8_t*)&swapped.uuid, sizeof(Uuid),
+                                           (uint8_t*)&temp, sizeof(AppDBEntry)));
+  cl_assert(uuid_equal(&swapped.uuid, &temp.uuid));
+}
+
+void test_app_db__lookup_flash_reads(void) {
+  // A watch full of apps
+  const int num_apps = 100;
+  AppDBEntry entry = app1;
+  for (int i = 0; i < num_apps; i++) {
+    entry.uuid.byte15 = i;
+    entry.uuid.byte14 = 0xa5;
+    cl_assert_equal_i(S_SUCCESS, app_db_insert((uint8_t*)&entry.uuid,
+        sizeof(Uuid), (uint8_t*)&entry, sizeof(AppDBEntry)));
+  }
+
+  uint32_t reads_before = fake_flash_read_count();
+  for (int i = 0; i < num_apps; i++) {
+    entry.uuid.byte15 = i;
+    cl_assert_equal_i(i + 4, app_db_get_install_id_for_uuid(&entry.uuid));
+  }
+  const uint32_t lookup_reads = fake_flash_read_count() - reads_before;
+
+  reads_before = fake_flash_read_count();
+  AppDBEntry temp;
+  for (int i = 0; i < num_apps; i++) {
+    entry.uuid.byte15 = i;
+    cl_assert_equal_i(S_SUCCESS, app_db_read((uint8_t*)&entry.uuid, sizeof(Uuid),
+                                             (uint8_t*)&temp, sizeof(AppDBEntry)));
+  }
+  const uint32_t read_reads = fake_flash_read_count() - reads_before;
+
+  // Scanning app_db for the UUID took more than 3 flash reads per installed app, the index only
+  // needs the record of the matching app
+  cl_assert(lookup_reads / num_apps < num_apps);
+  cl_assert(read_reads / num_apps < num_apps);
+}
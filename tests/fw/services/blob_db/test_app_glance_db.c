@@ -31,6 +31,7 @@
 
 #include "fake_settings_file.h"
 #include "fake_events.h"
+#include "fake_rtc.h"
 
 // Stubs
 ////////////////////////////////////////////////////////////////
@@ -423,6 +424,81 @@ void test_app_glance_db__glance_blob_with_slice_missing_expiration_time_gets_def
   cl_assert_equal_i(read_back_glance.slices[0].expiration_time, APP_GLANCE_SLICE_NO_EXPIRATION);
 }
 
+void test_app_glance_db__glance_blob_with_duplicate_and_unknown_attributes(void) {
+  const uint8_t app_glance_with_odd_attributes[] = {
+      // Version
+      APP_GLANCE_DB_CURRENT_VERSION,
+      // Creation time
+      0x14, 0x13, 0x4E, 0x57,   // 1464734484 (Tue, 31 May 2016 22:41:24 GMT)
+
+      // Slice 1
+      0x21, 0x00,               // Total size
+      0x00,                     // AppGlanceSliceType - AppGlanceSliceType_IconAndSubtitle
+      0x04,                     // Number of attributes
+      // Slice Attributes
+      0x2F,                     // Attribute ID - AttributeIdSubtitleTemplateString
+      0x06, 0x00,               // Attribute Length
+      // Slice subtitle, with a NUL in the middle:
+      'F', 'i', 'r', 's', 't', '\0',
+      0x2F,                     // Attribute ID - AttributeIdSubtitleTemplateString
+      0x06, 0x00,               // Attribute Length
+      // Duplicate slice subtitle, the first one counts:
+      'S', 'e', 'c', 'o', 'n', 'd',
+      0xFE,                     // Attribute ID - Unknown
+      0x01, 0x00,               // Attribute Length
+      0x00,
+      0x30,                     // Attribute ID - AttributeIdIcon
+      0x04, 0x00,               // Attribute Length
+      // Slice icon resource ID, ignored because it comes after an unknown attribute:
+      0x69, 0x00, 0x00, 0x00,
+  };
+  cl_assert_equal_i(app_glance_db_insert((uint8_t *)&APP_GLANCE_TEST_UUID, UUID_SIZE,
+                                         app_glance_with_odd_attributes,
+                                         sizeof(app_glance_with_odd_attributes)),
+                    S_SUCCESS);
+
+  AppGlance read_back_glance = {};
+  cl_assert_equal_i(app_glance_db_read_glance(&APP_GLANCE_TEST_UUID, &read_back_glance), S_SUCCESS);
+  cl_assert_equal_i(read_back_glance.num_slices, 1);
+  cl_assert_equal_s(read_back_glance.slices[0].icon_and_subtitle.template_string, "First");
+  cl_assert_equal_i(read_back_glance.slices[0].icon_and_subtitle.icon_resource_id,
+                    INVALID_RESOURCE);
+  cl_assert_equal_i(read_back_glance.slices[0].expiration_time, APP_GLANCE_SLICE_NO_EXPIRATION);
+}
+
+void test_app_glance_db__glance_blob_with_attribute_overflowing_slice_not_inserted(void) {
+  const uint8_t app_glance_with_overflowing_attribute[] = {
+      // Version
+      APP_GLANCE_DB_CURRENT_VERSION,
+      // Creation time
+      0x14, 0x13, 0x4E, 0x57,   // 1464734484 (Tue, 31 May 2016 22:41:24 GMT)
+
+      // Slice 1
+      0x0B, 0x00,               // Total size
+      0x00,                     // AppGlanceSliceType - AppGlanceSliceType_IconAndSubtitle
+      0x02,                     // Number of attributes
+      // Slice Attributes
+      0x25,                     // Attribute ID - AttributeIdTimestamp
+      0x04, 0x00,               // Attribute Length
+      // Slice expiration time:
+      0x94, 0x64, 0x4F, 0x57,   // 1464820884 (Wed, 1 June 2016 22:41:24 GMT)
+
+      // Slice 2, which the second attribute of slice 1 would run into
+      0x0B, 0x00,               // Total size
+      0x00,                     // AppGlanceSliceType - AppGlanceSliceType_IconAndSubtitle
+      0x01,                     // Number of attributes
+      // Slice Attributes
+      0x25,                     // Attribute ID - AttributeIdTimestamp
+      0x04, 0x00,               // Attribute Length
+      // Slice expiration time:
+      0x95, 0x64, 0x4F, 0x57,   // 1464820884 (Wed, 1 June 2016 22:41:25 GMT)
+  };
+  cl_assert_equal_i(app_glance_db_insert((uint8_t *)&APP_GLANCE_TEST_UUID, UUID_SIZE,
+                                         app_glance_with_overflowing_attribute,
+                                         sizeof(app_glance_with_overflowing_attribute)),
+                    E_INVALID_ARGUMENT);
+}
+
 // Glance Tests
 ////////////////////////////////////////////////////////////////
 
@@ -566,3 +642,48 @@ void test_app_glance_db__insert_app_in_cache(void) {
       s_app_glance_basic, sizeof(s_app_glance_basic)), S_SUCCESS);
   cl_assert_equal_i(s_launch_count, 1);
 }
+
+void test_app_glance_db__read_glance_opens_settings_file_once(void) {
+  test_app_glance_db__basic_glance_insert_and_read();
+
+  const uint32_t num_opens_before = fake_settings_file_get_num_opens();
+  AppGlance read_back_glance = {};
+  cl_assert_equal_i(app_glance_db_read_glance(&APP_GLANCE_TEST_UUID, &read_back_glance),
+                    S_SUCCESS);
+  cl_assert_equal_i(fake_settings_file_get_num_opens() - num_opens_before, 1);
+}
+
+void test_app_glance_db__repeated_insert_and_read(void) {
+  // Like an app that updates its glance every minute, which the launcher then reads back
+  const int num_updates = 100;
+  AppGlance glance = (AppGlance) {
+    .num_slices = APP_GLANCE_DB_MAX_SLICES_PER_GLANCE,
+  };
+  for (unsigned int i = 0; i < APP_GLANCE_DB_MAX_SLICES_PER_GLANCE; i++) {
+    glance.slices[i] = (AppGlanceSliceInternal) {
+      .type = AppGlanceSliceType_IconAndSubtitle,
+      .icon_and_subtitle = {
+        .icon_resource_id = RESOURCE_ID_SETTINGS_ICON_AIRPLANE,
+        .template_string = "{time_until(500)|format('%uS',' left')}",
+      },
+    };
+  }
+
+  const uint32_t num_opens_before = fake_settings_file_get_num_opens();
+  fake_rtc_init(0, 1464734484);
+  for (int i = 0; i < num_updates; i++) {
+    fake_rtc_increment_time(SECONDS_PER_MINUTE);
+    for (unsigned int j = 0; j < APP_GLANCE_DB_MAX_SLICES_PER_GLANCE; j++) {
+      glance.slices[j].expiration_time = rtc_get_time() + (j + 1) * SECONDS_PER_MINUTE;
+    }
+    cl_assert_equal_i(app_glance_db_insert_glance(&APP_GLANCE_TEST_UUID, &glance), S_SUCCESS);
+
+    AppGlance read_back_glance = {};
+    cl_assert_equal_i(app_glance_db_read_glance(&APP_GLANCE_TEST_UUID, &read_back_glance),
+                      S_SUCCESS);
+    cl_assert_equal_m(&glance, &read_back_glance, sizeof(AppGlance));
+  }
+
+  // Two opens to insert the glance and one to read it back
+  cl_assert_equal_i(fake_settings_file_get_num_opens() - num_opens_before, 3 * num_updates);
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "clar.h"
+
+#include "services/normal/blob_db/sync_util.h"
+#include "services/normal/blob_db/timeline_item_storage.h"
+#include "services/normal/blob_db/util.h"
+#include "services/normal/filesystem/pfs.h"
+#include "util/time/time.h"
+#include "util/units.h"
+
+// Fakes
+////////////////////////////////////////////////////////////////
+#include "fake_pbl_malloc.h"
+#include "fake_rtc.h"
+#include "fake_spi_flash.h"
+
+// Stubs
+////////////////////////////////////////////////////////////////
+#include "stubs_analytics.h"
+#include "stubs_hexdump.h"
+#include "stubs_layout_layer.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_prompt.h"
+#include "stubs_rand_ptr.h"
+#include "stubs_sleep.h"
+#include "stubs_task_watchdog.h"
+
+// Setup
+////////////////////////////////////////////////////////////////
+
+// Fits in the index, which holds at most 128 items
+#define NUM_ITEMS 120
+#define INDEX_MAX_CAPACITY 128
+#define NUM_EXTRA_CHILDREN 20
+#define CHILDREN_PER_PARENT 3
+#define MAX_ITEM_AGE (15 * SECONDS_PER_MINUTE)
+
+static const time_t s_now = 1421178000; // Tue Jan 13 11:40:00 PST 2015
+
+static TimezoneInfo s_tz = {
+  .tm_gmtoff = -8 * SECONDS_PER_HOUR, // PST
+};
+
+static char s_file_name[] = "tlitemstorage";
+static TimelineItemStorage s_storage;
+
+static void prv_make_id(uint8_t tag, int n, TimelineItemId *id_out) {
+  *id_out = (TimelineItemId) {
+    tag, 0x65, 0x2e, 0xb9, 0x26, 0xd6, 0x44, 0x2c,
+    0x98, 0x68, 0xa4, 0x36, 0x79, 0x7d, (n >> 8) & 0xff, n & 0xff,
+  };
+}
+
+static void prv_make_header(int n, SerializedTimelineItemHeader *hdr_out) {
+  *hdr_out = (SerializedTimelineItemHeader) {
+    .common = {
+      .duration = 0,
+      .type = TimelineItemTypeReminder,
+      .layout = LayoutIdTest,
+      // Every fifth item is floating, so its timestamp is in local time
+      .is_floating = ((n % 5) == 0),
+    },
+  };
+  prv_make_id(0x01, n, &hdr_out->common.id);
+  prv_make_id(0x02, n / CHILDREN_PER_PARENT, &hdr_out->common.parent_id);
+  // Spread the items one minute apart in a shuffled order. The floating items are a few seconds
+  // off the minute so that no two items share a timestamp once the timezone is applied.
+  const time_t utc_timestamp = s_now + ((n * 137) % NUM_ITEMS) * SECONDS_PER_MINUTE;
+  hdr_out->common.timestamp = hdr_out->common.is_floating ?
+      (utc_timestamp + s_tz.tm_gmtoff + 7) : utc_timestamp;
+}
+
+static status_t prv_insert(int n) {
+  SerializedTimelineItemHeader hdr;
+  prv_make_header(n, &hdr);
+  return timeline_item_storage_insert(&s_storage, (uint8_t *)&hdr.common.id, sizeof(Uuid),
+                                      (uint8_t *)&hdr, sizeof(hdr), false);
+}
+
+void test_timeline_item_storage__initialize(void) {
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+  fake_rtc_init(0, s_now);
+  time_util_update_timezone(&s_tz);
+  timeline_item_storage_init(&s_storage, s_file_name, KiBYTES(64), MAX_ITEM_AGE);
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    cl_assert_equal_i(prv_insert(i), S_SUCCESS);
+  }
+}
+
+void test_timeline_item_storage__cleanup(void) {
+  timeline_item_storage_deinit(&s_storage);
+  fake_spi_flash_cleanup();
+}
+
+// Tests
+////////////////////////////////////////////////////////////////
+
+static bool prv_odd_items_filter(SerializedTimelineItemHeader *hdr, void *context) {
+  return (hdr->common.id.byte15 % 2);
+}
+
+static void prv_assert_next_item_matches_scan(TimelineItemStorageFilterCallback filter_cb) {
+  TimelineItemId indexed_id = {};
+  TimelineItemId scanned_id = {};
+  const status_t indexed_rv = timeline_item_storage_next_item(&s_storage, &indexed_id, filter_cb);
+  const status_t scanned_rv = timeline_item_storage_next_item_scan_all(&s_storage, &scanned_id,
+                                                                       filter_cb);
+  cl_assert_equal_i(indexed_rv, scanned_rv);
+  cl_assert(uuid_equal(&indexed_id, &scanned_id));
+}
+
+void test_timeline_item_storage__next_item_matches_scan(void) {
+  for (time_t now = s_now - SECONDS_PER_HOUR; now <= s_now + 9 * SECONDS_PER_HOUR;
+       now += 7 * SECONDS_PER_MINUTE) {
+    rtc_set_time(now);
+    prv_assert_next_item_matches_scan(NULL);
+    prv_assert_next_item_matches_scan(prv_odd_items_filter);
+  }
+  // Past the last item
+  TimelineItemId id;
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_NO_MORE_ITEMS);
+}
+
+void test_timeline_item_storage__next_item_follows_changes(void) {
+  TimelineItemId first_id;
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &first_id, NULL), S_SUCCESS);
+
+  // Deleting the next item moves on to the one after it
+  cl_assert_equal_i(timeline_item_storage_delete(&s_storage, (uint8_t *)&first_id, sizeof(Uuid)),
+                    S_SUCCESS);
+  TimelineItemId id;
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  cl_assert(!uuid_equal(&id, &first_id));
+  prv_assert_next_item_matches_scan(NULL);
+
+  // An item inserted before everything else is next
+  SerializedTimelineItemHeader hdr;
+  prv_make_header(NUM_ITEMS, &hdr);
+  hdr.common.is_floating = false;
+  hdr.common.timestamp = s_now - SECONDS_PER_MINUTE;
+  cl_assert_equal_i(timeline_item_storage_insert(&s_storage, (uint8_t *)&hdr.common.id,
+                                                 sizeof(Uuid), (uint8_t *)&hdr, sizeof(hdr),
+                                                 false), S_SUCCESS);
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  cl_assert(uuid_equal(&id, &hdr.common.id));
+
+  // Moving it to the end makes it the last one
+  hdr.common.timestamp = s_now + DAYS_PER_WEEK * SECONDS_PER_DAY;
+  cl_assert_equal_i(timeline_item_storage_insert(&s_storage, (uint8_t *)&hdr.common.id,
+                                                 sizeof(Uuid), (uint8_t *)&hdr, sizeof(hdr),
+                                                 false), S_SUCCESS);
+  prv_assert_next_item_matches_scan(NULL);
+  rtc_set_time(s_now + 9 * SECONDS_PER_HOUR);
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  cl_assert(uuid_equal(&id, &hdr.common.id));
+}
+
+void test_timeline_item_storage__next_item_flash_reads(void) {
+  TimelineItemId id;
+  // The first query builds the index
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+
+  uint32_t reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  const uint32_t indexed_reads = fake_flash_read_count() - reads;
+
+  reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, prv_odd_items_filter),
+                    S_SUCCESS);
+  const uint32_t indexed_filtered_reads = fake_flash_read_count() - reads;
+
+  reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item_scan_all(&s_storage, &id,
+                                                             prv_odd_items_filter), S_SUCCESS);
+  const uint32_t scan_reads = fake_flash_read_count() - reads;
+
+  cl_assert_equal_i(indexed_reads, 0);
+  cl_assert(indexed_filtered_reads * 4 < scan_reads);
+}
+
+static int s_num_children_deleted;
+
+static void prv_child_deleted(const Uuid *id) {
+  s_num_children_deleted++;
+}
+
+void test_timeline_item_storage__delete_with_parent(void) {
+  const int parent = 22;
+  TimelineItemId parent_id;
+  prv_make_id(0x02, parent, &parent_id);
+  TimelineItemId missing_parent_id;
+  prv_make_id(0x03, parent, &missing_parent_id);
+
+  cl_assert(timeline_item_storage_exists_with_parent(&s_storage, &parent_id));
+
+  uint32_t reads = fake_flash_read_count();
+  cl_assert(!timeline_item_storage_exists_with_parent(&s_storage, &missing_parent_id));
+  cl_assert_equal_i(fake_flash_read_count() - reads, 0);
+
+  s_num_children_deleted = 0;
+  cl_assert_equal_i(timeline_item_storage_delete_with_parent(&s_storage, &parent_id,
+                                                             prv_child_deleted), S_SUCCESS);
+  cl_assert_equal_i(s_num_children_deleted, CHILDREN_PER_PARENT);
+  cl_assert(!timeline_item_storage_exists_with_parent(&s_storage, &parent_id));
+
+  for (int i = parent * CHILDREN_PER_PARENT; i < (parent + 1) * CHILDREN_PER_PARENT; i++) {
+    TimelineItemId id;
+    prv_make_id(0x01, i, &id);
+    cl_assert_equal_i(timeline_item_storage_get_len(&s_storage, (uint8_t *)&id, sizeof(id)), 0);
+  }
+
+  // The siblings of other parents are untouched
+  TimelineItemId other_parent_id;
+  prv_make_id(0x02, parent + 1, &other_parent_id);
+  cl_assert(timeline_item_storage_exists_with_parent(&s_storage, &other_parent_id));
+  prv_assert_next_item_matches_scan(NULL);
+}
+
+void test_timeline_item_storage__flush_rebuilds_index(void) {
+  TimelineItemId id;
+  cl_assert(!timeline_item_storage_is_empty(&s_storage));
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+
+  // None of the items are from the watch, so flushing removes all of them
+  cl_assert_equal_i(timeline_item_storage_flush(&s_storage), S_SUCCESS);
+  cl_assert(timeline_item_storage_is_empty(&s_storage));
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_NO_MORE_ITEMS);
+
+  cl_assert_equal_i(prv_insert(0), S_SUCCESS);
+  cl_assert(!timeline_item_storage_is_empty(&s_storage));
+  prv_assert_next_item_matches_scan(NULL);
+}
+
+static bool prv_count_cb(SettingsFile *file, SettingsRecordInfo *info, void *context) {
+  return true;
+}
+
+void test_timeline_item_storage__dirty_list_batches(void) {
+  // Every item was inserted unsynced
+  uint32_t reads = fake_flash_read_count();
+  cl_assert(timeline_item_storage_is_dirty(&s_storage));
+  cl_assert_equal_i(fake_flash_read_count() - reads, 0);
+
+  reads = fake_flash_read_count();
+  BlobDBDirtyItem *dirty_list = NULL;
+  timeline_item_storage_each(&s_storage, sync_util_build_dirty_list_cb, &dirty_list);
+  const uint32_t batch_reads = fake_flash_read_count() - reads;
+  cl_assert_equal_i(list_count(&dirty_list->node), SYNC_UTIL_DIRTY_LIST_BATCH_SIZE);
+
+  reads = fake_flash_read_count();
+  timeline_item_storage_each(&s_storage, prv_count_cb, NULL);
+  const uint32_t scan_reads = fake_flash_read_count() - reads;
+
+  cl_assert(batch_reads * 4 < scan_reads);
+
+  // Drain the dirty set batch by batch, like a sync session would
+  int num_synced = 0;
+  while (dirty_list) {
+    BlobDBDirtyItem *item = dirty_list;
+    while (item) {
+      cl_must_pass(timeline_item_storage_mark_synced(&s_storage, item->key, item->key_len));
+      num_synced++;
+      item = (BlobDBDirtyItem *)item->node.next;
+    }
+    blob_db_util_free_dirty_list(dirty_list);
+    dirty_list = NULL;
+    timeline_item_storage_each(&s_storage, sync_util_build_dirty_list_cb, &dirty_list);
+  }
+  cl_assert_equal_i(num_synced, NUM_ITEMS);
+  cl_assert(!timeline_item_storage_is_dirty(&s_storage));
+}
+
+void test_timeline_item_storage__too_many_items_to_index(void) {
+  // Give one parent more children than a single scan for children finds, and take the storage
+  // past what the index can hold so that every query falls back to scanning the file
+  const int parent = 22;
+  TimelineItemId parent_id;
+  prv_make_id(0x02, parent, &parent_id);
+  for (int i = 0; i < NUM_EXTRA_CHILDREN; i++) {
+    SerializedTimelineItemHeader hdr;
+    prv_make_header(NUM_ITEMS + i, &hdr);
+    hdr.common.parent_id = parent_id;
+    hdr.common.is_floating = false;
+    hdr.common.timestamp = s_now + (NUM_ITEMS + i) * SECONDS_PER_MINUTE;
+    cl_assert_equal_i(timeline_item_storage_insert(&s_storage, (uint8_t *)&hdr.common.id,
+                                                   sizeof(Uuid), (uint8_t *)&hdr, sizeof(hdr),
+                                                   false), S_SUCCESS);
+  }
+
+  TimelineItemId id;
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  const uint32_t reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  cl_assert(fake_flash_read_count() - reads > 0);
+  prv_assert_next_item_matches_scan(NULL);
+  prv_assert_next_item_matches_scan(prv_odd_items_filter);
+
+  s_num_children_deleted = 0;
+  cl_assert_equal_i(timeline_item_storage_delete_with_parent(&s_storage, &parent_id,
+                                                             prv_child_deleted), S_SUCCESS);
+  cl_assert_equal_i(s_num_children_deleted, CHILDREN_PER_PARENT + NUM_EXTRA_CHILDREN);
+  cl_assert(!timeline_item_storage_exists_with_parent(&s_storage, &parent_id));
+
+  // Back within the capacity, the index is built again
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  const uint32_t indexed_reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  cl_assert_equal_i(fake_flash_read_count() - indexed_reads, 0);
+  prv_assert_next_item_matches_scan(NULL);
+}
+
+static bool prv_next_item_is_indexed(void) {
+  TimelineItemId id;
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  const uint32_t reads = fake_flash_read_count();
+  cl_assert_equal_i(timeline_item_storage_next_item(&s_storage, &id, NULL), S_SUCCESS);
+  return (fake_flash_read_count() == reads);
+}
+
+static void prv_delete(int n) {
+  SerializedTimelineItemHeader hdr;
+  prv_make_header(n, &hdr);
+  cl_assert_equal_i(timeline_item_storage_delete(&s_storage, (uint8_t *)&hdr.common.id,
+                                                 sizeof(Uuid)), S_SUCCESS);
+}
+
+void test_timeline_item_storage__too_large_until_below_capacity(void) {
+  cl_assert(prv_next_item_is_indexed());
+  // Two items over the capacity, added while the index is in use
+  const int num_items = INDEX_MAX_CAPACITY + 2;
+  for (int i = NUM_ITEMS; i < num_items; i++) {
+    cl_assert_equal_i(prv_insert(i), S_SUCCESS);
+  }
+  cl_assert(!prv_next_item_is_indexed());
+
+  // Overwriting an item doesn't change the number of items
+  cl_assert_equal_i(prv_insert(0), S_SUCCESS);
+  prv_delete(1);
+  cl_assert(!prv_next_item_is_indexed());
+  prv_delete(2);
+  cl_assert(!prv_next_item_is_indexed());
+  prv_assert_next_item_matches_scan(NULL);
+
+  // Counted from the file when the storage is reopened too
+  timeline_item_storage_deinit(&s_storage);
+  timeline_item_storage_init(&s_storage, s_file_name, KiBYTES(64), MAX_ITEM_AGE);
+  cl_assert_equal_i(prv_insert(1), S_SUCCESS);
+  cl_assert(!prv_next_item_is_indexed());
+  prv_delete(1);
+  cl_assert(!prv_next_item_is_indexed());
+
+  // One below the capacity, all of the items fit again
+  prv_delete(3);
+  cl_assert(prv_next_item_is_indexed());
+  prv_assert_next_item_matches_scan(NULL);
+  prv_assert_next_item_matches_scan(prv_odd_items_filter);
+}
@@ -47,10 +47,12 @@
 // Tests
 ////////////////////////////////////
 extern status_t settings_file_compact(SettingsFile *file);
+extern void settings_file_reset_all_state(void);
 
 void test_settings_file__initialize(void) {
   fake_spi_flash_init(0, 0x1000000);
   pfs_init(false);
+  settings_file_reset_all_state();
 }
 
 void test_settings_file__cleanup(void) {}
@@ -233,6 +235,8 @@ void test_settings_file__compute_stats(void) {
   settings_file_compact(&file);
   const SettingsFile file_copy = file;
   settings_file_close(&file);
+  // Forget the stats kept for the closed file, so that they're computed from flash
+  settings_file_reset_all_state();
   cl_must_pass(settings_file_open(&file, "test_file_max_storage", max_used_space));
   cl_assert_equal_i(file.max_used_space, file_copy.max_used_space);
   cl_assert_equal_i(file.max_space_total, file_copy.max_space_total);
@@ -380,6 +384,7 @@ static RecordResult write_and_change_record_aborting_after_bytes(int after_n_byt
     extern void pfs_reset_all_state(void);
     pfs_reset_all_state();
     pfs_init(false);
+    settings_file_reset_all_state();
 
     // Reopen the file we were in the middle of writing.
     SettingsFile file_new;
@@ -681,3 +686,272 @@ void test_settings_file__iterator_wrapping(void) {
   after_count = settings_raw_iter_prv_get_num_record_searches();
   cl_assert_equal_i(NUM_RECORDS - 1, after_count - before_count);
 }
+
+void test_settings_file__dirty_count(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_dirty_count", 4096));
+  cl_assert_equal_i(0, settings_file_get_num_dirty(&file));
+
+  uint8_t key[5];
+  int key_len = 4;
+  uint8_t val[5];
+  int val_len = 4;
+
+  memcpy(key, "key0", key_len);
+  memcpy(val, "val0", val_len);
+  cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+  cl_assert_equal_i(1, settings_file_get_num_dirty(&file));
+
+  // Overwriting a dirty record replaces it rather than adding another
+  memcpy(val, "val1", val_len);
+  cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+  cl_assert_equal_i(1, settings_file_get_num_dirty(&file));
+
+  cl_must_pass(settings_file_mark_synced(&file, key, key_len));
+  cl_assert_equal_i(0, settings_file_get_num_dirty(&file));
+  cl_must_pass(settings_file_mark_synced(&file, key, key_len));
+  cl_assert_equal_i(0, settings_file_get_num_dirty(&file));
+
+  // Overwriting a synced record makes it dirty again
+  memcpy(val, "val2", val_len);
+  cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+  cl_assert_equal_i(1, settings_file_get_num_dirty(&file));
+
+  cl_must_pass(settings_file_delete(&file, key, key_len));
+  cl_assert_equal_i(0, settings_file_get_num_dirty(&file));
+
+  // Whether a deleted record has expired depends on the time. Deleted records never count, so
+  // counting them again from flash after the clock went back still agrees.
+  rtc_set_time(rtc_get_time() - SECONDS_PER_DAY);
+  settings_file_close(&file);
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, "test_dirty_count", 4096));
+  cl_assert_equal_i(0, settings_file_get_num_dirty(&file));
+  rtc_set_time(rtc_get_time() + SECONDS_PER_DAY);
+
+  const int NUM_RECORDS = 10;
+  for (int i = 0; i < NUM_RECORDS; i++) {
+    snprintf((char *)key, sizeof(key), "k%03d", i);
+    snprintf((char *)val, sizeof(val), "v%03d", i);
+    cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+  }
+  for (int i = 0; i < NUM_RECORDS; i += 2) {
+    snprintf((char *)key, sizeof(key), "k%03d", i);
+    cl_must_pass(settings_file_mark_synced(&file, key, key_len));
+  }
+  cl_assert_equal_i(NUM_RECORDS / 2, settings_file_get_num_dirty(&file));
+
+  // The count is kept when the file is closed and opened again
+  settings_file_close(&file);
+  cl_must_pass(settings_file_open(&file, "test_dirty_count", 4096));
+  cl_assert_equal_i(NUM_RECORDS / 2, settings_file_get_num_dirty(&file));
+  settings_file_close(&file);
+
+  // ...and rebuilt from flash after a reboot
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, "test_dirty_count", 4096));
+  cl_assert_equal_i(NUM_RECORDS / 2, settings_file_get_num_dirty(&file));
+  settings_file_close(&file);
+}
+
+static void prv_assert_stats_equal(const SettingsFile *a, const SettingsFile *b) {
+  cl_assert_equal_i(a->used_space, b->used_space);
+  cl_assert_equal_i(a->dead_space, b->dead_space);
+  cl_assert_equal_i(a->last_modified, b->last_modified);
+  cl_assert_equal_i(a->dirty_count, b->dirty_count);
+}
+
+void test_settings_file__reopen_keeps_stats(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  uint8_t key[5];
+  int key_len = 4;
+  uint8_t val[5];
+  int val_len = 4;
+  for (int i = 0; i < 40; i++) {
+    fake_rtc_increment_time(1);
+    snprintf((char *)key, sizeof(key), "k%03d", i % 16);
+    snprintf((char *)val, sizeof(val), "v%03d", i);
+    cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+    if (i % 3 == 0) {
+      cl_must_pass(settings_file_delete(&file, key, key_len));
+    }
+    if (i % 5 == 0) {
+      cl_must_pass(settings_file_mark_synced(&file, key, key_len));
+    }
+  }
+  settings_file_close(&file);
+
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  const SettingsFile cached = file;
+  settings_file_close(&file);
+
+  // The stats kept up to date by the writes match the ones computed from flash
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  prv_assert_stats_equal(&cached, &file);
+  settings_file_close(&file);
+}
+
+void test_settings_file__reopen_after_remove(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_must_pass(settings_file_set(&file, "key", 3, "val", 3));
+  settings_file_close(&file);
+
+  // A file that was removed and created again doesn't get the stats of the old one
+  pfs_remove("test_reopen");
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_assert_equal_i(file.used_space, sizeof(SettingsFileHeader) + sizeof(SettingsRecordHeader));
+  cl_assert_equal_i(file.dirty_count, 0);
+  cl_assert(!settings_file_exists(&file, "key", 3));
+  settings_file_close(&file);
+}
+
+static void prv_copy_file(const char *from, const char *to) {
+  const int from_fd = pfs_open(from, OP_FLAG_READ, 0, 0);
+  cl_assert(from_fd >= 0);
+  const size_t size = pfs_get_file_size(from_fd);
+  uint8_t *buf = malloc(size);
+  cl_assert_equal_i(pfs_read(from_fd, buf, size), size);
+  pfs_close(from_fd);
+
+  const int to_fd = pfs_open(to, OP_FLAG_OVERWRITE | OP_FLAG_READ, FILE_TYPE_STATIC, size);
+  cl_assert(to_fd >= 0);
+  cl_assert_equal_i(pfs_write(to_fd, buf, size), size);
+  pfs_close(to_fd);
+  free(buf);
+}
+
+void test_settings_file__reopen_after_replace(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_must_pass(settings_file_set(&file, "key", 3, "val", 3));
+  settings_file_close(&file);
+
+  SettingsFile other;
+  cl_must_pass(settings_file_open(&other, "test_other", 4096));
+  cl_must_pass(settings_file_set(&other, "a", 1, "1", 1));
+  cl_must_pass(settings_file_set(&other, "bb", 2, "22", 2));
+  cl_must_pass(settings_file_set(&other, "ccc", 3, "333", 3));
+  cl_must_pass(settings_file_mark_synced(&other, "a", 1));
+  const SettingsFile other_stats = other;
+  settings_file_close(&other);
+
+  // A file that was replaced under the same name doesn't get the stats of the old one
+  prv_copy_file("test_other", "test_reopen");
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  prv_assert_stats_equal(&other_stats, &file);
+  cl_assert(settings_file_exists(&file, "ccc", 3));
+  cl_assert(!settings_file_exists(&file, "key", 3));
+  settings_file_close(&file);
+}
+
+void test_settings_file__reopen_after_compaction(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_reopen", 2048));
+  uint8_t key[5];
+  int key_len = 4;
+  uint8_t val[5];
+  int val_len = 4;
+  // Enough overwrites to force a few automatic compactions
+  for (int i = 0; i < 500; i++) {
+    snprintf((char *)key, sizeof(key), "k%03d", i % 20);
+    snprintf((char *)val, sizeof(val), "v%03d", i);
+    cl_must_pass(settings_file_set(&file, key, key_len, val, val_len));
+  }
+  cl_must_pass(settings_file_compact(&file));
+  settings_file_close(&file);
+
+  cl_must_pass(settings_file_open(&file, "test_reopen", 2048));
+  const SettingsFile cached = file;
+  settings_file_close(&file);
+
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, "test_reopen", 2048));
+  prv_assert_stats_equal(&cached, &file);
+  settings_file_close(&file);
+}
+
+//! Opens the file with its remembered stats and again after forgetting them, so they have to be
+//! counted from flash at the current time
+static void prv_assert_reopened_stats_match_flash(const char *name) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, name, 4096));
+  const SettingsFile cached = file;
+  settings_file_close(&file);
+
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, name, 4096));
+  prv_assert_stats_equal(&cached, &file);
+  settings_file_close(&file);
+}
+
+void test_settings_file__reopen_after_deleted_record_expires(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_must_pass(settings_file_set(&file, "key", 3, "val", 3));
+  cl_must_pass(settings_file_set(&file, "other", 5, "val", 3));
+
+  // Deleted with the clock a day ahead, so the deleted record hasn't expired once it's back
+  rtc_set_time(rtc_get_time() + SECONDS_PER_DAY);
+  cl_must_pass(settings_file_delete(&file, "key", 3));
+  rtc_set_time(rtc_get_time() - SECONDS_PER_DAY);
+  settings_file_close(&file);
+  settings_file_reset_all_state();
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  const int used_space_before_expiry = file.used_space;
+  settings_file_close(&file);
+  prv_assert_reopened_stats_match_flash("test_reopen");
+
+  // Once it has expired, it counts as dead space
+  rtc_set_time(rtc_get_time() + (2 * SECONDS_PER_DAY));
+  prv_assert_reopened_stats_match_flash("test_reopen");
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_assert(file.used_space < used_space_before_expiry);
+  // Writes account for it the same way
+  cl_must_pass(settings_file_set(&file, "other", 5, "new", 3));
+  settings_file_close(&file);
+  prv_assert_reopened_stats_match_flash("test_reopen");
+
+  // ...until the clock goes back to before it expired
+  rtc_set_time(rtc_get_time() - (2 * SECONDS_PER_DAY));
+  prv_assert_reopened_stats_match_flash("test_reopen");
+  cl_must_pass(settings_file_open(&file, "test_reopen", 4096));
+  cl_must_pass(settings_file_set(&file, "third", 5, "val", 3));
+  settings_file_close(&file);
+  prv_assert_reopened_stats_match_flash("test_reopen");
+}
+
+//! Like a blob db lookup, which opens the file, reads one record and closes it again
+static uint32_t prv_count_flash_reads_for_lookup(const char *name, uint8_t *key, int key_len) {
+  const uint32_t reads_before = fake_flash_read_count();
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, name, 30 * 1024));
+  uint8_t val[8];
+  cl_must_pass(settings_file_get(&file, key, key_len, val, sizeof(val)));
+  settings_file_close(&file);
+  return fake_flash_read_count() - reads_before;
+}
+
+void test_settings_file__open_lookup_close_flash_reads(void) {
+  // About as many records as an app_db with a watch full of apps
+  const int num_records = 200;
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_lookup", 30 * 1024));
+  uint8_t key[5];
+  int key_len = 4;
+  uint8_t val[8] = {};
+  for (int i = 0; i < num_records; i++) {
+    snprintf((char *)key, sizeof(key), "k%03d", i);
+    cl_must_pass(settings_file_set(&file, key, key_len, val, sizeof(val)));
+  }
+  settings_file_close(&file);
+  settings_file_reset_all_state();
+
+  snprintf((char *)key, sizeof(key), "k%03d", num_records / 2);
+  const uint32_t first_reads = prv_count_flash_reads_for_lookup("test_lookup", key, key_len);
+  const uint32_t cached_reads = prv_count_flash_reads_for_lookup("test_lookup", key, key_len);
+  // Only the search for the record is left, the two full scans are skipped
+  cl_assert(cached_reads * 2 < first_reads);
+}
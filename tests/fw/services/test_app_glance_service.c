@@ -17,7 +17,9 @@
 #include "clar.h"
 
 #include "applib/app_glance.h"
+#include "applib/event_service_client.h"
 #include "drivers/rtc.h"
+#include "kernel/events.h"
 #include "kernel/pbl_malloc.h"
 #include "process_management/app_install_manager.h"
 #include "resource/resource_ids.auto.h"
@@ -27,9 +29,12 @@
 #include "services/normal/filesystem/pfs.h"
 #include "util/uuid.h"
 
+#include <stdio.h>
+
 // Fakes
 ////////////////////////////////////////////////////////////////
 
+#include "fake_new_timer.h"
 #include "fake_settings_file.h"
 
 // Stubs
@@ -38,11 +43,18 @@
 #include "stubs_app_cache.h"
 #include "stubs_app_install_manager.h"
 #include "stubs_events.h"
-#include "stubs_event_service_client.h"
 #include "stubs_logging.h"
 #include "stubs_mutex.h"
 #include "stubs_passert.h"
-#include "stubs_pbl_malloc.h"
+
+static EventServiceInfo *s_blob_db_event_info;
+void event_service_client_subscribe(EventServiceInfo *service_info) {
+  if (service_info->type == PEBBLE_BLOBDB_EVENT) {
+    s_blob_db_event_info = service_info;
+  }
+}
+
+void event_service_client_unsubscribe(EventServiceInfo *service_info) {}
 
 status_t pfs_remove(const char *name) {
   fake_settings_file_reset();
@@ -212,3 +224,157 @@ void test_app_glance_service__slice_with_no_expiration(void) {
   prv_check_expected_slice_data(no_expire_slice_data,
                                 expiring_slice_data->expiration_time + 9999999);
 }
+
+#define NUM_LAUNCHER_APPS (30)
+
+static const time_t s_launcher_glances_time = 1464734484; // (Tue, 31 May 2016 22:41:24 GMT)
+
+static Uuid prv_launcher_app_uuid(int app) {
+  Uuid uuid = APP_GLANCE_TEST_UUID;
+  uuid.byte15 = app;
+  return uuid;
+}
+
+static bool prv_launcher_app_has_glance(int app) {
+  // Only some of the apps in the launcher have a glance
+  return (app % 3) != 0;
+}
+
+static AppGlance prv_launcher_app_glance(int app) {
+  AppGlance glance = (AppGlance) {
+    .num_slices = 2,
+    .slices = {
+      {
+        .expiration_time = s_launcher_glances_time + 60 * (app + 1),
+        .type = AppGlanceSliceType_IconAndSubtitle,
+        .icon_and_subtitle.icon_resource_id = RESOURCE_ID_SETTINGS_ICON_AIRPLANE,
+      },
+      {
+        .expiration_time = APP_GLANCE_SLICE_NO_EXPIRATION,
+        .type = AppGlanceSliceType_IconAndSubtitle,
+        .icon_and_subtitle.icon_resource_id = RESOURCE_ID_SETTINGS_ICON_BLUETOOTH_ALT,
+      },
+    },
+  };
+  snprintf(glance.slices[0].icon_and_subtitle.template_string,
+           sizeof(glance.slices[0].icon_and_subtitle.template_string), "App %d", app);
+  snprintf(glance.slices[1].icon_and_subtitle.template_string,
+           sizeof(glance.slices[1].icon_and_subtitle.template_string), "App %d later", app);
+  return glance;
+}
+
+static void prv_put_blob_db_event(BlobDBEventType type, const Uuid *app_uuid) {
+  PebbleEvent event = {
+    .type = PEBBLE_BLOBDB_EVENT,
+    .blob_db = {
+      .db_id = BlobDBIdAppGlance,
+      .type = type,
+      .key = (uint8_t *)app_uuid,
+      .key_len = app_uuid ? UUID_SIZE : 0,
+    },
+  };
+  s_blob_db_event_info->handler(&event, s_blob_db_event_info->context);
+}
+
+//! Requests the current slice of the apps from first_app to last_app (in either direction) like
+//! the launcher does when it is scrolled through
+//! @return the number of times the glance database had to be opened
+static uint32_t prv_scroll_launcher_apps(time_t now, int first_app, int last_app) {
+  const uint32_t num_opens_before = fake_settings_file_get_num_opens();
+  const int step = (first_app <= last_app) ? 1 : -1;
+  for (int app = first_app; app != last_app + step; app += step) {
+    const Uuid app_uuid = prv_launcher_app_uuid(app);
+    AppGlanceSliceInternal slice_out;
+    const bool has_slice = app_glance_service_get_current_slice(&app_uuid, &slice_out);
+    cl_assert_equal_b(has_slice, prv_launcher_app_has_glance(app));
+    if (has_slice) {
+      const AppGlance glance = prv_launcher_app_glance(app);
+      const AppGlanceSliceInternal *expected_slice =
+          (now < glance.slices[0].expiration_time) ? &glance.slices[0] : &glance.slices[1];
+      cl_assert_equal_m(&slice_out, expected_slice, sizeof(slice_out));
+    }
+  }
+  return fake_settings_file_get_num_opens() - num_opens_before;
+}
+
+static uint32_t prv_scroll_launcher(time_t now) {
+  return prv_scroll_launcher_apps(now, 0, NUM_LAUNCHER_APPS - 1);
+}
+
+static void prv_insert_launcher_glances(int num_apps) {
+  for (int app = 0; app < num_apps; app++) {
+    if (prv_launcher_app_has_glance(app)) {
+      const Uuid app_uuid = prv_launcher_app_uuid(app);
+      const AppGlance glance = prv_launcher_app_glance(app);
+      cl_assert_equal_i(app_glance_db_insert_glance(&app_uuid, &glance), S_SUCCESS);
+    }
+  }
+}
+
+void test_app_glance_service__launcher_scrolling_uses_cache(void) {
+  const time_t now = s_launcher_glances_time;
+  rtc_set_time(now);
+  prv_insert_launcher_glances(NUM_LAUNCHER_APPS);
+
+  // Only the first pass through the launcher reads the glances
+  const uint32_t first_pass_opens = prv_scroll_launcher(now);
+  uint32_t later_pass_opens = 0;
+  for (int i = 0; i < 10; i++) {
+    later_pass_opens += prv_scroll_launcher(now);
+  }
+  cl_assert(first_pass_opens >= NUM_LAUNCHER_APPS);
+  cl_assert_equal_i(later_pass_opens, 0);
+
+  // Updating a glance only rereads that glance. The update needs a newer creation time.
+  rtc_set_time(now + 1);
+  const Uuid updated_app_uuid = prv_launcher_app_uuid(1);
+  const AppGlance updated_glance = prv_launcher_app_glance(1);
+  cl_assert_equal_i(app_glance_db_insert_glance(&updated_app_uuid, &updated_glance), S_SUCCESS);
+  prv_put_blob_db_event(BlobDBEventTypeInsert, &updated_app_uuid);
+  cl_assert_equal_i(prv_scroll_launcher(now + 1), 1);
+  cl_assert_equal_i(prv_scroll_launcher(now + 1), 0);
+
+  // Once the first slices of the first 5 apps expire, only those apps' glances are reread
+  const time_t later = now + (60 * 5);
+  rtc_set_time(later);
+  const uint32_t num_expired_apps_with_glances = 3; // Apps 1, 2 and 4
+  cl_assert_equal_i(prv_scroll_launcher(later), num_expired_apps_with_glances);
+  cl_assert_equal_i(prv_scroll_launcher(later), 0);
+
+  // The expiration timer is set for the next slice to expire, app 5's first slice
+  cl_assert_equal_i(s_new_timer_start_param_timeout_ms, 60 * MS_PER_SECOND);
+
+  // Flushing the database drops every glance
+  app_glance_db_flush();
+  prv_put_blob_db_event(BlobDBEventTypeFlush, NULL);
+  const uint32_t num_opens_before = fake_settings_file_get_num_opens();
+  for (int app = 0; app < NUM_LAUNCHER_APPS; app++) {
+    const Uuid app_uuid = prv_launcher_app_uuid(app);
+    AppGlanceSliceInternal slice_out;
+    cl_assert_equal_b(app_glance_service_get_current_slice(&app_uuid, &slice_out), false);
+  }
+  cl_assert(fake_settings_file_get_num_opens() - num_opens_before >= NUM_LAUNCHER_APPS);
+}
+
+void test_app_glance_service__launcher_with_more_apps_than_cache_entries(void) {
+  const int num_apps = APP_GLANCE_SERVICE_CACHE_NUM_ENTRIES + 18;
+  const time_t now = s_launcher_glances_time;
+  rtc_set_time(now);
+  prv_insert_launcher_glances(num_apps);
+
+  // The cache evicts the least recently used entry, so going straight through more apps than it
+  // holds drops every entry before it's needed again and every pass reads every glance
+  cl_assert(prv_scroll_launcher_apps(now, 0, num_apps - 1) >= num_apps);
+  cl_assert(prv_scroll_launcher_apps(now, 0, num_apps - 1) >= num_apps);
+
+  // Scrolling back over the apps that were just shown doesn't read any of them
+  const int first_cached_app = num_apps - APP_GLANCE_SERVICE_CACHE_NUM_ENTRIES;
+  cl_assert_equal_i(prv_scroll_launcher_apps(now, num_apps - 1, first_cached_app), 0);
+  cl_assert_equal_i(prv_scroll_launcher_apps(now, first_cached_app, num_apps - 1), 0);
+
+  // Going one app further back evicts the least recently used entry, the first app of the last
+  // pass, and keeps the others
+  cl_assert(prv_scroll_launcher_apps(now, first_cached_app - 1, first_cached_app - 1) >= 1);
+  cl_assert_equal_i(prv_scroll_launcher_apps(now, first_cached_app + 1, num_apps - 1), 0);
+  cl_assert(prv_scroll_launcher_apps(now, first_cached_app, first_cached_app) >= 1);
+}
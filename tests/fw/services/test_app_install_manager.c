@@ -43,6 +43,7 @@
 #include "stubs_analytics.h"
 #include "stubs_app_manager.h"
 #include "stubs_app_state.h"
+#include "stubs_bitmap_cache.h"
 #include "stubs_bootbits.h"
 #include "stubs_event_service_client.h"
 #include "stubs_events.h"
@@ -563,3 +564,34 @@ void test_app_install_manager__recently_communicated(void) {
   app_install_unmark_prioritized(music_id);
   cl_assert_equal_b(false, app_install_is_prioritized(music_id));
 }
+
+void test_app_install_manager__app_db_entry_cache(void) {
+  AppInstallEntry entry;
+  uint32_t reads_before = fake_flash_read_count();
+  cl_assert_equal_b(true, app_install_get_entry_for_install_id(menu_layer_id, &entry));
+  cl_assert_equal_b(true, app_install_get_entry_for_install_id(bg_counter_id, &entry));
+  // The first lookups read the entries from app_db
+  cl_assert(fake_flash_read_count() > reads_before);
+  cl_assert_equal_s(entry.name, bg_counter.name);
+
+  // Asking again doesn't have to go to flash
+  reads_before = fake_flash_read_count();
+  for (int i = 0; i < 10; i++) {
+    cl_assert_equal_b(true, app_install_get_entry_for_install_id(menu_layer_id, &entry));
+    cl_assert_equal_s(entry.name, menu_layer.name);
+    cl_assert_equal_b(true, app_install_get_entry_for_install_id(bg_counter_id, &entry));
+  }
+  cl_assert_equal_i(fake_flash_read_count() - reads_before, 0);
+
+  // Upgrading the app replaces the cached entry
+  AppDBEntry upgraded = menu_layer;
+  strncpy(upgraded.name, "Menu Layer 2", sizeof(upgraded.name));
+  cl_assert_equal_i(S_SUCCESS, app_db_insert((uint8_t *)&upgraded.uuid, sizeof(Uuid),
+                                             (uint8_t *)&upgraded, sizeof(AppDBEntry)));
+  cl_assert_equal_b(true, app_install_get_entry_for_install_id(menu_layer_id, &entry));
+  cl_assert_equal_s(entry.name, "Menu Layer 2");
+
+  // ...and removing it makes it go away
+  cl_assert_equal_i(S_SUCCESS, app_db_delete((uint8_t *)&upgraded.uuid, sizeof(Uuid)));
+  cl_assert_equal_b(false, app_install_get_entry_for_install_id(menu_layer_id, &entry));
+}
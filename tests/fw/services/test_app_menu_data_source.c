@@ -47,6 +47,7 @@
 #include "stubs_app_fetch_endpoint.h"
 #include "stubs_app_manager.h"
 #include "stubs_app_state.h"
+#include "stubs_bitmap_cache.h"
 #include "stubs_bootbits.h"
 #include "stubs_build_id.h"
 #include "stubs_comm_session.h"
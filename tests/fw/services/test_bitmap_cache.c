@@ -0,0 +1,149 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clar.h"
+
+#include "kernel/pbl_malloc.h"
+#include "services/normal/bitmap_cache.h"
+#include "services/normal/filesystem/app_file.h"
+#include "services/normal/filesystem/pfs.h"
+#include "services/normal/process_management/app_storage.h"
+#include "services/normal/settings/settings_file.h"
+
+#include <string.h>
+
+// Stubs
+////////////////////////////////////
+#include "fake_rtc.h"
+#include "fake_spi_flash.h"
+#include "stubs_analytics.h"
+#include "stubs_app_install_manager.h"
+#include "stubs_app_manager.h"
+#include "stubs_hexdump.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_prompt.h"
+#include "stubs_rand_ptr.h"
+#include "stubs_sleep.h"
+#include "stubs_syscall_internal.h"
+#include "stubs_system_reset.h"
+#include "stubs_task_watchdog.h"
+
+// Fakes
+////////////////////////////////////
+static uint32_t s_resource_crc;
+
+ResourceVersion resource_get_version(ResAppNum app_num, uint32_t resource_id) {
+  return (ResourceVersion) {
+    .crc = s_resource_crc,
+    .timestamp = 0,
+  };
+}
+
+bool resource_version_matches(const ResourceVersion *v1, const ResourceVersion *v2) {
+  return (v1->crc == v2->crc);
+}
+
+// Tests
+////////////////////////////////////
+#define TEST_APP_ID (5)
+#define TEST_RESOURCE_ID (3)
+
+static const uint8_t s_pbi_data[] = { 0x04, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00,
+                                      0x02, 0x00, 0x01, 0x00, 0xde, 0xad, 0xbe, 0xef };
+
+//! @return The size of the cached PBI data, 0 if there is none
+static size_t prv_load_size(ResAppNum app_num, uint32_t resource_id) {
+  size_t size = 0;
+  uint8_t *data = bitmap_cache_load(app_num, resource_id, &size);
+  if (!data) {
+    return 0;
+  }
+  task_free(data);
+  return size;
+}
+
+void test_bitmap_cache__initialize(void) {
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+  s_resource_crc = 0x12345678;
+  bitmap_cache_init();
+}
+
+void test_bitmap_cache__cleanup(void) {
+}
+
+void test_bitmap_cache__store_and_load(void) {
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), 0);
+
+  bitmap_cache_store(TEST_APP_ID, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), sizeof(s_pbi_data));
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID + 1), 0);
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID + 1, TEST_RESOURCE_ID), 0);
+
+  size_t size = 0;
+  uint8_t *data = bitmap_cache_load(TEST_APP_ID, TEST_RESOURCE_ID, &size);
+  cl_assert(data);
+  cl_assert_equal_i(size, sizeof(s_pbi_data));
+  cl_assert_equal_m(data, s_pbi_data, sizeof(s_pbi_data));
+  task_free(data);
+
+  cl_assert(!bitmap_cache_load(TEST_APP_ID, TEST_RESOURCE_ID + 1, &size));
+}
+
+void test_bitmap_cache__lookups_dont_create_files(void) {
+  char name[APP_FILENAME_MAX_LENGTH];
+  app_file_name_make(name, sizeof(name), TEST_APP_ID, "bmpcache", strlen("bmpcache"));
+
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), 0);
+  cl_assert(pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0) < 0);
+
+  bitmap_cache_store(TEST_APP_ID, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+  const int fd = pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0);
+  cl_assert(fd >= 0);
+  pfs_close(fd);
+}
+
+void test_bitmap_cache__stale_version(void) {
+  bitmap_cache_store(TEST_APP_ID, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+
+  // Updating the app changes the version of its resource bank
+  s_resource_crc++;
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), 0);
+}
+
+void test_bitmap_cache__system_resources_not_cached(void) {
+  bitmap_cache_store(SYSTEM_APP, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+  cl_assert_equal_i(prv_load_size(SYSTEM_APP, TEST_RESOURCE_ID), 0);
+}
+
+void test_bitmap_cache__too_large(void) {
+  static uint8_t s_large_data[SETTINGS_VAL_MAX_LEN];
+  bitmap_cache_store(TEST_APP_ID, TEST_RESOURCE_ID, s_large_data, sizeof(s_large_data));
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), 0);
+}
+
+void test_bitmap_cache__delete_app(void) {
+  bitmap_cache_store(TEST_APP_ID, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+  bitmap_cache_store(TEST_APP_ID + 1, TEST_RESOURCE_ID, s_pbi_data, sizeof(s_pbi_data));
+
+  bitmap_cache_delete_app(TEST_APP_ID);
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID, TEST_RESOURCE_ID), 0);
+  cl_assert_equal_i(prv_load_size(TEST_APP_ID + 1, TEST_RESOURCE_ID), sizeof(s_pbi_data));
+}
@@ -811,3 +811,111 @@ void test_cron__offset_positive_seconds_any_day_dst(void) {
   const time_t advance = SECONDS_PER_DAY;
   prv_basic_test(&s_timezone_gmt, &test_cron, s_2015_nov12_000000_gmt, advance, advance, 2);
 }
+
+#define NUM_ORDERED_JOBS CRON_MAX_JOBS
+#define NUM_ORDERED_CLOCK_CHANGES 20
+
+static CronJob *s_fired_jobs[NUM_ORDERED_JOBS];
+static int s_num_fired_jobs;
+
+static void prv_recording_cb(CronJob *job, void *cb_data) {
+  cl_assert(s_num_fired_jobs < NUM_ORDERED_JOBS);
+  s_fired_jobs[s_num_fired_jobs++] = job;
+}
+
+void test_cron__max_jobs_through_clock_changes(void) {
+  static CronJob jobs[NUM_ORDERED_JOBS];
+  prv_set_rtc(s_2015_nov12_123456_gmt, &s_timezone_gmt);
+  cron_clear_all_jobs();
+
+  // A mix of alarm-like, daily and monthly jobs, with many sharing an execution time
+  for (int i = 0; i < NUM_ORDERED_JOBS; i++) {
+    jobs[i] = (CronJob) {
+      .cb = prv_recording_cb,
+      .minute = (i * 7) % 60,
+      .hour = (i % 3) ? (i * 5) % 24 : CRON_HOUR_ANY,
+      .mday = (i % 5) ? CRON_MDAY_ANY : (i % 28),
+      .month = CRON_MONTH_ANY,
+      .wday = (i % 4) ? WDAY_ANY : WDAY_WEEKDAYS,
+      .clock_change_tolerance = (i % 2) ? 0 : SECONDS_PER_HOUR,
+    };
+    cron_job_schedule(&jobs[i]);
+  }
+  cl_assert_equal_i(cron_service_get_job_count(), NUM_ORDERED_JOBS);
+
+  // There's no room for another job
+  CronJob extra_job = {
+    .cb = prv_recording_cb,
+    .minute = 0,
+    .hour = CRON_HOUR_ANY,
+    .mday = CRON_MDAY_ANY,
+    .month = CRON_MONTH_ANY,
+  };
+  cl_assert_passert(cron_job_schedule(&extra_job));
+  cl_assert_equal_i(cron_service_get_job_count(), NUM_ORDERED_JOBS);
+
+  // Time zone changes and DST transitions recalculate every job, small clock adjustments only
+  // recalculate the jobs with a tolerance below the adjustment
+  for (int i = 0; i < NUM_ORDERED_CLOCK_CHANGES; i++) {
+    const int32_t sign = (i % 2) ? -1 : 1;
+    if (i % 4 == 0) {
+      prv_clock_change(0, sign * SECONDS_PER_HOUR, true);
+    } else if (i % 4 == 1) {
+      prv_clock_change(0, sign * 30 * SECONDS_PER_MINUTE, false);
+    } else {
+      prv_clock_change(sign * 5, 0, false);
+    }
+  }
+  cl_assert_equal_i(cron_service_get_job_count(), NUM_ORDERED_JOBS);
+
+  // All the jobs fire in order of their execution time, and in scheduling order for equal times
+  s_num_fired_jobs = 0;
+  fake_rtc_increment_time(SECONDS_PER_DAY * 62);
+  cron_service_wakeup();
+  cl_assert_equal_i(s_num_fired_jobs, NUM_ORDERED_JOBS);
+  cl_assert_equal_i(cron_service_get_job_count(), 0);
+  for (int i = 1; i < NUM_ORDERED_JOBS; i++) {
+    const CronJob *prev = s_fired_jobs[i - 1];
+    const CronJob *job = s_fired_jobs[i];
+    cl_assert(prev->cached_execute_time <= job->cached_execute_time);
+    if (prev->cached_execute_time == job->cached_execute_time) {
+      cl_assert(prev < job);
+    }
+  }
+}
+
+void test_cron__unschedule_and_reschedule(void) {
+  CronJob jobs[] = {
+    CRON_JOB(10, CRON_HOUR_ANY, CRON_MDAY_ANY, CRON_MONTH_ANY, prv_recording_cb)
+    CRON_JOB(20, CRON_HOUR_ANY, CRON_MDAY_ANY, CRON_MONTH_ANY, prv_recording_cb)
+    CRON_JOB(30, CRON_HOUR_ANY, CRON_MDAY_ANY, CRON_MONTH_ANY, prv_recording_cb)
+    CRON_JOB(40, CRON_HOUR_ANY, CRON_MDAY_ANY, CRON_MONTH_ANY, prv_recording_cb)
+  };
+  CronJob unscheduled_job = {};
+  prv_set_rtc(s_2015_nov12_000000_gmt, &s_timezone_gmt);
+  cron_clear_all_jobs();
+
+  for (int i = 0; i < ARRAY_LENGTH(jobs); ++i) {
+    cron_job_schedule(&jobs[i]);
+  }
+  cl_assert_equal_b(cron_job_is_scheduled(&unscheduled_job), false);
+  cl_assert_equal_b(cron_job_unschedule(&unscheduled_job), false);
+
+  cl_assert_equal_b(cron_job_unschedule(&jobs[1]), true);
+  cl_assert_equal_b(cron_job_is_scheduled(&jobs[1]), false);
+  cl_assert_equal_b(cron_job_unschedule(&jobs[1]), false);
+  cl_assert_equal_i(cron_service_get_job_count(), 3);
+
+  // Rescheduling a scheduled job moves it, rather than adding it twice
+  jobs[3].minute = 5;
+  cron_job_schedule(&jobs[3]);
+  cl_assert_equal_i(cron_service_get_job_count(), 3);
+
+  s_num_fired_jobs = 0;
+  fake_rtc_increment_time(SECONDS_PER_HOUR - 1);
+  cron_service_wakeup();
+  cl_assert_equal_i(s_num_fired_jobs, 3);
+  cl_assert_equal_p(s_fired_jobs[0], &jobs[3]);
+  cl_assert_equal_p(s_fired_jobs[1], &jobs[0]);
+  cl_assert_equal_p(s_fired_jobs[2], &jobs[2]);
+}
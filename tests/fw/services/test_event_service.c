@@ -0,0 +1,243 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clar.h"
+
+#include "kernel/events.h"
+#include "services/common/event_service.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#include <string.h>
+
+#include "fake_kernel_malloc.h"
+#include "fake_pebble_tasks.h"
+
+#include "stubs_app_manager.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_process_manager.h"
+#include "stubs_syscall_internal.h"
+#include "stubs_worker_manager.h"
+
+extern int16_t sys_event_service_get_plugin_service_index(const Uuid *uuid);
+extern void sys_event_service_cleanup(PebbleEvent *e);
+
+#define TASK_QUEUE_LENGTH 64
+
+// Fakes
+////////////////////////////////////////////////////////////////////////////////
+
+//! Stands in for the event queue of a task
+typedef struct {
+  PebbleEvent events[TASK_QUEUE_LENGTH];
+  int num_events;
+} TaskQueue;
+
+static TaskQueue s_kernel_main_queue;
+static TaskQueue s_app_queue;
+static TaskQueue s_worker_queue;
+
+signed portBASE_TYPE xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue,
+                                       TickType_t xTicksToWait, portBASE_TYPE xCopyPosition) {
+  TaskQueue *queue = (TaskQueue *)xQueue;
+  if (queue->num_events == TASK_QUEUE_LENGTH) {
+    return pdFALSE;
+  }
+  memcpy(&queue->events[queue->num_events++], pvItemToQueue, sizeof(PebbleEvent));
+  return pdTRUE;
+}
+
+static int s_num_inline_events;
+
+void event_service_client_handle_event(PebbleEvent *e) {
+  s_num_inline_events++;
+  sys_event_service_cleanup(e);
+}
+
+void **event_get_buffer(PebbleEvent *event) {
+  if (event->type == PEBBLE_BLOBDB_EVENT) {
+    return (void **)&event->blob_db.key;
+  }
+  return NULL;
+}
+
+void event_deinit(PebbleEvent *event) {
+  void **buffer = event_get_buffer(event);
+  if (buffer && *buffer) {
+    kernel_free(*buffer);
+    *buffer = NULL;
+  }
+}
+
+// Helpers
+////////////////////////////////////////////////////////////////////////////////
+
+static void prv_subscribe(PebbleTask task, TaskQueue *queue) {
+  PebbleSubscriptionEvent subscription = {
+    .subscribe = true,
+    .task = task,
+    .event_type = PEBBLE_BLOBDB_EVENT,
+    .event_queue = (QueueHandle_t)queue,
+  };
+  event_service_subscribe_from_kernel_main(&subscription);
+}
+
+static void prv_put_blob_db_event(uint8_t key) {
+  uint8_t *key_buf = kernel_malloc(sizeof(key));
+  *key_buf = key;
+  PebbleEvent e = {
+    .type = PEBBLE_BLOBDB_EVENT,
+    .blob_db = {
+      .key = key_buf,
+      .key_len = sizeof(key),
+    },
+  };
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  event_service_handle_event(&e);
+  // KernelMain cleans up its own copy of the event after handling it
+  event_deinit(&e);
+}
+
+//! Handles all the events queued up for the task, like the event loop of the task would
+//! @return The sum of the keys of the handled events
+static int prv_drain_queue(PebbleTask task, TaskQueue *queue) {
+  int key_sum = 0;
+  stub_pebble_tasks_set_current(task);
+  for (int i = 0; i < queue->num_events; i++) {
+    PebbleEvent *e = &queue->events[i];
+    cl_assert(e->blob_db.key);
+    key_sum += *e->blob_db.key;
+    sys_event_service_cleanup(e);
+  }
+  queue->num_events = 0;
+  return key_sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void test_event_service__initialize(void) {
+  // Replaces the service entry allocated by the previous test
+  fake_kernel_malloc_enable_stats(false);
+  event_service_init(PEBBLE_BLOBDB_EVENT, NULL, NULL);
+  fake_kernel_malloc_init();
+  fake_kernel_malloc_enable_stats(true);
+  event_service_system_init();
+  s_kernel_main_queue.num_events = 0;
+  s_app_queue.num_events = 0;
+  s_worker_queue.num_events = 0;
+  s_num_inline_events = 0;
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  fake_kernel_malloc_mark();
+}
+
+void test_event_service__cleanup(void) {
+  event_service_clear_process_subscriptions(PebbleTask_KernelMain);
+  event_service_clear_process_subscriptions(PebbleTask_App);
+  event_service_clear_process_subscriptions(PebbleTask_Worker);
+  fake_kernel_malloc_deinit();
+}
+
+void test_event_service__buffer_freed_after_last_subscriber(void) {
+  prv_subscribe(PebbleTask_App, &s_app_queue);
+  prv_subscribe(PebbleTask_Worker, &s_worker_queue);
+
+  prv_put_blob_db_event(7);
+  cl_assert_equal_i(s_app_queue.num_events, 1);
+  cl_assert_equal_i(s_worker_queue.num_events, 1);
+
+  // The buffer is kept around until both tasks have handled the event
+  cl_assert_equal_i(prv_drain_queue(PebbleTask_App, &s_app_queue), 7);
+  cl_assert(fake_kernel_malloc_get_total_bytes_allocated() > 0);
+  cl_assert_equal_i(prv_drain_queue(PebbleTask_Worker, &s_worker_queue), 7);
+  fake_kernel_malloc_mark_assert_equal();
+}
+
+void test_event_service__claimed_buffer(void) {
+  prv_subscribe(PebbleTask_App, &s_app_queue);
+
+  prv_put_blob_db_event(3);
+  PebbleEvent *e = &s_app_queue.events[0];
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  void *ref = event_service_claim_buffer(e);
+  cl_assert(ref);
+  cl_assert_equal_p(event_service_claim_buffer(e), NULL);
+
+  // A claimed buffer outlives the event
+  uint8_t *key = e->blob_db.key;
+  prv_drain_queue(PebbleTask_App, &s_app_queue);
+  cl_assert_equal_i(*key, 3);
+
+  event_service_free_claimed_buffer(ref);
+  fake_kernel_malloc_mark_assert_equal();
+}
+
+void test_event_service__more_buffers_in_flight_than_slots(void) {
+  prv_subscribe(PebbleTask_App, &s_app_queue);
+  prv_subscribe(PebbleTask_Worker, &s_worker_queue);
+
+  int expected_key_sum = 0;
+  for (int i = 0; i < TASK_QUEUE_LENGTH; i++) {
+    prv_put_blob_db_event(i);
+    expected_key_sum += i;
+  }
+  // Handle them in the opposite order of the tasks to release the buffers in a different order
+  cl_assert_equal_i(prv_drain_queue(PebbleTask_Worker, &s_worker_queue), expected_key_sum);
+  cl_assert_equal_i(prv_drain_queue(PebbleTask_App, &s_app_queue), expected_key_sum);
+  fake_kernel_malloc_mark_assert_equal();
+}
+
+void test_event_service__plugin_service_index(void) {
+  Uuid uuids[40];
+  int16_t indexes[40];
+  for (int i = 0; i < 40; i++) {
+    memset(&uuids[i], 0, sizeof(Uuid));
+    uuids[i].byte0 = i;
+    uuids[i].byte15 = i * 3;
+    indexes[i] = sys_event_service_get_plugin_service_index(&uuids[i]);
+    cl_assert(indexes[i] > 0);
+    for (int j = 0; j < i; j++) {
+      cl_assert(indexes[i] != indexes[j]);
+    }
+  }
+  // The same UUID keeps its index
+  for (int i = 0; i < 40; i++) {
+    cl_assert_equal_i(sys_event_service_get_plugin_service_index(&uuids[i]), indexes[i]);
+  }
+}
+
+void test_event_service__dispatch_bursts(void) {
+  const int num_events = 1200;
+  // Like a burst of accel or health events, a few are queued up before the tasks get to run
+  const int burst_length = 12;
+  prv_subscribe(PebbleTask_App, &s_app_queue);
+  prv_subscribe(PebbleTask_Worker, &s_worker_queue);
+  prv_subscribe(PebbleTask_KernelMain, &s_kernel_main_queue);
+
+  int num_handled = 0;
+  for (int i = 0; i < num_events; i += burst_length) {
+    for (int j = 0; j < burst_length; j++) {
+      prv_put_blob_db_event(j);
+    }
+    num_handled += s_app_queue.num_events + s_worker_queue.num_events;
+    prv_drain_queue(PebbleTask_App, &s_app_queue);
+    prv_drain_queue(PebbleTask_Worker, &s_worker_queue);
+  }
+  cl_assert_equal_i(num_handled, 2 * num_events);
+  fake_kernel_malloc_mark_assert_equal();
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clar.h"
+
+#include "kernel/events.h"
+#include "services/common/comm_session/session.h"
+#include "services/common/get_bytes/get_bytes.h"
+#include "services/common/get_bytes/get_bytes_private.h"
+#include "services/common/get_bytes/get_bytes_storage.h"
+#include "util/math.h"
+#include "util/net.h"
+
+#include <bluetooth/conn_event_stats.h>
+#include <os/tick.h>
+
+#include <string.h>
+
+#include "fake_kernel_malloc.h"
+#include "fake_pebble_tasks.h"
+#include "fake_rtc.h"
+#include "fake_session.h"
+#include "fake_system_task.h"
+
+#include "stubs_bt_lock.h"
+#include "stubs_hexdump.h"
+#include "stubs_logging.h"
+#include "stubs_passert.h"
+
+#define COREDUMP_SIZE (512 * 1024)
+
+// Stubs
+////////////////////////////////////////////////////////////////////////////////
+
+static int s_num_finished_events;
+
+void event_put(PebbleEvent *event) {
+  if (event->type == PEBBLE_GATHER_DEBUG_INFO_EVENT &&
+      event->debug_info.state == DebugInfoStateFinished) {
+    s_num_finished_events++;
+  }
+}
+
+static int s_num_stats_recorded;
+
+void bluetooth_analytics_handle_get_bytes_stats(uint8_t type, uint32_t num_bytes,
+                                                uint32_t elapsed_time_ms,
+                                                const SlaveConnEventStats *orig_stats) {
+  s_num_stats_recorded++;
+}
+
+bool bt_driver_analytics_get_conn_event_stats(SlaveConnEventStats *stats) {
+  return true;
+}
+
+uint32_t ticks_to_milliseconds(TickType_t ticks) {
+  return ticks;
+}
+
+// Fake storage, containing a patterned core dump
+////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t s_object_size;
+static GetBytesInfoErrorCode s_get_size_result;
+static int s_num_chunk_reads;
+static int s_num_cleanups;
+static bool s_cleanup_successful;
+
+static uint8_t prv_pattern_byte(uint32_t offset) {
+  return (uint8_t)((offset * 7) ^ (offset >> 8));
+}
+
+bool gb_storage_setup(GetBytesStorage *storage, GetBytesObjectType object_type,
+                      GetBytesStorageInfo *info) {
+  *storage = (GetBytesStorage) {};
+  return (object_type == GetBytesObjectCoredump);
+}
+
+GetBytesInfoErrorCode gb_storage_get_size(GetBytesStorage *storage, uint32_t *size) {
+  *size = s_object_size;
+  return s_get_size_result;
+}
+
+bool gb_storage_read_next_chunk(GetBytesStorage *storage, uint8_t *buffer, uint32_t len) {
+  cl_assert(storage->current_offset + len <= s_object_size);
+  for (uint32_t i = 0; i < len; i++) {
+    buffer[i] = prv_pattern_byte(storage->current_offset + i);
+  }
+  storage->current_offset += len;
+  s_num_chunk_reads++;
+  return true;
+}
+
+void gb_storage_cleanup(GetBytesStorage *storage, bool successful) {
+  s_num_cleanups++;
+  s_cleanup_successful = successful;
+}
+
+// Receiving end
+////////////////////////////////////////////////////////////////////////////////
+
+static Transport *s_transport;
+static CommSession *s_session;
+
+static uint8_t *s_received;
+static uint32_t s_num_received_bytes;
+static int s_num_data_messages;
+static int s_num_info_messages;
+static GetBytesRspObjectInfo s_info_rsp;
+//! Disconnect after this many data messages have been received, or 0 to never disconnect
+static int s_disconnect_after_num_data_messages;
+
+static void prv_sent_cb(uint16_t endpoint_id, const uint8_t *data, unsigned int data_length) {
+  cl_assert_equal_i(endpoint_id, GET_BYTES_ENDPOINT_ID);
+  const GetBytesHeader *hdr = (const GetBytesHeader *)data;
+  if (hdr->cmd_id == GET_BYTES_CMD_OBJECT_INFO) {
+    cl_assert_equal_i(data_length, sizeof(GetBytesRspObjectInfo));
+    cl_assert_equal_i(s_num_data_messages, 0);
+    memcpy(&s_info_rsp, data, sizeof(s_info_rsp));
+    s_num_info_messages++;
+    return;
+  }
+
+  cl_assert_equal_i(hdr->cmd_id, GET_BYTES_CMD_OBJECT_DATA);
+  cl_assert_equal_i(s_num_info_messages, 1);
+  const GetBytesRspObjectData *rsp = (const GetBytesRspObjectData *)data;
+  const uint32_t offset = ntohl(rsp->byte_offset);
+  const uint32_t length = data_length - sizeof(*rsp);
+  cl_assert_equal_i(offset, s_num_received_bytes);
+  cl_assert(offset + length <= s_object_size);
+  memcpy(s_received + offset, rsp->data, length);
+  s_num_received_bytes += length;
+  s_num_data_messages++;
+}
+
+//! Runs KernelBG until the transfer is done.
+//! @return The number of callbacks which were run
+static int prv_run_system_task(void) {
+  int num_callbacks = 0;
+  while (fake_system_task_count_callbacks()) {
+    if (s_disconnect_after_num_data_messages &&
+        s_num_data_messages >= s_disconnect_after_num_data_messages && s_session) {
+      fake_transport_set_connected(s_transport, false /* connected */);
+      s_session = NULL;
+    }
+    fake_system_task_callbacks_invoke(1);
+    num_callbacks++;
+  }
+  // The fake session doesn't kick the transport for messages sent with comm_session_send_data()
+  fake_comm_session_process_send_next();
+  return num_callbacks;
+}
+
+static void prv_request_coredump(void) {
+  const GetBytesHeader request = {
+    .cmd_id = GET_BYTES_CMD_GET_COREDUMP,
+    .transaction_id = 42,
+  };
+  get_bytes_protocol_msg_callback(s_session, (const uint8_t *)&request, sizeof(request));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void test_get_bytes__initialize(void) {
+  fake_kernel_malloc_init();
+  fake_kernel_malloc_enable_stats(true);
+  fake_rtc_init(0, 0);
+  fake_rtc_auto_increment_ticks(1);
+  fake_comm_session_init();
+  s_transport = fake_transport_create(TransportDestinationSystem, NULL, prv_sent_cb);
+  s_session = fake_transport_set_connected(s_transport, true /* connected */);
+  fake_kernel_malloc_mark();
+
+  s_object_size = COREDUMP_SIZE;
+  s_get_size_result = GET_BYTES_OK;
+  s_received = malloc(COREDUMP_SIZE);
+  s_num_received_bytes = 0;
+  s_num_data_messages = 0;
+  s_num_info_messages = 0;
+  s_info_rsp = (GetBytesRspObjectInfo) {};
+  s_disconnect_after_num_data_messages = 0;
+  s_num_chunk_reads = 0;
+  s_num_cleanups = 0;
+  s_cleanup_successful = false;
+  s_num_finished_events = 0;
+  s_num_stats_recorded = 0;
+}
+
+void test_get_bytes__cleanup(void) {
+  fake_system_task_callbacks_cleanup();
+  fake_comm_session_cleanup();
+  free(s_received);
+  s_received = NULL;
+  fake_kernel_malloc_deinit();
+}
+
+void test_get_bytes__transfer_coredump(void) {
+  prv_request_coredump();
+  const int num_callbacks = prv_run_system_task();
+
+  cl_assert_equal_i(s_num_info_messages, 1);
+  cl_assert_equal_i(s_info_rsp.hdr.transaction_id, 42);
+  cl_assert_equal_i(s_info_rsp.error_code, GET_BYTES_OK);
+  cl_assert_equal_i(ntohl(s_info_rsp.num_bytes), COREDUMP_SIZE);
+
+  cl_assert_equal_i(s_num_received_bytes, COREDUMP_SIZE);
+  for (uint32_t i = 0; i < COREDUMP_SIZE; i++) {
+    cl_assert_equal_i(s_received[i], prv_pattern_byte(i));
+  }
+  // Every chunk is read from storage exactly once
+  cl_assert_equal_i(s_num_chunk_reads, s_num_data_messages);
+
+  cl_assert_equal_i(s_num_cleanups, 1);
+  cl_assert_equal_b(s_cleanup_successful, true);
+  cl_assert_equal_i(s_num_finished_events, 1);
+  cl_assert_equal_i(s_num_stats_recorded, 1);
+  cl_assert_equal_b(fake_comm_session_is_latency_reduced(), false);
+  fake_kernel_malloc_mark_assert_equal();
+
+  // Every data message but the last one is filled up to the session's max payload
+  const size_t max_chunk_len = comm_session_send_buffer_get_max_payload_length(s_session) -
+                               sizeof(GetBytesRspObjectData);
+  cl_assert_equal_i(s_num_data_messages, DIVIDE_CEIL(COREDUMP_SIZE, max_chunk_len));
+  // Chunks are read straight into the send buffer, which takes fewer than two KernelBG callbacks
+  // per message even with retries while the send buffer is full
+  cl_assert(num_callbacks < 2 * s_num_data_messages);
+
+  // Another transfer can be started once the previous one has finished
+  s_num_received_bytes = 0;
+  s_num_data_messages = 0;
+  s_num_info_messages = 0;
+  prv_request_coredump();
+  prv_run_system_task();
+  cl_assert_equal_i(s_num_received_bytes, COREDUMP_SIZE);
+  cl_assert_equal_i(s_num_cleanups, 2);
+}
+
+void test_get_bytes__transfer_empty_object(void) {
+  s_object_size = 0;
+  prv_request_coredump();
+  prv_run_system_task();
+
+  cl_assert_equal_i(s_num_info_messages, 1);
+  cl_assert_equal_i(ntohl(s_info_rsp.num_bytes), 0);
+  cl_assert_equal_i(s_num_data_messages, 0);
+  cl_assert_equal_i(s_num_cleanups, 1);
+  cl_assert_equal_b(s_cleanup_successful, true);
+  cl_assert_equal_i(s_num_finished_events, 1);
+  fake_kernel_malloc_mark_assert_equal();
+}
+
+void test_get_bytes__get_size_error(void) {
+  s_get_size_result = GET_BYTES_DOESNT_EXIST;
+  prv_request_coredump();
+  prv_run_system_task();
+
+  cl_assert_equal_i(s_num_info_messages, 1);
+  cl_assert_equal_i(s_info_rsp.error_code, GET_BYTES_DOESNT_EXIST);
+  cl_assert_equal_i(s_num_data_messages, 0);
+  cl_assert_equal_i(s_num_cleanups, 1);
+  cl_assert_equal_b(s_cleanup_successful, false);
+  fake_kernel_malloc_mark_assert_equal();
+}
+
+void test_get_bytes__disconnect_during_transfer(void) {
+  s_disconnect_after_num_data_messages = 10;
+  prv_request_coredump();
+  prv_run_system_task();
+
+  // The transfer is aborted instead of waiting for the session to come back
+  cl_assert(s_num_received_bytes < COREDUMP_SIZE);
+  cl_assert_equal_i(fake_system_task_count_callbacks(), 0);
+  cl_assert_equal_i(s_num_cleanups, 1);
+  cl_assert_equal_b(s_cleanup_successful, false);
+  cl_assert_equal_i(s_num_finished_events, 1);
+  cl_assert_equal_i(s_num_stats_recorded, 0);
+
+  // The session owned by the fake transport has been freed, so compare against what's left
+  s_session = fake_transport_set_connected(s_transport, true /* connected */);
+  s_num_received_bytes = 0;
+  s_num_data_messages = 0;
+  s_num_info_messages = 0;
+  s_disconnect_after_num_data_messages = 0;
+  prv_request_coredump();
+  prv_run_system_task();
+  cl_assert_equal_i(s_num_received_bytes, COREDUMP_SIZE);
+}
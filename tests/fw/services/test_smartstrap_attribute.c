@@ -0,0 +1,422 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clar.h"
+
+#include "kernel/events.h"
+#include "services/normal/accessory/smartstrap_attribute.h"
+#include "services/normal/accessory/smartstrap_comms.h"
+#include "services/normal/accessory/smartstrap_profiles.h"
+#include "util/attributes.h"
+#include "util/mbuf.h"
+
+#include <string.h>
+
+#include "stubs_app_install_manager.h"
+#include "stubs_app_manager.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_syscall_internal.h"
+
+#include "fake_pebble_tasks.h"
+#include "fake_rtc.h"
+#include "fake_smartstrap_connection.h"
+#include "fake_smartstrap_state.h"
+#include "fake_system_task.h"
+
+#define SERVICE_ID 0x1001
+#define NUM_STRAP_ATTRS 8
+#define MAX_EVENTS 32
+#define TIMEOUT_MS 100
+//! Simulated cost of a request frame: waking the smartstrap, the frame overhead and the
+//! smartstrap handling the request
+#define FRAME_COST_US 5000
+//! Simulated cost of each byte on the wire (115200 baud)
+#define BYTE_COST_US 87
+
+// Mirrors of the generic service wire format
+typedef struct PACKED {
+  uint8_t version;
+  uint16_t service_id;
+  uint16_t attribute_id;
+  uint8_t type;
+  uint8_t error;
+  uint16_t length;
+} FrameInfo;
+
+enum {
+  GenericServiceTypeRead = 0,
+};
+
+enum {
+  ManagementServiceAttributeServiceDiscovery = 0x0001,
+};
+
+#define MANAGEMENT_SERVICE_ID 0x0101
+
+
+// Simulated smartstrap
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  uint16_t attribute_id;
+  uint8_t data[80];
+  uint16_t length;
+} StrapAttribute;
+
+typedef struct {
+  StrapAttribute attrs[NUM_STRAP_ATTRS];
+  int num_attrs;
+  int num_frames;
+  uint16_t frame_attribute_ids[MAX_EVENTS];
+  uint8_t response[512];
+  uint32_t response_length;
+  MBuf *read_mbuf;
+} FakeSmartstrap;
+
+static FakeSmartstrap s_strap;
+
+static const SmartstrapProfileInfo *s_info;
+
+static void prv_strap_add_attr(uint16_t attribute_id, const void *data, uint16_t length) {
+  StrapAttribute *attr = &s_strap.attrs[s_strap.num_attrs++];
+  attr->attribute_id = attribute_id;
+  memcpy(attr->data, data, length);
+  attr->length = length;
+}
+
+static StrapAttribute *prv_strap_find_attr(uint16_t attribute_id) {
+  for (int i = 0; i < s_strap.num_attrs; i++) {
+    if (s_strap.attrs[i].attribute_id == attribute_id) {
+      return &s_strap.attrs[i];
+    }
+  }
+  return NULL;
+}
+
+static void prv_strap_append(const void *data, uint32_t length) {
+  cl_assert(s_strap.response_length + length <= sizeof(s_strap.response));
+  memcpy(&s_strap.response[s_strap.response_length], data, length);
+  s_strap.response_length += length;
+}
+
+static void prv_strap_handle_request(const FrameInfo *request) {
+  FrameInfo response = *request;
+  response.length = 0;
+  s_strap.response_length = sizeof(FrameInfo);
+  if (request->service_id == MANAGEMENT_SERVICE_ID) {
+    if (request->attribute_id == ManagementServiceAttributeServiceDiscovery) {
+      const uint16_t service_id = SERVICE_ID;
+      prv_strap_append(&service_id, sizeof(service_id));
+    } else {
+      response.error = 1;
+    }
+  } else {
+    cl_assert_equal_i(request->type, GenericServiceTypeRead);
+    const StrapAttribute *attr = prv_strap_find_attr(request->attribute_id);
+    if (attr) {
+      prv_strap_append(attr->data, attr->length);
+    } else {
+      response.error = 1;
+    }
+  }
+  response.length = s_strap.response_length - sizeof(FrameInfo);
+  memcpy(s_strap.response, &response, sizeof(FrameInfo));
+}
+
+SmartstrapResult smartstrap_send(SmartstrapProfile profile, MBuf *write_mbuf, MBuf *read_mbuf,
+                                 uint16_t timeout_ms) {
+  cl_assert_equal_i(profile, SmartstrapProfileGenericService);
+  cl_assert(read_mbuf);
+  // flatten the request
+  uint8_t request[128];
+  uint32_t request_length = 0;
+  for (MBuf *mbuf = write_mbuf; mbuf; mbuf = mbuf_get_next(mbuf)) {
+    cl_assert(request_length + mbuf_get_length(mbuf) <= sizeof(request));
+    memcpy(&request[request_length], mbuf_get_data(mbuf), mbuf_get_length(mbuf));
+    request_length += mbuf_get_length(mbuf);
+  }
+  const FrameInfo *header = (const FrameInfo *)request;
+  cl_assert_equal_i(request_length, sizeof(FrameInfo) + header->length);
+  if (s_strap.num_frames < MAX_EVENTS) {
+    s_strap.frame_attribute_ids[s_strap.num_frames] = header->attribute_id;
+  }
+  s_strap.num_frames++;
+
+  prv_strap_handle_request(header);
+  s_strap.read_mbuf = read_mbuf;
+  const uint32_t cost_us =
+      FRAME_COST_US + (request_length + s_strap.response_length) * BYTE_COST_US;
+  fake_rtc_increment_ticks(((uint64_t)cost_us * RTC_TICKS_HZ) / 1000000);
+  smartstrap_fsm_state_set(SmartstrapStateReadDisabled);
+  smartstrap_fsm_state_set(SmartstrapStateReadInProgress);
+  return SmartstrapResultOk;
+}
+
+void smartstrap_cancel_send(void) {
+}
+
+//! Delivers the smartstrap's response to the outstanding request
+static void prv_strap_respond(void) {
+  cl_assert(s_strap.read_mbuf);
+  uint32_t offset = 0;
+  for (MBuf *mbuf = s_strap.read_mbuf; mbuf && (offset < s_strap.response_length);
+       mbuf = mbuf_get_next(mbuf)) {
+    const uint32_t length = MIN(mbuf_get_length(mbuf), s_strap.response_length - offset);
+    memcpy(mbuf_get_data(mbuf), &s_strap.response[offset], length);
+    offset += length;
+  }
+  cl_assert_equal_i(offset, s_strap.response_length);
+  s_strap.read_mbuf = NULL;
+  smartstrap_fsm_state_set(SmartstrapStateReadComplete);
+  smartstrap_fsm_state_set(SmartstrapStateReadReady);
+  s_info->read_complete(true, s_strap.response_length);
+}
+
+
+// Fakes
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  SmartstrapEventType type;
+  SmartstrapResult result;
+  void *attribute;
+  uint16_t read_length;
+} EventInfo;
+
+static EventInfo s_events[MAX_EVENTS];
+static int s_num_events;
+
+bool process_manager_send_event_to_process(PebbleTask task, PebbleEvent *e) {
+  cl_assert_equal_i(e->type, PEBBLE_SMARTSTRAP_EVENT);
+  if (s_num_events < MAX_EVENTS) {
+    s_events[s_num_events] = (EventInfo) {
+      .type = e->smartstrap.type,
+      .result = e->smartstrap.result,
+      .attribute = e->smartstrap.attribute,
+      .read_length = e->smartstrap.read_length,
+    };
+  }
+  s_num_events++;
+  return true;
+}
+
+SmartstrapResult smartstrap_profiles_handle_request(const SmartstrapRequest *request) {
+  smartstrap_state_lock();
+  SmartstrapResult result = s_info->send(request);
+  smartstrap_state_unlock();
+  return result;
+}
+
+bool smartstrap_link_control_is_profile_supported(SmartstrapProfile profile) {
+  return true;
+}
+
+void smartstrap_connection_state_set_by_service(uint16_t service_id, bool connected) {
+}
+
+void applib_free(void *ptr) {
+}
+
+const SmartstrapProfileInfo *smartstrap_generic_service_get_info(void);
+
+
+// Setup
+////////////////////////////////////////////////////////////////////////////////
+
+static time_t s_time = 100;
+
+static void prv_connect(void) {
+  s_info->connected(true);
+  stub_pebble_tasks_set_current(PebbleTask_KernelBackground);
+  // service discovery
+  cl_assert(s_info->control());
+  prv_strap_respond();
+  cl_assert(!s_info->control());
+  s_strap.num_frames = 0;
+}
+
+void test_smartstrap_attribute__initialize(void) {
+  // service discovery is rate-limited, so move time forward for each test
+  s_time += 10;
+  fake_rtc_init(0, s_time);
+  smartstrap_fsm_state_reset();
+  s_strap = (FakeSmartstrap) {};
+  s_num_events = 0;
+  smartstrap_attribute_init();
+  s_info = smartstrap_generic_service_get_info();
+  s_info->init();
+}
+
+void test_smartstrap_attribute__cleanup(void) {
+  smartstrap_attribute_unregister_all();
+  fake_system_task_callbacks_invoke_pending();
+}
+
+
+// Helpers
+////////////////////////////////////////////////////////////////////////////////
+
+//! Runs the connection monitor until there are no more pending requests
+static void prv_run_monitor(void) {
+  stub_pebble_tasks_set_current(PebbleTask_KernelBackground);
+  while (smartstrap_attribute_send_pending()) {
+    if (smartstrap_fsm_state_get() == SmartstrapStateReadInProgress) {
+      prv_strap_respond();
+    }
+  }
+}
+
+static SmartstrapResult prv_read(SmartstrapAttribute *attr) {
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  return sys_smartstrap_attribute_do_request(attr, SmartstrapRequestTypeRead, TIMEOUT_MS, 0);
+}
+
+static SmartstrapAttribute *prv_register(uint8_t *buffer, uint16_t attribute_id, size_t length) {
+  cl_assert(sys_smartstrap_attribute_register(SERVICE_ID, attribute_id, buffer, length));
+  return (SmartstrapAttribute *)buffer;
+}
+
+static const EventInfo *prv_find_event(SmartstrapEventType type, SmartstrapAttribute *attr) {
+  for (int i = 0; i < MIN(s_num_events, MAX_EVENTS); i++) {
+    if ((s_events[i].type == type) && (s_events[i].attribute == attr)) {
+      return &s_events[i];
+    }
+  }
+  return NULL;
+}
+
+static void prv_assert_read(SmartstrapAttribute *attr, SmartstrapResult result,
+                            const void *data, uint16_t length) {
+  const EventInfo *event = prv_find_event(SmartstrapDataReceivedEvent, attr);
+  cl_assert(event);
+  cl_assert_equal_i(event->result, result);
+  cl_assert_equal_i(event->read_length, length);
+  if (length) {
+    cl_assert_equal_m(attr, data, length);
+  }
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  sys_smartstrap_attribute_event_processed(attr);
+}
+
+
+// Tests
+////////////////////////////////////////////////////////////////////////////////
+
+void test_smartstrap_attribute__read(void) {
+  const uint8_t data[] = {1, 2, 3, 4};
+  prv_strap_add_attr(1, data, sizeof(data));
+  prv_connect();
+
+  uint8_t buffer[8];
+  SmartstrapAttribute *attr = prv_register(buffer, 1, sizeof(buffer));
+  cl_assert_equal_i(prv_read(attr), SmartstrapResultOk);
+  prv_run_monitor();
+
+  cl_assert_equal_i(s_strap.num_frames, 1);
+  cl_assert_equal_i(s_num_events, 2);
+  cl_assert(prv_find_event(SmartstrapDataSentEvent, attr));
+  prv_assert_read(attr, SmartstrapResultOk, data, sizeof(data));
+}
+
+void test_smartstrap_attribute__read_while_pending(void) {
+  const uint8_t data[] = {5, 6};
+  prv_strap_add_attr(1, data, sizeof(data));
+  prv_connect();
+
+  uint8_t buffer[8];
+  SmartstrapAttribute *attr = prv_register(buffer, 1, sizeof(buffer));
+  cl_assert_equal_i(prv_read(attr), SmartstrapResultOk);
+  // another read is rejected until the response to the first one has been received
+  cl_assert_equal_i(prv_read(attr), SmartstrapResultBusy);
+  prv_run_monitor();
+  prv_assert_read(attr, SmartstrapResultOk, data, sizeof(data));
+  cl_assert_equal_i(s_strap.num_frames, 1);
+
+  cl_assert_equal_i(prv_read(attr), SmartstrapResultOk);
+  prv_run_monitor();
+  cl_assert_equal_i(s_strap.num_frames, 2);
+}
+
+void test_smartstrap_attribute__priority_order(void) {
+  const uint8_t data[] = {7};
+  for (uint16_t i = 1; i <= 4; i++) {
+    prv_strap_add_attr(i, data, sizeof(data));
+  }
+  prv_connect();
+
+  uint8_t buffers[4][4];
+  SmartstrapAttribute *attrs[4];
+  for (int i = 0; i < 4; i++) {
+    attrs[i] = prv_register(buffers[i], i + 1, sizeof(buffers[i]));
+  }
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  sys_smartstrap_attribute_set_priority(attrs[0], SmartstrapAttributePriorityLow);
+  sys_smartstrap_attribute_set_priority(attrs[3], SmartstrapAttributePriorityHigh);
+  for (int i = 0; i < 4; i++) {
+    cl_assert_equal_i(prv_read(attrs[i]), SmartstrapResultOk);
+  }
+  prv_run_monitor();
+
+  // the high priority request goes first, then the normal ones in order, then the low one
+  cl_assert_equal_i(s_strap.num_frames, 4);
+  cl_assert_equal_i(s_strap.frame_attribute_ids[0], 4);
+  cl_assert_equal_i(s_strap.frame_attribute_ids[1], 2);
+  cl_assert_equal_i(s_strap.frame_attribute_ids[2], 3);
+  cl_assert_equal_i(s_strap.frame_attribute_ids[3], 1);
+  for (int i = 0; i < 4; i++) {
+    prv_assert_read(attrs[i], SmartstrapResultOk, data, sizeof(data));
+  }
+}
+
+void test_smartstrap_attribute__stats(void) {
+  const uint8_t data[] = {1, 2, 3, 4, 5, 6};
+  for (uint16_t i = 1; i <= 4; i++) {
+    prv_strap_add_attr(i, data, sizeof(data));
+  }
+  prv_connect();
+
+  SmartstrapAttributeStats stats_before;
+  smartstrap_attribute_get_stats(&stats_before);
+  uint8_t buffers[4][8];
+  SmartstrapAttribute *attrs[4];
+  for (int i = 0; i < 4; i++) {
+    attrs[i] = prv_register(buffers[i], i + 1, sizeof(buffers[i]));
+  }
+  const int num_rounds = 10;
+  for (int round = 0; round < num_rounds; round++) {
+    for (int i = 0; i < 4; i++) {
+      cl_assert_equal_i(prv_read(attrs[i]), SmartstrapResultOk);
+    }
+    s_num_events = 0;
+    prv_run_monitor();
+    for (int i = 0; i < 4; i++) {
+      prv_assert_read(attrs[i], SmartstrapResultOk, data, sizeof(data));
+    }
+  }
+
+  SmartstrapAttributeStats stats;
+  smartstrap_attribute_get_stats(&stats);
+  cl_assert_equal_i(stats.num_requests - stats_before.num_requests, 4 * num_rounds);
+  cl_assert_equal_i(stats.num_frames - stats_before.num_frames, 4 * num_rounds);
+  cl_assert_equal_i(stats.num_completed - stats_before.num_completed, 4 * num_rounds);
+  // the last read of each round waits for the three before it
+  cl_assert(stats.max_latency_ms >= (4 * FRAME_COST_US) / 1000);
+  cl_assert(stats.total_latency_ms - stats_before.total_latency_ms <=
+            4 * num_rounds * stats.max_latency_ms);
+}
@@ -17,6 +17,8 @@
 #include "clar.h"
 
 #include "services/normal/accessory/smartstrap_comms.h"
+#include "util/crc8.h"
+#include "util/hdlc.h"
 #include "util/mbuf.h"
 
 #include <string.h>
@@ -50,6 +52,7 @@ bool accessory_bus_contention_detected(void) {
 void test_smartstrap_comms__initialize(void) {
   smartstrap_comms_init();
   s_faked_bus_contention.enabled = false;
+  fake_accessory_rx_dma_reset();
 }
 
 void test_smartstrap_comms__cleanup(void) {
@@ -121,6 +124,56 @@ static void prv_do_read(uint8_t *data, int length, MBuf *read_mbuf, uint8_t *exp
   }
 }
 
+static void prv_do_read_dma(uint8_t *data, int length, MBuf *read_mbuf, uint8_t *expect_data,
+                            int expect_length) {
+  fake_accessory_rx_dma_receive(data, length);
+  fake_system_task_callbacks_invoke_pending();
+  fake_smartstrap_profiles_check_read_params(true, SmartstrapProfileRawData, expect_length);
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadReady);
+  uint8_t *read_data = mbuf_get_data(read_mbuf);
+  cl_assert_equal_i(mbuf_get_length(read_mbuf), expect_length);
+  cl_assert_equal_m(read_data, expect_data, expect_length);
+}
+
+static void prv_send_read_request(MBuf *read_mbuf) {
+  MBuf write_mbuf = MBUF_EMPTY;
+  uint8_t write_data[] = {0x01};
+  mbuf_set_data(&write_mbuf, write_data, sizeof(write_data));
+  smartstrap_fsm_state_reset();
+  smartstrap_state_lock();
+  cl_assert(smartstrap_send(SmartstrapProfileRawData, &write_mbuf, read_mbuf, 1000) ==
+            SmartstrapResultOk);
+  smartstrap_state_unlock();
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadInProgress);
+}
+
+static void prv_append_escaped(uint8_t *frame, int *length, uint8_t data) {
+  if (hdlc_encode(&data)) {
+    frame[(*length)++] = HDLC_ESCAPE;
+  }
+  frame[(*length)++] = data;
+}
+
+//! Builds the on-the-wire response frame for a RawData read with the given payload
+static int prv_build_response(const uint8_t *payload, int payload_length, uint8_t *frame) {
+  const uint8_t header[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00};
+  uint8_t checksum = 0;
+  crc8_calculate_bytes_streaming(header, sizeof(header), &checksum, false /* !big_endian */);
+  crc8_calculate_bytes_streaming(payload, payload_length, &checksum, false /* !big_endian */);
+
+  int length = 0;
+  frame[length++] = HDLC_FLAG;
+  for (unsigned int i = 0; i < sizeof(header); i++) {
+    prv_append_escaped(frame, &length, header[i]);
+  }
+  for (int i = 0; i < payload_length; i++) {
+    prv_append_escaped(frame, &length, payload[i]);
+  }
+  prv_append_escaped(frame, &length, checksum);
+  frame[length++] = HDLC_FLAG;
+  return length;
+}
+
 static void prv_do_read_notify(uint8_t *data, int length) {
   for (int i = 0; i < length; i++) {
     smartstrap_handle_data_from_isr(data[i]);
@@ -225,3 +278,154 @@ void test_smartstrap_comms__notification(void) {
   // process the fake context frame
   prv_do_read_notify(notify_context_raw, sizeof(notify_context_raw));
 }
+
+void test_smartstrap_comms__receive_data_dma(void) {
+  // read mbuf
+  MBuf read_mbuf = MBUF_EMPTY;
+  uint8_t read_data[2] = {0};
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+  // faked on-the-wire data for response
+  uint8_t response_raw[] = {0x7E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x43, 0x7E};
+  uint8_t expected[] = {0x00, 0x01};
+
+  prv_send_read_request(&read_mbuf);
+  prv_do_read_dma(response_raw, sizeof(response_raw), &read_mbuf, expected, sizeof(expected));
+  // a single idle line interrupt for the whole frame
+  cl_assert_equal_i(fake_accessory_rx_dma_get_num_interrupts(), 1);
+}
+
+void test_smartstrap_comms__receive_escaped_data_dma(void) {
+  // read MBuf
+  uint8_t test_data[] = {0x7D, 0x7E, 0x00, 0x7E, 0x7D, 0x00};
+  MBuf read_mbuf = MBUF_EMPTY;
+  uint8_t read_data[sizeof(test_data)] = {0};
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+  // faked on-the-wire data for response
+  uint8_t response_raw[] = {0x7E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x7D, 0x5D, 0x7D, 0x5E,
+                            0x00, 0x7D, 0x5E, 0x7D, 0x5D, 0x00, 0xC5, 0x7E};
+
+  prv_send_read_request(&read_mbuf);
+  // split the frame between an escape byte and the byte it escapes, with KernelBG decoding the
+  // first part before the rest arrives
+  fake_accessory_rx_dma_receive(response_raw, 9);
+  fake_system_task_callbacks_invoke_pending();
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadInProgress);
+  prv_do_read_dma(&response_raw[9], sizeof(response_raw) - 9, &read_mbuf, test_data,
+                  sizeof(test_data));
+}
+
+void test_smartstrap_comms__receive_data_dma_wraps(void) {
+  uint8_t payload[150];
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 7);
+  }
+  uint8_t response_raw[2 * sizeof(payload) + 20];
+  const int response_length = prv_build_response(payload, sizeof(payload), response_raw);
+
+  // receive the same response a few times so that frames wrap around the end of the DMA buffer
+  for (int i = 0; i < 4; i++) {
+    MBuf read_mbuf = MBUF_EMPTY;
+    uint8_t read_data[sizeof(payload)] = {0};
+    mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+    prv_send_read_request(&read_mbuf);
+    prv_do_read_dma(response_raw, response_length, &read_mbuf, payload, sizeof(payload));
+  }
+}
+
+void test_smartstrap_comms__receive_corrupt_data_dma(void) {
+  MBuf read_mbuf = MBUF_EMPTY;
+  uint8_t read_data[2] = {0};
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+  // bad checksum
+  uint8_t response_raw[] = {0x7E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x44, 0x7E};
+
+  prv_send_read_request(&read_mbuf);
+  fake_accessory_rx_dma_receive(response_raw, sizeof(response_raw));
+  fake_system_task_callbacks_invoke_pending();
+  // the frame is dropped and we wait for the timeout
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadInProgress);
+}
+
+void test_smartstrap_comms__receive_throughput(void) {
+  const int NUM_FRAMES = 2000;
+  uint8_t payload[150];
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)((i * 37) + 11);
+  }
+  uint8_t response_raw[2 * sizeof(payload) + 20];
+  const int response_length = prv_build_response(payload, sizeof(payload), response_raw);
+  uint8_t read_data[sizeof(payload)];
+  MBuf read_mbuf = MBUF_EMPTY;
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+
+  // one interrupt per byte
+  uint32_t num_byte_interrupts = 0;
+  for (int i = 0; i < NUM_FRAMES; i++) {
+    prv_send_read_request(&read_mbuf);
+    for (int j = 0; j < response_length; j++) {
+      smartstrap_handle_data_from_isr(response_raw[j]);
+      num_byte_interrupts++;
+    }
+    fake_system_task_callbacks_invoke_pending();
+    fake_smartstrap_profiles_check_read_params(true, SmartstrapProfileRawData, sizeof(payload));
+  }
+
+  // DMA with the frame decoded in bulk from KernelBG
+  for (int i = 0; i < NUM_FRAMES; i++) {
+    prv_send_read_request(&read_mbuf);
+    fake_accessory_rx_dma_receive(response_raw, response_length);
+    fake_system_task_callbacks_invoke_pending();
+    fake_smartstrap_profiles_check_read_params(true, SmartstrapProfileRawData, sizeof(payload));
+  }
+  cl_assert_equal_m(read_data, payload, sizeof(payload));
+
+  const uint32_t num_dma_interrupts = fake_accessory_rx_dma_get_num_interrupts();
+  cl_assert(num_dma_interrupts * 10 < num_byte_interrupts);
+  // each frame spans at most two half / full transfer interrupts on top of the idle line interrupt
+  cl_assert(num_dma_interrupts <= (uint32_t)(3 * NUM_FRAMES));
+}
+
+void test_smartstrap_comms__receive_data_dma_overrun(void) {
+  // a response which is longer than the DMA buffer
+  uint8_t payload[300];
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 3);
+  }
+  uint8_t response_raw[2 * sizeof(payload) + 20];
+  const int response_length = prv_build_response(payload, sizeof(payload), response_raw);
+  MBuf read_mbuf = MBUF_EMPTY;
+  uint8_t read_data[sizeof(payload)];
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+
+  // KernelBG doesn't get to decode any of it before the DMA wraps around past unread data, so the
+  // read fails without waiting for the timeout
+  prv_send_read_request(&read_mbuf);
+  fake_accessory_rx_dma_receive(response_raw, response_length);
+  fake_system_task_callbacks_invoke_pending();
+  fake_smartstrap_profiles_check_read_params(false, SmartstrapProfileRawData, 0);
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadReady);
+
+  // the next response which is read in time goes through
+  uint8_t expected[] = {0x00, 0x01};
+  uint8_t small_response_raw[] = {0x7E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x43,
+                                  0x7E};
+  mbuf_set_data(&read_mbuf, read_data, sizeof(expected));
+  prv_send_read_request(&read_mbuf);
+  prv_do_read_dma(small_response_raw, sizeof(small_response_raw), &read_mbuf, expected,
+                  sizeof(expected));
+}
+
+void test_smartstrap_comms__receive_framing_error_dma(void) {
+  MBuf read_mbuf = MBUF_EMPTY;
+  uint8_t read_data[2] = {0};
+  mbuf_set_data(&read_mbuf, read_data, sizeof(read_data));
+  uint8_t response_raw[] = {0x7E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x43, 0x7E};
+
+  // the UART flags an error on one of the bytes, so the frame can't be trusted even though it
+  // looks valid
+  prv_send_read_request(&read_mbuf);
+  fake_accessory_rx_dma_receive_with_error(response_raw, sizeof(response_raw));
+  fake_system_task_callbacks_invoke_pending();
+  fake_smartstrap_profiles_check_read_params(false, SmartstrapProfileRawData, 0);
+  cl_assert(smartstrap_fsm_state_get() == SmartstrapStateReadReady);
+}
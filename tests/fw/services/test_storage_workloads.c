@@ -0,0 +1,387 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flash_region/filesystem_regions.h"
+#include "flash_region/flash_region.h"
+#include "services/normal/filesystem/pfs.h"
+#include "services/normal/settings/settings_file.h"
+#include "util/math.h"
+#include "util/size.h"
+
+#include "clar.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "fake_rtc.h"
+#include "fake_spi_flash.h"
+#include "stubs_analytics.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_print.h"
+#include "stubs_prompt.h"
+#include "stubs_serial.h"
+#include "stubs_sleep.h"
+#include "stubs_task_watchdog.h"
+
+extern void settings_file_reset_all_state(void);
+
+//! Replays synthetic workloads that look like what the system services do to the filesystem and
+//! reports how much flash traffic and wear they cause. The counts are compared against
+//! storage/workload_baseline.txt in the fixtures so that regressions in garbage collection,
+//! compaction or the cost of opening files fail the test. When a change makes a workload cheaper,
+//! copy the report written to TEST_OUTPUT_PATH over the baseline.
+
+#define BASELINE_FIXTURE "storage/workload_baseline.txt"
+#define REPORT_FILENAME "storage_workloads.txt"
+
+#define PERSIST_MAX_USED_SPACE (6 * 1024)
+
+static const FSRegion s_fs_regions[] = {
+  FILE_SYSTEM_REGIONS(FILE_SYSTEM_FS_REGION_ENTRY_CONSTRUCTOR)
+};
+
+typedef struct {
+  uint32_t num_ops;
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t erases;
+  uint32_t max_wear;
+} WorkloadCounts;
+
+typedef struct {
+  const char *name;
+  void (*run)(void);
+} Workload;
+
+static uint32_t s_num_ops;
+static uint32_t s_rand_state;
+
+// Helpers
+////////////////////////////////////////////////////////////////////////////////
+
+//! Deterministic, so that the counts can be compared against the baseline
+static uint32_t prv_rand(void) {
+  s_rand_state = s_rand_state * 1103515245 + 12345;
+  return (s_rand_state >> 16) & 0x7fff;
+}
+
+static uint32_t prv_rand_range(uint32_t min, uint32_t max) {
+  return min + (prv_rand() % (max - min + 1));
+}
+
+static void prv_fill_value(uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    buf[i] = prv_rand();
+  }
+}
+
+typedef struct {
+  uint8_t bytes[16];
+} ItemKey;
+
+static ItemKey prv_item_key(uint32_t id) {
+  ItemKey key = {};
+  memcpy(key.bytes, &id, sizeof(id));
+  key.bytes[15] = 0x5a;
+  return key;
+}
+
+static void prv_set_item(SettingsFile *file, uint32_t id, size_t min_len, size_t max_len) {
+  uint8_t val[max_len];
+  const size_t len = prv_rand_range(min_len, max_len);
+  prv_fill_value(val, len);
+  const ItemKey key = prv_item_key(id);
+  cl_must_pass(settings_file_set(file, &key, sizeof(key), val, len));
+  s_num_ops++;
+}
+
+static void prv_delete_item(SettingsFile *file, uint32_t id) {
+  const ItemKey key = prv_item_key(id);
+  cl_must_pass(settings_file_delete(file, &key, sizeof(key)));
+  s_num_ops++;
+}
+
+static void prv_write_file(const char *name, size_t size, size_t chunk_size) {
+  const int fd = pfs_open(name, OP_FLAG_WRITE, FILE_TYPE_STATIC, size);
+  cl_assert(fd >= 0);
+  uint8_t chunk[chunk_size];
+  for (size_t offset = 0; offset < size; offset += chunk_size) {
+    const size_t len = MIN(chunk_size, size - offset);
+    prv_fill_value(chunk, len);
+    cl_assert_equal_i(pfs_write(fd, chunk, len), len);
+    s_num_ops++;
+  }
+  cl_must_pass(pfs_close(fd));
+  s_num_ops++;
+}
+
+static void prv_read_file_head(const char *name, size_t len) {
+  const int fd = pfs_open(name, OP_FLAG_READ, 0, 0);
+  cl_assert(fd >= 0);
+  uint8_t buf[len];
+  cl_assert_equal_i(pfs_read(fd, buf, len), len);
+  cl_must_pass(pfs_close(fd));
+  s_num_ops++;
+}
+
+// Workloads
+////////////////////////////////////////////////////////////////////////////////
+
+//! A burst of notifications coming in while the watch was disconnected, the oldest ones get
+//! deleted to stay under the limit
+static void prv_notification_burst(void) {
+  const int max_notifications = 40;
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "notifs", 32 * 1024));
+  for (int i = 0; i < 120; i++) {
+    prv_set_item(&file, i, 150, 500);
+    if (i >= max_notifications) {
+      prv_delete_item(&file, i - max_notifications);
+    }
+    fake_rtc_increment_time(5);
+  }
+  settings_file_close(&file);
+}
+
+//! A full timeline sync after a reconnect, followed by a few days worth of incremental syncs that
+//! update some pins, expire old ones and add new ones
+static void prv_pin_sync(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "pins", 64 * 1024));
+  const int num_pins = 150;
+  for (int i = 0; i < num_pins; i++) {
+    prv_set_item(&file, i, 200, 400);
+  }
+  settings_file_close(&file);
+
+  int oldest_pin = 0;
+  int next_pin = num_pins;
+  for (int day = 0; day < 3; day++) {
+    fake_rtc_increment_time(SECONDS_PER_DAY);
+    cl_must_pass(settings_file_open(&file, "pins", 64 * 1024));
+    for (int i = 0; i < 40; i++) {
+      prv_set_item(&file, prv_rand_range(oldest_pin, next_pin - 1), 200, 400);
+    }
+    for (int i = 0; i < 20; i++) {
+      prv_delete_item(&file, oldest_pin++);
+      prv_set_item(&file, next_pin++, 200, 400);
+    }
+    settings_file_close(&file);
+  }
+}
+
+//! Health minute data, written out in a new file every 15 minutes, only the last 2 hours are kept
+//! around until they get synced
+static void prv_health_minutes(void) {
+  const int minutes_per_file = 15;
+  const int num_files_kept = 8;
+  const size_t minute_record_size = 24;
+  char name[16];
+  for (int file_idx = 0; file_idx < 6 * 60 / minutes_per_file; file_idx++) {
+    snprintf(name, sizeof(name), "hmin%d", file_idx);
+    prv_write_file(name, minutes_per_file * minute_record_size, minute_record_size);
+    if (file_idx >= num_files_kept) {
+      snprintf(name, sizeof(name), "hmin%d", file_idx - num_files_kept);
+      cl_must_pass(pfs_remove(name));
+      s_num_ops++;
+    }
+    fake_rtc_increment_time(minutes_per_file * SECONDS_PER_MINUTE);
+  }
+}
+
+//! Installing apps the way put_bytes does, reading the header back at launch and replacing an
+//! older app each time
+static void prv_app_installs(void) {
+  const size_t put_bytes_chunk_size = 2000;
+  char name[16];
+  for (int app = 0; app < 6; app++) {
+    snprintf(name, sizeof(name), "app%d", app);
+    prv_write_file(name, 48 * 1024 + app * 1000, put_bytes_chunk_size);
+    prv_read_file_head(name, 512);
+    snprintf(name, sizeof(name), "res%d", app);
+    prv_write_file(name, 96 * 1024 - app * 3000, put_bytes_chunk_size);
+    prv_read_file_head(name, 512);
+    if (app >= 2) {
+      snprintf(name, sizeof(name), "app%d", app - 2);
+      cl_must_pass(pfs_remove(name));
+      snprintf(name, sizeof(name), "res%d", app - 2);
+      cl_must_pass(pfs_remove(name));
+      s_num_ops += 2;
+    }
+  }
+}
+
+//! An app that keeps overwriting a few persist keys, and gets relaunched every so often
+static void prv_persist_churn(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "ps", PERSIST_MAX_USED_SPACE));
+  for (int i = 0; i < 6000; i++) {
+    const uint32_t key = prv_rand_range(0, 15);
+    if (key < 8) {
+      prv_set_item(&file, key, sizeof(int32_t), sizeof(int32_t));
+    } else {
+      prv_set_item(&file, key, 8, 256);
+    }
+    if ((i % 100) == 99) {
+      settings_file_close(&file);
+      cl_must_pass(settings_file_open(&file, "ps", PERSIST_MAX_USED_SPACE));
+      s_num_ops++;
+    }
+    fake_rtc_increment_time(1);
+  }
+  settings_file_close(&file);
+}
+
+static const Workload s_workloads[] = {
+  { "notification_burst", prv_notification_burst },
+  { "pin_sync", prv_pin_sync },
+  { "health_minutes", prv_health_minutes },
+  { "app_installs", prv_app_installs },
+  { "persist_churn", prv_persist_churn },
+};
+
+// Measuring
+////////////////////////////////////////////////////////////////////////////////
+
+//! Fills up the filesystem with files that stay around, up to where get_available_pfs_space()
+//! starts turning down big files, so that the workloads have to garbage collect like they would
+//! on a watch that has been in use for a while
+static void prv_populate_filesystem(void) {
+  char name[16];
+  for (int i = 0; get_available_pfs_space() > 64 * 1024; i++) {
+    snprintf(name, sizeof(name), "static%d", i);
+    prv_write_file(name, 32 * 1024, 4096);
+  }
+}
+
+static void prv_get_wear(uint32_t *min_wear_out, uint32_t *max_wear_out) {
+  *min_wear_out = UINT32_MAX;
+  *max_wear_out = 0;
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_fs_regions); i++) {
+    for (uint32_t addr = s_fs_regions[i].start; addr < s_fs_regions[i].end;
+         addr += SUBSECTOR_SIZE_BYTES) {
+      const uint32_t wear = fake_flash_subsector_erase_count(addr);
+      *min_wear_out = MIN(*min_wear_out, wear);
+      *max_wear_out = MAX(*max_wear_out, wear);
+    }
+  }
+}
+
+static uint64_t prv_host_time_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static WorkloadCounts prv_run_workload(const Workload *workload) {
+  fake_spi_flash_init(0, 0x1000000);
+  fake_rtc_init(0, 1000000);
+  pfs_init(false);
+  pfs_format(true /* write erase headers */);
+  settings_file_reset_all_state();
+  s_rand_state = 1;
+  prv_populate_filesystem();
+
+  fake_flash_reset_stats();
+  s_num_ops = 0;
+  const uint64_t start_us = prv_host_time_us();
+  workload->run();
+  const uint64_t host_time_us = prv_host_time_us() - start_us;
+
+  WorkloadCounts counts = {
+    .num_ops = s_num_ops,
+    .reads = fake_flash_read_count(),
+    .writes = fake_flash_write_count(),
+    .erases = fake_flash_erase_count(),
+  };
+  uint32_t min_wear;
+  prv_get_wear(&min_wear, &counts.max_wear);
+
+  printf("%-20s %5"PRIu32" ops, flash: %7"PRIu32" reads (%"PRIu64" KiB), %6"PRIu32" writes "
+         "(%"PRIu64" KiB), %4"PRIu32" erases, %6"PRIu64" us/op modeled, %5"PRIu64" us/op host, "
+         "subsector erases min/max %"PRIu32"/%"PRIu32"\n",
+         workload->name, counts.num_ops, counts.reads, fake_flash_bytes_read() / 1024,
+         counts.writes, fake_flash_bytes_written() / 1024, counts.erases,
+         fake_flash_busy_time_us() / counts.num_ops, host_time_us / counts.num_ops,
+         min_wear, counts.max_wear);
+  return counts;
+}
+
+static bool prv_find_baseline(const char *name, WorkloadCounts *baseline_out) {
+  FILE *file = fopen(cl_fixture(BASELINE_FIXTURE), "r");
+  cl_assert(file);
+  bool found = false;
+  char line[128];
+  char line_name[32];
+  while (!found && fgets(line, sizeof(line), file)) {
+    WorkloadCounts counts;
+    if (line[0] == '#' ||
+        sscanf(line, "%31s %"SCNu32" %"SCNu32" %"SCNu32" %"SCNu32" %"SCNu32, line_name,
+               &counts.num_ops, &counts.reads, &counts.writes, &counts.erases,
+               &counts.max_wear) != 6) {
+      continue;
+    }
+    if (strcmp(line_name, name) == 0) {
+      *baseline_out = counts;
+      found = true;
+    }
+  }
+  fclose(file);
+  return found;
+}
+
+// Tests
+////////////////////////////////////////////////////////////////////////////////
+
+void test_storage_workloads__cleanup(void) {
+  fake_spi_flash_cleanup();
+}
+
+void test_storage_workloads__replay(void) {
+  WorkloadCounts counts[ARRAY_LENGTH(s_workloads)];
+  printf("\n");
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_workloads); i++) {
+    counts[i] = prv_run_workload(&s_workloads[i]);
+  }
+
+  // Written before checking against the baseline, so it can be used to update the baseline
+  FILE *report = fopen(TEST_OUTPUT_PATH "/" REPORT_FILENAME, "w");
+  cl_assert(report);
+  fprintf(report, "# workload ops flash_reads flash_writes flash_erases max_subsector_erases\n");
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_workloads); i++) {
+    fprintf(report, "%s %"PRIu32" %"PRIu32" %"PRIu32" %"PRIu32" %"PRIu32"\n",
+            s_workloads[i].name, counts[i].num_ops, counts[i].reads, counts[i].writes,
+            counts[i].erases, counts[i].max_wear);
+  }
+  fclose(report);
+
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_workloads); i++) {
+    WorkloadCounts baseline;
+    cl_assert(prv_find_baseline(s_workloads[i].name, &baseline));
+    // The workloads are deterministic, anything above the baseline is a regression
+    cl_assert_equal_i(counts[i].num_ops, baseline.num_ops);
+    cl_assert(counts[i].reads <= baseline.reads);
+    cl_assert(counts[i].writes <= baseline.writes);
+    cl_assert(counts[i].erases <= baseline.erases);
+    cl_assert(counts[i].max_wear <= baseline.max_wear);
+  }
+}
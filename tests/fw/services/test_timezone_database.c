@@ -31,8 +31,10 @@
 int timezone_database_find_region_by_name(const char *region_name, int region_name_length);
 
 #include "resource/resource.h"
+static int s_num_resource_reads;
 size_t resource_load_byte_range_system(ResAppNum app_num, uint32_t resource_id,
                                        uint32_t start_offset, uint8_t *data, size_t num_bytes) {
+  s_num_resource_reads++;
   memcpy(data, ((uint8_t*) s_timezone_database) + start_offset, num_bytes);
   return num_bytes;
 }
@@ -128,3 +130,42 @@ void test_timezone_database__kazakhstan(void) {
     cl_assert_equal_i(tz_info.tm_gmtoff, 6 * 60 * 60); // +6 hours
   }
 }
+
+void test_timezone_database__find_every_region_by_name(void) {
+  const int region_count = timezone_database_get_region_count();
+  for (int i = 0; i < region_count; i++) {
+    char region_name[TIMEZONE_NAME_LENGTH];
+    cl_assert(timezone_database_load_region_name(i, region_name));
+
+    // A few names appear more than once, in which case we find the first
+    const int region_id = FIND_REGION(region_name);
+    cl_assert(region_id != -1);
+    cl_assert(region_id <= i);
+    char found_region_name[TIMEZONE_NAME_LENGTH];
+    cl_assert(timezone_database_load_region_name(region_id, found_region_name));
+    cl_assert_equal_s(found_region_name, region_name);
+  }
+}
+
+void test_timezone_database__find_region_by_name_reads(void) {
+  // Lookups are binary searches, so they only need a handful of reads no matter how many regions
+  // and links there are
+  s_num_resource_reads = 0;
+  const int pacific_wallis_region = FIND_REGION("Pacific/Wallis");
+  cl_assert(pacific_wallis_region != -1);
+  const int region_reads = s_num_resource_reads;
+
+  s_num_resource_reads = 0;
+  const int us_pacific_region = FIND_REGION("US/Pacific");
+  cl_assert(us_pacific_region != -1);
+  const int link_reads = s_num_resource_reads;
+
+  s_num_resource_reads = 0;
+  const int america_waterloo_region = FIND_REGION("America/Waterloo");
+  cl_assert(america_waterloo_region == -1);
+  const int miss_reads = s_num_resource_reads;
+
+  cl_assert(region_reads <= 12);
+  cl_assert(link_reads <= 24);
+  cl_assert(miss_reads <= 24);
+}
@@ -313,3 +313,128 @@ void test_wakeup__handle_clock_change_scheduled_jump(void) {
   // Make sure the wakeup event is no longer scheduled
   cl_assert_equal_i(sys_wakeup_query(first_timer), E_DOES_NOT_EXIST);
 }
+
+#define NUM_BENCHMARK_APPS 8
+#define NUM_CHURN_ROUNDS 200
+
+typedef struct {
+  WakeupId wakeup_id;
+  time_t timestamp;
+} ScheduledWakeup;
+
+static ScheduledWakeup s_scheduled[NUM_BENCHMARK_APPS][MAX_WAKEUP_EVENTS_PER_APP];
+
+static void prv_switch_to_app(int app) {
+  s_app_md.common.uuid = TEST_UUID;
+  s_app_md.common.uuid.byte15 = app;
+}
+
+static WakeupId prv_soonest_scheduled(void) {
+  const ScheduledWakeup *soonest = NULL;
+  for (int app = 0; app < NUM_BENCHMARK_APPS; app++) {
+    for (int i = 0; i < MAX_WAKEUP_EVENTS_PER_APP; i++) {
+      const ScheduledWakeup *wakeup = &s_scheduled[app][i];
+      if (wakeup->wakeup_id > 0 && (!soonest || wakeup->timestamp < soonest->timestamp)) {
+        soonest = wakeup;
+      }
+    }
+  }
+  return soonest ? soonest->wakeup_id : -1;
+}
+
+static void prv_assert_all_scheduled(void) {
+  for (int app = 0; app < NUM_BENCHMARK_APPS; app++) {
+    prv_switch_to_app(app);
+    for (int i = 0; i < MAX_WAKEUP_EVENTS_PER_APP; i++) {
+      cl_assert_equal_i(sys_wakeup_query(s_scheduled[app][i].wakeup_id),
+                        s_scheduled[app][i].timestamp);
+    }
+  }
+  cl_assert_equal_i(wakeup_get_next_scheduled(), prv_soonest_scheduled());
+}
+
+void test_wakeup__many_apps_with_churn(void) {
+  const time_t start_time = sys_get_time();
+
+  // 8 apps each schedule 8 wakeups, spread out in a shuffled order
+  for (int app = 0; app < NUM_BENCHMARK_APPS; app++) {
+    prv_switch_to_app(app);
+    for (int i = 0; i < MAX_WAKEUP_EVENTS_PER_APP; i++) {
+      const int slot = (((app * MAX_WAKEUP_EVENTS_PER_APP) + i) * 37) % 64;
+      const time_t timestamp = start_time + (slot + 1) * WAKEUP_EVENT_WINDOW;
+      const WakeupId wakeup_id = sys_wakeup_schedule(timestamp, app, false);
+      cl_assert(wakeup_id > 0);
+      s_scheduled[app][i] = (ScheduledWakeup) { wakeup_id, timestamp };
+    }
+    // Every app is at its limit
+    const time_t extra = start_time + (100 + app) * WAKEUP_EVENT_WINDOW;
+    cl_assert_equal_i(sys_wakeup_schedule(extra, 0, false), E_OUT_OF_RESOURCES);
+  }
+  prv_assert_all_scheduled();
+
+  // Apps repeatedly cancel a wakeup and schedule a replacement
+  const uint32_t churn_start_reads = fake_flash_read_count();
+  uint32_t lookup_reads = 0;
+  for (int round = 0; round < NUM_CHURN_ROUNDS; round++) {
+    const int app = (round * 3) % NUM_BENCHMARK_APPS;
+    const int i = (round * 5) % MAX_WAKEUP_EVENTS_PER_APP;
+    prv_switch_to_app(app);
+
+    // Another app can't cancel this wakeup
+    prv_switch_to_app((app + 1) % NUM_BENCHMARK_APPS);
+    sys_wakeup_delete(s_scheduled[app][i].wakeup_id);
+    prv_switch_to_app(app);
+
+    uint32_t reads = fake_flash_read_count();
+    cl_assert_equal_i(sys_wakeup_query(s_scheduled[app][i].wakeup_id),
+                      s_scheduled[app][i].timestamp);
+    lookup_reads += fake_flash_read_count() - reads;
+
+    sys_wakeup_delete(s_scheduled[app][i].wakeup_id);
+    cl_assert_equal_i(sys_wakeup_query(s_scheduled[app][i].wakeup_id), E_DOES_NOT_EXIST);
+    s_scheduled[app][i].wakeup_id = -1;
+    cl_assert_equal_i(wakeup_get_next_scheduled(), prv_soonest_scheduled());
+
+    const int slot = (round * 29) % NUM_CHURN_ROUNDS;
+    const time_t timestamp = start_time + (65 + slot) * WAKEUP_EVENT_WINDOW;
+    const WakeupId wakeup_id = sys_wakeup_schedule(timestamp, round, false);
+    cl_assert(wakeup_id > 0);
+    s_scheduled[app][i] = (ScheduledWakeup) { wakeup_id, timestamp };
+    cl_assert_equal_i(wakeup_get_next_scheduled(), prv_soonest_scheduled());
+
+    // Rescheduling the timer doesn't touch flash
+    reads = fake_flash_read_count();
+    wakeup_enable(false);
+    wakeup_enable(true);
+    lookup_reads += fake_flash_read_count() - reads;
+  }
+  const uint32_t churn_reads = fake_flash_read_count() - churn_start_reads;
+
+  // Only persisting the two deletes and the schedule of each round touches flash, scanning the
+  // settings file for every query and schedule used to take about 10000 reads per round
+  cl_assert(churn_reads < NUM_CHURN_ROUNDS * 2000);
+  cl_assert_equal_i(lookup_reads, 0);
+  prv_assert_all_scheduled();
+
+  // The schedule is rebuilt from flash after a reboot
+  wakeup_init();
+  wakeup_enable(true);
+  prv_assert_all_scheduled();
+
+  // Cancelling all of an app's wakeups only removes that app's wakeups
+  prv_switch_to_app(0);
+  sys_wakeup_cancel_all_for_app();
+  for (int i = 0; i < MAX_WAKEUP_EVENTS_PER_APP; i++) {
+    cl_assert_equal_i(sys_wakeup_query(s_scheduled[0][i].wakeup_id), E_DOES_NOT_EXIST);
+    s_scheduled[0][i].wakeup_id = -1;
+  }
+  cl_assert_equal_i(wakeup_get_next_scheduled(), prv_soonest_scheduled());
+  for (int app = 1; app < NUM_BENCHMARK_APPS; app++) {
+    prv_switch_to_app(app);
+    for (int i = 0; i < MAX_WAKEUP_EVENTS_PER_APP; i++) {
+      cl_assert_equal_i(sys_wakeup_query(s_scheduled[app][i].wakeup_id),
+                        s_scheduled[app][i].timestamp);
+    }
+  }
+  s_app_md.common.uuid = TEST_UUID;
+}
@@ -138,7 +138,30 @@ static void prv_assert_forecast_equal(const WeatherLocationForecast *to_check,
   cl_assert_equal_i(to_check->tomorrow_weather_type, original->tomorrow_weather_type);
 }
 
+static void prv_put_blob_db_event(BlobDBId db_id, BlobDBEventType type, const uint8_t *key,
+                                  size_t key_len) {
+  PebbleEvent event = (PebbleEvent) {
+    .type = PEBBLE_BLOBDB_EVENT,
+    .blob_db = {
+      .db_id = db_id,
+      .type = type,
+      .key = (uint8_t *)key,
+      .key_len = key_len,
+    }
+  };
+  s_event_info->handler(&event, s_event_info->context);
+}
+
+static void prv_put_weather_order_changed_event(void) {
+  prv_put_blob_db_event(BlobDBIdWatchAppPrefs, BlobDBEventTypeInsert,
+                        (const uint8_t *)PREF_KEY_WEATHER_APP, sizeof(PREF_KEY_WEATHER_APP));
+}
+
 void test_weather_service__get_data_for_all_locations(void) {
+  // The forecast cache only picks up the entries written by weather_shared_data_init() once a
+  // blob db event comes in
+  prv_put_weather_order_changed_event();
+
   size_t count_out;
   WeatherDataListNode *head = weather_service_locations_list_create(&count_out);
   WeatherLocationID id = 0;
@@ -157,10 +180,22 @@ void test_weather_service__get_data_for_all_locations(void) {
   weather_service_locations_list_destroy(head);
 }
 
+//! Asserts that the default forecast matches the expected one, or that there is none if NULL
+static void prv_assert_default_forecast(const WeatherLocationForecast *expected) {
+  weather_service_lock();
+  const WeatherLocationForecast *forecast = weather_service_get_default_forecast();
+  if (expected) {
+    cl_assert(forecast);
+    prv_assert_forecast_equal(forecast, expected);
+  } else {
+    cl_assert(!forecast);
+  }
+  weather_service_unlock();
+}
+
 void test_weather_service__get_default_location_forecast_from_weather_db_update(void) {
-  WeatherLocationForecast *forecast = weather_service_create_default_forecast();
   // no blob db events were fired during unit test, therefore forecast cache never updated
-  cl_assert(!forecast);
+  prv_assert_default_forecast(NULL);
 
   const int default_location_index = 0;
   const WeatherDBKey *default_location_key = weather_shared_data_get_key(default_location_index);
@@ -176,11 +211,7 @@ void test_weather_service__get_default_location_forecast_from_weather_db_update(
   };
 
   s_event_info->handler(&insert_event, s_event_info->context);
-  forecast = weather_service_create_default_forecast();
-
-  cl_assert(forecast);
-  prv_assert_forecast_equal(forecast, &s_forecasts[0]);
-  weather_service_destroy_default_forecast(forecast);
+  prv_assert_default_forecast(&s_forecasts[0]);
 
   weather_db_flush();
   PebbleEvent flush_event = (PebbleEvent) {
@@ -194,14 +225,12 @@ void test_weather_service__get_default_location_forecast_from_weather_db_update(
   };
 
   s_event_info->handler(&flush_event, s_event_info->context);
-  forecast = weather_service_create_default_forecast();
-  cl_assert(!forecast);
+  prv_assert_default_forecast(NULL);
 }
 
 void test_weather_service__get_default_location_forecast_from_watch_app_prefs_db_update(void) {
-  WeatherLocationForecast *forecast = weather_service_create_default_forecast();
   // no blob db events were fired during unit test, therefore forecast cache never updated
-  cl_assert(!forecast);
+  prv_assert_default_forecast(NULL);
 
   const int default_location_index = 0;
   const WeatherDBKey *default_location_key = weather_shared_data_get_key(0);
@@ -217,9 +246,72 @@ void test_weather_service__get_default_location_forecast_from_watch_app_prefs_db
   };
 
   s_event_info->handler(&insert_event, s_event_info->context);
-  forecast = weather_service_create_default_forecast();
+  prv_assert_default_forecast(&s_forecasts[0]);
+}
+
+void test_weather_service__default_forecast_view(void) {
+  weather_service_lock();
+  cl_assert(!weather_service_get_default_forecast());
+  weather_service_unlock();
+
+  prv_put_weather_order_changed_event();
 
+  const int num_allocs_before = fake_pbl_malloc_num_net_allocs();
+  weather_service_lock();
+  const WeatherLocationForecast *forecast = weather_service_get_default_forecast();
   cl_assert(forecast);
   prv_assert_forecast_equal(forecast, &s_forecasts[0]);
-  weather_service_destroy_default_forecast(forecast);
+  // Views are handed out straight from the cache
+  cl_assert(forecast == weather_service_get_default_forecast());
+  weather_service_unlock();
+  cl_assert_equal_i(fake_pbl_malloc_num_net_allocs(), num_allocs_before);
+}
+
+void test_weather_service__cache_follows_weather_db_updates(void) {
+  prv_put_weather_order_changed_event();
+
+  // Remove the default location
+  const WeatherDBKey *default_location_key = weather_shared_data_get_key(0);
+  cl_assert_equal_i(weather_db_delete((uint8_t *)default_location_key, sizeof(WeatherDBKey)),
+                    S_SUCCESS);
+  prv_put_blob_db_event(BlobDBIdWeather, BlobDBEventTypeDelete,
+                        (const uint8_t *)default_location_key, sizeof(WeatherDBKey));
+
+  prv_assert_default_forecast(NULL);
+  size_t count_out;
+  WeatherDataListNode *head = weather_service_locations_list_create(&count_out);
+  cl_assert_equal_i(count_out, 3);
+  cl_assert_equal_i(head->id, 1);
+  prv_assert_forecast_equal(&head->forecast, &s_forecasts[1]);
+  weather_service_locations_list_destroy(head);
+
+  // And add it back
+  cl_assert_equal_i(weather_db_insert((uint8_t *)default_location_key, sizeof(WeatherDBKey),
+                                      (uint8_t *)weather_shared_data_get_entry(0),
+                                      weather_shared_data_get_entry_size(0)), S_SUCCESS);
+  prv_put_blob_db_event(BlobDBIdWeather, BlobDBEventTypeInsert,
+                        (const uint8_t *)default_location_key, sizeof(WeatherDBKey));
+
+  prv_assert_default_forecast(&s_forecasts[0]);
+
+  head = weather_service_locations_list_create(&count_out);
+  cl_assert_equal_i(count_out, 4);
+  weather_service_locations_list_destroy(head);
+}
+
+void test_weather_service__repeated_cache_updates(void) {
+  // Like the launcher glance and the weather app refreshing while forecasts come in
+  const int num_requests = 20;
+  for (int i = 0; i < num_requests; i++) {
+    prv_put_weather_order_changed_event();
+    prv_put_blob_db_event(BlobDBIdWeather, BlobDBEventTypeInsert,
+                          (const uint8_t *)weather_shared_data_get_key(i % 4),
+                          sizeof(WeatherDBKey));
+    prv_assert_default_forecast(&s_forecasts[0]);
+
+    size_t count_out;
+    WeatherDataListNode *head = weather_service_locations_list_create(&count_out);
+    cl_assert_equal_i(count_out, 4);
+    weather_service_locations_list_destroy(head);
+  }
 }
@@ -17,6 +17,7 @@
 #include "util/heap.h"
 
 #include "applib/app_heap_util.h"
+#include "util/size.h"
 
 #include "clar.h"
 
@@ -345,3 +346,113 @@ void test_heap__fuzz_on_free(void) {
   prv_alloc_and_test_fuzz_on_free(true);
   prv_alloc_and_test_fuzz_on_free(false);
 }
+
+typedef struct {
+  HeapTraceOp op;
+  void *ptr;
+  size_t nbytes;
+  uintptr_t client_pc;
+} TraceEvent;
+
+static TraceEvent s_trace_events[8];
+static int s_num_trace_events;
+
+static void prv_trace_handler(Heap *heap, HeapTraceOp op, void *ptr, size_t nbytes,
+                              uintptr_t client_pc) {
+  cl_assert(s_num_trace_events < ARRAY_LENGTH(s_trace_events));
+  s_trace_events[s_num_trace_events++] = (TraceEvent) {
+    .op = op,
+    .ptr = ptr,
+    .nbytes = nbytes,
+    .client_pc = client_pc,
+  };
+}
+
+void test_heap__trace_handler(void) {
+  const size_t heap_size_bytes = 256;
+  void *heap_space = malloc(heap_size_bytes);
+  Heap heap;
+  heap_init(&heap, heap_space, heap_space + heap_size_bytes, false);
+  s_num_trace_events = 0;
+
+  // Nothing gets traced without a handler
+  heap_free(&heap, heap_malloc(&heap, 10, 0x1), 0x2);
+  cl_assert_equal_i(s_num_trace_events, 0);
+
+  heap_set_trace_handler(&heap, prv_trace_handler);
+
+  void *ptr = heap_malloc(&heap, 10, 0x10);
+  cl_assert(ptr);
+  ptr = heap_realloc(&heap, ptr, 20, 0x20);
+  cl_assert(ptr);
+  cl_assert_equal_p(heap_malloc(&heap, heap_size_bytes, 0x30), NULL);
+  heap_free(&heap, ptr, 0x40);
+  heap_free(&heap, NULL, 0x50);
+
+  cl_assert_equal_i(s_num_trace_events, 5);
+
+  cl_assert_equal_i(s_trace_events[0].op, HeapTraceOp_Malloc);
+  cl_assert_equal_i(s_trace_events[0].nbytes, 10);
+  cl_assert_equal_i(s_trace_events[0].client_pc, 0x10);
+
+  // realloc is a malloc of the new buffer followed by a free of the old one
+  cl_assert_equal_i(s_trace_events[1].op, HeapTraceOp_Malloc);
+  cl_assert_equal_p(s_trace_events[1].ptr, ptr);
+  cl_assert_equal_i(s_trace_events[1].nbytes, 20);
+  cl_assert_equal_i(s_trace_events[2].op, HeapTraceOp_Free);
+  cl_assert_equal_p(s_trace_events[2].ptr, s_trace_events[0].ptr);
+  cl_assert(s_trace_events[2].nbytes >= 10);
+  cl_assert_equal_i(s_trace_events[2].client_pc, 0x20);
+
+  // Failed mallocs are traced with a NULL pointer
+  cl_assert_equal_i(s_trace_events[3].op, HeapTraceOp_Malloc);
+  cl_assert_equal_p(s_trace_events[3].ptr, NULL);
+  cl_assert_equal_i(s_trace_events[3].nbytes, heap_size_bytes);
+
+  cl_assert_equal_i(s_trace_events[4].op, HeapTraceOp_Free);
+  cl_assert_equal_p(s_trace_events[4].ptr, ptr);
+  cl_assert_equal_i(s_trace_events[4].client_pc, 0x40);
+
+  free(heap_space);
+}
+
+typedef struct {
+  size_t total_size;
+  int num_allocated;
+  int num_free;
+  void *allocated[4];
+} BlockWalk;
+
+static bool prv_count_block(void *data, size_t block_size, bool is_allocated, void *context) {
+  BlockWalk *walk = context;
+  walk->total_size += block_size;
+  if (is_allocated) {
+    walk->allocated[walk->num_allocated++] = data;
+  } else {
+    walk->num_free++;
+  }
+  return true;
+}
+
+void test_heap__for_each_block(void) {
+  const size_t heap_size_bytes = 256;
+  void *heap_space = malloc(heap_size_bytes);
+  Heap heap;
+  heap_init(&heap, heap_space, heap_space + heap_size_bytes, false);
+
+  void *a = heap_malloc(&heap, 8, 0);
+  void *b = heap_malloc(&heap, 8, 0);
+  void *c = heap_malloc(&heap, 8, 0);
+  heap_free(&heap, b, 0);
+
+  // a, free block where b was, c, free rest of the heap
+  BlockWalk walk = {};
+  heap_for_each_block(&heap, prv_count_block, &walk);
+  cl_assert_equal_i(walk.total_size, heap_size(&heap));
+  cl_assert_equal_i(walk.num_allocated, 2);
+  cl_assert_equal_i(walk.num_free, 2);
+  cl_assert_equal_p(walk.allocated[0], a);
+  cl_assert_equal_p(walk.allocated[1], c);
+
+  free(heap_space);
+}
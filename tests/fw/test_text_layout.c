@@ -20,9 +20,12 @@
 #include "applib/graphics/text_layout_private.h"
 #include "applib/graphics/graphics.h"
 #include "applib/graphics/framebuffer.h"
+#include "util/math.h"
+#include "util/size.h"
 
 #include "clar.h"
 
+#include <string.h>
 
 ///////////////////////////////////////////////////////////
 // Stubs
@@ -37,13 +40,52 @@
 #include "stubs_applib_resource.h"
 #include "stubs_app_state.h"
 #include "stubs_fonts.h"
-#include "stubs_text_resources.h"
-#include "stubs_text_render.h"
 #include "stubs_reboot_reason.h"
 #include "stubs_resources.h"
 #include "stubs_syscalls.h"
 #include "stubs_compiled_with_legacy2_sdk.h"
 
+///////////////////////////////////////////////////////////
+// Fakes
+
+#define HORIZ_ADVANCE_PX (2)
+
+//! Counts the glyph metric lookups, which is what breaking text into lines costs
+static int s_num_horiz_advance_lookups;
+
+bool text_resources_setup_font(FontCache* font_cache, FontInfo* fontinfo) {
+  return true;
+}
+
+int8_t text_resources_get_glyph_horiz_advance(FontCache* font_cache, Codepoint codepoint,
+                                              FontInfo* fontinfo) {
+  s_num_horiz_advance_lookups++;
+  if (codepoint_is_zero_width(codepoint)) {
+    return 0;
+  }
+  // Real fonts have some weird values here, give something totally bogus for testing.
+  if (codepoint == '\n') {
+    return 5;
+  }
+  return HORIZ_ADVANCE_PX;
+}
+
+int8_t text_resources_get_glyph_height(FontCache* font_cache, Codepoint codepoint,
+                                       FontInfo* fontinfo) {
+  return 10;
+}
+
+//! Sums up the rendered glyphs and where they were rendered
+static uint32_t s_render_checksum;
+static int s_num_rendered_glyphs;
+
+void render_glyph(GContext* ctx, uint32_t codepoint, FontInfo* font, GRect cursor) {
+  s_render_checksum = (s_render_checksum * 31) + codepoint;
+  s_render_checksum = (s_render_checksum * 31) + (uint16_t)cursor.origin.x;
+  s_render_checksum = (s_render_checksum * 31) + (uint16_t)cursor.origin.y;
+  s_num_rendered_glyphs++;
+}
+
 #if SCREEN_COLOR_DEPTH_BITS == 8
 #define FONT_LINE_DELTA 2
 #else
@@ -429,3 +471,296 @@ void test_text_layout__special_codepoints(void) {
   cl_assert_equal_i(layout.box.size.w, box.size.w);
   cl_assert_equal_i(layout.max_used_size.w, 0 * HORIZ_ADVANCE_PX);
 }
+
+///////////////////////////////////////////////////////////
+// Long text scrolling
+
+#define LONG_TEXT_BOX_WIDTH (24 * HORIZ_ADVANCE_PX + 1)
+#define LONG_TEXT_BOX_HEIGHT (1000 * FONT_HEIGHT)
+
+static char *prv_create_long_text(int num_paragraphs) {
+  static const char *s_sentences[] = {
+    "Reminder: the meeting got moved to the big room on the third floor. ",
+    "Can you pick up some milk on the way home? ",
+    "Supercalifragilisticexpialidocious words get hyphenated. ",
+    "Ok\n\n",
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. ",
+  };
+  const int num_sentences = ARRAY_LENGTH(s_sentences);
+  const size_t text_size = num_paragraphs * 512;
+  char *text = malloc(text_size);
+  text[0] = '\0';
+  for (int i = 0; i < num_paragraphs; i++) {
+    for (int j = 0; j <= (i % 4); j++) {
+      strcat(text, s_sentences[(i + j) % num_sentences]);
+    }
+    strcat(text, "\n");
+  }
+  cl_assert(strlen(text) < text_size);
+  return text;
+}
+
+typedef struct {
+  uint32_t render_checksum;
+  int num_rendered_glyphs;
+  GSize max_used_size;
+} DrawResult;
+
+//! Draws the text like a TextLayer in a ScrollLayer would, scrolled by scroll_offset
+static DrawResult prv_draw_scrolled(GContext *ctx, const char *text, int16_t scroll_offset,
+                                    GTextOverflowMode overflow_mode, GTextAlignment alignment,
+                                    TextLayoutExtended *layout) {
+  s_render_checksum = 0;
+  s_num_rendered_glyphs = 0;
+  layout->max_used_size = GSizeZero;
+  const GRect box = GRect(0, -scroll_offset, LONG_TEXT_BOX_WIDTH, LONG_TEXT_BOX_HEIGHT);
+  graphics_draw_text(ctx, text, (GFont) { 0 }, box, overflow_mode, alignment,
+                     (GTextLayoutCacheRef)layout);
+  return (DrawResult) {
+    .render_checksum = s_render_checksum,
+    .num_rendered_glyphs = s_num_rendered_glyphs,
+    .max_used_size = layout->max_used_size,
+  };
+}
+
+static void prv_assert_draw_result_equal(const DrawResult *a, const DrawResult *b) {
+  cl_assert_equal_i(a->render_checksum, b->render_checksum);
+  cl_assert_equal_i(a->num_rendered_glyphs, b->num_rendered_glyphs);
+  cl_assert_equal_i(a->max_used_size.w, b->max_used_size.w);
+  cl_assert_equal_i(a->max_used_size.h, b->max_used_size.h);
+}
+
+//! Scrolls through the text with one context that keeps its checkpoints and compares every frame
+//! against drawing it with a context that starts over at the top of the text
+static void prv_assert_scrolling_renders_same_glyphs(const char *text,
+                                                     GTextOverflowMode overflow_mode,
+                                                     GTextAlignment alignment,
+                                                     int16_t line_spacing_delta) {
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  GContext warm_ctx;
+  graphics_context_init(&warm_ctx, fb, GContextInitializationMode_App);
+  TextLayoutExtended warm_layout = { .line_spacing_delta = line_spacing_delta };
+  TextLayoutExtended cold_layout = { .line_spacing_delta = line_spacing_delta };
+
+  const int16_t content_height =
+      graphics_text_layout_get_max_used_size(&warm_ctx, text, (GFont) { 0 },
+                                             GRect(0, 0, LONG_TEXT_BOX_WIDTH, LONG_TEXT_BOX_HEIGHT),
+                                             overflow_mode, alignment,
+                                             (GTextLayoutCacheRef)&warm_layout).h;
+  cl_assert(content_height > 10 * DISP_ROWS);
+
+  // Scroll down, jump back up and scroll down again with a different step
+  const int16_t scroll_steps[] = { 7, -content_height, 33 };
+  int16_t scroll_offset = 0;
+  for (unsigned int i = 0; i < ARRAY_LENGTH(scroll_steps); i++) {
+    const int16_t step = scroll_steps[i];
+    do {
+      GContext cold_ctx;
+      graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+      const DrawResult cold = prv_draw_scrolled(&cold_ctx, text, scroll_offset, overflow_mode,
+                                                alignment, &cold_layout);
+      const DrawResult warm = prv_draw_scrolled(&warm_ctx, text, scroll_offset, overflow_mode,
+                                                alignment, &warm_layout);
+      prv_assert_draw_result_equal(&warm, &cold);
+      cl_assert(cold.num_rendered_glyphs > 0);
+      text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+
+      scroll_offset = CLIP(scroll_offset + step, 0, content_height - DISP_ROWS);
+    } while (scroll_offset > 0 && scroll_offset < content_height - DISP_ROWS);
+  }
+  cl_assert(warm_ctx.text_draw_state.checkpoints->num_checkpoints > 0);
+  text_draw_state_free_checkpoints(&warm_ctx.text_draw_state);
+  free(fb);
+}
+
+void test_text_layout__scroll_checkpoints_render_same_glyphs(void) {
+  char *text = prv_create_long_text(40);
+  prv_assert_scrolling_renders_same_glyphs(text, GTextOverflowModeWordWrap,
+                                           GTextAlignmentLeft, 0);
+  prv_assert_scrolling_renders_same_glyphs(text, GTextOverflowModeTrailingEllipsis,
+                                           GTextAlignmentCenter, 0);
+  prv_assert_scrolling_renders_same_glyphs(text, GTextOverflowModeFill,
+                                           GTextAlignmentRight, 0);
+  prv_assert_scrolling_renders_same_glyphs(text, GTextOverflowModeWordWrap,
+                                           GTextAlignmentLeft, 3);
+  free(text);
+}
+
+void test_text_layout__scroll_checkpoints_keep_max_used_width(void) {
+  // Only the first line is wide
+  char text[512] = "The widest line of all\n";
+  for (int i = 0; i < 100; i++) {
+    strcat(text, "ab\n");
+  }
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  GContext ctx;
+  graphics_context_init(&ctx, fb, GContextInitializationMode_App);
+  TextLayoutExtended layout = {};
+
+  for (int i = 0; i < 2; i++) {
+    const DrawResult result = prv_draw_scrolled(&ctx, text, 800, GTextOverflowModeWordWrap,
+                                                GTextAlignmentLeft, &layout);
+    cl_assert_equal_i(result.max_used_size.w, 22 * HORIZ_ADVANCE_PX);
+  }
+  text_draw_state_free_checkpoints(&ctx.text_draw_state);
+  free(fb);
+}
+
+void test_text_layout__scroll_checkpoints_survive_short_texts(void) {
+  char *text = prv_create_long_text(40);
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  GContext ctx;
+  graphics_context_init(&ctx, fb, GContextInitializationMode_App);
+  TextLayoutExtended layout = {};
+
+  prv_draw_scrolled(&ctx, text, 2000, GTextOverflowModeWordWrap, GTextAlignmentLeft, &layout);
+  cl_assert(ctx.text_draw_state.checkpoints);
+  const TextLayoutCheckpoints checkpoints = *ctx.text_draw_state.checkpoints;
+  cl_assert(checkpoints.num_checkpoints > 0);
+
+  // Titles and status bars drawn in between don't take over the checkpoints
+  TextLayoutExtended title_layout = {};
+  graphics_draw_text(&ctx, "Title\nSubtitle", (GFont) { 0 }, GRect(0, 0, 100, 30),
+                     GTextOverflowModeWordWrap, GTextAlignmentLeft,
+                     (GTextLayoutCacheRef)&title_layout);
+  cl_assert_equal_m(ctx.text_draw_state.checkpoints, &checkpoints, sizeof(checkpoints));
+
+  s_num_horiz_advance_lookups = 0;
+  prv_draw_scrolled(&ctx, text, 2000, GTextOverflowModeWordWrap, GTextAlignmentLeft, &layout);
+  const int warm_lookups = s_num_horiz_advance_lookups;
+
+  GContext cold_ctx;
+  graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+  s_num_horiz_advance_lookups = 0;
+  prv_draw_scrolled(&cold_ctx, text, 2000, GTextOverflowModeWordWrap, GTextAlignmentLeft,
+                    &layout);
+  cl_assert(warm_lookups * 2 < s_num_horiz_advance_lookups);
+
+  text_draw_state_free_checkpoints(&ctx.text_draw_state);
+  text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+  free(fb);
+  free(text);
+}
+
+void test_text_layout__scroll_checkpoints_invalidated(void) {
+  char *text = prv_create_long_text(40);
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  GContext warm_ctx;
+  graphics_context_init(&warm_ctx, fb, GContextInitializationMode_App);
+  TextLayoutExtended layout = {};
+  prv_draw_scrolled(&warm_ctx, text, 2000, GTextOverflowModeWordWrap, GTextAlignmentLeft,
+                    &layout);
+  cl_assert(warm_ctx.text_draw_state.checkpoints->num_checkpoints > 0);
+
+  // Changing the text in place moves the line breaks
+  memset(text, 'x', 100);
+  GContext cold_ctx;
+  graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+  DrawResult cold = prv_draw_scrolled(&cold_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                      GTextAlignmentLeft, &layout);
+  DrawResult warm = prv_draw_scrolled(&warm_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                      GTextAlignmentLeft, &layout);
+  prv_assert_draw_result_equal(&warm, &cold);
+
+  // So does a narrower box
+  text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+  graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+  const GRect box = GRect(0, -2000, LONG_TEXT_BOX_WIDTH - 10, LONG_TEXT_BOX_HEIGHT);
+  s_render_checksum = 0;
+  graphics_draw_text(&cold_ctx, text, (GFont) { 0 }, box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  const uint32_t cold_checksum = s_render_checksum;
+  s_render_checksum = 0;
+  graphics_draw_text(&warm_ctx, text, (GFont) { 0 }, box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  cl_assert_equal_i(s_render_checksum, cold_checksum);
+
+  text_draw_state_free_checkpoints(&warm_ctx.text_draw_state);
+  text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+  free(fb);
+  free(text);
+}
+
+void test_text_layout__scroll_checkpoints_hash_once_per_frame(void) {
+  char *text = prv_create_long_text(40);
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  GContext warm_ctx;
+  graphics_context_init(&warm_ctx, fb, GContextInitializationMode_App);
+  TextLayoutExtended layout = {};
+
+  text_draw_state_begin_frame(&warm_ctx.text_draw_state);
+  const uint32_t first_frame_id = warm_ctx.text_draw_state.frame_id;
+  cl_assert(first_frame_id != 0);
+  const DrawResult first = prv_draw_scrolled(&warm_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                             GTextAlignmentLeft, &layout);
+  cl_assert_equal_i(warm_ctx.text_draw_state.checkpoints->text_verified_frame_id,
+                    first_frame_id);
+  // Drawing the same text again in the same frame, e.g. as a shadow, trusts the earlier hash
+  const DrawResult second = prv_draw_scrolled(&warm_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                              GTextAlignmentLeft, &layout);
+  prv_assert_draw_result_equal(&second, &first);
+  text_draw_state_end_frame(&warm_ctx.text_draw_state);
+  cl_assert_equal_i(warm_ctx.text_draw_state.frame_id, 0);
+
+  // The text may change between frames, the next frame hashes it again
+  memset(text, 'x', 100);
+  text_draw_state_begin_frame(&warm_ctx.text_draw_state);
+  cl_assert(warm_ctx.text_draw_state.frame_id != first_frame_id);
+  GContext cold_ctx;
+  graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+  const DrawResult cold = prv_draw_scrolled(&cold_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                            GTextAlignmentLeft, &layout);
+  const DrawResult warm = prv_draw_scrolled(&warm_ctx, text, 2000, GTextOverflowModeWordWrap,
+                                            GTextAlignmentLeft, &layout);
+  prv_assert_draw_result_equal(&warm, &cold);
+  text_draw_state_end_frame(&warm_ctx.text_draw_state);
+
+  text_draw_state_free_checkpoints(&warm_ctx.text_draw_state);
+  text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+  free(fb);
+  free(text);
+}
+
+void test_text_layout__scroll_long_text_benchmark(void) {
+  char *text = prv_create_long_text(200);
+  FrameBuffer *fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) { DISP_COLS, DISP_ROWS });
+  TextLayoutExtended layout = {};
+  GContext ctx;
+  graphics_context_init(&ctx, fb, GContextInitializationMode_App);
+  const int16_t content_height =
+      graphics_text_layout_get_max_used_size(&ctx, text, (GFont) { 0 },
+                                             GRect(0, 0, LONG_TEXT_BOX_WIDTH, LONG_TEXT_BOX_HEIGHT),
+                                             GTextOverflowModeWordWrap, GTextAlignmentLeft,
+                                             (GTextLayoutCacheRef)&layout).h;
+  const int16_t scroll_step = 6;
+
+  // Every frame of scrolling through the text from top to bottom, like a ScrollLayer animation
+  int cold_lookups = 0;
+  int warm_lookups = 0;
+  for (int16_t scroll_offset = 0; scroll_offset < content_height - DISP_ROWS;
+       scroll_offset += scroll_step) {
+    GContext cold_ctx;
+    graphics_context_init(&cold_ctx, fb, GContextInitializationMode_App);
+    s_num_horiz_advance_lookups = 0;
+    prv_draw_scrolled(&cold_ctx, text, scroll_offset, GTextOverflowModeWordWrap,
+                      GTextAlignmentLeft, &layout);
+    cold_lookups += s_num_horiz_advance_lookups;
+    text_draw_state_free_checkpoints(&cold_ctx.text_draw_state);
+
+    s_num_horiz_advance_lookups = 0;
+    prv_draw_scrolled(&ctx, text, scroll_offset, GTextOverflowModeWordWrap,
+                      GTextAlignmentLeft, &layout);
+    warm_lookups += s_num_horiz_advance_lookups;
+  }
+  cl_assert(warm_lookups * 4 < cold_lookups);
+
+  text_draw_state_free_checkpoints(&ctx.text_draw_state);
+  free(fb);
+  free(text);
+}
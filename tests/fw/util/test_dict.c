@@ -23,18 +23,43 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <strings.h>
 
 // Stubs
 ///////////////////////////////////////////////////////////
 #include "stubs_logging.h"
 #include "stubs_passert.h"
-#include "stubs_pbl_malloc.h"
+
+//! Bytes task_malloc() can still hand out, to run dict_merge() low on memory
+static size_t s_heap_bytes_left;
+
+void *task_malloc(size_t bytes) {
+  if (bytes > s_heap_bytes_left) {
+    return NULL;
+  }
+  s_heap_bytes_left -= bytes;
+  size_t *block = malloc(sizeof(size_t) + bytes);
+  *block = bytes;
+  return block + 1;
+}
+
+void task_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  size_t *block = (size_t *)ptr - 1;
+  s_heap_bytes_left += *block;
+  free(block);
+}
 
 // Tests
 ///////////////////////////////////////////////////////////
 
 void test_dict__initialize(void) {
+  s_heap_bytes_left = SIZE_MAX;
 }
 
 void test_dict__cleanup(void) {
@@ -391,3 +416,194 @@ void test_dict__merge(void) {
     cl_assert(has_tuple[DATA_IDX] == true);
   }
 }
+
+void test_dict__index_find(void) {
+  // Out of order, with a duplicate key of which dict_find() returns the first one
+  Tuplet tuplets[] = {
+    TupletInteger(5, (uint8_t) 50),
+    TupletInteger(1, (uint8_t) 10),
+    TupletInteger(9, (uint8_t) 90),
+    TupletInteger(5, (uint8_t) 51),
+    TupletInteger(0, (uint8_t) 0),
+    TupletCString(3, "three"),
+  };
+  uint8_t buffer[dict_calc_buffer_size_from_tuplets(tuplets, ARRAY_LENGTH(tuplets))];
+  uint32_t size = sizeof(buffer);
+  DictionaryIterator iter;
+  cl_assert_equal_i(dict_serialize_tuplets_to_buffer_with_iter(&iter, tuplets,
+                                                               ARRAY_LENGTH(tuplets), buffer,
+                                                               &size), DICT_OK);
+
+  const size_t index_size = dict_index_size(&iter);
+  cl_assert_equal_i(index_size,
+                    sizeof(DictionaryIndex) + ARRAY_LENGTH(tuplets) * sizeof(DictionaryIndexEntry));
+  uint32_t index_buffer[index_size / sizeof(uint32_t) + 1];
+  cl_assert_equal_p(dict_index_build(&iter, index_buffer, index_size - 1), NULL);
+  DictionaryIndex *index = dict_index_build(&iter, index_buffer, index_size);
+  cl_assert(index);
+
+  for (uint32_t key = 0; key < 12; key++) {
+    cl_assert_equal_p(dict_index_find(index, key), dict_find(&iter, key));
+  }
+  cl_assert_equal_i(dict_index_find(index, 5)->value->uint8, 50);
+  cl_assert_equal_s(dict_index_find(index, 3)->value->cstring, "three");
+
+  // An empty dictionary
+  size = sizeof(buffer);
+  cl_assert_equal_i(dict_serialize_tuplets_to_buffer_with_iter(&iter, tuplets, 0, buffer, &size),
+                    DICT_OK);
+  index = dict_index_build(&iter, index_buffer, sizeof(index_buffer));
+  cl_assert(index);
+  cl_assert_equal_p(dict_index_find(index, 5), NULL);
+}
+
+// Like a watchface that syncs its configuration and the weather with AppSync
+#define SYNC_NUM_KEYS (60)
+#define SYNC_NUM_UPDATED_KEYS (20)
+#define SYNC_BUFFER_SIZE (1024)
+
+static int s_num_updated_keys;
+
+static void prv_count_updated_keys(const uint32_t key, const Tuple *new_tuple,
+                                   const Tuple *old_tuple, void *context) {
+  s_num_updated_keys++;
+}
+
+static void prv_serialize_sync_dict(uint8_t *buffer, uint32_t *size, DictionaryIterator *iter,
+                                    const uint32_t *keys, int num_keys, int value_offset) {
+  cl_assert_equal_i(dict_write_begin(iter, buffer, *size), DICT_OK);
+  for (int i = 0; i < num_keys; i++) {
+    if (keys[i] % 3 == 0) {
+      char string[16];
+      snprintf(string, sizeof(string), "value %d", (int)keys[i] + value_offset);
+      cl_assert_equal_i(dict_write_cstring(iter, keys[i], string), DICT_OK);
+    } else {
+      cl_assert_equal_i(dict_write_int32(iter, keys[i], keys[i] + value_offset), DICT_OK);
+    }
+  }
+  *size = dict_write_end(iter);
+}
+
+static void prv_sync_keys(uint32_t *all_keys, uint32_t *updated_keys) {
+  for (int i = 0; i < SYNC_NUM_KEYS; i++) {
+    all_keys[i] = 1000 + ((i * 37) % SYNC_NUM_KEYS);
+  }
+  for (int i = 0; i < SYNC_NUM_UPDATED_KEYS; i++) {
+    updated_keys[i] = all_keys[(i * 7) % SYNC_NUM_KEYS];
+  }
+}
+
+void test_dict__merge_output_order(void) {
+  uint32_t all_keys[SYNC_NUM_KEYS];
+  uint32_t updated_keys[SYNC_NUM_UPDATED_KEYS + 1];
+  prv_sync_keys(all_keys, updated_keys);
+  // A key that isn't in the destination yet
+  updated_keys[SYNC_NUM_UPDATED_KEYS] = 3000;
+
+  for (int update_existing_keys_only = 0; update_existing_keys_only < 2;
+       update_existing_keys_only++) {
+    uint8_t dest_buffer[SYNC_BUFFER_SIZE];
+    uint32_t dest_size = sizeof(dest_buffer);
+    DictionaryIterator dest_iter;
+    prv_serialize_sync_dict(dest_buffer, &dest_size, &dest_iter, all_keys, SYNC_NUM_KEYS, 0);
+
+    uint8_t new_buffer[SYNC_BUFFER_SIZE];
+    uint32_t new_size = sizeof(new_buffer);
+    DictionaryIterator new_iter;
+    prv_serialize_sync_dict(new_buffer, &new_size, &new_iter, updated_keys,
+                            ARRAY_LENGTH(updated_keys), 1);
+
+    s_num_updated_keys = 0;
+    uint32_t merged_size = sizeof(dest_buffer);
+    cl_assert_equal_i(dict_merge(&dest_iter, &merged_size, &new_iter, update_existing_keys_only,
+                                 prv_count_updated_keys, NULL), DICT_OK);
+
+    // The updated tuples come first in the order of the new dictionary, followed by the tuples
+    // that didn't change in their original order
+    uint32_t expected_keys[SYNC_NUM_KEYS + 1];
+    int num_expected_keys = 0;
+    const int num_new_keys = ARRAY_LENGTH(updated_keys) - (update_existing_keys_only ? 1 : 0);
+    for (int i = 0; i < num_new_keys; i++) {
+      expected_keys[num_expected_keys++] = updated_keys[i];
+    }
+    uint8_t expected_new_buffer[SYNC_BUFFER_SIZE];
+    uint32_t expected_new_size = sizeof(expected_new_buffer);
+    DictionaryIterator expected_iter;
+    prv_serialize_sync_dict(expected_new_buffer, &expected_new_size, &expected_iter,
+                            expected_keys, num_expected_keys, 1);
+
+    uint8_t expected_old_buffer[SYNC_BUFFER_SIZE];
+    uint32_t expected_old_size = sizeof(expected_old_buffer);
+    uint32_t old_keys[SYNC_NUM_KEYS];
+    int num_old_keys = 0;
+    for (int i = 0; i < SYNC_NUM_KEYS; i++) {
+      bool is_updated = false;
+      for (int j = 0; j < num_new_keys; j++) {
+        is_updated |= (all_keys[i] == updated_keys[j]);
+      }
+      if (!is_updated) {
+        old_keys[num_old_keys++] = all_keys[i];
+      }
+    }
+    prv_serialize_sync_dict(expected_old_buffer, &expected_old_size, &expected_iter,
+                            old_keys, num_old_keys, 0);
+
+    cl_assert_equal_i(s_num_updated_keys, num_expected_keys + num_old_keys);
+    cl_assert_equal_i(merged_size, expected_new_size + expected_old_size - sizeof(Dictionary));
+    // The count isn't updated by a merge, so only compare the tuples
+    cl_assert_equal_m(((Dictionary *)dest_buffer)->head,
+                      ((Dictionary *)expected_new_buffer)->head,
+                      expected_new_size - sizeof(Dictionary));
+    cl_assert_equal_m((uint8_t *)((Dictionary *)dest_buffer)->head +
+                          expected_new_size - sizeof(Dictionary),
+                      ((Dictionary *)expected_old_buffer)->head,
+                      expected_old_size - sizeof(Dictionary));
+  }
+}
+
+void test_dict__merge_low_on_memory(void) {
+  uint32_t all_keys[SYNC_NUM_KEYS];
+  uint32_t updated_keys[SYNC_NUM_UPDATED_KEYS];
+  prv_sync_keys(all_keys, updated_keys);
+
+  uint8_t new_buffer[SYNC_BUFFER_SIZE];
+  uint32_t new_size = sizeof(new_buffer);
+  DictionaryIterator new_iter;
+  prv_serialize_sync_dict(new_buffer, &new_size, &new_iter, updated_keys, SYNC_NUM_UPDATED_KEYS,
+                          1);
+
+  uint8_t expected_buffer[SYNC_BUFFER_SIZE];
+  uint32_t expected_size = sizeof(expected_buffer);
+  DictionaryIterator expected_iter;
+  prv_serialize_sync_dict(expected_buffer, &expected_size, &expected_iter, all_keys,
+                          SYNC_NUM_KEYS, 0);
+  uint32_t merged_size = sizeof(expected_buffer);
+  cl_assert_equal_i(dict_merge(&expected_iter, &merged_size, &new_iter, true,
+                               prv_count_updated_keys, NULL), DICT_OK);
+
+  uint8_t dest_buffer[SYNC_BUFFER_SIZE];
+  uint32_t dest_size = sizeof(dest_buffer);
+  DictionaryIterator dest_iter;
+  prv_serialize_sync_dict(dest_buffer, &dest_size, &dest_iter, all_keys, SYNC_NUM_KEYS, 0);
+
+  // Enough memory for either the indexes or the copy of the destination, but not for both
+  const size_t index_size = dict_index_size(&dest_iter) + dict_index_size(&new_iter);
+  const size_t heap_size = MAX(index_size, dest_size);
+  cl_assert(heap_size < index_size + dest_size);
+
+  // Without the copy there's no merge
+  s_heap_bytes_left = dest_size - 1;
+  uint32_t size = sizeof(dest_buffer);
+  cl_assert_equal_i(dict_merge(&dest_iter, &size, &new_iter, true, prv_count_updated_keys, NULL),
+                    DICT_MALLOC_FAILED);
+  cl_assert_equal_i(s_heap_bytes_left, dest_size - 1);
+
+  // The merge does without the indexes instead
+  s_heap_bytes_left = heap_size;
+  size = sizeof(dest_buffer);
+  cl_assert_equal_i(dict_merge(&dest_iter, &size, &new_iter, true, prv_count_updated_keys, NULL),
+                    DICT_OK);
+  cl_assert_equal_i(s_heap_bytes_left, heap_size);
+  cl_assert_equal_i(size, merged_size);
+  cl_assert_equal_m(dest_buffer, expected_buffer, size);
+}
@@ -15,6 +15,7 @@
  */
 
 #include "util/shared_circular_buffer.h"
+#include "util/math.h"
 
 #include "clar.h"
 
@@ -371,3 +372,174 @@ void test_shared_circular_buffer__subsampling_set_ratio_is_idempotent(void) {
       &buffer, &client, item_size, out_buffer, 1), 1);
   cl_assert_equal_m(out_buffer, "6g", 2);
 }
+
+
+void test_shared_circular_buffer__read_spans(void) {
+  SharedCircularBuffer buffer;
+  uint8_t storage[9];
+  shared_circular_buffer_init(&buffer, storage, sizeof(storage));
+
+  SharedCircularBufferClient client = (SharedCircularBufferClient) {};
+  shared_circular_buffer_add_client(&buffer, &client);
+
+  SharedCircularBufferSpan spans[2];
+  cl_assert_equal_i(shared_circular_buffer_read_spans(&buffer, &client, 4, spans), 0);
+  cl_assert_equal_i(spans[0].length + spans[1].length, 0);
+
+  // Contiguous data comes back as a single span
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "123456", 6, false));
+  cl_assert_equal_i(shared_circular_buffer_read_spans(&buffer, &client, 4, spans), 4);
+  cl_assert_equal_i(spans[0].length, 4);
+  cl_assert_equal_i(spans[1].length, 0);
+  cl_assert_equal_m(spans[0].data, "1234", 4);
+  cl_assert(spans[0].data == &storage[0]);
+  cl_assert(shared_circular_buffer_consume(&buffer, &client, 6));
+
+  // Wrapped data comes back as two spans pointing into the storage
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "abcde", 5, false));
+  cl_assert_equal_i(shared_circular_buffer_read_spans(&buffer, &client, 100, spans), 5);
+  cl_assert_equal_i(spans[0].length, 3);
+  cl_assert_equal_m(spans[0].data, "abc", 3);
+  cl_assert(spans[0].data == &storage[6]);
+  cl_assert_equal_i(spans[1].length, 2);
+  cl_assert_equal_m(spans[1].data, "de", 2);
+  cl_assert(spans[1].data == &storage[0]);
+
+  // Reading doesn't consume; a single consume covers both spans
+  cl_assert_equal_i(shared_circular_buffer_get_read_space_remaining(&buffer, &client), 5);
+  cl_assert(shared_circular_buffer_consume(&buffer, &client, 5));
+  cl_assert_equal_i(shared_circular_buffer_get_read_space_remaining(&buffer, &client), 0);
+}
+
+
+void test_shared_circular_buffer__slowest_client_tracking(void) {
+  SharedCircularBuffer buffer;
+  uint8_t storage[10];
+  shared_circular_buffer_init(&buffer, storage, sizeof(storage));
+
+  SharedCircularBufferClient client1 = (SharedCircularBufferClient) {};
+  SharedCircularBufferClient client2 = (SharedCircularBufferClient) {};
+  SharedCircularBufferClient client3 = (SharedCircularBufferClient) {};
+  shared_circular_buffer_add_client(&buffer, &client1);
+  shared_circular_buffer_add_client(&buffer, &client2);
+
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "123456", 6, false));
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 3);
+
+  // Adding a client doesn't change the space used by the others
+  shared_circular_buffer_add_client(&buffer, &client3);
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 3);
+
+  // Space is only freed once every client has caught up
+  cl_assert(shared_circular_buffer_consume(&buffer, &client1, 6));
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 3);
+  cl_assert(shared_circular_buffer_consume(&buffer, &client2, 2));
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 5);
+
+  // Removing the slowest client frees its space
+  shared_circular_buffer_remove_client(&buffer, &client2);
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 9);
+
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "abcd", 4, false));
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 5);
+
+  // Advancing slackers frees exactly the space of the client that falls behind
+  cl_assert(shared_circular_buffer_consume(&buffer, &client3, 4));
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "efghi", 5, false));
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 0);
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*) "jk", 2, true));
+  cl_assert_equal_i(shared_circular_buffer_get_read_space_remaining(&buffer, &client1), 2);
+  cl_assert_equal_i(shared_circular_buffer_get_read_space_remaining(&buffer, &client3), 7);
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 2);
+
+  uint8_t out[7];
+  uint16_t out_length;
+  cl_assert(shared_circular_buffer_read_consume(&buffer, &client3, 7, out, &out_length));
+  cl_assert_equal_i(out_length, 7);
+  cl_assert_equal_m(out, "efghijk", 7);
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer), 7);
+}
+
+
+void test_shared_circular_buffer__subsampling_wrapped_items(void) {
+  SharedCircularBuffer buffer;
+  uint16_t item_size = 3;
+  uint8_t storage[4*item_size + 1];
+  uint8_t out_buffer[4*item_size];
+
+  shared_circular_buffer_init(&buffer, storage, sizeof(storage));
+  SubsampledSharedCircularBufferClient client = {};
+  shared_circular_buffer_add_subsampled_client(&buffer, &client, 1, 2);
+
+  // Shift the write index so that items straddle the end of the storage
+  cl_assert(shared_circular_buffer_write(&buffer, (uint8_t*)"xxxx", 4, false));
+  cl_assert(shared_circular_buffer_consume(&buffer, &client.buffer_client, 4));
+
+  cl_assert(shared_circular_buffer_write(
+      &buffer, (uint8_t*)"0ab1cd2ef3gh", 4*item_size, false));
+  cl_assert_equal_i(shared_circular_buffer_read_subsampled(
+      &buffer, &client, item_size, out_buffer, 100), 2);
+  cl_assert_equal_m(out_buffer, "0ab2ef", 6);
+  cl_assert_equal_i(shared_circular_buffer_get_read_space_remaining(
+      &buffer, &client.buffer_client), 0);
+}
+
+
+// Pushes a long stream of data through the buffer with 1 to 4 readers each reading a different
+// amount at a time, making sure every reader sees every byte in order.
+static void prv_multi_reader_throughput(int num_readers) {
+  SharedCircularBuffer buffer;
+  uint8_t storage[257];
+  shared_circular_buffer_init(&buffer, storage, sizeof(storage));
+
+  SharedCircularBufferClient clients[4] = {};
+  uint32_t bytes_read[4] = {};
+  for (int i = 0; i < num_readers; i++) {
+    shared_circular_buffer_add_client(&buffer, &clients[i]);
+  }
+
+  const uint32_t total_bytes = 64 * 1024;
+  uint32_t bytes_written = 0;
+  uint8_t chunk[24];
+  while (bytes_written < total_bytes) {
+    const uint16_t write_length = MIN(sizeof(chunk), total_bytes - bytes_written);
+    for (int i = 0; i < write_length; i++) {
+      chunk[i] = (uint8_t)(bytes_written + i);
+    }
+    if (shared_circular_buffer_write(&buffer, chunk, write_length, false)) {
+      bytes_written += write_length;
+    }
+
+    for (int i = 0; i < num_readers; i++) {
+      SharedCircularBufferSpan spans[2];
+      const uint16_t length = shared_circular_buffer_read_spans(&buffer, &clients[i],
+                                                                (i + 1) * 7, spans);
+      for (int s = 0; s < 2; s++) {
+        for (int j = 0; j < spans[s].length; j++) {
+          cl_assert_equal_i(spans[s].data[j], (uint8_t)bytes_read[i]);
+          bytes_read[i]++;
+        }
+      }
+      cl_assert(shared_circular_buffer_consume(&buffer, &clients[i], length));
+    }
+  }
+
+  for (int i = 0; i < num_readers; i++) {
+    uint8_t out[sizeof(storage)];
+    uint16_t out_length;
+    shared_circular_buffer_read_consume(&buffer, &clients[i], sizeof(out), out, &out_length);
+    for (int j = 0; j < out_length; j++) {
+      cl_assert_equal_i(out[j], (uint8_t)bytes_read[i]);
+      bytes_read[i]++;
+    }
+    cl_assert_equal_i(bytes_read[i], total_bytes);
+  }
+  cl_assert_equal_i(shared_circular_buffer_get_write_space_remaining(&buffer),
+                    sizeof(storage) - 1);
+}
+
+void test_shared_circular_buffer__multi_reader_throughput(void) {
+  for (int num_readers = 1; num_readers <= 4; num_readers++) {
+    prv_multi_reader_throughput(num_readers);
+  }
+}
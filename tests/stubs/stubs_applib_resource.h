@@ -36,6 +36,11 @@ void applib_resource_munmap_or_free(void *bytes) {
   free(bytes);
 }
 
+void *applib_resource_mmap(ResAppNum app_num, uint32_t resource_id,
+                           size_t offset, size_t num_bytes) {
+  return NULL;
+}
+
 // this is just a stub, if you need proper resource handling
 // link against fake_applib_resource.c in your test
 void *applib_resource_mmap_or_load(ResAppNum app_num, uint32_t resource_id,
@@ -19,7 +19,7 @@
 #include "services/normal/blob_db/api.h"
 #include "services/normal/settings/settings_file.h"
 
-bool sync_util_is_dirty_cb(SettingsFile *file, SettingsRecordInfo *info, void *context) {
+bool sync_util_is_dirty(SettingsFile *file) {
   return false;
 }
 
@@ -30,6 +30,10 @@ GBitmap *gbitmap_create_with_resource_system(ResAppNum app_num, uint32_t resourc
   return NULL;
 }
 
+GBitmap *gbitmap_create_with_resource_system_cached(ResAppNum app_num, uint32_t resource_id) {
+  return NULL;
+}
+
 GBitmap *gbitmap_create_with_data(const uint8_t *data){ return NULL; }
 
 GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) { return NULL; }
@@ -49,6 +49,16 @@ uint32_t WEAK sys_resource_get_and_cache(ResAppNum app_num, uint32_t resource_id
   return resource_id;
 }
 
+uint8_t * WEAK sys_bitmap_cache_load(ResAppNum app_num, uint32_t resource_id,
+                                     size_t *size_out) {
+  return NULL;
+}
+
+void WEAK sys_bitmap_cache_store(ResAppNum app_num, uint32_t resource_id,
+                                 const uint8_t *pbi_data, size_t pbi_data_size) {
+  return;
+}
+
 bool WEAK sys_resource_is_valid(ResAppNum app_num, uint32_t resource_id) {
   return resource_is_valid(app_num, resource_id);
 }
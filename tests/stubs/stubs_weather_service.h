@@ -19,9 +19,10 @@
 #include "services/normal/weather/weather_service.h"
 #include "util/attributes.h"
 
-WeatherLocationForecast * WEAK weather_service_create_default_forecast(void) {
-  return NULL;
-}
+void WEAK weather_service_lock(void) {}
 
+void WEAK weather_service_unlock(void) {}
 
-void WEAK weather_service_destroy_default_forecast(WeatherLocationForecast *forecast) {}
+const WeatherLocationForecast * WEAK weather_service_get_default_forecast(void) {
+  return NULL;
+}
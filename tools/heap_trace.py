@@ -0,0 +1,136 @@
+# Copyright 2024 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Replays a kernel heap trace against src/libutil/heap.c and reports fragmentation, the largest
+free block over time and the allocation sites that fragment the heap the most.
+
+To record a trace, configure the firmware with --malloc_trace and run "dump malloc trace" on the
+prompt often enough that the buffer on the watch doesn't fill up (the report warns if it did).
+Every dump prints a chunk of "HT:<hex>" lines, pass the whole serial log to this script:
+
+  ./waf build_tools
+  python tools/heap_trace.py --elf_file build/src/fw/tintin_fw.elf serial.log
+
+To try an allocator change against a recorded trace, change heap.c, rebuild the tools and run
+the script again on the same log. Use --heap_size to see how the trace behaves on a smaller heap.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# Must match KERNEL_HEAP_TRACE_LINE_PREFIX in src/fw/kernel/kernel_heap_trace.h
+TRACE_LINE_PREFIX = 'HT:'
+
+ROOT_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+DEFAULT_REPLAY_TOOL = os.path.join(ROOT_PATH, 'build', 'tools', 'heap_trace_replay')
+
+
+def extract_trace(log_lines):
+    """ Returns the binary trace of all the HT: lines in a serial log, in order """
+    trace = bytearray()
+    line_re = re.compile(re.escape(TRACE_LINE_PREFIX) + r'([0-9a-fA-F]+)')
+    for line in log_lines:
+        match = line_re.search(line)
+        if match:
+            trace.extend(bytearray.fromhex(match.group(1)))
+    return bytes(trace)
+
+
+def symbolize(report, elf_path):
+    """ Appends function, file and line to every PC in the worst offenders table """
+    pcs = sorted(set(re.findall(r'^(0x[0-9a-f]{8}) ', report, re.MULTILINE)))
+    if not pcs:
+        return report
+
+    try:
+        output = subprocess.check_output(['arm-none-eabi-addr2line', '-f', '-s', '-e', elf_path] +
+                                         pcs).decode('utf-8')
+    except (OSError, subprocess.CalledProcessError) as e:
+        print('Could not symbolize the PCs: %s' % e, file=sys.stderr)
+        return report
+
+    lines = output.splitlines()
+    symbols = {}
+    for i, pc in enumerate(pcs):
+        function, location = lines[2 * i], lines[2 * i + 1]
+        symbols[pc] = '%s (%s)' % (function, location)
+
+    def add_symbol(match):
+        return '%s  %s' % (match.group(0), symbols[match.group(1)])
+
+    return re.sub(r'^(0x[0-9a-f]{8}) .*$', add_symbol, report, flags=re.MULTILINE)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--elf_file', help='firmware ELF, used to symbolize allocation sites')
+    parser.add_argument('--replay_tool', default=DEFAULT_REPLAY_TOOL,
+                        help='path to heap_trace_replay (default: %(default)s)')
+    parser.add_argument('--heap_size', type=int,
+                        help='replay against a heap of this many bytes instead of the recorded '
+                             'size')
+    parser.add_argument('--offenders', type=int, default=20,
+                        help='number of allocation sites to list')
+    parser.add_argument('--timeline', help='write the heap usage after every operation to this '
+                                           'CSV file')
+    parser.add_argument('--save_trace', help='also write the binary trace to this file')
+    parser.add_argument('log_file', help='serial log with the output of "dump malloc trace"')
+    args = parser.parse_args()
+
+    with open(args.log_file, 'r') as f:
+        trace = extract_trace(f.readlines())
+    if not trace:
+        print('No %s lines found in %s' % (TRACE_LINE_PREFIX, args.log_file), file=sys.stderr)
+        return 1
+
+    if args.save_trace:
+        trace_path = args.save_trace
+    else:
+        trace_fd, trace_path = tempfile.mkstemp(suffix='.heaptrace')
+        os.close(trace_fd)
+
+    try:
+        with open(trace_path, 'wb') as f:
+            f.write(trace)
+
+        cmd = [args.replay_tool, '-n', str(args.offenders)]
+        if args.heap_size:
+            cmd += ['-s', str(args.heap_size)]
+        if args.timeline:
+            cmd += ['-t', args.timeline]
+        cmd.append(trace_path)
+        report = subprocess.check_output(cmd).decode('utf-8')
+    except subprocess.CalledProcessError as e:
+        # heap_trace_replay already printed what's wrong with the trace
+        return e.returncode
+    finally:
+        if not args.save_trace:
+            os.remove(trace_path)
+
+    if args.elf_file:
+        report = symbolize(report, args.elf_file)
+    print(report, end='')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
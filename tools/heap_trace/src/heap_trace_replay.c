@@ -0,0 +1,534 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! Replays a kernel heap trace recorded by a --malloc_trace build against src/libutil/heap.c and
+//! reports how fragmented the heap got and which allocation sites are to blame.
+//! Usually run through tools/heap_trace.py, which extracts the trace from a serial log and
+//! symbolizes the PCs in the report.
+
+#include "kernel/kernel_heap_trace.h"
+#include "util/heap.h"
+#include "util/math.h"
+#include "util/size.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RTC_TICKS_HZ (1024)
+
+#define MAX_SITES (4096)
+#define NUM_TIMELINE_ROWS (16)
+#define DEFAULT_NUM_OFFENDERS (20)
+
+//! Indexed by offsets in units of KERNEL_HEAP_TRACE_UNIT_SIZE, the heap can't be bigger than this
+#define MAX_OFFSETS (0x10000)
+
+//! Everything we know about one caller of malloc
+typedef struct {
+  uint32_t pc;
+  uint32_t num_mallocs;
+  uint32_t num_frees;
+  uint32_t num_watch_failures;
+  uint32_t num_replay_failures;
+  uint64_t total_bytes;
+  uint32_t live_bytes;
+  uint32_t peak_live_bytes;
+  uint64_t total_lifetime_ticks;
+  uint32_t max_lifetime_ticks;
+  //! Sum over all operations of the free bytes this site's blocks were keeping apart
+  uint64_t pinned_bytes_sum;
+  //! Free bytes this site's blocks were keeping apart at the most fragmented point
+  uint32_t pinned_bytes_at_worst;
+  //! Scratch space for the heap walk after every operation
+  uint32_t pinned_bytes_now;
+} Site;
+
+//! A buffer that was allocated on the watch and is still live
+typedef struct {
+  void *ptr;
+  Site *site;
+  uint32_t ticks;
+  uint32_t size;
+} LiveAllocation;
+
+typedef struct {
+  uint32_t op_index;
+  uint32_t ticks;
+  uint32_t used;
+  uint32_t free;
+  uint32_t largest_free;
+  uint32_t num_free_blocks;
+} HeapSample;
+
+typedef struct {
+  Heap heap;
+  void *heap_buffer;
+
+  Site sites[MAX_SITES];
+  uint32_t num_sites;
+  //! Sites that got pinned_bytes_now set during the current heap walk
+  Site *pinned_sites[MAX_SITES];
+  uint32_t num_pinned_sites;
+
+  //! Live allocations by the offset they had on the watch
+  LiveAllocation live[MAX_OFFSETS];
+  //! Site of each allocated block in the replayed heap, by offset in the replayed heap
+  Site *replay_sites[MAX_OFFSETS];
+
+  uint32_t num_ops;
+  uint32_t num_mallocs;
+  uint32_t num_frees;
+  uint32_t num_chunks;
+  uint32_t num_dropped_records;
+  uint32_t num_watch_failures;
+  uint32_t num_replay_failures;
+  uint32_t num_moved;
+  uint32_t num_unknown_frees;
+  uint32_t num_reused_offsets;
+
+  uint32_t peak_used;
+  HeapSample worst;
+  HeapSample timeline[NUM_TIMELINE_ROWS];
+  uint32_t ops_per_timeline_row;
+  FILE *timeline_csv;
+} ReplayState;
+
+static ReplayState s_state;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Sites
+
+static Site *prv_get_site(uint32_t pc) {
+  for (uint32_t i = 0; i < s_state.num_sites; i++) {
+    if (s_state.sites[i].pc == pc) {
+      return &s_state.sites[i];
+    }
+  }
+  if (s_state.num_sites == MAX_SITES) {
+    fprintf(stderr, "Too many allocation sites, counting pc 0x%08"PRIx32" as the last one\n", pc);
+    return &s_state.sites[MAX_SITES - 1];
+  }
+  Site *site = &s_state.sites[s_state.num_sites++];
+  *site = (Site) { .pc = pc };
+  return site;
+}
+
+static uint32_t prv_replay_offset(void *ptr) {
+  return ((uintptr_t)ptr - (uintptr_t)s_state.heap.begin) / KERNEL_HEAP_TRACE_UNIT_SIZE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap walk
+
+typedef struct {
+  HeapSample sample;
+  //! Size of the last free block before the current run of allocated blocks, 0 if none
+  uint32_t free_before_run;
+  //! Allocated blocks since the last free block
+  Site *run[64];
+  uint32_t run_length;
+  bool run_overflowed;
+} HeapWalk;
+
+static void prv_pin_run(HeapWalk *walk, uint32_t free_after_run) {
+  if (walk->free_before_run == 0 || walk->run_length == 0 || walk->run_overflowed) {
+    return;
+  }
+  // Each block in the run keeps the free blocks on either side apart. Blame the blocks for the
+  // smaller of the two, which is what would become contiguous with the other one.
+  const uint32_t pinned = MIN(walk->free_before_run, free_after_run) / walk->run_length;
+  if (pinned == 0) {
+    return;
+  }
+  for (uint32_t i = 0; i < walk->run_length; i++) {
+    Site *site = walk->run[i];
+    if (!site) {
+      continue;
+    }
+    if (site->pinned_bytes_now == 0) {
+      s_state.pinned_sites[s_state.num_pinned_sites++] = site;
+    }
+    site->pinned_bytes_now += pinned;
+  }
+}
+
+static bool prv_walk_block(void *data, size_t block_size, bool is_allocated, void *context) {
+  HeapWalk *walk = context;
+  if (is_allocated) {
+    walk->sample.used += block_size;
+    if (walk->run_length < ARRAY_LENGTH(walk->run)) {
+      walk->run[walk->run_length++] = s_state.replay_sites[prv_replay_offset(data)];
+    } else {
+      walk->run_overflowed = true;
+    }
+    return true;
+  }
+
+  walk->sample.free += block_size;
+  walk->sample.largest_free = MAX(walk->sample.largest_free, block_size);
+  walk->sample.num_free_blocks++;
+
+  prv_pin_run(walk, block_size);
+  walk->free_before_run = block_size;
+  walk->run_length = 0;
+  walk->run_overflowed = false;
+  return true;
+}
+
+static uint32_t prv_fragmentation_percent(const HeapSample *sample) {
+  if (sample->free == 0) {
+    return 0;
+  }
+  return 100 - (100 * sample->largest_free / sample->free);
+}
+
+static void prv_sample_heap(uint32_t ticks) {
+  HeapWalk walk = {
+    .sample = {
+      .op_index = s_state.num_ops,
+      .ticks = ticks,
+    },
+  };
+  heap_for_each_block(&s_state.heap, prv_walk_block, &walk);
+  const HeapSample *sample = &walk.sample;
+
+  const bool is_worst = (s_state.num_ops == 1 ||
+                         sample->largest_free < s_state.worst.largest_free);
+  if (is_worst) {
+    s_state.worst = *sample;
+    // Only the sites pinning something now have a share of the new worst case
+    for (uint32_t i = 0; i < s_state.num_sites; i++) {
+      s_state.sites[i].pinned_bytes_at_worst = 0;
+    }
+  }
+  for (uint32_t i = 0; i < s_state.num_pinned_sites; i++) {
+    Site *site = s_state.pinned_sites[i];
+    if (is_worst) {
+      site->pinned_bytes_at_worst = site->pinned_bytes_now;
+    }
+    site->pinned_bytes_sum += site->pinned_bytes_now;
+    site->pinned_bytes_now = 0;
+  }
+  s_state.num_pinned_sites = 0;
+
+  s_state.peak_used = MAX(s_state.peak_used, sample->used);
+
+  // Keep the most fragmented point of each stretch of the trace for the timeline
+  const uint32_t row = MIN((s_state.num_ops - 1) / s_state.ops_per_timeline_row,
+                           NUM_TIMELINE_ROWS - 1);
+  HeapSample *timeline_sample = &s_state.timeline[row];
+  if (timeline_sample->op_index == 0 ||
+      sample->largest_free < timeline_sample->largest_free) {
+    *timeline_sample = *sample;
+  }
+
+  if (s_state.timeline_csv) {
+    fprintf(s_state.timeline_csv, "%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32"\n",
+            sample->op_index, sample->ticks, sample->used, sample->free, sample->largest_free,
+            sample->num_free_blocks);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Replay
+
+static void prv_replay_free(LiveAllocation *allocation, uint32_t ticks) {
+  Site *site = allocation->site;
+  const uint32_t lifetime = ticks - allocation->ticks;
+  site->num_frees++;
+  site->live_bytes -= allocation->size;
+  site->total_lifetime_ticks += lifetime;
+  site->max_lifetime_ticks = MAX(site->max_lifetime_ticks, lifetime);
+
+  s_state.replay_sites[prv_replay_offset(allocation->ptr)] = NULL;
+  heap_free(&s_state.heap, allocation->ptr, site->pc);
+  *allocation = (LiveAllocation) {};
+}
+
+static void prv_replay_malloc(const KernelHeapTraceRecord *record) {
+  Site *site = prv_get_site(record->pc);
+  const uint32_t size = record->size * KERNEL_HEAP_TRACE_UNIT_SIZE;
+  s_state.num_mallocs++;
+  site->num_mallocs++;
+  site->total_bytes += size;
+
+  if (record->offset == KERNEL_HEAP_TRACE_OFFSET_NULL) {
+    // Failed on the watch as well, there's nothing to free later
+    s_state.num_watch_failures++;
+    site->num_watch_failures++;
+    return;
+  }
+
+  LiveAllocation *allocation = &s_state.live[record->offset];
+  if (allocation->ptr) {
+    // The free of the previous buffer at this offset wasn't recorded, most likely dropped
+    s_state.num_reused_offsets++;
+    prv_replay_free(allocation, record->ticks);
+  }
+
+  void *ptr = heap_malloc(&s_state.heap, size, record->pc);
+  if (!ptr) {
+    s_state.num_replay_failures++;
+    site->num_replay_failures++;
+    return;
+  }
+  if (prv_replay_offset(ptr) != record->offset) {
+    // Expected when replaying against a modified allocator or a different heap size
+    s_state.num_moved++;
+  }
+
+  *allocation = (LiveAllocation) {
+    .ptr = ptr,
+    .site = site,
+    .ticks = record->ticks,
+    .size = size,
+  };
+  s_state.replay_sites[prv_replay_offset(ptr)] = site;
+  site->live_bytes += size;
+  site->peak_live_bytes = MAX(site->peak_live_bytes, site->live_bytes);
+}
+
+static void prv_replay_record(const KernelHeapTraceRecord *record) {
+  s_state.num_ops++;
+  if (record->is_free) {
+    s_state.num_frees++;
+    LiveAllocation *allocation = &s_state.live[record->offset];
+    if (allocation->ptr) {
+      prv_replay_free(allocation, record->ticks);
+    } else {
+      // Allocated before a dropped chunk or failed in the replay
+      s_state.num_unknown_frees++;
+    }
+  } else {
+    prv_replay_malloc(record);
+  }
+  prv_sample_heap(record->ticks);
+}
+
+//! Walks the chunks of the trace. If replay is false, only validates them and counts the records.
+static bool prv_walk_trace(const uint8_t *trace, size_t trace_size, bool replay,
+                           uint32_t *heap_size_out, uint32_t *num_records_out) {
+  size_t pos = 0;
+  uint32_t num_records = 0;
+  while (pos < trace_size) {
+    KernelHeapTraceHeader header;
+    if (trace_size - pos < sizeof(header)) {
+      fprintf(stderr, "Truncated header at offset %zu\n", pos);
+      return false;
+    }
+    memcpy(&header, trace + pos, sizeof(header));
+    pos += sizeof(header);
+
+    if (header.magic != KERNEL_HEAP_TRACE_MAGIC ||
+        header.version != KERNEL_HEAP_TRACE_VERSION ||
+        header.record_size < sizeof(KernelHeapTraceRecord)) {
+      fprintf(stderr, "Unsupported header at offset %zu\n", pos - sizeof(header));
+      return false;
+    }
+    if (*heap_size_out == 0) {
+      *heap_size_out = header.heap_size;
+    }
+    if (header.num_records > (trace_size - pos) / header.record_size) {
+      fprintf(stderr, "Truncated chunk at offset %zu\n", pos - sizeof(header));
+      return false;
+    }
+
+    if (replay) {
+      s_state.num_chunks++;
+      s_state.num_dropped_records += header.num_dropped_records;
+      for (uint16_t i = 0; i < header.num_records; i++) {
+        KernelHeapTraceRecord record;
+        memcpy(&record, trace + pos + i * header.record_size, sizeof(record));
+        prv_replay_record(&record);
+      }
+    }
+    pos += header.num_records * header.record_size;
+    num_records += header.num_records;
+  }
+  *num_records_out = num_records;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Report
+
+static int prv_compare_sites(const void *a, const void *b) {
+  const Site *site_a = a;
+  const Site *site_b = b;
+  if (site_a->pinned_bytes_sum != site_b->pinned_bytes_sum) {
+    return (site_a->pinned_bytes_sum < site_b->pinned_bytes_sum) ? 1 : -1;
+  }
+  return (site_a->peak_live_bytes < site_b->peak_live_bytes) ? 1 : -1;
+}
+
+static void prv_print_sample(const HeapSample *sample) {
+  printf("%8"PRIu32" %10.1f %8"PRIu32" %8"PRIu32" %8"PRIu32" %6"PRIu32" %4"PRIu32"%%\n",
+         sample->op_index, (double)sample->ticks / RTC_TICKS_HZ, sample->used, sample->free,
+         sample->largest_free, sample->num_free_blocks, prv_fragmentation_percent(sample));
+}
+
+static void prv_print_report(uint32_t heap_size, uint32_t num_offenders) {
+  printf("Heap size %"PRIu32" bytes, %"PRIu32" operations in %"PRIu32" chunks "
+         "(%"PRIu32" mallocs, %"PRIu32" frees)\n",
+         heap_size, s_state.num_ops, s_state.num_chunks, s_state.num_mallocs, s_state.num_frees);
+  if (s_state.num_dropped_records || s_state.num_unknown_frees || s_state.num_reused_offsets) {
+    printf("WARNING: the trace is incomplete: %"PRIu32" dropped records, %"PRIu32" unknown frees, "
+           "%"PRIu32" missing frees. Dump the trace more often.\n",
+           s_state.num_dropped_records, s_state.num_unknown_frees, s_state.num_reused_offsets);
+  }
+  printf("Failed mallocs: %"PRIu32" on the watch, %"PRIu32" in the replay\n",
+         s_state.num_watch_failures, s_state.num_replay_failures);
+  printf("Blocks placed differently than on the watch: %"PRIu32"\n", s_state.num_moved);
+  printf("Peak used: %"PRIu32" bytes\n", s_state.peak_used);
+  printf("\nMost fragmented point:\n");
+  printf("%8s %10s %8s %8s %8s %6s %5s\n",
+         "op", "seconds", "used", "free", "largest", "blocks", "frag");
+  prv_print_sample(&s_state.worst);
+
+  printf("\nLargest free block over time (most fragmented point of each stretch):\n");
+  printf("%8s %10s %8s %8s %8s %6s %5s\n",
+         "op", "seconds", "used", "free", "largest", "blocks", "frag");
+  for (uint32_t i = 0; i < NUM_TIMELINE_ROWS; i++) {
+    if (s_state.timeline[i].op_index) {
+      prv_print_sample(&s_state.timeline[i]);
+    }
+  }
+
+  qsort(s_state.sites, s_state.num_sites, sizeof(Site), prv_compare_sites);
+  printf("\nWorst offenders (free bytes kept apart, averaged over all operations):\n");
+  printf("%-10s %8s %8s %7s %8s %8s %8s %10s %10s\n", "pc", "avg_pin", "at_worst", "mallocs",
+         "avg_size", "max_live", "failed", "avg_life_s", "max_life_s");
+  for (uint32_t i = 0; i < MIN(num_offenders, s_state.num_sites); i++) {
+    const Site *site = &s_state.sites[i];
+    const double avg_lifetime_s = site->num_frees ?
+        ((double)site->total_lifetime_ticks / site->num_frees / RTC_TICKS_HZ) : 0;
+    printf("0x%08"PRIx32" %8"PRIu64" %8"PRIu32" %7"PRIu32" %8"PRIu64" %8"PRIu32" %8"PRIu32
+           " %10.1f %10.1f\n",
+           site->pc, site->pinned_bytes_sum / MAX(s_state.num_ops, 1),
+           site->pinned_bytes_at_worst, site->num_mallocs,
+           site->total_bytes / MAX(site->num_mallocs, 1), site->peak_live_bytes,
+           site->num_watch_failures + site->num_replay_failures, avg_lifetime_s,
+           (double)site->max_lifetime_ticks / RTC_TICKS_HZ);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+
+static uint8_t *prv_read_file(const char *path, size_t *size_out) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *buffer = malloc(MAX(size, 1));
+  if (buffer && fread(buffer, 1, size, file) != (size_t)size) {
+    free(buffer);
+    buffer = NULL;
+  }
+  fclose(file);
+  *size_out = size;
+  return buffer;
+}
+
+static void prv_usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-s heap_size] [-n num_offenders] [-t timeline.csv] trace.bin\n"
+          "  -s  replay against a heap of this many bytes instead of the recorded size\n"
+          "  -n  number of allocation sites to list, default %d\n"
+          "  -t  write used / free / largest free block after every operation to a CSV file\n",
+          argv0, DEFAULT_NUM_OFFENDERS);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t replay_heap_size = 0;
+  uint32_t num_offenders = DEFAULT_NUM_OFFENDERS;
+  const char *timeline_path = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:t:h")) != -1) {
+    switch (opt) {
+      case 's':
+        replay_heap_size = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        num_offenders = strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        timeline_path = optarg;
+        break;
+      default:
+        prv_usage(argv[0]);
+        return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    prv_usage(argv[0]);
+    return 1;
+  }
+
+  size_t trace_size;
+  uint8_t *trace = prv_read_file(argv[optind], &trace_size);
+  if (!trace) {
+    fprintf(stderr, "Couldn't read %s\n", argv[optind]);
+    return 1;
+  }
+
+  uint32_t recorded_heap_size = 0;
+  uint32_t num_records;
+  if (!prv_walk_trace(trace, trace_size, false /* replay */, &recorded_heap_size, &num_records)) {
+    return 1;
+  }
+  if (replay_heap_size == 0) {
+    replay_heap_size = recorded_heap_size;
+  }
+  if (replay_heap_size == 0 || replay_heap_size / KERNEL_HEAP_TRACE_UNIT_SIZE >= MAX_OFFSETS) {
+    fprintf(stderr, "Invalid heap size %"PRIu32"\n", replay_heap_size);
+    return 1;
+  }
+
+  if (timeline_path) {
+    s_state.timeline_csv = fopen(timeline_path, "w");
+    if (!s_state.timeline_csv) {
+      fprintf(stderr, "Couldn't open %s\n", timeline_path);
+      return 1;
+    }
+    fprintf(s_state.timeline_csv, "op,ticks,used,free,largest_free,free_blocks\n");
+  }
+
+  s_state.heap_buffer = malloc(replay_heap_size);
+  heap_init(&s_state.heap, s_state.heap_buffer,
+            (uint8_t *)s_state.heap_buffer + replay_heap_size,
+            false /* fuzz_on_free */);
+  s_state.ops_per_timeline_row = MAX(DIVIDE_CEIL(num_records, NUM_TIMELINE_ROWS), 1);
+
+  prv_walk_trace(trace, trace_size, true /* replay */, &recorded_heap_size, &num_records);
+  prv_print_report(heap_size(&s_state.heap), num_offenders);
+
+  if (s_state.timeline_csv) {
+    fclose(s_state.timeline_csv);
+  }
+  free(s_state.heap_buffer);
+  free(trace);
+  return 0;
+}
@@ -17,9 +17,20 @@
 import argparse
 import stm32_crc
 import struct
+import sys
 import time
 
 
+# Rough cost model used by ResourcePack.dump_stats() to estimate how long the firmware spends
+# loading each resource of a pack once. These are ballpark figures for the external SPI flash and
+# the PNG decoder on a Cortex-M4 at 100MHz, only meant to compare pack layouts with each other.
+FLASH_READ_BYTES_PER_US = 4
+PNG_DECODE_SETUP_US = 400
+PNG_DECODE_US_PER_PIXEL = 0.25
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+
 class ResourcePackTableEntry(object):
     TABLE_ENTRY_FMT = '<IIII'
 
@@ -91,18 +102,24 @@ class ResourcePack(object):
 
     def serialize_content(self):
         """
-        Serialize the content in the order dictated by offsets in the table entries
+        Serialize the content in the order dictated by offsets in the table entries, zero padding
+        any gaps left between them for alignment
         """
 
         serialized_content_indexes = set()
         serialized_content = []
+        current_offset = 0
         for entry in sorted(self.table_entries, key=lambda e: e.offset):
             if entry.content_index in serialized_content_indexes:
                 continue
 
             serialized_content_indexes.add(entry.content_index)
 
+            if entry.offset > current_offset:
+                serialized_content.append(b'\0' * (entry.offset - current_offset))
+
             serialized_content.append(self.contents[entry.content_index])
+            current_offset = max(current_offset, entry.offset + entry.length)
 
         return b"".join(serialized_content)
 
@@ -169,6 +186,7 @@ class ResourcePack(object):
                                 % (entry, calculated_crc, "" if is_system else "out"))
 
             resource_pack.contents.append(content)
+            resource_pack.content_localities.append(None)
 
         resource_pack.finalized = True
 
@@ -184,30 +202,56 @@ class ResourcePack(object):
             raise Exception("Exceeded max number of resources. Must have %d or "
                             "fewer" % self.table_size)
 
-        # Assign offsets to each of the entries in reverse order. The reason we do this in reverse
-        # is so that the resource at the end is guaranteed to be at the end of the pack.
+        # Assign offsets to each of the contents following get_content_layout(). The content of
+        # the final table entry is always laid out at the very end of the pack.
         #
         # This is required because the firmware looks at the offset + length of the final resource
         # in the table in order to determine the total size of the pack. If the final resource
         # is a duplicate of an earlier resource and if we assigned offsets starting at the
         # beginning of the table, that final resource would end up pointing to an assigned
         # offset somewhere in the middle of the pack, causing the pack to appear to be truncated.
-        current_offset = sum((len(c) for c in self.contents))
-        for table_entry in reversed(self.table_entries):
-            if table_entry.offset == -1:
-                # This entry doesn't have an offset in the output file yet, assign one to all
-                # entries that share the same content index
-
-                current_offset -= table_entry.length
+        content_offsets = {}
+        current_offset = 0
+        for content_index in self.get_content_layout():
+            current_offset = self._align(current_offset)
+            content_offsets[content_index] = current_offset
+            current_offset += len(self.contents[content_index])
 
-                for e in self.table_entries:
-                    if e.content_index == table_entry.content_index:
-                        e.offset = current_offset
+        for e in self.table_entries:
+            e.offset = content_offsets[e.content_index]
 
         self.crc = self.get_content_crc()
 
         self.finalized = True
 
+    def get_content_layout(self):
+        """
+        Return the content indexes in the order they should be laid out in the pack body.
+
+        Contents with an access locality hint come first, grouped by hint, so resources that are
+        used together end up next to each other in flash. Everything else keeps the order of the
+        table entries that last reference it. The content of the final table entry always comes
+        last, see finalize().
+        """
+
+        last_use = {}
+        for i, e in enumerate(self.table_entries):
+            last_use[e.content_index] = i
+
+        final_content_index = self.table_entries[-1].content_index if self.table_entries else None
+
+        def layout_key(content_index):
+            locality = self.content_localities[content_index]
+            return (content_index == final_content_index,
+                    locality is None,
+                    locality,
+                    last_use[content_index])
+
+        return sorted(last_use.keys(), key=layout_key)
+
+    def _align(self, offset):
+        return (offset + self.alignment - 1) // self.alignment * self.alignment
+
     def serialize(self, f_out):
         if not self.finalized:
             self.finalize()
@@ -218,7 +262,12 @@ class ResourcePack(object):
 
         return self.crc
 
-    def add_resource(self, content):
+    def add_resource(self, content, locality=None):
+        """
+        Add a resource to the pack. Resources with a lower locality hint are expected to be
+        accessed more often and are placed before resources with a higher or no hint.
+        """
+
         if self.finalized:
             raise Exception("Cannot add additional resource, " +
                             "resource pack has already been finalized")
@@ -228,9 +277,17 @@ class ResourcePack(object):
             # Try to find the index for this content if it already exists. If it doesn't we'll
             # throw the ValueError.
             content_index = self.contents.index(content)
+            # Shared content is as hot as its hottest user
+            previous_locality = self.content_localities[content_index]
+            if previous_locality is not None and locality is not None:
+                locality = min(previous_locality, locality)
+            elif locality is None:
+                locality = previous_locality
+            self.content_localities[content_index] = locality
         except ValueError:
             # This content is completely new, add it to the contents list.
             self.contents.append(content)
+            self.content_localities.append(locality)
             content_index = len(self.contents) - 1
 
         crc = stm32_crc.crc32(content)
@@ -249,7 +306,49 @@ class ResourcePack(object):
         for i, entry in enumerate(self.table_entries, start=1):
             print('  %u: Offset %u Length %u CRC 0x%x' % (i, entry.offset, entry.length, entry.crc))
 
-    def __init__(self, is_system):
+    def dump_stats(self, alignment=4, max_size=None):
+        """
+        Dump the size of this pbpack and an estimate of the time it takes to load each of its
+        resources once, see the cost model at the top of this file. If max_size is given, also
+        dump how much of a flash region of that size is left. Returns False if the pack doesn't fit.
+        """
+
+        unique_entries = {}
+        for entry in self.table_entries:
+            unique_entries.setdefault(entry.content_index, entry)
+
+        body_size = max([e.offset + e.length for e in self.table_entries] or [0])
+        content_size = sum(len(c) for c in self.contents)
+
+        num_png = 0
+        num_misaligned = 0
+        flash_us = 0.0
+        decode_us = 0.0
+        for content_index, entry in unique_entries.items():
+            content = self.contents[content_index]
+            if entry.offset % alignment:
+                num_misaligned += 1
+            flash_us += float(len(content)) / FLASH_READ_BYTES_PER_US
+            if content.startswith(PNG_SIGNATURE) and len(content) >= 24:
+                # The IHDR chunk always comes first, right after the signature
+                width, height = struct.unpack('>II', content[16:24])
+                num_png += 1
+                decode_us += PNG_DECODE_SETUP_US + width * height * PNG_DECODE_US_PER_PIXEL
+
+        print('Num Items: %u (%u unique)' % (len(self.table_entries), len(unique_entries)))
+        print('Pack Size: %u bytes (%u bytes of content, %u bytes of padding)'
+              % (self.content_start + body_size, content_size, body_size - content_size))
+        print('Not %u-byte aligned: %u' % (alignment, num_misaligned))
+        print('PNGs: %u' % num_png)
+        print('Simulated Load Time: %.2f ms (%.2f ms flash reads, %.2f ms PNG decoding)'
+              % ((flash_us + decode_us) / 1000, flash_us / 1000, decode_us / 1000))
+
+        pack_size = self.content_start + body_size
+        if max_size is not None:
+            print('Region: %u bytes (%d free)' % (max_size, max_size - pack_size))
+        return (max_size is None) or (pack_size <= max_size)
+
+    def __init__(self, is_system, alignment=1):
         self.table_size = 512 if is_system else 256
         self.content_start = self.MANIFEST_SIZE_BYTES + self.table_size * self.TABLE_ENTRY_SIZE_BYTES
 
@@ -266,6 +365,13 @@ class ResourcePack(object):
         # resource.
         self.contents = []
 
+        # Access locality hint for each entry in self.contents, see add_resource()
+        self.content_localities = []
+
+        # Every content starts at an offset into the body that is a multiple of this, so that
+        # memory-mapped resources can be accessed with aligned loads
+        self.alignment = alignment
+
         # List of resources that are in the pack. Note that this list may be longer than the
         # self.contents list if there are duplicates, duplicated entries (exact same data) will
         # not be repeated in self.contents. Each entry is a ResourcePackTableEntry
@@ -281,11 +387,20 @@ if __name__ == '__main__':
     parser.add_argument('pbpack_path', help='path to pbpack to dump')
     parser.add_argument('--app', default=False, action='store_true',
                         help='Indicate this pbpack is an app pbpack')
+    parser.add_argument('--stats', default=False, action='store_true',
+                        help='Dump the pack size and the simulated load time instead')
+    parser.add_argument('--max-size', type=lambda x: int(x, 0), default=None,
+                        help='With --stats, the size of the flash region the pack has to fit in. '
+                             'Exits with an error if it does not fit.')
 
     args = parser.parse_args()
 
     with open(args.pbpack_path, 'rb') as f:
         pack = ResourcePack.deserialize(f, is_system=not args.app)
 
-    pack.dump()
+    if args.stats:
+        if not pack.dump_stats(max_size=args.max_size):
+            sys.exit('Pack does not fit in a %u byte region' % args.max_size)
+    else:
+        pack.dump()
 
@@ -49,6 +49,7 @@ class ResourceGenerator(ResourceGeneratorBase):
         # Now generate ResourceDefintion objects for each resource
         target_platforms = definition_dict.get('targetPlatforms', None)
         aliases = definition_dict.get('aliases', [])
+        access_locality = definition_dict.get('accessLocality', None)
         builtin = False if bld.variant == 'applib' else definition_dict.get('builtin', False)
 
         definitions = []
@@ -64,7 +65,8 @@ class ResourceGenerator(ResourceGeneratorBase):
             d = ResourceDefinition(definition_dict['type'], r['name'],
                                    filename_path, storage=storage,
                                    target_platforms=target_platforms,
-                                   aliases=aliases)
+                                   aliases=aliases,
+                                   access_locality=access_locality)
 
             if 'size' in r:
                 d.size = r['size']
@@ -23,6 +23,11 @@ import re
 
 PNG_MIN_APP_MEMORY = 0x8000  # 32k, fairly arbitrarily
 
+# PNGs have to be inflated into a second heap buffer on every load, whereas PBIs are read as they
+# are (or even memory-mapped). Unless told otherwise, only store a bitmap as a PNG if that saves at
+# least this many bytes.
+PNG_MIN_SAVINGS_BYTES = 256
+
 class BitmapResourceGenerator(ResourceGenerator):
     type = 'bitmap'
 
@@ -65,11 +70,16 @@ class BitmapResourceGenerator(ResourceGenerator):
                                          .format(definition.name, definition.space_optimization,
                                                  ', '.join(format_mapping.keys())))
 
+        # With no storage format specified, firmware resources are free to use whichever one is
+        # cheaper to load. SDK apps keep the documented default, switching their bitmaps to PBI
+        # would change their size and how much app memory they take up when loaded.
+        pick_cheapest = False
         if definition.storage_format is None:
             if pebble_platforms[env.PLATFORM_NAME]['MAX_APP_MEMORY_SIZE'] < PNG_MIN_APP_MEMORY:
                 definition.storage_format = 'pbi'
             else:
                 definition.storage_format = 'png'
+                pick_cheapest = 'PEBBLE_SDK_ROOT' not in env
 
         # At this point, what we want to do should be completely determined (though, depending on
         # image content, not necessarily actually possible); begin figuring out what to actually do.
@@ -120,15 +130,18 @@ class BitmapResourceGenerator(ResourceGenerator):
                 task.generator.bld.fatal("{}: can't use more than two bits on a black-and-white"
                                          "platform." .format(definition.name))
 
-            if definition.storage_format == 'pbi':
+            def pbi_bytes():
                 pb = bitmapgen.PebbleBitmap(task.inputs[0].abspath(), bitmap_format='color',
                                             bitdepth=bits, crop=False, palette_name=palette_name)
-                return ResourceObject(definition, pb.convert_to_pbi())
-            else:
-                image_bytes = png2pblpng.convert_png_to_pebble_png_bytes(task.inputs[0].abspath(),
-                                                                         palette_name,
-                                                                         bitdepth=bits)
-                return ResourceObject(definition, image_bytes)
+                return pb.convert_to_pbi()
+
+            def png_bytes():
+                return png2pblpng.convert_png_to_pebble_png_bytes(task.inputs[0].abspath(),
+                                                                  palette_name, bitdepth=bits)
+
+            return ResourceObject(definition,
+                                  cls._generate_data(definition, pick_cheapest,
+                                                     pbi_bytes, png_bytes))
         else:
             if memory_format == '1bit':
                 pb = bitmapgen.PebbleBitmap(task.inputs[0].abspath(), bitmap_format='bw',
@@ -139,13 +152,35 @@ class BitmapResourceGenerator(ResourceGenerator):
                     task.generator.bld.fatal("{}: can't use more than two bits on a black-and-white"
                                              "platform.".format(definition.name))
                 # generate an 8-bit pbi or png, as appropriate.
-                if definition.storage_format == 'pbi':
+                def pbi_bytes():
                     pb = bitmapgen.PebbleBitmap(task.inputs[0].abspath(), bitmap_format='color_raw',
                                                 crop=False, palette_name=palette_name)
-                    return ResourceObject(definition, pb.convert_to_pbi())
-                else:
-                    image_bytes = png2pblpng.convert_png_to_pebble_png_bytes(
+                    return pb.convert_to_pbi()
+
+                def png_bytes():
+                    return png2pblpng.convert_png_to_pebble_png_bytes(
                         task.inputs[0].abspath(), palette_name, bitdepth=8)
-                    return ResourceObject(definition, image_bytes)
+
+                return ResourceObject(definition,
+                                      cls._generate_data(definition, pick_cheapest,
+                                                         pbi_bytes, png_bytes))
 
         raise Exception("Got to the end without doing anything?")
+
+    @staticmethod
+    def _generate_data(definition, pick_cheapest, pbi_bytes, png_bytes):
+        """
+        Generate the bitmap in the requested storage format. If we're free to pick, generate both
+        and only keep the PNG if it is significantly smaller than the PBI.
+        """
+        if definition.storage_format == 'pbi':
+            return pbi_bytes()
+        if not pick_cheapest:
+            return png_bytes()
+
+        pbi_data = pbi_bytes()
+        png_data = png_bytes()
+        if len(pbi_data) - len(png_data) < PNG_MIN_SAVINGS_BYTES:
+            definition.storage_format = 'pbi'
+            return pbi_data
+        return png_data
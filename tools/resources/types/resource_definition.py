@@ -25,7 +25,7 @@ class StorageType(object):
 
 class ResourceDefinition(ResourceDeclaration):
     def __init__(self, type, name, file, storage=StorageType.pbpack,
-                 target_platforms=None, aliases=()):
+                 target_platforms=None, aliases=(), access_locality=None):
         self.type = type
         self.name = name
 
@@ -37,6 +37,10 @@ class ResourceDefinition(ResourceDeclaration):
         self.target_platforms = target_platforms
         self.aliases = list(aliases)
 
+        # Optional hint for laying out the pbpack. Resources with a lower value are expected to be
+        # accessed more often and are kept together at the start of the pack. None means no hint.
+        self.access_locality = access_locality
+
         self.sources = [self.file]
 
     def is_in_target_platform(self, bld):
@@ -19,6 +19,10 @@ from resources.types.resource_definition import StorageType
 
 from pbpack import ResourcePack
 
+# Only the system resource bank gets memory-mapped, align its resources so they can be accessed in
+# place with word loads
+SYSTEM_PBPACK_ALIGNMENT = 4
+
 
 class generate_pbpack(Task.Task):
     def run(self):
@@ -26,10 +30,12 @@ class generate_pbpack(Task.Task):
         resource_objects = [reso for reso in resource_ball.resource_objects
                             if reso.definition.storage == StorageType.pbpack]
 
-        pack = ResourcePack(self.is_system)
+        alignment = SYSTEM_PBPACK_ALIGNMENT if self.is_system else 1
+        pack = ResourcePack(self.is_system, alignment=alignment)
 
         for r in resource_objects:
-            pack.add_resource(r.data)
+            # Resource balls pickled before access hints existed don't have the attribute
+            pack.add_resource(r.data, locality=getattr(r.definition, 'access_locality', None))
 
         with open(self.outputs[0].abspath(), 'wb') as f:
             pack.serialize(f)
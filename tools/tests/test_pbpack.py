@@ -99,6 +99,58 @@ class TestResourcePack(unittest.TestCase):
         self.assertEquals(after_pack.contents[after_pack.table_entries[2].content_index], '')
         self.assertEquals(len(after_pack.table_entries), 3)
 
+    def test_alignment(self):
+        is_system = True
+
+        pack = ResourcePack(is_system, alignment=4)
+        pack.add_resource(b'1')
+        pack.add_resource(b'22')
+        pack.add_resource(b'333')
+        pack.add_resource(b'')
+
+        after_pack = self._test_deserialize_serialize_pack(pack, is_system)
+
+        # Every resource starts on an aligned offset with zero padding in between
+        content = b'1\0\0\0' b'22\0\0' b'333\0'
+        self.assertEqual([e.offset for e in after_pack.table_entries], [0, 4, 8, 12])
+        self.assertEqual(after_pack.serialize_content(), content)
+        self.assertEqual(after_pack.crc, stm32_crc.crc32(content))
+
+    def test_access_locality(self):
+        is_system = False
+
+        pack = ResourcePack(is_system)
+        pack.add_resource(b'1')
+        pack.add_resource(b'22', locality=1)
+        pack.add_resource(b'333', locality=0)
+        pack.add_resource(b'4444', locality=0)
+
+        after_pack = self._test_deserialize_serialize_pack(pack, is_system)
+
+        # Hinted resources come first, but the last resource always stays at the end of the pack
+        self.assertEqual(after_pack.serialize_content(), b'333' b'22' b'1' b'4444')
+        self.assertEqual([e.offset for e in after_pack.table_entries], [5, 3, 0, 6])
+
+    def test_stats_max_size(self):
+        is_system = True
+
+        pack = ResourcePack(is_system, alignment=4)
+        pack.add_resource(b'1')
+        pack.add_resource(b'22')
+        pack.finalize()
+
+        # The padding between the resources counts towards the size of the pack
+        pack_size = pack.content_start + 6
+        with open(os.devnull, 'w') as devnull:
+            stdout = sys.stdout
+            sys.stdout = devnull
+            try:
+                self.assertTrue(pack.dump_stats())
+                self.assertTrue(pack.dump_stats(max_size=pack_size))
+                self.assertFalse(pack.dump_stats(max_size=pack_size - 1))
+            finally:
+                sys.stdout = stdout
+
     def _test_deserialize_serialize_pack(self, pack, is_system):
         """
         Serialize a given pack object to a file and then assert that if we deserialize and
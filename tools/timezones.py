@@ -329,14 +329,32 @@ def zoneinfo_to_bin(zoneinfo_list, dstrule_list, zonelink_list, output_bin):
     # 1 byte + 15 bytes + 2 bytes + 5 bytes + 1 byte = 24 bytes
     # Continent_index City gmt_offset_minutes tz_abbr dst_id
 
+    # The firmware binary searches the regions and links by name, so both tables must be sorted
+    # by name. The regions are written in the order of zoneinfo_list, which is sorted
+    # alphabetically, and the region ids are persisted so that order must not change.
+    region_id_list = [line.split(' ')[0] + "/" + line.split(' ')[1] for line in zoneinfo_list]
+    assert region_id_list == sorted(region_id_list)
+
+    # Resolve each link to its region id, sorted by link name. Links to unknown regions are
+    # dropped. Ties are broken by region id to preserve which duplicate a lookup finds.
+    links = []
+    for line in zonelink_list:
+        target, linkname = line.split(' ')
+        try:
+            region_id = region_id_list.index(target)
+        except ValueError as e:
+            print("Couldn't find region, skipping:", e)
+            continue
+        links.append((linkname, region_id))
+    links.sort()
+
     # Unsigned short - count of entries
     output_bin.write(struct.pack('H', len(zoneinfo_list)))
     # Unsigned short - count of DST rules
     output_bin.write(struct.pack('H', len(dstzone_dict.values())))
     # Unsigned short - count of links
-    output_bin.write(struct.pack('H', len(zonelink_list)))
+    output_bin.write(struct.pack('H', len(links)))
 
-    region_id_list = []
     # write all the timezones to file
     for line in zoneinfo_list:
         continent, region, gmt_offset_minutes, tz_abbr, dst_zone = line.split(' ')
@@ -344,7 +362,6 @@ def zoneinfo_to_bin(zoneinfo_list, dstrule_list, zonelink_list, output_bin):
         # output the timezone continent index
         continent_index = tz_continent_dict[continent]
         output_bin.write(struct.pack('B', continent_index))
-        region_id_list.append(continent+"/"+region)
 
         # fixup and output the timezone region name
         output_bin.write(region.ljust(15, '\0').encode("utf8"))  # 15-character region zero padded
@@ -400,13 +417,7 @@ def zoneinfo_to_bin(zoneinfo_list, dstrule_list, zonelink_list, output_bin):
                 output_bin.write(struct.pack('B', 0))
 
     # write all the timezone links to file
-    for line in zonelink_list:
-        target, linkname = line.split(' ')
-        try:
-            region_id = region_id_list.index(target)
-        except ValueError as e:
-            print("Couldn't find region, skipping:", e)
-            continue
+    for linkname, region_id in links:
         output_bin.write(struct.pack('H', region_id))
         output_bin.write(linkname.ljust(TIMEZONE_LINK_NAME_LENGTH, '\0').encode("utf8"))
 